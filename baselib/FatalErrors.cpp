@@ -28,6 +28,9 @@ static constexpr const char* const UNSPECIFIED_ERROR_STR = "An unspecified/unkno
     } else {
         std::printf("[FATAL ERROR] %s\n", UNSPECIFIED_ERROR_STR);
     }
+
+    // Make sure the message makes it out before terminating, in case standard out is buffered (redirected to a file)
+    std::fflush(stdout);
     
     // Call the user error handler and finish up
     if (gFatalErrorHandler) {
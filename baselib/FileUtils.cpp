@@ -149,6 +149,70 @@ int64_t getFileSize(const char* filePath) noexcept {
     }
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the last modification time of the given file and return '-1' if there is an error.
+// The units and epoch of the time are platform specific, so it is only useful for telling whether a file has changed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+int64_t getFileModTime(const char* filePath) noexcept {
+    ASSERT(filePath);
+
+    try {
+        // MacOS: working around missing support for <filesystem> in everything except the latest bleeding edge OS and Xcode.
+        // Use standard Unix file functions instead for now, but some day this can be removed.
+        #ifdef __APPLE__
+            struct stat fileInfo;
+            
+            if (stat(filePath, &fileInfo) < 0)
+                return -1;
+
+            return (int64_t) fileInfo.st_mtime;
+        #else
+            return (int64_t) std::filesystem::last_write_time(filePath).time_since_epoch().count();
+        #endif
+    } catch (...) {
+        return -1;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Rename the given file, replacing any existing file at the new path. Returns 'true' on success.
+// On POSIX systems the replacement is atomic: anything which already has the old file at the new path open or mapped keeps seeing it.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool renameFile(const char* const oldFilePath, const char* const newFilePath) noexcept {
+    ASSERT(oldFilePath);
+    ASSERT(newFilePath);
+
+    try {
+        // MacOS: working around missing support for <filesystem> in everything except the latest bleeding edge OS and Xcode.
+        // Use standard Unix file functions instead for now, but some day this can be removed.
+        #ifdef __APPLE__
+            return (std::rename(oldFilePath, newFilePath) == 0);
+        #else
+            std::filesystem::rename(oldFilePath, newFilePath);
+            return true;
+        #endif
+    } catch (...) {
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Delete the given file and return 'true' if it was deleted
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool removeFile(const char* const filePath) noexcept {
+    ASSERT(filePath);
+
+    try {
+        #ifdef __APPLE__
+            return (std::remove(filePath) == 0);
+        #else
+            return std::filesystem::remove(filePath);
+        #endif
+    } catch (...) {
+        return false;
+    }
+}
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Given a file or folder path, return the parent folder path or an empty string if there is no parent.
 // Accepts POSIX or Windows style separators (forward or backward slash) in the path only.
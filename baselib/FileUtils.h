@@ -33,6 +33,9 @@ bool writeDataToFile(
 
 bool fileExists(const char* filePath) noexcept;
 int64_t getFileSize(const char* filePath) noexcept;
+int64_t getFileModTime(const char* filePath) noexcept;
+bool renameFile(const char* const oldFilePath, const char* const newFilePath) noexcept;
+bool removeFile(const char* const filePath) noexcept;
 void getParentPath(const char* path, std::string& parentPath) noexcept;
 
 END_NAMESPACE(FileUtils)
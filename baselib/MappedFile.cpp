@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Read only memory mapping of files
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "MappedFile.h"
+
+#include "Asserts.h"
+
+#if _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile() noexcept
+    : mpData(nullptr)
+    , mSize(0)
+    , mpFileHandle(nullptr)
+    , mpMapHandle(nullptr)
+{
+}
+
+MappedFile::~MappedFile() noexcept {
+    close();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Map the given file into memory, closing any previously mapped file first.
+// Returns 'false' on failure, which includes trying to map an empty file.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool MappedFile::open(const char* const filePath) noexcept {
+    ASSERT(filePath);
+    close();
+
+    #if _WIN32
+        // Open the file and get it's size
+        const HANDLE hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (hFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize = {};
+
+        if ((!GetFileSizeEx(hFile, &fileSize)) || (fileSize.QuadPart <= 0) || ((uint64_t) fileSize.QuadPart > SIZE_MAX)) {
+            CloseHandle(hFile);
+            return false;
+        }
+
+        // Create the mapping and map a view of the whole file
+        const HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (!hMapping) {
+            CloseHandle(hFile);
+            return false;
+        }
+
+        const void* const pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (!pData) {
+            CloseHandle(hMapping);
+            CloseHandle(hFile);
+            return false;
+        }
+
+        mpFileHandle = hFile;
+        mpMapHandle = hMapping;
+        mpData = (const std::byte*) pData;
+        mSize = (size_t) fileSize.QuadPart;
+    #else
+        // Open the file and get it's size.
+        // Note: the file descriptor can be closed straight after mapping, the mapping keeps the file referenced.
+        const int fd = ::open(filePath, O_RDONLY);
+
+        if (fd < 0)
+            return false;
+
+        struct stat fileStat = {};
+
+        if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size <= 0) || ((uint64_t) fileStat.st_size > SIZE_MAX)) {
+            ::close(fd);
+            return false;
+        }
+
+        void* const pData = mmap(nullptr, (size_t) fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (pData == MAP_FAILED)
+            return false;
+
+        mpData = (const std::byte*) pData;
+        mSize = (size_t) fileStat.st_size;
+    #endif
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Unmap the currently mapped file, if any
+//------------------------------------------------------------------------------------------------------------------------------------------
+void MappedFile::close() noexcept {
+    #if _WIN32
+        if (mpData) {
+            UnmapViewOfFile(mpData);
+        }
+
+        if (mpMapHandle) {
+            CloseHandle((HANDLE) mpMapHandle);
+        }
+
+        if (mpFileHandle) {
+            CloseHandle((HANDLE) mpFileHandle);
+        }
+    #else
+        if (mpData) {
+            munmap((void*) mpData, mSize);
+        }
+    #endif
+
+    mpData = nullptr;
+    mSize = 0;
+    mpFileHandle = nullptr;
+    mpMapHandle = nullptr;
+}
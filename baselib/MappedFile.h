@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Macros.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A read only view of an entire file that is memory mapped into the address space of the process.
+// The file contents are paged in on demand by the OS as they are accessed, rather than being read up front.
+//------------------------------------------------------------------------------------------------------------------------------------------
+class MappedFile {
+public:
+    MappedFile() noexcept;
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator = (const MappedFile& other) = delete;
+    ~MappedFile() noexcept;
+
+    bool open(const char* const filePath) noexcept;
+    void close() noexcept;
+
+    inline bool isOpen() const noexcept { return (mpData != nullptr); }
+    inline const std::byte* getData() const noexcept { return mpData; }
+    inline size_t getSize() const noexcept { return mSize; }
+
+private:
+    const std::byte*    mpData;         // The mapped file data or null if nothing is mapped
+    size_t              mSize;          // Size of the mapped file data
+    void*               mpFileHandle;   // Windows only: handle to the file which is mapped
+    void*               mpMapHandle;    // Windows only: handle to the file mapping object
+};
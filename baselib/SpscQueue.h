@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A fixed capacity, lock-free queue for passing items from one producer thread to one consumer thread.
+// Only the producer thread may call 'push' and only the consumer thread may call 'front' and 'pop'.
+// The capacity must be a power of two.
+//------------------------------------------------------------------------------------------------------------------------------------------
+template <class T, uint32_t Capacity>
+class SpscQueue {
+public:
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0), "Capacity must be a power of two!");
+
+    SpscQueue() noexcept
+        : mHead(0)
+        , mTail(0)
+        , mItems()
+    {
+    }
+
+    // Add an item to the end of the queue. Returns 'false' if the queue is full.
+    bool push(const T& item) noexcept {
+        const uint32_t tail = mTail.load(std::memory_order_relaxed);
+
+        if (tail - mHead.load(std::memory_order_acquire) >= Capacity)
+            return false;
+
+        mItems[tail & (Capacity - 1)] = item;
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Get the item at the front of the queue, or null if the queue is empty
+    const T* front() const noexcept {
+        const uint32_t head = mHead.load(std::memory_order_relaxed);
+
+        if (head == mTail.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &mItems[head & (Capacity - 1)];
+    }
+
+    // Remove the item at the front of the queue, which must not be empty
+    void pop() noexcept {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    // Note: the read and write positions are kept on separate cache lines so the two threads do not contend over them
+    alignas(64) std::atomic<uint32_t>   mHead;      // Where the consumer reads from next: only written by the consumer
+    alignas(64) std::atomic<uint32_t>   mTail;      // Where the producer writes to next: only written by the producer
+    alignas(64) T                       mItems[Capacity];
+};
@@ -3,13 +3,30 @@
 # Used for automated testing of the game.
 #
 # Usage:
-#   python run_demo_tests.py <demoset|all> <psydoom_path> <demos_dir>
+#   python run_demo_tests.py <demoset|all> <psydoom_path> <demos_dir> [options]
+#
+# Options:
+#   --jobs <num>            How many demos to run at once. Defaults to the number of CPUs on the machine.
+#   --filter <text>         Only run demos with file names containing the given text.
+#   --json <file>           Save a report of the results in JSON format to the given file.
+#   --junit <file>          Save a report of the results in JUnit XML format to the given file, for consumption by CI systems.
+#   --logdir <dir>          Save the output of each PsyDoom process to the given directory ('<demo name>.log').
+#   --tracedir <dir>        Save a trace of the game state for each tick of each demo to the given directory ('<demo name>.trace').
+#   --reftracedir <dir>     Compare the trace for each demo against the reference trace with the same name in the given directory.
+#                           Reports the first tick where the game state differs and fails the demo if there is a difference, even if
+#                           the end result matches. Requires '--tracedir' also.
+#
+# Returns '0' if all of the demos that were run passed.
 ############################################################################################################################################
+import argparse
+import json
 import multiprocessing
 import os
+import re
 import subprocess
 import sys
 import time
+from xml.sax.saxutils import quoteattr
 
 # These are the lists of demo sets and expected result files
 demosets = {
@@ -75,45 +92,175 @@ demosets = {
     },
 }
 
-# This function executes the demo in a worker process
-def run_demo(psydoom_path, cue_file_path, demos_dir, demo_and_result):
-    # Show what demo we are about to run
+# Look through the output of a PsyDoom process for the reason a demo failed or errored
+def get_failure_reason(output):
+    for line in output.splitlines():
+        if line.startswith("[FATAL ERROR]") or line.startswith("Demo result") or line.startswith("Failed to"):
+            return line.rstrip()
+
+    return ""
+
+# Run PsyDoom with the given arguments and return the exit code and all of the output.
+# Exit codes are negative if PsyDoom was terminated abnormally (by a signal), as per 'subprocess'.
+def run_psydoom(psydoom_path, args):
+    process = subprocess.run(
+        [psydoom_path] + args,
+        shell=False,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        universal_newlines=True,
+        errors="replace"
+    )
+    return process.returncode, process.stdout
+
+# Compare the trace recorded for the demo against the reference trace for it (if there is one) to find the first tick where it diverges.
+# If there is a divergence then the demo is failed, even if the end result matches.
+def compare_demo_traces(psydoom_path, result, ref_trace_dir):
+    ref_trace_path = os.path.join(ref_trace_dir, result["name"] + ".trace")
+
+    if not os.path.isfile(ref_trace_path):
+        return
+
+    # PsyDoom does the comparison and prints the divergence, if any ('1' is returned in that case)
+    exit_code, output = run_psydoom(psydoom_path, ["-comparetraces", ref_trace_path, result["traceFile"]])
+
+    if exit_code != 1:
+        return
+
+    for line in output.splitlines():
+        match = re.match(r"Traces diverge at tick (-?\d+)", line)
+
+        if match:
+            result["divergenceTick"] = int(match.group(1))
+
+            if result["status"] == "passed":
+                result["status"] = "failed"
+                result["message"] = line.rstrip()
+            else:
+                result["message"] = (result["message"] + " " + line.rstrip()).strip()
+
+            break
+
+# This function executes the demo in a worker process and returns the result
+def run_demo(job):
+    psydoom_path, cue_file_path, demos_dir, demo_and_result, options = job
     demo_path = os.path.join(demos_dir, demo_and_result[0])
     result_path = os.path.join(demos_dir, demo_and_result[1])
+    demo_name = os.path.splitext(demo_and_result[0])[0]
+
+    result = {
+        "name" : demo_name,
+        "demoFile" : demo_path,
+        "resultFile" : result_path,
+        "cueFile" : cue_file_path,
+        "message" : ""
+    }
 
     # Execute the demo using PsyDoom in headless mode and verify the result.
-    # PsyDoom will return '0' if the demo was successful.
-    result = subprocess.call(
-        [psydoom_path, "-cue", cue_file_path, "-headless", "-playdemo", demo_path, "-checkresult", result_path],
-        shell=False,
-        stdout=subprocess.PIPE,     # Hide output
-        stderr=subprocess.PIPE      # Hide output
-    )
+    # PsyDoom will return '0' if the demo was successful, '1' if the demo result did not match and anything else is an error.
+    args = ["-cue", cue_file_path, "-headless", "-playdemo", demo_path, "-checkresult", result_path]
+
+    if options["tracedir"]:
+        result["traceFile"] = os.path.join(options["tracedir"], demo_name + ".trace")
+        args += ["-savetrace", result["traceFile"]]
+
+    start_time = time.time()
+    exit_code, output = run_psydoom(psydoom_path, args)
+    result["durationSecs"] = time.time() - start_time
+    result["exitCode"] = exit_code
+    result["crashed"] = (exit_code < 0)
 
-    # If the test failed (error code != 0) then inform the user.
-    # Otherwise print that the test succeeded
-    if result == 0:
-        print("Test passed: {0:s}".format(demo_path))
+    if options["logdir"]:
+        result["logFile"] = os.path.join(options["logdir"], demo_name + ".log")
+
+        with open(result["logFile"], "w") as log_file:
+            log_file.write(output)
+
+    if exit_code == 0:
+        result["status"] = "passed"
     else:
-        print("[TEST FAIL] Unexpected demo result!: {0:s}".format(demo_path))
-        sys.exit(1)
+        result["message"] = get_failure_reason(output)
 
-# High level script logic
-def main():    
-    # Verify program args
-    if len(sys.argv) != 4:
-        print("Usage: python run_demo_tests.py <demoset|all> <psydoom_path> <demos_dir>")
-        sys.exit(1)
+        if (exit_code == 1) and (not result["message"].startswith("[FATAL ERROR]")):
+            result["status"] = "failed"
+            result["message"] = result["message"] or "Demo result does not match the expected result"
+        else:
+            result["status"] = "error"
+
+            if not result["message"]:
+                if exit_code < 0:
+                    result["message"] = "PsyDoom was terminated by signal {0:d}".format(-exit_code)
+                else:
+                    result["message"] = "PsyDoom exited with code {0:d}".format(exit_code)
+
+    # Find where the demo first diverges from the reference, if possible
+    if options["tracedir"] and options["reftracedir"]:
+        compare_demo_traces(psydoom_path, result, options["reftracedir"])
 
-    psydoom_path = sys.argv[2]
-    demos_dir = sys.argv[3]
+    return result
+
+# Save the results of running all the demos to a JSON file
+def save_json_report(results, json_path):
+    report = {
+        "numDemos" : len(results),
+        "numPassed" : sum(1 for result in results if result["status"] == "passed"),
+        "numFailed" : sum(1 for result in results if result["status"] == "failed"),
+        "numErrors" : sum(1 for result in results if result["status"] == "error"),
+        "demos" : results
+    }
+
+    with open(json_path, "w") as json_file:
+        json.dump(report, json_file, indent=4)
+
+# Save the results of running all the demos to a JUnit XML file
+def save_junit_report(results, xml_path):
+    num_failed = sum(1 for result in results if result["status"] == "failed")
+    num_errors = sum(1 for result in results if result["status"] == "error")
+    total_secs = sum(result["durationSecs"] for result in results)
+
+    with open(xml_path, "w") as xml_file:
+        xml_file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n")
+        xml_file.write(
+            "<testsuite name=\"PsyDoomDemos\" tests=\"{0:d}\" failures=\"{1:d}\" errors=\"{2:d}\" time=\"{3:.3f}\">\n".format(
+                len(results), num_failed, num_errors, total_secs
+            )
+        )
+
+        for result in results:
+            xml_file.write(
+                "    <testcase classname=\"PsyDoomDemos\" name={0:s} time=\"{1:.3f}\"".format(quoteattr(result["name"]), result["durationSecs"])
+            )
+
+            if result["status"] == "failed":
+                xml_file.write(">\n        <failure message={0:s}/>\n    </testcase>\n".format(quoteattr(result["message"])))
+            elif result["status"] == "error":
+                xml_file.write(">\n        <error message={0:s}/>\n    </testcase>\n".format(quoteattr(result["message"])))
+            else:
+                xml_file.write("/>\n")
+
+        xml_file.write("</testsuite>\n")
+
+# High level script logic
+def main():
+    # Parse and verify program args
+    arg_parser = argparse.ArgumentParser(description="Runs sets of demos against PsyDoom in headless mode, verifying each demo result.")
+    arg_parser.add_argument("demoset", help="The demo set to run, or 'all'. One of: " + ", ".join(demosets.keys()))
+    arg_parser.add_argument("psydoom_path")
+    arg_parser.add_argument("demos_dir")
+    arg_parser.add_argument("--jobs", type=int, default=multiprocessing.cpu_count())
+    arg_parser.add_argument("--filter", default="")
+    arg_parser.add_argument("--json", default="")
+    arg_parser.add_argument("--junit", default="")
+    arg_parser.add_argument("--logdir", default="")
+    arg_parser.add_argument("--tracedir", default="")
+    arg_parser.add_argument("--reftracedir", default="")
+    args = arg_parser.parse_args()
 
     # Verify demoset argument is okay or 'all' is specified
-    demoset_arg = sys.argv[1]
-    single_demoset = demosets.get(demoset_arg)
+    single_demoset = demosets.get(args.demoset)
 
-    if not single_demoset and demoset_arg != "all":
-        print("Invalid demoset '{0:s}'!".format(demoset_arg))
+    if not single_demoset and args.demoset != "all":
+        print("Invalid demoset '{0:s}'!".format(args.demoset))
         sys.exit(1)
 
     if single_demoset:
@@ -121,24 +268,51 @@ def main():
     else:
         run_demosets = demosets.values()
 
-    # Start running the demos and verify they match the expected results
-    all_tests_passed = True
-    start_time = time.time()
+    if args.jobs <= 0:
+        print("Invalid number of jobs '{0:d}'!".format(args.jobs))
+        sys.exit(1)
+
+    if args.reftracedir and not args.tracedir:
+        print("The '--reftracedir' option requires '--tracedir' also!")
+        sys.exit(1)
+
+    for output_dir in [ args.logdir, args.tracedir ]:
+        if output_dir:
+            os.makedirs(output_dir, exist_ok=True)
+
+    # Gather up all the demos to run
+    options = { "logdir" : args.logdir, "tracedir" : args.tracedir, "reftracedir" : args.reftracedir }
     jobs = []
 
     for demoset in run_demosets:
         for demo_and_result in demoset["tests"]:
-            job = multiprocessing.Process(
-                target=run_demo,
-                args=(psydoom_path, demoset["cue_file"], demos_dir, demo_and_result)
-            )
-            job.start()
-            jobs.append(job)
+            if args.filter in demo_and_result[0]:
+                jobs.append((args.psydoom_path, demoset["cue_file"], args.demos_dir, demo_and_result, options))
+
+    # Start running the demos and verify they match the expected results, reporting each result as it comes in
+    start_time = time.time()
+    results = []
+
+    with multiprocessing.Pool(processes=args.jobs) as pool:
+        for result in pool.imap_unordered(run_demo, jobs):
+            results.append(result)
 
-    for job in jobs:
-        job.join()
-        if job.exitcode != 0:
-            all_tests_passed = False
+            if result["status"] == "passed":
+                print("Test passed: {0:s} ({1:.2f}s)".format(result["demoFile"], result["durationSecs"]))
+            else:
+                print("[TEST FAIL] {0:s}: {1:s}".format(result["demoFile"], result["message"]))
+
+            sys.stdout.flush()
+
+    results.sort(key=lambda result: result["name"])
+    all_tests_passed = all(result["status"] == "passed" for result in results)
+
+    # Save reports if requested
+    if args.json:
+        save_json_report(results, args.json)
+
+    if args.junit:
+        save_junit_report(results, args.junit)
 
     # Print the overall result
     if all_tests_passed:
@@ -150,6 +324,9 @@ def main():
     time_taken = time.time() - start_time
     print("Time taken: {0:f} seconds".format(time_taken))
 
+    if not all_tests_passed:
+        sys.exit(1)
+
 # This is required for correct parallelism on Windows.
 # See: https://stackoverflow.com/questions/18204782/runtimeerror-on-windows-trying-python-multiprocessing
 if __name__ == '__main__':
@@ -2,6 +2,7 @@
 
 #include "i_drawcmds.h"
 #include "i_main.h"
+#include "PcPsx/ProgArgs.h"
 #include "PcPsx/Utils.h"
 #include "PcPsx/Video.h"
 #include "PsyQ/LIBETC.h"
@@ -16,6 +17,11 @@
 // PsyDoom: this function has been rewritten, for the original version see the 'Old' folder.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void I_CrossFadeFrameBuffers() noexcept {
+    // Nothing to display in headless mode.
+    // This must also be skipped because the wait loop below polls 'I_GetTotalVBlanks', which never advances in headless mode without a present.
+    if (ProgArgs::gbHeadlessMode)
+        return;
+
     // Clear out what we can from the texture cache
     I_PurgeTexCache();
 
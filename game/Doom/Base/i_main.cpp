@@ -14,6 +14,7 @@
 #include "PcPsx/Game.h"
 #include "PcPsx/Input.h"
 #include "PcPsx/Network.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/PsxPadButtons.h"
 #include "PcPsx/PsxVm.h"
@@ -28,6 +29,7 @@
 #include "z_zone.h"
 
 #include <algorithm>
+#include <cstdio>
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Texture cache related stuff.
@@ -59,6 +61,8 @@
 //      Map floor and wall textures are placed in 'locked' pages so that they are never unloaded during level gameplay.
 //  (10) Lastly it is worth mentioning that since textures in unlocked pages can be evicted at any time, these textures must also be
 //       backed up and retained in main RAM. So essentially the renderer needs to keep a copy of all sprite data in main RAM also.
+//  (11) PsyDoom: points (7) and (8) no longer apply. The whole cache is searched for a free space and if there is none, the least
+//       recently used textures are evicted to make room. See 'I_FindTexCacheLocation' for more details.
 //------------------------------------------------------------------------------------------------------------------------------------------
 struct tcachepage_t {
     texture_t* cells[TCACHE_CELLS_Y][TCACHE_CELLS_X];
@@ -106,6 +110,18 @@ uint32_t    gTCacheFillRowCellH;
 // Sprites on the other hand are placed in 'unlocked' texture pages and can be evicted at any time.
 uint32_t gLockedTexPagesMask;
 
+#if PSYDOOM_MODS
+    // PsyDoom: texture cache statistics for the frame currently being drawn.
+    // If requested via '-tcachestats' these are also summed up over the level, along with the number of frames and the peak residency.
+    tcachestats_t           gTCacheStats;
+    static tcachestats_t    gTCacheLevelStats;
+    static int32_t          gTCacheLevelNumFrames;
+    static int32_t          gTCacheLevelPeakResidentCells;
+
+    // PsyDoom: how many frames a texture must go unused for before it is considered as old as possible, when choosing what to evict
+    static constexpr uint32_t TCACHE_LRU_MAX_AGE = 64;
+#endif
+
 // A 64-KB buffer used for WAD loading and other stuff
 std::byte gTmpBuffer[TMP_BUFFER_SIZE];
 
@@ -114,6 +130,13 @@ uint32_t gTotalVBlanks;
 uint32_t gLastTotalVBlanks;
 uint32_t gElapsedVBlanks;
 
+// PsyDoom: a virtual vblank clock used instead of real time in headless mode.
+// It only advances when a frame is presented, by exactly one demo tick, so demos play back as fast as possible but tick the same way.
+// Note: waiting on this clock without presenting will never finish, see 'I_GetTotalVBlanks'.
+#if PSYDOOM_MODS
+    static int32_t gHeadlessTotalVBlanks;
+#endif
+
 // The index of the currently displaying framebuffer, 0 or 1
 uint32_t gCurDispBufferIdx;
 
@@ -520,13 +543,104 @@ void I_DrawLoadingPlaque(texture_t& tex, const int16_t xpos, const int16_t ypos,
     I_DrawSprite(tex.texPageId, clutId, xpos, ypos, tex.texPageCoordX, tex.texPageCoordY, tex.width, tex.height);
     I_SubmitGpuCmds();
     I_DrawPresent();
+
+    // PsyDoom: if frames are pipelined then the plaque would only be shown on the next present, show it now before the long operation
+    #if PSYDOOM_MODS
+        if (PsxVm::gbFramePipelining) {
+            Video::displayFramebuffer();
+        }
+    #endif
 }
 
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: counts the textures and cells currently resident in the texture cache, for the texture cache stats of the current frame
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void I_UpdateTexCacheResidencyStats() noexcept {
+    gTCacheStats.numResidentTextures = 0;
+    gTCacheStats.numResidentCells = 0;
+
+    if (!gpTexCache)
+        return;
+
+    for (tcachepage_t& page : gpTexCache->pages) {
+        texture_t** pCacheEntry = &page.cells[0][0];
+
+        for (uint32_t cellIdx = 0; cellIdx < NUM_TCACHE_PAGE_CELLS; ++cellIdx, ++pCacheEntry) {
+            const texture_t* const pCellTex = *pCacheEntry;
+
+            if (!pCellTex)
+                continue;
+
+            gTCacheStats.numResidentCells++;
+
+            // Count each texture only once, at it's top left cell
+            if (pCellTex->ppTexCacheEntries == pCacheEntry) {
+                gTCacheStats.numResidentTextures++;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: resets the texture cache statistics summed up over the level
+//------------------------------------------------------------------------------------------------------------------------------------------
+void I_ResetTexCacheLevelStats() noexcept {
+    gTCacheLevelStats = {};
+    gTCacheLevelNumFrames = 0;
+    gTCacheLevelPeakResidentCells = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: prints the texture cache statistics summed up over the level, if they were requested via '-tcachestats'
+//------------------------------------------------------------------------------------------------------------------------------------------
+void I_PrintTexCacheLevelStats() noexcept {
+    if ((!ProgArgs::gbTexCacheStats) || (gTCacheLevelNumFrames <= 0))
+        return;
+
+    const double numFrames = gTCacheLevelNumFrames;
+
+    std::printf(
+        "Map %d texture cache: %d frames, %d uploads (%.2f/frame, %d cells), %d evictions (%d forced), "
+        "avg resident %.1f textures / %.1f cells, peak %d of %u cells\n",
+        gGameMap,
+        gTCacheLevelNumFrames,
+        gTCacheLevelStats.numUploads,
+        gTCacheLevelStats.numUploads / numFrames,
+        gTCacheLevelStats.numUploadedCells,
+        gTCacheLevelStats.numEvictions,
+        gTCacheLevelStats.numForcedEvictions,
+        gTCacheLevelStats.numResidentTextures / numFrames,
+        gTCacheLevelStats.numResidentCells / numFrames,
+        gTCacheLevelPeakResidentCells,
+        NUM_TCACHE_PAGES * NUM_TCACHE_PAGE_CELLS
+    );
+}
+#endif
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Increments the 'drawn frame' counter used to track texture cache overflows
 //------------------------------------------------------------------------------------------------------------------------------------------
 void I_IncDrawnFrameCount() noexcept {
     gNumFramesDrawn++;
+
+    // PsyDoom: finish up the texture cache stats for the frame and start collecting them for the next one.
+    // Only count resident textures (which means visiting every cell in the cache) and add to the totals for the level if requested.
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbTexCacheStats) {
+            I_UpdateTexCacheResidencyStats();
+            gTCacheLevelStats.numUploads += gTCacheStats.numUploads;
+            gTCacheLevelStats.numUploadedCells += gTCacheStats.numUploadedCells;
+            gTCacheLevelStats.numEvictions += gTCacheStats.numEvictions;
+            gTCacheLevelStats.numForcedEvictions += gTCacheStats.numForcedEvictions;
+            gTCacheLevelStats.numResidentTextures += gTCacheStats.numResidentTextures;
+            gTCacheLevelStats.numResidentCells += gTCacheStats.numResidentCells;
+            gTCacheLevelNumFrames++;
+            gTCacheLevelPeakResidentCells = std::max(gTCacheLevelPeakResidentCells, gTCacheStats.numResidentCells);
+        }
+
+        gTCacheStats = {};
+    #endif
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -534,8 +648,34 @@ void I_IncDrawnFrameCount() noexcept {
 // Also does framerate limiting to 30 Hz and updates the elapsed vblank count, which feeds the game's timing system.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void I_DrawPresent() noexcept {
-    // Finish up all in-flight drawing commands
-    LIBGPU_DrawSync(0);
+    PROFILE_SCOPE("I_DrawPresent");
+
+    // PsyDoom: in headless mode there is nothing to display and no waiting for time to pass.
+    // Just advance the virtual vblank clock by one demo tick and register that time as elapsed.
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbHeadlessMode) {
+            const int32_t headlessTickVBlanks = (Game::gSettings.bUsePalTimings) ? 3 : VBLANKS_PER_TIC;
+            gHeadlessTotalVBlanks += headlessTickVBlanks;
+            gTotalVBlanks = gHeadlessTotalVBlanks;
+            gElapsedVBlanks = headlessTickVBlanks;
+            gLastTotalVBlanks = gTotalVBlanks;
+            return;
+        }
+    #endif
+
+    // PsyDoom: if frames are pipelined then don't wait for drawing to finish here, just show the previous frame.
+    // The previous frame has most likely finished drawing in the background while the game was busy working on this one, and this frame
+    // continues drawing in the background while the game works on the next. The framebuffers are swapped below as normal.
+    #if PSYDOOM_MODS
+        if (PsxVm::gbFramePipelining) {
+            Video::displayFramebuffer();
+        } else {
+            LIBGPU_DrawSync(0);
+        }
+    #else
+        // Finish up all in-flight drawing commands
+        LIBGPU_DrawSync(0);
+    #endif
 
     // Wait until a VBlank occurs to swap the framebuffers.
     // PsyDoom: Note: this call now does nothing as that would inferfere with frame pacing - here just for historical reference!
@@ -546,9 +686,11 @@ void I_DrawPresent() noexcept {
     LIBGPU_PutDrawEnv(gDrawEnvs[gCurDispBufferIdx]);
     LIBGPU_PutDispEnv(gDispEnvs[gCurDispBufferIdx]);
 
-    // PsyDoom: copy the PSX framebuffer to the display
+    // PsyDoom: copy the PSX framebuffer to the display (if not pipelining frames, that is done at the start of the next present)
     #if PSYDOOM_MODS
-        Video::displayFramebuffer();
+        if (!PsxVm::gbFramePipelining) {
+            Video::displayFramebuffer();
+        }
     #endif
 
     // How many vblanks there are in a demo tick
@@ -644,9 +786,125 @@ void I_Init() noexcept {
     I_PurgeTexCache();
 }
 
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: get the cost of evicting whatever occupies the given texture cache cell, for deciding where to put a texture in the cache.
+// Free cells cost nothing and the cost of occupied cells is higher the more recently the occupying texture was used.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t I_GetTexCacheCellCost(const texture_t* const pCellTex) noexcept {
+    if (!pCellTex)
+        return 0;
+
+    const uint32_t age = (pCellTex->uploadFrameNum != TEX_INVALID_UPLOAD_FRAME_NUM) ?
+        gNumFramesDrawn - pCellTex->uploadFrameNum :
+        TCACHE_LRU_MAX_AGE;
+
+    return 1 + (int32_t)(TCACHE_LRU_MAX_AGE - std::min(age, TCACHE_LRU_MAX_AGE));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: finds where to put the given texture in the texture cache and sets the fill location ('gTCacheFillPage' etc.) to that spot.
+// This replaces the original search, which moved a fill location across and down through the cache pages and evicted whatever was in the
+// way, regardless of how recently it was used, and which failed with a 'Texture Cache Overflow' error on finding textures used this frame.
+//
+// The search works as follows:
+//  (1) Every position in every unlocked page is considered, starting with the page the last texture was put in.
+//  (2) Within a page, positions are tried from the top left across and downwards, and the first completely free position is used.
+//      Trying pages in order means the texture cache still fills up page by page, which the level setup code relies on.
+//  (3) If no free position exists then the position with the lowest eviction cost is used, where the cost of each occupied cell is
+//      higher the more recently the occupying texture was used. This evicts the least recently used textures first.
+//  (4) Textures with power of two dimensions are aligned to multiples of their size, like the original level setup code arranged for.
+//      Wall and floor textures are drawn with a texture window for wrapping and the window offset must be aligned to the window size.
+//  (5) Positions occupied by textures already used this frame are only used if there is no other choice. Evicting those textures is
+//      safe because uploads to VRAM wait for any queued drawing to finish, but the textures may need to be uploaded again this frame.
+//
+// Summed area tables of the cell costs for each page are used so that the cost of each position can be found quickly.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void I_FindTexCacheLocation(const texture_t& tex) noexcept {
+    const uint32_t lockedTPages = gLockedTexPagesMask;
+
+    // If all the pages are locked there is nowhere to put the texture
+    if ((lockedTPages & ALL_TPAGES_MASK) == ALL_TPAGES_MASK) {
+        I_Error("Texture Cache Overflow\n");
+    }
+
+    const int32_t texW = tex.width16;
+    const int32_t texH = tex.height16;
+    const int32_t maxCellX = (int32_t) TCACHE_CELLS_X - texW;
+    const int32_t maxCellY = (int32_t) TCACHE_CELLS_Y - texH;
+    const int32_t alignX = ((texW > 0) && ((texW & (texW - 1)) == 0)) ? texW : 1;
+    const int32_t alignY = ((texH > 0) && ((texH & (texH - 1)) == 0)) ? texH : 1;
+
+    // The best position found so far, and it's cost.
+    // Positions with textures used this frame are only considered if there is no other choice.
+    uint32_t bestPage = gTCacheFillPage;
+    int32_t bestCellX = 0;
+    int32_t bestCellY = 0;
+    bool bBestUsedThisFrame = true;
+    int32_t bestCost = INT32_MAX;
+
+    for (uint32_t pageOffset = 0; pageOffset < NUM_TCACHE_PAGES; ++pageOffset) {
+        const uint32_t pageIdx = (gTCacheFillPage + pageOffset) % NUM_TCACHE_PAGES;
+
+        if ((lockedTPages >> pageIdx) & 1)
+            continue;
+
+        // Build summed area tables of the eviction cost for each cell and of the cells with textures used this frame
+        int32_t costSums[TCACHE_CELLS_Y + 1][TCACHE_CELLS_X + 1] = {};
+        int32_t usedSums[TCACHE_CELLS_Y + 1][TCACHE_CELLS_X + 1] = {};
+        const tcachepage_t& page = gpTexCache->pages[pageIdx];
+
+        for (int32_t y = 0; y < (int32_t) TCACHE_CELLS_Y; ++y) {
+            for (int32_t x = 0; x < (int32_t) TCACHE_CELLS_X; ++x) {
+                const texture_t* const pCellTex = page.cells[y][x];
+                const int32_t bUsedThisFrame = (pCellTex && (pCellTex->uploadFrameNum == gNumFramesDrawn));
+
+                costSums[y + 1][x + 1] = I_GetTexCacheCellCost(pCellTex) + costSums[y][x + 1] + costSums[y + 1][x] - costSums[y][x];
+                usedSums[y + 1][x + 1] = bUsedThisFrame + usedSums[y][x + 1] + usedSums[y + 1][x] - usedSums[y][x];
+            }
+        }
+
+        // Find the best position in this page
+        for (int32_t y = 0; y <= maxCellY; y += alignY) {
+            for (int32_t x = 0; x <= maxCellX; x += alignX) {
+                const int32_t x2 = x + texW;
+                const int32_t y2 = y + texH;
+                const int32_t cost = costSums[y2][x2] - costSums[y][x2] - costSums[y2][x] + costSums[y][x];
+                const bool bUsedThisFrame = (usedSums[y2][x2] - usedSums[y][x2] - usedSums[y2][x] + usedSums[y][x] > 0);
+
+                const bool bIsBetter = (bBestUsedThisFrame && (!bUsedThisFrame)) || (
+                    (bBestUsedThisFrame == bUsedThisFrame) && (cost < bestCost)
+                );
+
+                if (!bIsBetter)
+                    continue;
+
+                bestPage = pageIdx;
+                bestCellX = x;
+                bestCellY = y;
+                bBestUsedThisFrame = bUsedThisFrame;
+                bestCost = cost;
+
+                // Can't do better than a completely free position
+                if (cost == 0)
+                    goto found_location;
+            }
+        }
+    }
+
+found_location:
+    gTCacheFillPage = bestPage;
+    gTCacheFillCellX = bestCellX;
+    gTCacheFillCellY = bestCellY;
+    gTCacheFillRowCellH = 0;
+}
+
+#endif  // #if PSYDOOM_MODS
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Upload the specified texture into VRAM if it's not already resident.
 // If there's no more room for textures in VRAM for this frame then the game will die with an error.
+// PsyDoom: the least recently used textures are now evicted to make room instead, see 'I_FindTexCacheLocation' for more details.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void I_CacheTex(texture_t& tex) noexcept {
     // First update the frame the texture was added to the cache, for tracking overflows
@@ -656,6 +914,41 @@ void I_CacheTex(texture_t& tex) noexcept {
     if (tex.texPageId != 0)
         return;
 
+    // PsyDoom: find where to put the texture with a search of the whole texture cache, evicting the least recently used textures if needed.
+    // This never fails with a 'Texture Cache Overflow' error unless all texture pages are locked.
+    #if PSYDOOM_MODS
+        I_FindTexCacheLocation(tex);
+
+        tcache_t& tcache = *gpTexCache;
+        texture_t** const pTexStartCacheCell = &tcache.pages[gTCacheFillPage].cells[gTCacheFillCellY][gTCacheFillCellX];
+
+        {
+            texture_t** pCacheEntry = pTexStartCacheCell;
+
+            for (int32_t y = 0; y < tex.height16; ++y) {
+                for (int32_t x = 0; x < tex.width16; ++x) {
+                    texture_t* const pCellTex = *pCacheEntry;
+                    ++pCacheEntry;
+
+                    if (!pCellTex)
+                        continue;
+
+                    gTCacheStats.numEvictions++;
+
+                    if (pCellTex->uploadFrameNum == gNumFramesDrawn) {
+                        gTCacheStats.numForcedEvictions++;
+                    }
+
+                    I_RemoveTexCacheEntry(*pCellTex);
+                }
+
+                pCacheEntry += TCACHE_CELLS_X - tex.width16;    // Move onto the next row of cells
+            }
+        }
+
+        gTCacheStats.numUploads++;
+        gTCacheStats.numUploadedCells += tex.width16 * tex.height16;
+    #else
     const uint32_t startTCacheFillPage = gTCacheFillPage;
     texture_t** pTexStartCacheCell = nullptr;
 
@@ -673,19 +966,11 @@ void I_CacheTex(texture_t& tex) noexcept {
         if (gTCacheFillCellY + tex.height16 > TCACHE_CELLS_Y) {
             const uint32_t lockedTPages = gLockedTexPagesMask;
 
-            // PsyDoom: if all the pages are locked this code will loop forever.
-            // If this situation arises go straight to the overflow error so we can at least report the problem.
-            #if PSYDOOM_MODS
-                if ((lockedTPages & ALL_TPAGES_MASK) != ALL_TPAGES_MASK) {
-            #endif
-                    // Continue moving to the next texture page and wraparound if required until we find one that is not locked
-                    do {
-                        gTCacheFillPage++;
-                        gTCacheFillPage -= (gTCacheFillPage / NUM_TCACHE_PAGES) * NUM_TCACHE_PAGES;
-                    } while ((lockedTPages >> gTCacheFillPage) & 1);
-            #if PSYDOOM_MODS
-                }
-            #endif
+            // Continue moving to the next texture page and wraparound if required until we find one that is not locked
+            do {
+                gTCacheFillPage++;
+                gTCacheFillPage -= (gTCacheFillPage / NUM_TCACHE_PAGES) * NUM_TCACHE_PAGES;
+            } while ((lockedTPages >> gTCacheFillPage) & 1);
 
             // If we wound up back where we started then there's nowhere in the cache to fit this texture.
             // This is where the imfamous overflow error kicks in...
@@ -741,6 +1026,7 @@ void I_CacheTex(texture_t& tex) noexcept {
             }
         }
     }
+    #endif  // #if PSYDOOM_MODS
 
     // Fill all of the cells in the cache occupied by this texture with references to it
     {
@@ -1298,6 +1584,7 @@ void I_SubmitGpuCmds() noexcept {
         // Note: this marks the end of the primitive list, by setting the 'tag' field of an invalid primitive to 0xFFFFFF.
         // This is similar to LIBGPU_TermPrim, except we don't bother using a valid primitive struct.
         ((uint32_t*) gpGpuPrimsEnd)[0] = 0x00FFFFFF;
+        PROFILE_SCOPE("LIBGPU_DrawOTag");
         LIBGPU_DrawOTag(gpGpuPrimsBeg, gGpuCmdsBuffer);
     }
 
@@ -1309,9 +1596,16 @@ void I_SubmitGpuCmds() noexcept {
 #if PSYDOOM_MODS
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// PsyDoom: get the total number of vblanks elapsed, and use the current time adjustment in networked games
+// PsyDoom: get the total number of vblanks elapsed, and use the current time adjustment in networked games.
+// In headless mode the virtual vblank clock is used instead of real time, which only advances when a frame is presented.
+//
+// WARNING: because of this, any loop which waits for time to pass by polling this function (without presenting a frame in between) will
+// hang forever in headless mode! Such code must be skipped in headless mode, as is done for 'I_CrossFadeFrameBuffers'.
 //------------------------------------------------------------------------------------------------------------------------------------------
 int32_t I_GetTotalVBlanks() noexcept {
+    if (ProgArgs::gbHeadlessMode)
+        return gHeadlessTotalVBlanks;
+
     typedef std::chrono::system_clock::time_point               time_point_t;
     typedef std::chrono::system_clock::duration                 duration_t;
     typedef std::chrono::duration<int64_t, std::ratio<1, 50>>   tick_50hz_t;
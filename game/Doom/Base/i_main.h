@@ -62,11 +62,28 @@ enum : int32_t {
 // Certain bits correspond to certain buttons on the PSX digital controller.
 typedef uint32_t padbuttons_t;
 
+// PsyDoom: statistics on texture cache residency and activity for a frame
+#if PSYDOOM_MODS
+    struct tcachestats_t {
+        int32_t     numUploads;                 // Textures uploaded to VRAM
+        int32_t     numUploadedCells;           // Cells occupied by textures uploaded to VRAM
+        int32_t     numEvictions;               // Textures evicted to make room for uploads
+        int32_t     numForcedEvictions;         // Evictions of textures already used in the frame (previously a 'Texture Cache Overflow')
+        int32_t     numResidentTextures;        // Textures in the cache at the end of the frame
+        int32_t     numResidentCells;           // Cells occupied by textures at the end of the frame
+    };
+#endif
+
 extern uint32_t             gTCacheFillPage;
 extern uint32_t             gTCacheFillCellX;
 extern uint32_t             gTCacheFillCellY;
 extern uint32_t             gTCacheFillRowCellH;
 extern uint32_t             gLockedTexPagesMask;
+
+#if PSYDOOM_MODS
+    extern tcachestats_t    gTCacheStats;
+#endif
+
 extern std::byte            gTmpBuffer[TMP_BUFFER_SIZE];
 extern uint32_t             gTotalVBlanks;
 extern uint32_t             gLastTotalVBlanks;
@@ -138,4 +155,6 @@ void I_SubmitGpuCmds() noexcept;
 
 #if PSYDOOM_MODS
     int32_t I_GetTotalVBlanks() noexcept;
+    void I_ResetTexCacheLevelStats() noexcept;
+    void I_PrintTexCacheLevelStats() noexcept;
 #endif
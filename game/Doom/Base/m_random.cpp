@@ -58,3 +58,14 @@ void M_ClearRandom() noexcept {
     gPRndIndex = 0;
     gMRndIndex = 0;
 }
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: get the current position in the RNG table for the main game and UI RNGs.
+// Used for checking that demo playback stays in sync.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void M_GetRandomIndexes(uint32_t& pRndIndex, uint32_t& mRndIndex) noexcept {
+    pRndIndex = gPRndIndex;
+    mRndIndex = gMRndIndex;
+}
+#endif  // #if PSYDOOM_MODS
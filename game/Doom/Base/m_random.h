@@ -8,3 +8,7 @@ int32_t P_Random() noexcept;
 int32_t P_SubRandom() noexcept;
 int32_t M_Random() noexcept;
 void M_ClearRandom() noexcept;
+
+#if PSYDOOM_MODS
+    void M_GetRandomIndexes(uint32_t& pRndIndex, uint32_t& mRndIndex) noexcept;
+#endif
@@ -9,6 +9,7 @@
 #include "i_main.h"
 #include "m_fixed.h"
 #include "PcPsx/Game.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/Utils.h"
 #include "sounds.h"
@@ -260,6 +261,11 @@ static uint8_t gSound_WmdMem[WMD_MEM_SIZE];
 // Anything at this address or after in the buffer can be used for that purpose.
 static uint8_t* gpSound_MusicSeqData;
 
+// PsyDoom: how many bytes of the WMD memory buffer are used by the currently loaded map music sequence
+#if PSYDOOM_MODS
+    static int32_t gSound_MusicSeqSize;
+#endif
+
 // Which of the music sequence definitions is currently playing
 static uint32_t gCurMusicSeqIdx;
 
@@ -385,6 +391,10 @@ void S_LoadMapSoundAndMusic(const int32_t mapIdx) noexcept {
             S_StopMusic();
             Utils::waitUntilSeqEnteredStatus(pMusicSeqDefs[gCurMusicSeqIdx].seqIdx, SequenceStatus::SEQUENCE_INACTIVE);
             wess_seq_range_free(0 + NUMSFX, (Game::isFinalDoom()) ? NUM_MUSIC_SEQS_FINAL_DOOM : NUM_MUSIC_SEQS_DOOM);
+
+            #if PSYDOOM_MODS
+                gSound_MusicSeqSize = 0;
+            #endif
         }
 
         S_UnloadSampleBlock(gMapSndBlock);
@@ -423,7 +433,11 @@ void S_LoadMapSoundAndMusic(const int32_t mapIdx) noexcept {
 
         const musicseq_t& musicseq = pMusicSeqDefs[gCurMusicSeqIdx];
         psxspu_init_reverb(musicseq.reverbMode, musicseq.reverbDepthL, musicseq.reverbDepthR, 0, 0);
-        wess_seq_load(musicseq.seqIdx, gpSound_MusicSeqData);
+        #if PSYDOOM_MODS
+            gSound_MusicSeqSize = wess_seq_load(musicseq.seqIdx, gpSound_MusicSeqData);
+        #else
+            wess_seq_load(musicseq.seqIdx, gpSound_MusicSeqData);
+        #endif
         destSpuAddr += wess_dig_lcd_load(musicseq.lcdFile, destSpuAddr, &gMapSndBlock, false);
 
         // Restore the master volume to what it was.
@@ -569,6 +583,8 @@ void S_StartSound(mobj_t* const pOrigin, const sfxenum_t soundId) noexcept {
 // Placeholder where sound update logic per tick can be done
 //------------------------------------------------------------------------------------------------------------------------------------------
 void S_UpdateSounds() noexcept {
+    PROFILE_SCOPE("S_UpdateSounds");
+
     // This didn't do anything for PSX DOOM other than incrementing this global sound tick counter.
     // Updates to the sequencer system were instead driven by hardware timer interrupts, firing approximately 120 times a second.
     gNumSoundTics++;
@@ -632,6 +648,19 @@ void PsxSoundInit(const int32_t sfxVol, const int32_t musVol, void* const pTmpWm
     gbDidLoadDoomSfxLcd = true;
 }
 
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: returns how many bytes of the WMD memory buffer (of size 'WMD_MEM_SIZE') are currently in use.
+// This includes the module data, the sound effect sequences and the sequence for the current map's music.
+//------------------------------------------------------------------------------------------------------------------------------------------
+int32_t S_GetWmdMemUsed() noexcept {
+    if (!gpSound_MusicSeqData)
+        return 0;
+
+    return (int32_t)(gpSound_MusicSeqData - gSound_WmdMem) + gSound_MusicSeqSize;
+}
+#endif
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Shutdown the PlayStation sound system
 //------------------------------------------------------------------------------------------------------------------------------------------
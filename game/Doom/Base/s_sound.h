@@ -53,3 +53,7 @@ void S_StartSound(mobj_t* const pOrigin, const sfxenum_t soundId) noexcept;
 void S_UpdateSounds() noexcept;
 void PsxSoundInit(const int32_t sfxVol, const int32_t musVol, void* const pTmpWmdLoadBuffer) noexcept;
 void PsxSoundExit() noexcept;
+
+#if PSYDOOM_MODS
+    int32_t S_GetWmdMemUsed() noexcept;
+#endif
@@ -4,16 +4,14 @@
 #include "Doom/d_main.h"
 #include "i_file.h"
 #include "i_main.h"
+#include "PcPsx/LumpCache.h"
 #include "z_zone.h"
 
-// WAD file header
-struct wadinfo_t {
-    char        fileid[4];      // Should always be "IWAD" for PSX DOOM
-    int32_t     numlumps;       // The number of lumps in the WAD
-    int32_t     infotableofs;   // Offset in the WAD of the lump infos array
-};
-
-static_assert(sizeof(wadinfo_t) == 12);
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 // Main IWAD lump related state: the number of lumps, info on each lump, pointers to loaded lumps and
 // whether each lump was loaded from the main IWAD or not.
@@ -31,6 +29,93 @@ static void*    gpMapWadFileData;
 static int32_t  gNumMapWadLumps;
 lumpinfo_t*     gpMapWadLumpInfo;
 
+#if PSYDOOM_MODS
+    static CdFileId gMapWadFile;    // PsyDoom: which file the currently open map WAD came from
+
+    // PsyDoom: hash table indexes for looking up lumps by name in the main IWAD and the current map WAD.
+    // Each table is a power of two in size, uses linear probing and holds lump numbers or '-1' for empty slots.
+    // Only the first lump with a particular name is added to an index, which matches the behavior of the original linear search.
+    struct LumpNameIndex {
+        std::vector<int32_t>    slots;
+        uint32_t                slotMask;
+    };
+
+    static LumpNameIndex gMainWadLumpIndex;
+    static LumpNameIndex gMapWadLumpIndex;
+#endif
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: hash the two words of a lump name, which must have the compression flag bit masked out of the first word already
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint32_t W_HashLumpName(const uint32_t nameW1, const uint32_t nameW2) noexcept {
+    const uint64_t nameBits = ((uint64_t) nameW2 << 32) | nameW1;
+    return (uint32_t)((nameBits * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: build a hash table index for looking up the given lumps by name
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void W_BuildLumpNameIndex(LumpNameIndex& index, const lumpinfo_t* const pLumps, const int32_t numLumps) noexcept {
+    // Keep the table no more than half full so that probe sequences stay short
+    uint32_t numSlots = 16;
+
+    while (numSlots < (uint32_t) numLumps * 2) {
+        numSlots *= 2;
+    }
+
+    index.slots.assign(numSlots, -1);
+    index.slotMask = numSlots - 1;
+
+    for (int32_t lumpIdx = 0; lumpIdx < numLumps; ++lumpIdx) {
+        // Note: must mask the highest bit of the first character of the lump name, since it is used to indicate whether the lump is compressed
+        const uint32_t nameW1 = pLumps[lumpIdx].name.words[0] & NAME_WORD_MASK;
+        const uint32_t nameW2 = pLumps[lumpIdx].name.words[1];
+
+        for (uint32_t slotIdx = W_HashLumpName(nameW1, nameW2) & index.slotMask;; slotIdx = (slotIdx + 1) & index.slotMask) {
+            const int32_t slotLumpIdx = index.slots[slotIdx];
+
+            if (slotLumpIdx < 0) {
+                index.slots[slotIdx] = lumpIdx;
+                break;
+            }
+
+            // If there is already a lump with this name then it takes precedence, since it comes first
+            const lumpinfo_t& slotLump = pLumps[slotLumpIdx];
+
+            if (((slotLump.name.words[0] & NAME_WORD_MASK) == nameW1) && (slotLump.name.words[1] == nameW2))
+                break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: lookup a lump by name using the given index, returning the lump number or '-1' if not found.
+// The name to find is given as two words and is expected to be uppercase.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t W_FindLumpInIndex(
+    const LumpNameIndex& index,
+    const lumpinfo_t* const pLumps,
+    const uint32_t findNameW1,
+    const uint32_t findNameW2
+) noexcept {
+    if (index.slots.empty())
+        return -1;
+
+    for (uint32_t slotIdx = W_HashLumpName(findNameW1, findNameW2) & index.slotMask;; slotIdx = (slotIdx + 1) & index.slotMask) {
+        const int32_t lumpIdx = index.slots[slotIdx];
+
+        if (lumpIdx < 0)
+            return -1;
+
+        const lumpinfo_t& lump = pLumps[lumpIdx];
+
+        if (((lump.name.words[0] & NAME_WORD_MASK) == findNameW1) && (lump.name.words[1] == findNameW2))
+            return lumpIdx;
+    }
+}
+#endif  // #if PSYDOOM_MODS
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Initializes the WAD file management system.
 // Opens up the main WAD file and verifies it is valid, and then reads all of the header info for all of the lumps.
@@ -64,6 +149,16 @@ void W_Init() noexcept {
 
     D_memset(gpLumpCache, std::byte(0), gNumLumps * sizeof(void*));
     D_memset(gpbIsUncompressedLump, std::byte(0), gNumLumps * sizeof(bool));
+
+    // PsyDoom: build the index for fast lookup of lumps by name
+    #if PSYDOOM_MODS
+        W_BuildLumpNameIndex(gMainWadLumpIndex, gpLumpInfo, gNumLumps);
+    #endif
+
+    // PsyDoom: load or build the cache of pre-decompressed lumps for the main IWAD and map WADs
+    #if PSYDOOM_MODS
+        LumpCache::init();
+    #endif
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -81,25 +176,30 @@ int32_t W_CheckNumForName(const char* const name) noexcept {
     const uint32_t findNameW1 = (uint32_t&) nameUpper[0];
     const uint32_t findNameW2 = (uint32_t&) nameUpper[4];
 
-    // Try to find the given lump name and compare names using 32-bit words rather than single chars
-    lumpinfo_t* pLump = gpLumpInfo;
-    int32_t lumpIdx = 0;
-
-    while (lumpIdx < gNumLumps) {
-        // Note: must mask the highest bit of the first character of the lump name.
-        // This bit is used to indicate whether the lump is compressed or not.
-        const uint32_t lumpNameW1 = ((uint32_t&) pLump->name.chars[0]) & NAME_WORD_MASK;
-        const uint32_t lumpNameW2 = ((uint32_t&) pLump->name.chars[4]);
-
-        if (lumpNameW1 == findNameW1 && lumpNameW2 == findNameW2)
-            return lumpIdx;
+    // PsyDoom: use the hash table index to find the lump rather than searching through all of the lumps
+    #if PSYDOOM_MODS
+        return W_FindLumpInIndex(gMainWadLumpIndex, gpLumpInfo, findNameW1, findNameW2);
+    #else
+        // Try to find the given lump name and compare names using 32-bit words rather than single chars
+        lumpinfo_t* pLump = gpLumpInfo;
+        int32_t lumpIdx = 0;
+
+        while (lumpIdx < gNumLumps) {
+            // Note: must mask the highest bit of the first character of the lump name.
+            // This bit is used to indicate whether the lump is compressed or not.
+            const uint32_t lumpNameW1 = ((uint32_t&) pLump->name.chars[0]) & NAME_WORD_MASK;
+            const uint32_t lumpNameW2 = ((uint32_t&) pLump->name.chars[4]);
+
+            if (lumpNameW1 == findNameW1 && lumpNameW2 == findNameW2)
+                return lumpIdx;
         
-        ++lumpIdx;
-        ++pLump;
-    };
+            ++lumpIdx;
+            ++pLump;
+        };
 
-    // If we get to here then the lump name is not found
-    return -1;
+        // If we get to here then the lump name is not found
+        return -1;
+    #endif
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -158,6 +258,14 @@ void W_ReadLump(const int32_t lumpNum, void* const pDest, const bool bDecompress
     const uint32_t sizeToRead = nextLump.filepos - lump.filepos;
 
     if (bDecompress && (((uint8_t) lump.name.chars[0] & 0x80u) != 0)) {
+        // PsyDoom: if the lump has already been decompressed in the lump cache then just copy it, skipping the disc read and decompression
+        #if PSYDOOM_MODS
+            if (const std::byte* const pCachedLump = LumpCache::getLump(CdFileId::PSXDOOM_WAD, lumpNum, lump.size)) {
+                std::memcpy(pDest, pCachedLump, lump.size);
+                return;
+            }
+        #endif
+
         // Decompression needed, must alloc a temp buffer for the compressed data before reading and decompressing!
         void* const pTmpBuffer = Z_EndMalloc(*gpMainMemZone, lump.size, PU_STATIC, nullptr);
         
@@ -278,8 +386,17 @@ void* W_OpenMapWad(const CdFileId discFile) noexcept {
     }
     
     // Finish up by saving some high level map wad info
+    #if PSYDOOM_MODS
+        gMapWadFile = discFile;
+    #endif
+
     gNumMapWadLumps = wadinfo.numlumps;
     gpMapWadLumpInfo = (lumpinfo_t*)((std::byte*) gpMapWadFileData + wadinfo.infotableofs);
+
+    // PsyDoom: build the index for fast lookup of map lumps by name
+    #if PSYDOOM_MODS
+        W_BuildLumpNameIndex(gMapWadLumpIndex, gpMapWadLumpInfo, gNumMapWadLumps);
+    #endif
     return gpMapWadFileData;
 }
 
@@ -311,24 +428,29 @@ int32_t W_MapCheckNumForName(const char* const name) noexcept {
     const uint32_t findNameW1 = (uint32_t&) nameUpper[0];
     const uint32_t findNameW2 = (uint32_t&) nameUpper[4];
 
-    // Try to find the given lump name and compare names using 32-bit words rather than single chars
-    lumpinfo_t* pLump = gpMapWadLumpInfo;
-    int32_t lumpIdx = 0;
+    // PsyDoom: use the hash table index to find the lump rather than searching through all of the lumps
+    #if PSYDOOM_MODS
+        return W_FindLumpInIndex(gMapWadLumpIndex, gpMapWadLumpInfo, findNameW1, findNameW2);
+    #else
+        // Try to find the given lump name and compare names using 32-bit words rather than single chars
+        lumpinfo_t* pLump = gpMapWadLumpInfo;
+        int32_t lumpIdx = 0;
     
-    while (lumpIdx < gNumMapWadLumps) {
-        // Note: must mask the highest bit of the first character of the lump name.
-        // This bit is used to indicate whether the lump is compressed or not.
-        const uint32_t lumpNameW1 = ((uint32_t&) pLump->name.chars[0]) & NAME_WORD_MASK;
-        const uint32_t lumpNameW2 = ((uint32_t&) pLump->name.chars[4]);
-
-        if (lumpNameW1 == findNameW1 && lumpNameW2 == findNameW2)
-            return lumpIdx;
+        while (lumpIdx < gNumMapWadLumps) {
+            // Note: must mask the highest bit of the first character of the lump name.
+            // This bit is used to indicate whether the lump is compressed or not.
+            const uint32_t lumpNameW1 = ((uint32_t&) pLump->name.chars[0]) & NAME_WORD_MASK;
+            const uint32_t lumpNameW2 = ((uint32_t&) pLump->name.chars[4]);
+
+            if (lumpNameW1 == findNameW1 && lumpNameW2 == findNameW2)
+                return lumpIdx;
         
-        ++lumpIdx;
-        ++pLump;
-    };
+            ++lumpIdx;
+            ++pLump;
+        };
 
-    return -1;
+        return -1;
+    #endif
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -357,6 +479,14 @@ void W_ReadMapLump(const int32_t lumpNum, void* const pDest, const bool bDecompr
     const std::byte* const pLumpBytes = (std::byte*) gpMapWadFileData + lump.filepos;
     
     if (bDecompress && (((uint8_t) lump.name.chars[0] & 0x80u) != 0)) {
+        // PsyDoom: use the already decompressed lump from the lump cache if available
+        #if PSYDOOM_MODS
+            if (const std::byte* const pCachedLump = LumpCache::getLump(gMapWadFile, lumpNum, lump.size)) {
+                std::memcpy(pDest, pCachedLump, lump.size);
+                return;
+            }
+        #endif
+
         // Decompression needed: decompress to the given output buffer
         decode(pLumpBytes, pDest);
     } else {
@@ -367,97 +497,264 @@ void W_ReadMapLump(const int32_t lumpNum, void* const pDest, const bool bDecompr
     }
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Helper for 'decode': copies a back reference of 2-16 bytes using a pair of fixed size copies instead of one byte at a time.
+// The two copies overlap each other when the length is not exactly the copy size, which avoids writing past the end of the reference.
+// Returns 'false' if the reference overlaps the output too closely for this to work, in which case the caller must copy byte by byte.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static inline bool copyBackReference(uint8_t* const pDst, const uint8_t* const pSrc, const uint32_t srcOffset, const uint32_t numBytes) noexcept {
+    // Note: each copy must read only bytes before where it writes, hence the distance checks against the copy size
+    if (numBytes >= 8) {
+        if (srcOffset < 8)
+            return false;
+
+        std::memcpy(pDst, pSrc, 8);
+        std::memcpy(pDst + numBytes - 8, pSrc + numBytes - 8, 8);
+    } else if (numBytes >= 4) {
+        if (srcOffset < 4)
+            return false;
+
+        std::memcpy(pDst, pSrc, 4);
+        std::memcpy(pDst + numBytes - 4, pSrc + numBytes - 4, 4);
+    } else {
+        if (srcOffset < 2)
+            return false;
+
+        std::memcpy(pDst, pSrc, 2);
+        std::memcpy(pDst + numBytes - 2, pSrc + numBytes - 2, 2);
+    }
+
+    return true;
+}
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Decode the given compressed data into the given output buffer.
 // The compression algorithm used is a form of LZSS.
+//
+// PsyDoom: this has been rewritten for speed, see the 'Old' folder for the original version which worked one bit and byte at a time.
+// Each id byte is now handled in one go, runs of 8 uncompressed bytes are copied at once and back references use wide copies.
+// The output is identical to the original.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void decode(const void* pSrc, void* pDst) noexcept {
     const uint8_t* pSrcByte = (const uint8_t*) pSrc;
     uint8_t* pDstByte = (uint8_t*) pDst;
 
-    uint32_t idByte = 0;        // Controls whether there is compressed or uncompressed data ahead
-    uint32_t haveIdByte = 0;    // Controls when to read an id byte, when '0' we need to read another one
-    
     while (true) {
-        // Read the id byte if required.
-        // We need 1 id byte for every 8 bytes of uncompressed output, or every 8 runs of compressed data.
-        if (haveIdByte == 0) {
-            idByte = *pSrcByte;
-            ++pSrcByte;
+        // Each id byte has 1 bit for each of the next 8 items in the stream: '0' for an uncompressed byte and '1' for a back reference
+        uint32_t idByte = *pSrcByte;
+        ++pSrcByte;
+
+        // Fast path: 8 uncompressed bytes in a row
+        if (idByte == 0) {
+            std::memcpy(pDstByte, pSrcByte, 8);
+            pSrcByte += 8;
+            pDstByte += 8;
+            continue;
         }
-        
-        haveIdByte = (haveIdByte + 1) & 7;
 
-        if (idByte & 1) {
+        for (int32_t itemIdx = 0; itemIdx < 8; ++itemIdx, idByte >>= 1) {
+            if ((idByte & 1) == 0) {
+                // Uncompressed data: just copy the input byte
+                *pDstByte = *pSrcByte;
+                ++pSrcByte;
+                ++pDstByte;
+                continue;
+            }
+
             // Compressed data ahead: the first 12-bits tells where to take repeated data from.
             // The remaining 4-bits tell how many bytes of repeated data to take.
             const uint32_t srcByte1 = pSrcByte[0];
             const uint32_t srcByte2 = pSrcByte[1];
             pSrcByte += 2;
 
-            const int32_t srcOffset = ((srcByte1 << 4) | (srcByte2 >> 4)) + 1;
-            const int32_t numRepeatedBytes = (srcByte2 & 0xF) + 1;
+            const uint32_t srcOffset = ((srcByte1 << 4) | (srcByte2 >> 4)) + 1;
+            const uint32_t numRepeatedBytes = (srcByte2 & 0xF) + 1;
 
             // A value of '1' is a special value and means we have reached the end of the compressed stream
             if (numRepeatedBytes == 1)
-                break;
+                return;
 
             const uint8_t* const pRepeatedBytes = pDstByte - srcOffset;
 
-            for (int32_t i = 0; i < numRepeatedBytes; ++i) {
-                *pDstByte = pRepeatedBytes[i];
-                ++pDstByte;
+            if (!copyBackReference(pDstByte, pRepeatedBytes, srcOffset, numRepeatedBytes)) {
+                // The reference overlaps the bytes being output (a repeating pattern), must copy one byte at a time
+                for (uint32_t i = 0; i < numRepeatedBytes; ++i) {
+                    pDstByte[i] = pRepeatedBytes[i];
+                }
             }
-        } else {
-            // Uncompressed data: just copy the input byte
-            *pDstByte = *pSrcByte;
-            ++pSrcByte;
-            ++pDstByte;
+
+            pDstByte += numRepeatedBytes;
         }
-        
-        idByte >>= 1;
     }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Similar to 'decode' except does not do any decompression.
 // Instead, this function returns the decompressed size of the data.
+//
+// PsyDoom: this has been rewritten for speed in the same way as 'decode', see the 'Old' folder for the original version.
+// Where the decompressed size of a lump is already known (from the 'lumpinfo_t' for the lump) that should be used instead of this.
 //------------------------------------------------------------------------------------------------------------------------------------------
 uint32_t getDecodedSize(const void* const pSrc) noexcept {
-    // This code is pretty much a replica of 'decode()' - see that function for more details/comments.
-    // The only difference here is that we don't save the decompressed data and just count the number of output bytes instead.
-    const uint8_t* pSrcByte = (uint8_t*) pSrc;
+    const uint8_t* pSrcByte = (const uint8_t*) pSrc;
     uint32_t size = 0;
 
-    uint32_t idByte = 0;
-    uint32_t haveIdByte = 0;
-
     while (true) {
-        if (haveIdByte == 0) {
-            idByte = *pSrcByte;
-            ++pSrcByte;
+        uint32_t idByte = *pSrcByte;
+        ++pSrcByte;
+
+        // Fast path: 8 uncompressed bytes in a row
+        if (idByte == 0) {
+            pSrcByte += 8;
+            size += 8;
+            continue;
         }
 
-        haveIdByte = (haveIdByte + 1) & 7;
+        for (int32_t itemIdx = 0; itemIdx < 8; ++itemIdx, idByte >>= 1) {
+            if ((idByte & 1) == 0) {
+                ++pSrcByte;
+                ++size;
+                continue;
+            }
 
-        if (idByte & 1) {
             // Note: not bothering to read the byte containing only positional information for the replicated data.
             // We are only interested in the byte count in this instance.
-            const uint32_t srcByte2 = pSrcByte[1];
+            const uint32_t numRepeatedBytes = (pSrcByte[1] & 0xF) + 1;
             pSrcByte += 2;
-            const uint32_t numRepeatedBytes = (srcByte2 & 0xF) + 1;
 
             if (numRepeatedBytes == 1)
-                break;
-            
+                return size;
+
             size += numRepeatedBytes;
-        } else {
-            ++size;
-            ++pSrcByte;
         }
+    }
+}
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: a version of 'getDecodedSize' for data which might be corrupt or truncated, which never reads past the given number of bytes.
+// Returns 'false' if the compressed data runs past the end of the source bytes without reaching the end marker.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool getDecodedSize(const void* const pSrc, const size_t srcSize, uint32_t& decodedSize) noexcept {
+    const uint8_t* pSrcByte = (const uint8_t*) pSrc;
+    const uint8_t* const pSrcEnd = pSrcByte + srcSize;
+    uint32_t size = 0;
+
+    while (pSrcByte < pSrcEnd) {
+        uint32_t idByte = *pSrcByte;
+        ++pSrcByte;
 
-        idByte >>= 1;
+        // Fast path: 8 uncompressed bytes in a row
+        if (idByte == 0) {
+            if (pSrcEnd - pSrcByte < 8)
+                return false;
+
+            pSrcByte += 8;
+            size += 8;
+            continue;
+        }
+
+        for (int32_t itemIdx = 0; itemIdx < 8; ++itemIdx, idByte >>= 1) {
+            if ((idByte & 1) == 0) {
+                if (pSrcByte >= pSrcEnd)
+                    return false;
+
+                ++pSrcByte;
+                ++size;
+                continue;
+            }
+
+            if (pSrcEnd - pSrcByte < 2)
+                return false;
+
+            const uint32_t numRepeatedBytes = (pSrcByte[1] & 0xF) + 1;
+            pSrcByte += 2;
+
+            if (numRepeatedBytes == 1) {
+                decodedSize = size;
+                return true;
+            }
+
+            size += numRepeatedBytes;
+        }
     }
 
-    return size;
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: measures how fast the compressed lumps in the main IWAD and all map WADs are decompressed and prints the results.
+// Every compressed lump is decoded repeatedly (and also sized with 'getDecodedSize') for at least a second or so to get a stable timing.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void W_RunDecodeBenchmark() noexcept {
+    // Gather up all of the compressed lumps in all of the WAD files
+    struct BenchLump {
+        const std::byte*    pCompressedData;
+        uint32_t            size;
+    };
+
+    std::vector<std::vector<std::byte>> wadFiles;
+    std::vector<BenchLump> lumps;
+    uint64_t decompressedBytes = 0;
+    uint32_t maxLumpSize = 0;
+
+    for (int32_t fileIdx = 0; fileIdx < (int32_t) CdFileId::END; ++fileIdx) {
+        const CdFileId fileId = (CdFileId) fileIdx;
+        std::vector<std::byte> wadData;
+
+        if ((!LumpCache::isCachedWadFile(fileId)) || (!LumpCache::readDiscFile(fileId, wadData)))
+            continue;
+
+        W_ForEachCompressedLump(wadData.data(), wadData.size(), [&](const int32_t, const lumpinfo_t& lumpInfo, const std::byte* const pCompressedData) noexcept {
+            lumps.push_back(BenchLump{ pCompressedData, lumpInfo.size });
+            decompressedBytes += lumpInfo.size;
+            maxLumpSize = std::max(maxLumpSize, lumpInfo.size);
+        });
+
+        wadFiles.push_back(std::move(wadData));
+    }
+
+    if (lumps.empty()) {
+        std::printf("Decode benchmark: no compressed lumps found!\n");
+        return;
+    }
+
+    // Time repeated passes over all the lumps until enough time has elapsed
+    typedef std::chrono::steady_clock clock_t;
+    std::vector<std::byte> decodeBuffer(maxLumpSize);
+    bool bSizesOk = true;
+
+    const auto timePasses = [&](const bool bDecode) noexcept {
+        const clock_t::time_point startTime = clock_t::now();
+        uint32_t numPasses = 0;
+        double elapsedSecs = 0;
+
+        do {
+            for (const BenchLump& lump : lumps) {
+                if (bDecode) {
+                    decode(lump.pCompressedData, decodeBuffer.data());
+                } else {
+                    bSizesOk &= (getDecodedSize(lump.pCompressedData) == lump.size);
+                }
+            }
+
+            ++numPasses;
+            elapsedSecs = std::chrono::duration<double>(clock_t::now() - startTime).count();
+        } while ((numPasses < 3) || (elapsedSecs < 1.0));
+
+        return (double) decompressedBytes * numPasses / (elapsedSecs * 1024.0 * 1024.0);
+    };
+
+    const double decodeSpeed = timePasses(true);
+    const double sizeSpeed = timePasses(false);
+
+    std::printf("Decode benchmark: %u compressed lumps in %u WAD files\n", (uint32_t) lumps.size(), (uint32_t) wadFiles.size());
+    std::printf("  Decompressed size:      %.2f MiB\n", (double) decompressedBytes / (1024.0 * 1024.0));
+    std::printf("  decode():               %.1f MiB/s\n", decodeSpeed);
+    std::printf("  getDecodedSize():       %.1f MiB/s\n", sizeSpeed);
+
+    if (!bSizesOk) {
+        std::printf("  WARNING: 'getDecodedSize()' gave inconsistent results!\n");
+    }
 }
+#endif  // #if PSYDOOM_MODS
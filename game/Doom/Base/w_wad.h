@@ -2,6 +2,9 @@
 
 #include "Endian.h"
 
+#include <cstddef>
+#include <cstring>
+
 enum class CdFileId : int32_t;
 
 // This is a mask to chop off the highest bit of the 1st 32-bit word in a lump name.
@@ -28,6 +31,15 @@ struct lumpinfo_t {
 
 static_assert(sizeof(lumpinfo_t) == 16);
 
+// WAD file header
+struct wadinfo_t {
+    char        fileid[4];      // Should always be "IWAD" for PSX DOOM
+    int32_t     numlumps;       // The number of lumps in the WAD
+    int32_t     infotableofs;   // Offset in the WAD of the lump infos array
+};
+
+static_assert(sizeof(wadinfo_t) == 12);
+
 extern int32_t      gNumLumps;
 extern lumpinfo_t*  gpLumpInfo;
 extern void**       gpLumpCache;
@@ -47,3 +59,48 @@ int32_t W_MapCheckNumForName(const char* const name) noexcept;
 void W_ReadMapLump(const int32_t lumpNum, void* const pDest, const bool bDecompress) noexcept;
 void decode(const void* pSrc, void* pDst) noexcept;
 uint32_t getDecodedSize(const void* const pSrc) noexcept;
+
+#if PSYDOOM_MODS
+    bool getDecodedSize(const void* const pSrc, const size_t srcSize, uint32_t& decodedSize) noexcept;
+    void W_RunDecodeBenchmark() noexcept;
+
+    //--------------------------------------------------------------------------------------------------------------------------------------
+    // PsyDoom: calls the given function for each compressed lump in the given WAD file data, passing the lump number, info and compressed
+    // data. Lumps which look invalid, which would run past the end of the WAD data or which do not decompress to the size the WAD says they
+    // are are skipped.
+    //--------------------------------------------------------------------------------------------------------------------------------------
+    template <class LumpFuncT>
+    void W_ForEachCompressedLump(const std::byte* const pWadData, const size_t wadSize, const LumpFuncT& lumpFunc) noexcept {
+        if (wadSize < sizeof(wadinfo_t))
+            return;
+
+        wadinfo_t wadInfo;
+        std::memcpy(&wadInfo, pWadData, sizeof(wadinfo_t));
+
+        if ((wadInfo.numlumps <= 0) || (wadInfo.infotableofs < 0))
+            return;
+
+        if ((size_t) wadInfo.infotableofs + (size_t) wadInfo.numlumps * sizeof(lumpinfo_t) > wadSize)
+            return;
+
+        // Note: the last lump is skipped since it is an end marker and the game is not allowed to read it.
+        // Also, the lump infos are copied out since there is no guarantee the table is aligned.
+        const std::byte* const pLumpInfos = pWadData + wadInfo.infotableofs;
+
+        for (int32_t lumpNum = 0; lumpNum + 1 < wadInfo.numlumps; ++lumpNum) {
+            lumpinfo_t lumpInfo;
+            std::memcpy(&lumpInfo, pLumpInfos + (size_t) lumpNum * sizeof(lumpinfo_t), sizeof(lumpinfo_t));
+            const bool bIsCompressed = (((uint8_t) lumpInfo.name.chars[0] & 0x80u) != 0);
+
+            if ((!bIsCompressed) || (lumpInfo.size == 0) || (lumpInfo.filepos >= wadSize))
+                continue;
+
+            const std::byte* const pCompressedData = pWadData + lumpInfo.filepos;
+            uint32_t decodedSize = 0;
+
+            if (getDecodedSize(pCompressedData, wadSize - lumpInfo.filepos, decodedSize) && (decodedSize == lumpInfo.size)) {
+                lumpFunc(lumpNum, lumpInfo, pCompressedData);
+            }
+        }
+    }
+#endif  // #if PSYDOOM_MODS
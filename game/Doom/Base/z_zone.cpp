@@ -4,21 +4,59 @@
 #include "i_main.h"
 #include "EngineLimits.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <memory>
+#include <vector>
+
+#if !PSYDOOM_USE_SEGREGATED_ZONE
 
 // The minimum size that a memory block must be
 static constexpr int32_t MINFRAGMENT = 64;
 
-// Size of the first two fields of the memory zone
+#endif  // #if !PSYDOOM_USE_SEGREGATED_ZONE
+
+// Size of the fields of the memory zone preceding the first memory block
 static constexpr size_t MEMZONE_HEADER_SIZE = offsetof(memzone_t, blocklist);
 
 // PsyDoom: the entire heap memory used by the game
 static std::unique_ptr<std::byte[]> gZoneHeap;
 
+#if PSYDOOM_MODS
+    // PsyDoom: memory for additional regions that the zone has grown to include, when the initial heap memory ran out
+    static std::vector<std::unique_ptr<std::byte[]>> gZoneHeapRegions;
+
+    // PsyDoom: how big each chunk of memory for the level arena is, unless a bigger chunk is needed for a single allocation
+    static constexpr int32_t LEVEL_ARENA_CHUNK_SIZE = 1024 * 1024;
+
+    // PsyDoom: a chunk of memory in the level arena, and how much of it has been allocated
+    struct LevelArenaChunk {
+        std::unique_ptr<std::byte[]>    pMem;
+        int32_t                         size;
+        int32_t                         usedSize;
+    };
+
+    static std::vector<LevelArenaChunk>     gLevelArenaChunks;          // Memory for the level arena
+    static bool                             gbLevelArenaActive;         // Whether 'PU_LEVEL' allocations for the main zone go to the arena
+    static int32_t                          gNumLevelArenaBlocks;       // How many blocks in the level arena are still in use
+#endif
+
 // The main (and only) memory zone used by PSX DOOM
 memzone_t* gpMainMemZone;
 
+#if PSYDOOM_ZONE_STATS
+    // PsyDoom: statistics on zone memory usage
+    zonestats_t gZoneStats;
+#endif
+
+#if PSYDOOM_MODS
+    // PsyDoom: how many purgable blocks have been evicted in total by the allocator, and their size
+    uint32_t    gZoneNumPurges;
+    int64_t     gZonePurgedBytes;
+#endif
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Initializes the zone memory management system. DOOM doesn't use any PsyQ SDK allocation functions AT ALL (either directly or indirectly)
 // so it just gobbles up the entire of the available heap space on the system for it's own purposes.
@@ -29,8 +67,206 @@ memzone_t* gpMainMemZone;
 void Z_Init() noexcept {    
     gZoneHeap.reset(new std::byte[Z_HEAP_SIZE]);                    // Allocate the native heap for the application
     gpMainMemZone = Z_InitZone(gZoneHeap.get(), Z_HEAP_SIZE);       // Setup and save the main memory zone (the only zone)
+
+    // PsyDoom: discard any additional heap regions and level arena memory from a previous initialization
+    #if PSYDOOM_MODS
+        gZoneHeapRegions.clear();
+        gLevelArenaChunks.clear();
+        gbLevelArenaActive = false;
+        gNumLevelArenaBlocks = 0;
+    #endif
+
+    // PsyDoom: start recording zone memory statistics from scratch
+    #if PSYDOOM_ZONE_STATS
+        gZoneStats = {};
+        Z_BeginStatsPeriod();
+    #endif
+}
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: get the region of memory following the given zone region, creating it if it doesn't exist.
+// This is used instead of failing with an out of memory error when an allocation can't be satisfied by the given region.
+// New regions are the same size as the initial heap, or bigger if needed to fit the given allocation size.
+//------------------------------------------------------------------------------------------------------------------------------------------
+memzone_t& Z_GetNextRegion(memzone_t& zone, const int32_t allocSize) noexcept {
+    if (!zone.pNextRegion) {
+        const int32_t minRegionSize = allocSize + (int32_t)(MEMZONE_HEADER_SIZE + sizeof(memblock_t));
+        const int32_t regionSize = std::max((int32_t) Z_HEAP_SIZE, minRegionSize);
+
+        gZoneHeapRegions.emplace_back(new std::byte[regionSize]);
+        zone.pNextRegion = Z_InitZone(gZoneHeapRegions.back().get(), regionSize);
+    }
+
+    return *zone.pNextRegion;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: get which region of the given zone a block of memory belongs to.
+// If the block is not found in any region then the given zone region is returned.
+//------------------------------------------------------------------------------------------------------------------------------------------
+memzone_t& Z_GetRegionForBlock(memzone_t& zone, const void* const ptr) noexcept {
+    const uintptr_t blockAddr = (uintptr_t) ptr;
+
+    for (memzone_t* pRegion = &zone; pRegion; pRegion = pRegion->pNextRegion) {
+        const uintptr_t regionStartAddr = (uintptr_t) pRegion;
+        const uintptr_t regionEndAddr = regionStartAddr + (uint32_t) pRegion->size;
+
+        if ((blockAddr >= regionStartAddr) && (blockAddr < regionEndAddr))
+            return *pRegion;
+    }
+
+    return zone;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: releases the memory used by the level arena once it is no longer in use and no blocks in it are still allocated
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_ReleaseLevelArenaIfUnused() noexcept {
+    if (gbLevelArenaActive || (gNumLevelArenaBlocks > 0) || gLevelArenaChunks.empty())
+        return;
+
+    // Keep the first chunk of memory around for the next level
+    gLevelArenaChunks.resize(1);
+    gLevelArenaChunks[0].usedSize = 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: start or stop serving 'PU_LEVEL' allocations for the main zone from the level arena.
+// The level arena is used while a level is being setup; level data is allocated quickly by bumping a pointer and is all freed at once
+// when 'PU_LEVEL' memory is freed on level exit. Blocks in the arena can also be freed individually but their memory is not reused.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_BeginLevelArena() noexcept {
+    gbLevelArenaActive = true;
+}
+
+void Z_EndLevelArena() noexcept {
+    gbLevelArenaActive = false;
+    Z_ReleaseLevelArenaIfUnused();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: tells if an allocation with the given tag in the given zone should come from the level arena
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool Z_UseLevelArena(const memzone_t& zone, const int16_t tag) noexcept {
+    return (gbLevelArenaActive && (tag == PU_LEVEL) && (&zone == gpMainMemZone));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: tells if the given block of memory was allocated from the level arena
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool Z_IsLevelArenaBlock(const memblock_t& block) noexcept {
+    const std::byte* const pBlockBytes = (const std::byte*) &block;
+
+    for (const LevelArenaChunk& chunk : gLevelArenaChunks) {
+        const uintptr_t blockAddr = (uintptr_t) pBlockBytes;
+        const uintptr_t chunkStartAddr = (uintptr_t) chunk.pMem.get();
+
+        if ((blockAddr >= chunkStartAddr) && (blockAddr < chunkStartAddr + (uint32_t) chunk.usedSize))
+            return true;
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: allocate a block of memory from the level arena, with the same conventions as 'Z_Malloc'
+//------------------------------------------------------------------------------------------------------------------------------------------
+void* Z_LevelArenaMalloc(const int32_t size, const int16_t tag, void** const ppUser) noexcept {
+    // Blocks are aligned in the arena so that the block headers are always properly aligned
+    constexpr int32_t BLOCK_ALIGN = (int32_t) alignof(memblock_t);
+    const int32_t allocSize = (size + (int32_t) sizeof(memblock_t) + (BLOCK_ALIGN - 1)) & (-BLOCK_ALIGN);
+
+    // Get a new chunk of memory if there is not enough space left in the current one
+    if (gLevelArenaChunks.empty() || (gLevelArenaChunks.back().size - gLevelArenaChunks.back().usedSize < allocSize)) {
+        const int32_t chunkSize = std::max(LEVEL_ARENA_CHUNK_SIZE, allocSize);
+        gLevelArenaChunks.push_back(LevelArenaChunk{ std::unique_ptr<std::byte[]>(new std::byte[chunkSize]), chunkSize, 0 });
+    }
+
+    LevelArenaChunk& chunk = gLevelArenaChunks.back();
+    memblock_t& block = (memblock_t&) chunk.pMem[chunk.usedSize];
+    chunk.usedSize += allocSize;
+    gNumLevelArenaBlocks++;
+
+    // Setup the block and the pointer referencing it (if given)
+    block = {};
+    block.size = allocSize;
+    block.lockframe = -1;
+
+    if (ppUser) {
+        block.user = ppUser;
+        *ppUser = &(&block)[1];
+    } else {
+        if (tag >= PU_PURGELEVEL) {
+            I_Error("Z_Malloc: an owner is required for purgable blocks");
+        }
+
+        // Non purgable blocks without any owner are assigned a pointer value of '1'
+        block.user = (void**) 1;
+    }
+
+    block.tag = tag;
+    block.id = ZONEID;
+
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnAlloc(block);
+    #endif
+
+    return &(&block)[1];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: free a block of memory in the level arena.
+// The memory is not reused, but the arena is released once all of the blocks in it are freed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_MarkLevelArenaBlockFree(memblock_t& block) noexcept {
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnFree(block);
+    #endif
+
+    // Clear the pointer field referencing the memory block too.
+    // Treat very small addresses as not pointers also:
+    if (block.user > (void*) 0x100) {
+        *block.user = nullptr;
+    }
+
+    block.user = nullptr;
+    block.tag = 0;
+    block.id = 0;
+    gNumLevelArenaBlocks--;
+}
+
+void Z_FreeLevelArenaBlock(memblock_t& block) noexcept {
+    Z_MarkLevelArenaBlockFree(block);
+    Z_ReleaseLevelArenaIfUnused();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: free blocks in the level arena that have one or more of the given tag bits, if freeing tags for the main zone
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_FreeLevelArenaTags(const memzone_t& zone, const int16_t tagBits) noexcept {
+    if ((&zone != gpMainMemZone) || (gNumLevelArenaBlocks <= 0))
+        return;
+
+    for (LevelArenaChunk& chunk : gLevelArenaChunks) {
+        for (int32_t offset = 0; offset < chunk.usedSize;) {
+            memblock_t& block = (memblock_t&) chunk.pMem[offset];
+            offset += block.size;
+
+            if (block.user && ((block.tag & tagBits) != 0)) {
+                Z_MarkLevelArenaBlockFree(block);
+            }
+        }
+    }
+
+    Z_ReleaseLevelArenaIfUnused();
+}
+#endif  // #if PSYDOOM_MODS
+
+// PsyDoom: the functions below are for the original allocator, which scans the heap with a 'rover'.
+// If the segregated fit allocator is being used instead then those functions are implemented in 'z_zone_segfit.cpp'.
+#if !PSYDOOM_USE_SEGREGATED_ZONE
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Sets up the given block of memory as a memory zone
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -39,6 +275,12 @@ memzone_t* Z_InitZone(void* const pBase, const int32_t size) noexcept {
 
     pZone->size = size;
     pZone->rover = &pZone->blocklist;
+
+    #if PSYDOOM_MODS
+        pZone->pNextRegion = nullptr;
+        pZone->failedAllocSize = INT32_MAX;
+    #endif
+
     pZone->blocklist.size = size - MEMZONE_HEADER_SIZE;
     pZone->blocklist.user = nullptr;
     pZone->blocklist.tag = 0;
@@ -60,14 +302,30 @@ memzone_t* Z_InitZone(void* const pBase, const int32_t size) noexcept {
 // Optionally, a referencing pointer field can also be supplied which is updated when the block is allocated or freed.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void* Z_Malloc(memzone_t& zone, const int32_t size, const int16_t tag, void** const ppUser) noexcept {
+    // PsyDoom: level data allocated while the level is being setup comes from the level arena instead, if it is active
+    #if PSYDOOM_MODS
+        if (Z_UseLevelArena(zone, tag))
+            return Z_LevelArenaMalloc(size, tag, ppUser);
+    #endif
+
     // This is the real size to allocate: have to add room for a memblock and also 4-byte align
     const int32_t allocSize = (size + sizeof(memblock_t) + 3) & 0xFFFFFFFC;
 
+    // PsyDoom: skip straight to the next region of the zone if this region is already known to be too full for the allocation
+    #if PSYDOOM_MODS
+        if (allocSize >= zone.failedAllocSize)
+            return Z_Malloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+    #endif
+
     // Scan through the block list looking for the first free block of sufficient size.
     // Also throw out any purgable blocks along the way.
     memblock_t* pBase = zone.rover;
     memblock_t* const pStart = pBase;
 
+    #if PSYDOOM_MODS
+        int32_t numWraps = 0;
+    #endif
+
     while (pBase->user || (pBase->size < allocSize)) {
         // Set the rover to the next block if the current is free, so we can merge free blocks:
         memblock_t* const pRover = (pBase->user) ? pBase : pBase->next;
@@ -86,19 +344,47 @@ void* Z_Malloc(memzone_t& zone, const int32_t size, const int16_t tag, void** co
                 if (!pBase) {
                 block_list_begin:
                     pBase = &zone.blocklist;
+
+                    #if PSYDOOM_MODS
+                        ++numWraps;
+                    #endif
                 }
 
                 // If we have wrapped around back to where we started then we're out of RAM.
                 // In this case we have searched all blocks for one big enough and not found one :(
-                if (pBase == pStart) {
-                    Z_DumpHeap();
-                    I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                //
+                // PsyDoom: instead of failing try the next region of the zone, which is created if it doesn't exist yet.
+                // Also treat wrapping around twice as having searched all blocks. The block the search started at can be purged and
+                // merged into the free block before it, in which case we would never arrive back at it and the search would never end.
+                #if PSYDOOM_MODS
+                    const bool bSearchedAllBlocks = ((pBase == pStart) || (numWraps >= 2));
+                #else
+                    const bool bSearchedAllBlocks = (pBase == pStart);
+                #endif
+
+                if (bSearchedAllBlocks) {
+                    #if PSYDOOM_MODS
+                        zone.failedAllocSize = allocSize;
+                        return Z_Malloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+                    #else
+                        Z_DumpHeap();
+                        I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                    #endif
                 }
 
                 continue;
             }
 
             // Chuck out this block!
+            #if PSYDOOM_ZONE_STATS
+                Z_StatsOnPurge(*pRover);
+            #endif
+
+            #if PSYDOOM_MODS
+                gZoneNumPurges++;
+                gZonePurgedBytes += pRover->size;
+            #endif
+
             Z_Free2(*gpMainMemZone, &pRover[1]);
         }
 
@@ -154,6 +440,10 @@ void* Z_Malloc(memzone_t& zone, const int32_t size, const int16_t tag, void** co
     pBase->tag = tag;
     pBase->id = ZONEID;
 
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnAlloc(*pBase);
+    #endif
+
     // Move along the rover to the next block and return the usable memory allocated (past the allocated block header)
     zone.rover = (pBase->next) ? pBase->next : &zone.blocklist;
     return &pBase[1];
@@ -166,6 +456,12 @@ void* Z_Malloc(memzone_t& zone, const int32_t size, const int16_t tag, void** co
 void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void** const ppUser) noexcept {
     // This is the real size to allocate: have to add room for a memblock and also 4-byte align
     const int32_t allocSize = (size + sizeof(memblock_t) + 3) & 0xFFFFFFFC;
+
+    // PsyDoom: skip straight to the next region of the zone if this region is already known to be too full for the allocation
+    #if PSYDOOM_MODS
+        if (allocSize >= zone.failedAllocSize)
+            return Z_EndMalloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+    #endif
     
     // Start at the very last block in the list, since we want to alloc at the end of the heap
     memblock_t* pBase = &zone.blocklist;
@@ -184,8 +480,14 @@ void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void**
             pRover = pBase->prev;
 
             // Have we gone past the start? If so then we have failed...
+            // PsyDoom: instead of failing try the next region of the zone, which is created if it doesn't exist yet.
             if (!pRover) {
-                I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                #if PSYDOOM_MODS
+                    zone.failedAllocSize = allocSize;
+                    return Z_EndMalloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+                #else
+                    I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                #endif
             }
         }
 
@@ -197,14 +499,29 @@ void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void**
 
                 // If we have wrapped around back to the start of the zone then we're out of RAM.
                 // In this case we have searched all blocks for one big enough and not found one :(
+                // PsyDoom: instead of failing try the next region of the zone, which is created if it doesn't exist yet.
                 if (!pBase) {
-                    I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                    #if PSYDOOM_MODS
+                        zone.failedAllocSize = allocSize;
+                        return Z_EndMalloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+                    #else
+                        I_Error("Z_Malloc: failed allocation on %i", allocSize);
+                    #endif
                 }
 
                 continue;
             }
 
             // Chuck out this block!
+            #if PSYDOOM_ZONE_STATS
+                Z_StatsOnPurge(*pRover);
+            #endif
+
+            #if PSYDOOM_MODS
+                gZoneNumPurges++;
+                gZonePurgedBytes += pRover->size;
+            #endif
+
             Z_Free2(*gpMainMemZone, &pRover[1]);
         }
 
@@ -259,6 +576,10 @@ void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void**
     pBase->id = ZONEID;
     pBase->tag = tag;
 
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnAlloc(*pBase);
+    #endif
+
     // Set the rover for the zone and return the usable memory allocated (past the allocated block header)
     zone.rover = &zone.blocklist;
     return (void*) &pBase[1];
@@ -267,6 +588,7 @@ void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void**
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Free the given block of memory.
 // Note that the zone param is actually not needed here to perform the dealloc, perhaps it was passed in case it was needed in future?
+// PsyDoom: the zone is now used to find which region the block belongs to, so that region can be marked as having free memory again.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void Z_Free2([[maybe_unused]] memzone_t& zone, void* const ptr) noexcept {
     // Get the memory block header which is located before the actual memory.
@@ -277,6 +599,20 @@ void Z_Free2([[maybe_unused]] memzone_t& zone, void* const ptr) noexcept {
         I_Error("Z_Free: freed a pointer without ZONEID");
     }
 
+    // PsyDoom: blocks in the level arena need to be freed by the arena
+    #if PSYDOOM_MODS
+        if (Z_IsLevelArenaBlock(block)) {
+            Z_FreeLevelArenaBlock(block);
+            return;
+        }
+
+        Z_GetRegionForBlock(zone, &block).failedAllocSize = INT32_MAX;
+    #endif
+
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnFree(block);
+    #endif
+
     // Clear the pointer field referencing the memory block too.
     // Treat very small addresses as not pointers also:
     if (block.user > (void*) 0x100) {
@@ -292,6 +628,11 @@ void Z_Free2([[maybe_unused]] memzone_t& zone, void* const ptr) noexcept {
 // Free memory blocks that have one or more of the given tag bits
 //------------------------------------------------------------------------------------------------------------------------------------------
 void Z_FreeTags(memzone_t& zone, const int16_t tagBits) noexcept {
+    // PsyDoom: free matching blocks in the level arena also
+    #if PSYDOOM_MODS
+        Z_FreeLevelArenaTags(zone, tagBits);
+    #endif
+
     // Free each block if it is in use and matches one of the given tags
     for (memblock_t* pBlock = &zone.blocklist; pBlock; pBlock = pBlock->next) {
         if (pBlock->user) {
@@ -333,8 +674,20 @@ void Z_FreeTags(memzone_t& zone, const int16_t tagBits) noexcept {
 
     // Reset the rover back to the start of the heap
     zone.rover = &zone.blocklist;
+
+    // PsyDoom: allocations which previously failed might fit now.
+    // Free matching blocks in any additional regions of the zone also.
+    #if PSYDOOM_MODS
+        zone.failedAllocSize = INT32_MAX;
+
+        if (zone.pNextRegion) {
+            Z_FreeTags(*zone.pNextRegion, tagBits);
+        }
+    #endif
 }
 
+#endif  // #if !PSYDOOM_USE_SEGREGATED_ZONE
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Performs basic sanity checks for the integrity of the heap.
 // If any sanity checks fail, then a fatal error is emitted.
@@ -368,9 +721,25 @@ void Z_CheckHeap(const memzone_t& zone) noexcept {
         if (pBlock->next->prev != pBlock) {
             I_Error("Z_CheckHeap: next block doesn't have proper back link\n");
         }
+
+        // PsyDoom: the segregated fit allocator always merges free blocks immediately, so there should never be two free blocks together
+        #if PSYDOOM_USE_SEGREGATED_ZONE
+            if ((!pBlock->user) && (!pBlock->next->user)) {
+                I_Error("Z_CheckHeap: adjacent free blocks were not merged\n");
+            }
+        #endif
     }
+
+    // PsyDoom: check any additional regions of the zone also
+    #if PSYDOOM_MODS
+        if (zone.pNextRegion) {
+            Z_CheckHeap(*zone.pNextRegion);
+        }
+    #endif
 }
 
+#if !PSYDOOM_USE_SEGREGATED_ZONE
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Update the tags for a given block of memory
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -388,11 +757,22 @@ void Z_ChangeTag(void* const ptr, const int16_t tagBits) noexcept {
         if (block.user < (void*) 0x100) {
             I_Error("Z_ChangeTag: an owner is required for purgable blocks");
         }
+
+        // PsyDoom: allocations which previously failed in the block's region might fit now, since the block can be purged
+        #if PSYDOOM_MODS
+            Z_GetRegionForBlock(*gpMainMemZone, &block).failedAllocSize = INT32_MAX;
+        #endif
     }
 
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnChangeTag(block, tagBits);
+    #endif
+
     block.tag = (int16_t) tagBits;
 }
 
+#endif  // #if !PSYDOOM_USE_SEGREGATED_ZONE
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Counts and returns the number of free bytes in the given memory zone
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -405,11 +785,357 @@ int32_t Z_FreeMemory(memzone_t& zone) noexcept {
         }
     }
 
+    // PsyDoom: include free memory in any additional regions of the zone also
+    #if PSYDOOM_MODS
+        if (zone.pNextRegion) {
+            bytesFree += Z_FreeMemory(*zone.pNextRegion);
+        }
+    #endif
+
     return bytesFree;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // This function is empty in PSX DOOM - probably compiled out of the release build.
 // If you want this functionality you could take a look at the Linux DOOM source.
+//
+// PsyDoom: this now prints a map of all the blocks in the main zone (and any additional regions of it) to standard output,
+// followed by a summary of used, purgable and free memory for each region and the level arena.
 //------------------------------------------------------------------------------------------------------------------------------------------
+#if PSYDOOM_MODS
+void Z_DumpHeap() noexcept {
+    if (!gpMainMemZone)
+        return;
+
+    int32_t regionIdx = 0;
+
+    for (const memzone_t* pRegion = gpMainMemZone; pRegion; pRegion = pRegion->pNextRegion, ++regionIdx) {
+        std::printf("Zone region %d: %d bytes\n", regionIdx, pRegion->size);
+        std::printf("  %10s %10s %6s %s\n", "offset", "size", "tag", "user");
+
+        int32_t numBlocks = 0;
+        int32_t usedBytes = 0;
+        int32_t purgableBytes = 0;
+        int32_t freeBytes = 0;
+        int32_t largestFreeBlock = 0;
+
+        for (const memblock_t* pBlock = &pRegion->blocklist; pBlock; pBlock = pBlock->next) {
+            const int32_t offset = (int32_t)((const std::byte*) pBlock - (const std::byte*) pRegion);
+            ++numBlocks;
+
+            if (pBlock->user) {
+                std::printf("  %10d %10d 0x%04X %p\n", offset, pBlock->size, (uint16_t) pBlock->tag, (const void*) pBlock->user);
+
+                if (pBlock->tag >= PU_PURGELEVEL) {
+                    purgableBytes += pBlock->size;
+                } else {
+                    usedBytes += pBlock->size;
+                }
+            } else {
+                std::printf("  %10d %10d   free\n", offset, pBlock->size);
+                freeBytes += pBlock->size;
+                largestFreeBlock = std::max(largestFreeBlock, pBlock->size);
+            }
+        }
+
+        std::printf(
+            "  %d blocks, %d bytes used, %d bytes purgable, %d bytes free, largest free block %d bytes\n",
+            numBlocks, usedBytes, purgableBytes, freeBytes, largestFreeBlock
+        );
+    }
+
+    int32_t arenaSize = 0;
+    int32_t arenaUsedSize = 0;
+
+    for (const LevelArenaChunk& chunk : gLevelArenaChunks) {
+        arenaSize += chunk.size;
+        arenaUsedSize += chunk.usedSize;
+    }
+
+    std::printf(
+        "Level arena: %d chunks, %d of %d bytes used, %d blocks still allocated\n",
+        (int32_t) gLevelArenaChunks.size(), arenaUsedSize, arenaSize, gNumLevelArenaBlocks
+    );
+
+    std::fflush(stdout);
+}
+#else
 void Z_DumpHeap() noexcept {}
+#endif
+
+#if PSYDOOM_ZONE_STATS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: get which tag bit the bytes for a block with the given tag are counted against for zone memory statistics
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t Z_GetStatsTagIdx(const int16_t tag) noexcept {
+    const uint32_t tagBits = (uint16_t) tag;
+
+    for (int32_t tagIdx = 0; tagIdx < Z_NUM_STATS_TAGS; ++tagIdx) {
+        if (tagBits & (1u << tagIdx))
+            return tagIdx;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: adjust the number of bytes in use for the given tag by the given amount, updating peaks also
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_StatsAddUsedBytes(const int16_t tag, const int32_t numBytes) noexcept {
+    const int32_t tagIdx = Z_GetStatsTagIdx(tag);
+
+    gZoneStats.usedBytes += numBytes;
+    gZoneStats.tagUsedBytes[tagIdx] += numBytes;
+    gZoneStats.peakUsedBytes = std::max(gZoneStats.peakUsedBytes, gZoneStats.usedBytes);
+    gZoneStats.tagPeakUsedBytes[tagIdx] = std::max(gZoneStats.tagPeakUsedBytes[tagIdx], gZoneStats.tagUsedBytes[tagIdx]);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: update zone memory statistics for the given block being allocated, freed, purged or re-tagged.
+// These must be called while the block is still in use, so that it's size and tag are valid.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_StatsOnAlloc(const memblock_t& block) noexcept {
+    gZoneStats.numAllocs++;
+    gZoneStats.allocBytes += block.size;
+    Z_StatsAddUsedBytes(block.tag, block.size);
+}
+
+void Z_StatsOnFree(const memblock_t& block) noexcept {
+    if (!block.user)
+        return;
+
+    gZoneStats.numFrees++;
+    Z_StatsAddUsedBytes(block.tag, -block.size);
+}
+
+void Z_StatsOnPurge(const memblock_t& block) noexcept {
+    gZoneStats.numPurges++;
+    gZoneStats.purgedBytes += block.size;
+}
+
+void Z_StatsOnChangeTag(const memblock_t& block, const int16_t newTag) noexcept {
+    if (!block.user)
+        return;
+
+    Z_StatsAddUsedBytes(block.tag, -block.size);
+    Z_StatsAddUsedBytes(newTag, block.size);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: returns the size of the largest free block in the given zone, including any additional regions of it
+//------------------------------------------------------------------------------------------------------------------------------------------
+int32_t Z_LargestFreeBlock(const memzone_t& zone) noexcept {
+    int32_t largestFreeBlock = 0;
+
+    for (const memzone_t* pRegion = &zone; pRegion; pRegion = pRegion->pNextRegion) {
+        for (const memblock_t* pBlock = &pRegion->blocklist; pBlock; pBlock = pBlock->next) {
+            if (!pBlock->user) {
+                largestFreeBlock = std::max(largestFreeBlock, pBlock->size);
+            }
+        }
+    }
+
+    return largestFreeBlock;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: records zone memory statistics which are sampled once per frame, such as the largest free block.
+// The largest free block shows how fragmented the heap gets, and the smallest value seen is how big an allocation could always succeed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_SampleFrameStats() noexcept {
+    if (!gpMainMemZone)
+        return;
+
+    int32_t numRegions = 0;
+
+    for (const memzone_t* pRegion = gpMainMemZone; pRegion; pRegion = pRegion->pNextRegion) {
+        ++numRegions;
+    }
+
+    gZoneStats.numFrames++;
+    gZoneStats.largestFreeBlock = Z_LargestFreeBlock(*gpMainMemZone);
+    gZoneStats.minLargestFreeBlock = std::min(gZoneStats.minLargestFreeBlock, gZoneStats.largestFreeBlock);
+    gZoneStats.peakNumRegions = std::max(gZoneStats.peakNumRegions, numRegions);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: starts a new period (usually a level) for recording zone memory statistics.
+// Counts are reset, and peaks restart from the memory which is in use right now.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_BeginStatsPeriod() noexcept {
+    gZoneStats.numAllocs = 0;
+    gZoneStats.numFrees = 0;
+    gZoneStats.numPurges = 0;
+    gZoneStats.allocBytes = 0;
+    gZoneStats.purgedBytes = 0;
+    gZoneStats.peakUsedBytes = gZoneStats.usedBytes;
+
+    for (int32_t tagIdx = 0; tagIdx < Z_NUM_STATS_TAGS; ++tagIdx) {
+        gZoneStats.tagPeakUsedBytes[tagIdx] = gZoneStats.tagUsedBytes[tagIdx];
+    }
+
+    gZoneStats.numFrames = 0;
+    gZoneStats.largestFreeBlock = (gpMainMemZone) ? Z_LargestFreeBlock(*gpMainMemZone) : 0;
+    gZoneStats.minLargestFreeBlock = gZoneStats.largestFreeBlock;
+    gZoneStats.peakNumRegions = 0;
+}
+#endif  // #if PSYDOOM_ZONE_STATS
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: runs a series of allocation heavy workloads against the main memory zone and reports how long each one took.
+// Build with 'PSYDOOM_USE_SEGREGATED_ZONE' on and off to compare the segregated fit and original 'rover' allocators.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_RunBenchmark() noexcept {
+    if (!gpMainMemZone) {
+        Z_Init();
+    }
+
+    memzone_t& zone = *gpMainMemZone;
+
+    // A simple xorshift random number generator, so that each run (and each allocator) sees the exact same sequence of operations
+    uint32_t randState = 0x2545F491;
+
+    const auto randomInRange = [&](const int32_t minValue, const int32_t maxValue) noexcept {
+        randState ^= randState << 13;
+        randState ^= randState >> 17;
+        randState ^= randState << 5;
+        return minValue + (int32_t)(randState % (uint32_t)(maxValue - minValue + 1));
+    };
+
+    // Times the given workload and prints the results, checking that the heap is intact afterwards.
+    // How many blocks were purged and how many bytes that evicted is also reported, since the allocators choose different blocks to purge.
+    typedef std::chrono::steady_clock clock_t;
+
+    const auto timeWorkload = [&](const char* const name, const uint32_t numOps, auto&& workload) noexcept {
+        const uint32_t startNumPurges = gZoneNumPurges;
+        const int64_t startPurgedBytes = gZonePurgedBytes;
+        const clock_t::time_point startTime = clock_t::now();
+        workload();
+        const double elapsedSecs = std::chrono::duration<double>(clock_t::now() - startTime).count();
+        Z_CheckHeap(zone);
+
+        const uint32_t numPurges = gZoneNumPurges - startNumPurges;
+        const int64_t purgedBytes = gZonePurgedBytes - startPurgedBytes;
+
+        std::printf(
+            "  %-22s %9.2f ms %9.1f ns/op %8.3f purges/op %10.1f purged bytes/op\n",
+            name,
+            elapsedSecs * 1000.0,
+            elapsedSecs * 1e9 / numOps,
+            (double) numPurges / numOps,
+            (double) purgedBytes / numOps
+        );
+    };
+
+    #if PSYDOOM_USE_SEGREGATED_ZONE
+        std::printf("Zone allocator benchmark: segregated fit allocator, %u byte heap\n", (uint32_t) zone.size);
+    #else
+        std::printf("Zone allocator benchmark: original rover allocator, %u byte heap\n", (uint32_t) zone.size);
+    #endif
+
+    // Level loads: lots of small map data and thinker allocations, all freed together at the end of the level
+    constexpr uint32_t NUM_LEVEL_LOADS = 100;
+    constexpr uint32_t NUM_LEVEL_ALLOCS = 3000;
+    constexpr uint32_t NUM_LEVSPEC_ALLOCS = 300;
+
+    timeWorkload("Level loads", NUM_LEVEL_LOADS * (NUM_LEVEL_ALLOCS + NUM_LEVSPEC_ALLOCS + 1), [&]() noexcept {
+        for (uint32_t levelIdx = 0; levelIdx < NUM_LEVEL_LOADS; ++levelIdx) {
+            for (uint32_t allocIdx = 0; allocIdx < NUM_LEVEL_ALLOCS; ++allocIdx) {
+                Z_Malloc(zone, randomInRange(16, 400), PU_LEVEL, nullptr);
+            }
+
+            for (uint32_t allocIdx = 0; allocIdx < NUM_LEVSPEC_ALLOCS; ++allocIdx) {
+                Z_Malloc(zone, randomInRange(32, 160), PU_LEVSPEC, nullptr);
+            }
+
+            Z_FreeTags(zone, PU_LEVEL | PU_LEVSPEC);
+        }
+    });
+
+    // Thinker churn: small blocks being allocated and freed in a random order, like doors and platforms starting and stopping
+    constexpr uint32_t NUM_THINKER_SLOTS = 1024;
+    constexpr uint32_t NUM_THINKER_OPS = 500000;
+    std::vector<void*> blockOwners(NUM_THINKER_SLOTS);
+
+    timeWorkload("Thinker churn", NUM_THINKER_OPS, [&]() noexcept {
+        for (uint32_t opIdx = 0; opIdx < NUM_THINKER_OPS; ++opIdx) {
+            void*& pBlock = blockOwners[randomInRange(0, NUM_THINKER_SLOTS - 1)];
+
+            if (pBlock) {
+                Z_Free2(zone, pBlock);
+            } else {
+                Z_Malloc(zone, randomInRange(32, 256), PU_LEVSPEC, &pBlock);
+            }
+        }
+
+        Z_FreeTags(zone, PU_LEVSPEC);
+    });
+
+    // Cache churn: purgable texture data which needs far more memory than the heap has, on top of a level using a good chunk of the heap.
+    // This forces constant eviction of 'PU_CACHE' blocks.
+    constexpr uint32_t NUM_CACHE_SLOTS = 4096;
+    constexpr uint32_t NUM_CACHE_OPS = 200000;
+    blockOwners.assign(NUM_CACHE_SLOTS, nullptr);
+
+    timeWorkload("Cache churn", NUM_CACHE_OPS, [&]() noexcept {
+        while (Z_FreeMemory(zone) > zone.size * 6 / 10) {
+            Z_Malloc(zone, randomInRange(16, 400), PU_LEVEL, nullptr);
+        }
+
+        for (uint32_t opIdx = 0; opIdx < NUM_CACHE_OPS; ++opIdx) {
+            void*& pBlock = blockOwners[randomInRange(0, NUM_CACHE_SLOTS - 1)];
+
+            if (!pBlock) {
+                Z_Malloc(zone, randomInRange(256, 16384), PU_CACHE, &pBlock);
+            } else if (randomInRange(0, 3) == 0) {
+                Z_Free2(zone, pBlock);
+            }
+        }
+
+        Z_FreeTags(zone, PU_CACHE | PU_LEVEL);
+    });
+
+    // Fragmented cache: the heap is filled with purgable blocks interleaved with small level blocks which can't be purged, then purgable
+    // blocks are allocated at random sizes. Nearly every allocation needs purging, and the ops reported are the allocations alone, so this
+    // compares how much of the cache each allocator evicts to make room.
+    constexpr uint32_t NUM_FRAG_SLOTS = 8192;
+    constexpr uint32_t NUM_FRAG_ALLOCS = 50000;
+    blockOwners.assign(NUM_FRAG_SLOTS, nullptr);
+
+    for (uint32_t slotIdx = 0; slotIdx < NUM_FRAG_SLOTS; ++slotIdx) {
+        if (Z_FreeMemory(zone) < zone.size / 20)
+            break;
+
+        Z_Malloc(zone, randomInRange(16, 128), PU_LEVEL, nullptr);
+        Z_Malloc(zone, randomInRange(256, 8192), PU_CACHE, &blockOwners[slotIdx]);
+    }
+
+    timeWorkload("Fragmented cache", NUM_FRAG_ALLOCS, [&]() noexcept {
+        for (uint32_t allocIdx = 0; allocIdx < NUM_FRAG_ALLOCS; ++allocIdx) {
+            void*& pBlock = blockOwners[randomInRange(0, NUM_FRAG_SLOTS - 1)];
+
+            if (pBlock) {
+                Z_Free2(zone, pBlock);
+            }
+
+            Z_Malloc(zone, randomInRange(256, 16384), PU_CACHE, &pBlock);
+        }
+    });
+
+    Z_FreeTags(zone, PU_CACHE | PU_LEVEL);
+
+    // Temporary buffers: allocations at the end of the heap, like those used when reading lumps, with other allocations in between
+    constexpr uint32_t NUM_TEMP_BUFFERS = 10000;
+
+    timeWorkload("End of heap buffers", NUM_TEMP_BUFFERS * 3, [&]() noexcept {
+        for (uint32_t bufferIdx = 0; bufferIdx < NUM_TEMP_BUFFERS; ++bufferIdx) {
+            void* const pTmpBuffer = Z_EndMalloc(zone, randomInRange(4096, 65536), PU_STATIC, nullptr);
+            Z_Malloc(zone, randomInRange(16, 64), PU_LEVEL, nullptr);
+            Z_Free2(zone, pTmpBuffer);
+        }
+
+        Z_FreeTags(zone, PU_LEVEL);
+    });
+}
+#endif  // #if PSYDOOM_MODS
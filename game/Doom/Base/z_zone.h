@@ -18,6 +18,52 @@ static constexpr int16_t PU_CACHE       = 0x20;     // Used to temporarily cache
 // All blocks must have this id
 static constexpr int16_t ZONEID = 0x1D4A;
 
+#if PSYDOOM_USE_SEGREGATED_ZONE
+    // PsyDoom: a link in one of the circular doubly linked lists used by the segregated fit zone allocator.
+    // The list heads are links also, which act as sentinels so that a link can always be removed without knowing which list it is in.
+    struct zlink_t {
+        zlink_t*    next;
+        zlink_t*    prev;
+    };
+
+    // PsyDoom: the number of size class lists for free blocks used by the segregated fit zone allocator.
+    // Each power of two size range (the 'first level') is split into a number of evenly sized ranges (the 'second level').
+    static constexpr int32_t Z_NUM_FREE_LIST_FL_BITS = 24;      // Free blocks must be less than 16 MiB in size
+    static constexpr int32_t Z_FREE_LIST_SL_SHIFT = 3;
+    static constexpr int32_t Z_NUM_FREE_LIST_SL = 1 << Z_FREE_LIST_SL_SHIFT;
+
+    // PsyDoom: the number of lists of in use blocks used by the segregated fit zone allocator.
+    // Blocks with single bit tags go in a list per bit, and blocks with any other tags go in the last list.
+    static constexpr int32_t Z_NUM_TAG_LISTS = 16;
+#endif
+
+#if PSYDOOM_ZONE_STATS
+    // PsyDoom: the number of tag bits that zone memory statistics are kept for.
+    // Bytes for each block are counted against the lowest bit set in the block's tag.
+    static constexpr int32_t Z_NUM_STATS_TAGS = 16;
+
+    // PsyDoom: statistics on zone memory usage, recorded by the allocator when 'PSYDOOM_ZONE_STATS' is enabled.
+    // Counts and peaks are for the current stats period (usually a level), while the used byte counts are for the memory in use right now.
+    // All byte counts include the block headers and any alignment padding, and memory in the level arena is counted as used.
+    struct zonestats_t {
+        int32_t     numAllocs;                                  // Number of blocks allocated
+        int32_t     numFrees;                                   // Number of blocks freed (including purges)
+        int32_t     numPurges;                                  // Number of purgable blocks evicted to make room for an allocation
+        int64_t     allocBytes;                                 // Total bytes allocated
+        int64_t     purgedBytes;                                // Total bytes evicted by purging
+        int32_t     usedBytes;                                  // Bytes currently in use
+        int32_t     peakUsedBytes;                              // Most bytes in use at once
+        int32_t     tagUsedBytes[Z_NUM_STATS_TAGS];             // Bytes currently in use for each tag bit
+        int32_t     tagPeakUsedBytes[Z_NUM_STATS_TAGS];         // Most bytes in use at once for each tag bit
+        int32_t     numFrames;                                  // Number of frames sampled
+        int32_t     largestFreeBlock;                           // Size of the largest free block when the last frame was sampled
+        int32_t     minLargestFreeBlock;                        // Smallest 'largest free block' seen in any sampled frame
+        int32_t     peakNumRegions;                             // Most regions the main zone had at the end of a sampled frame
+    };
+
+    extern zonestats_t gZoneStats;
+#endif
+
 // Holds details on a block of memory
 struct memblock_t {
     int32_t         size;           // Including the header and possibly tiny fragments
@@ -27,12 +73,36 @@ struct memblock_t {
     int32_t         lockframe;      // Don't purge on this frame
     memblock_t*     next;
     memblock_t*     prev;
+
+    // PsyDoom: links the block into a size class list when free, or the list of blocks with the same tag when in use
+    #if PSYDOOM_USE_SEGREGATED_ZONE
+        zlink_t     listLink;
+    #endif
 };
 
 // Info for a memory allocation zone
 struct memzone_t {
     int32_t         size;           // Total bytes malloced, including header
     memblock_t*     rover;
+
+    // PsyDoom: the next region of memory in the zone, if the zone has grown beyond it's initial size.
+    // Each additional region is a zone in it's own right, and allocations which don't fit in a region move onto the next one.
+    // The original allocator also remembers the smallest allocation which did not fit in the region, so it can skip over full regions
+    // without scanning them. This is reset whenever memory in the region is freed or made purgable.
+    #if PSYDOOM_MODS
+        memzone_t*  pNextRegion;
+        int32_t     failedAllocSize;
+    #endif
+
+    // PsyDoom: lists of free blocks by size class and of in use blocks by tag, for the segregated fit zone allocator.
+    // The bitmasks say which size class lists are non empty, so a suitably sized free block can be found without searching.
+    #if PSYDOOM_USE_SEGREGATED_ZONE
+        uint32_t    freeListFLBits;
+        uint32_t    freeListSLBits[Z_NUM_FREE_LIST_FL_BITS];
+        zlink_t     freeLists[Z_NUM_FREE_LIST_FL_BITS][Z_NUM_FREE_LIST_SL];
+        zlink_t     tagLists[Z_NUM_TAG_LISTS];
+    #endif
+
     memblock_t      blocklist;      // Start / end cap for linked list
 };
 
@@ -48,3 +118,36 @@ void Z_CheckHeap(const memzone_t& zone) noexcept;
 void Z_ChangeTag(void* const ptr, const int16_t tagBits) noexcept;
 int32_t Z_FreeMemory(memzone_t& zone) noexcept;
 void Z_DumpHeap() noexcept;
+
+#if PSYDOOM_MODS
+    // PsyDoom: how many purgable blocks have been evicted in total by the allocator, and their size.
+    // These are always counted (unlike the zone memory stats) so that '-benchzone' can compare eviction volume between the allocators.
+    extern uint32_t gZoneNumPurges;
+    extern int64_t  gZonePurgedBytes;
+
+    void Z_RunBenchmark() noexcept;
+
+    // PsyDoom: growing the zone with additional regions of memory, used by the allocator implementations
+    memzone_t& Z_GetNextRegion(memzone_t& zone, const int32_t allocSize) noexcept;
+    memzone_t& Z_GetRegionForBlock(memzone_t& zone, const void* const ptr) noexcept;
+
+    // PsyDoom: the level arena, a fast bump allocator for 'PU_LEVEL' allocations made while a level is being setup
+    void Z_BeginLevelArena() noexcept;
+    void Z_EndLevelArena() noexcept;
+    bool Z_UseLevelArena(const memzone_t& zone, const int16_t tag) noexcept;
+    bool Z_IsLevelArenaBlock(const memblock_t& block) noexcept;
+    void* Z_LevelArenaMalloc(const int32_t size, const int16_t tag, void** const ppUser) noexcept;
+    void Z_FreeLevelArenaBlock(memblock_t& block) noexcept;
+    void Z_FreeLevelArenaTags(const memzone_t& zone, const int16_t tagBits) noexcept;
+#endif
+
+#if PSYDOOM_ZONE_STATS
+    // PsyDoom: zone memory statistics, recorded by the allocator implementations
+    void Z_StatsOnAlloc(const memblock_t& block) noexcept;
+    void Z_StatsOnFree(const memblock_t& block) noexcept;
+    void Z_StatsOnPurge(const memblock_t& block) noexcept;
+    void Z_StatsOnChangeTag(const memblock_t& block, const int16_t newTag) noexcept;
+    void Z_SampleFrameStats() noexcept;
+    void Z_BeginStatsPeriod() noexcept;
+    int32_t Z_LargestFreeBlock(const memzone_t& zone) noexcept;
+#endif
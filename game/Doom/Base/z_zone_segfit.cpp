@@ -0,0 +1,691 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: an alternative implementation of the zone memory allocator which uses segregated fit free lists.
+// Free blocks are kept in lists according to their size class, so a suitably sized block can be found in constant time rather than by
+// scanning the heap with a 'rover'. In use blocks are also kept in lists according to their tag, so that 'Z_FreeTags' only needs to visit the
+// blocks which are affected. Free blocks are merged with their neighbors immediately when freed. The heap is only walked (from a 'rover')
+// when no free block is big enough and purgable blocks must be evicted, and like the original only the contiguous run of blocks that the
+// allocation goes into is evicted.
+//
+// This allocator has the same semantics for tags, purging and owner pointers as the original one but does not allocate blocks in the
+// exact same places. It is enabled with the 'PSYDOOM_USE_SEGREGATED_ZONE' CMake option, and replaces the allocation functions in 'z_zone.cpp'.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "z_zone.h"
+
+#if PSYDOOM_USE_SEGREGATED_ZONE
+
+#include "i_main.h"
+
+#include <cstddef>
+
+#if _MSC_VER
+    #include <intrin.h>
+#endif
+
+// The minimum size that a memory block must be
+static constexpr int32_t MINFRAGMENT = 64;
+
+// Size of the fields of the memory zone preceding the first memory block
+static constexpr size_t MEMZONE_HEADER_SIZE = offsetof(memzone_t, blocklist);
+
+// What all memory block sizes are rounded up to, so that all block headers are suitably aligned
+static constexpr int32_t BLOCK_ALIGN = (int32_t) alignof(memblock_t);
+
+// The index of the list for in use blocks which don't have a single bit tag
+static constexpr int32_t OTHER_TAGS_LIST_IDX = Z_NUM_TAG_LISTS - 1;
+
+static_assert(MINFRAGMENT >= (int32_t) sizeof(memblock_t), "Free block fragments must be big enough to hold a block header!");
+static_assert((int32_t) sizeof(memblock_t) >= (1 << Z_FREE_LIST_SL_SHIFT), "Blocks are too small for the size class calculation!");
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the index of the lowest or highest set bit in the given bits, which must not be zero
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t Z_FindFirstSetBit(const uint32_t bits) noexcept {
+    #if _MSC_VER
+        unsigned long bitIdx;
+        _BitScanForward(&bitIdx, bits);
+        return (int32_t) bitIdx;
+    #else
+        return __builtin_ctz(bits);
+    #endif
+}
+
+static int32_t Z_FindLastSetBit(const uint32_t bits) noexcept {
+    #if _MSC_VER
+        unsigned long bitIdx;
+        _BitScanReverse(&bitIdx, bits);
+        return (int32_t) bitIdx;
+    #else
+        return 31 - __builtin_clz(bits);
+    #endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Helpers for manipulating the circular linked lists of blocks
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_InitList(zlink_t& list) noexcept {
+    list.next = &list;
+    list.prev = &list;
+}
+
+static void Z_ListAddBack(zlink_t& list, zlink_t& link) noexcept {
+    link.next = &list;
+    link.prev = list.prev;
+    list.prev->next = &link;
+    list.prev = &link;
+}
+
+static void Z_ListRemove(zlink_t& link) noexcept {
+    link.prev->next = link.next;
+    link.next->prev = link.prev;
+    link.next = nullptr;
+    link.prev = nullptr;
+}
+
+static memblock_t& Z_LinkToBlock(zlink_t& link) noexcept {
+    return *(memblock_t*)((std::byte*) &link - offsetof(memblock_t, listLink));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the real size to allocate for a block of the given size: have to add room for a memblock and also align
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t Z_GetAllocSize(const int32_t size) noexcept {
+    return (size + (int32_t) sizeof(memblock_t) + (BLOCK_ALIGN - 1)) & (-BLOCK_ALIGN);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get which list blocks with the given tag go in when they are in use
+//------------------------------------------------------------------------------------------------------------------------------------------
+static int32_t Z_GetTagListIdx(const int16_t tag) noexcept {
+    const bool bIsSingleBitTag = ((tag > 0) && ((tag & (tag - 1)) == 0));
+    return (bIsSingleBitTag) ? Z_FindFirstSetBit((uint32_t) tag) : OTHER_TAGS_LIST_IDX;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the size class (free list) for a free block of the given size
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_GetFreeListIdx(const uint32_t size, int32_t& flIdx, int32_t& slIdx) noexcept {
+    flIdx = Z_FindLastSetBit(size);
+    slIdx = (int32_t)(size >> (flIdx - Z_FREE_LIST_SL_SHIFT)) & (Z_NUM_FREE_LIST_SL - 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Add or remove a free block from the size class list that it belongs in
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_AddFreeBlock(memzone_t& zone, memblock_t& block) noexcept {
+    int32_t flIdx, slIdx;
+    Z_GetFreeListIdx(block.size, flIdx, slIdx);
+    Z_ListAddBack(zone.freeLists[flIdx][slIdx], block.listLink);
+
+    zone.freeListFLBits |= 1u << flIdx;
+    zone.freeListSLBits[flIdx] |= 1u << slIdx;
+}
+
+static void Z_RemoveFreeBlock(memzone_t& zone, memblock_t& block) noexcept {
+    int32_t flIdx, slIdx;
+    Z_GetFreeListIdx(block.size, flIdx, slIdx);
+    Z_ListRemove(block.listLink);
+
+    // Clear the bits saying the size class and range of size classes have free blocks, if that is no longer true
+    zlink_t& list = zone.freeLists[flIdx][slIdx];
+
+    if (list.next == &list) {
+        zone.freeListSLBits[flIdx] &= ~(1u << slIdx);
+
+        if (zone.freeListSLBits[flIdx] == 0) {
+            zone.freeListFLBits &= ~(1u << flIdx);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Changes the size of a free block, moving it to a different size class list only if required
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_SetFreeBlockSize(memzone_t& zone, memblock_t& block, const int32_t newSize) noexcept {
+    int32_t oldFlIdx, oldSlIdx;
+    int32_t newFlIdx, newSlIdx;
+    Z_GetFreeListIdx(block.size, oldFlIdx, oldSlIdx);
+    Z_GetFreeListIdx(newSize, newFlIdx, newSlIdx);
+
+    if ((oldFlIdx == newFlIdx) && (oldSlIdx == newSlIdx)) {
+        block.size = newSize;
+    } else {
+        Z_RemoveFreeBlock(zone, block);
+        block.size = newSize;
+        Z_AddFreeBlock(zone, block);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Replaces a free block in the free lists with another free block.
+// If both blocks are in the same size class then the new block simply takes the place of the old one in it's list.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_ReplaceFreeBlock(memzone_t& zone, memblock_t& oldBlock, memblock_t& newBlock) noexcept {
+    int32_t oldFlIdx, oldSlIdx;
+    int32_t newFlIdx, newSlIdx;
+    Z_GetFreeListIdx(oldBlock.size, oldFlIdx, oldSlIdx);
+    Z_GetFreeListIdx(newBlock.size, newFlIdx, newSlIdx);
+
+    if ((oldFlIdx == newFlIdx) && (oldSlIdx == newSlIdx)) {
+        zlink_t& oldLink = oldBlock.listLink;
+        zlink_t& newLink = newBlock.listLink;
+        newLink.next = oldLink.next;
+        newLink.prev = oldLink.prev;
+        newLink.next->prev = &newLink;
+        newLink.prev->next = &newLink;
+        oldLink.next = nullptr;
+        oldLink.prev = nullptr;
+    } else {
+        Z_RemoveFreeBlock(zone, oldBlock);
+        Z_AddFreeBlock(zone, newBlock);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Find a free block which is at least the given size, returning null if there is none.
+// Prefers the smallest size class that is guaranteed to satisfy the request, so that large free blocks are not needlessly broken up.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static memblock_t* Z_FindFreeBlock(memzone_t& zone, const int32_t allocSize) noexcept {
+    // Round the size up to the start of the next size class so that every block in the size class found is big enough
+    int32_t flIdx, slIdx;
+    Z_GetFreeListIdx(allocSize, flIdx, slIdx);
+
+    const uint32_t roundedSize = (uint32_t) allocSize + (1u << (flIdx - Z_FREE_LIST_SL_SHIFT)) - 1;
+    int32_t roundedFlIdx, roundedSlIdx;
+    Z_GetFreeListIdx(roundedSize, roundedFlIdx, roundedSlIdx);
+
+    if (roundedFlIdx < Z_NUM_FREE_LIST_FL_BITS) {
+        // Look for a non empty size class in the same power of two range first, then in the bigger ranges
+        uint32_t slBits = zone.freeListSLBits[roundedFlIdx] & (~0u << roundedSlIdx);
+
+        if (slBits == 0) {
+            const uint32_t flBits = zone.freeListFLBits & (~0u << (roundedFlIdx + 1));
+
+            if (flBits != 0) {
+                roundedFlIdx = Z_FindFirstSetBit(flBits);
+                slBits = zone.freeListSLBits[roundedFlIdx];
+            }
+        }
+
+        if (slBits != 0) {
+            roundedSlIdx = Z_FindFirstSetBit(slBits);
+            return &Z_LinkToBlock(*zone.freeLists[roundedFlIdx][roundedSlIdx].next);
+        }
+    }
+
+    // Otherwise the only blocks which might be big enough are in the size class that the requested size falls in: search that
+    zlink_t& list = zone.freeLists[flIdx][slIdx];
+
+    for (zlink_t* pLink = list.next; pLink != &list; pLink = pLink->next) {
+        memblock_t& block = Z_LinkToBlock(*pLink);
+
+        if (block.size >= allocSize)
+            return &block;
+    }
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Find the free block closest to the end of the heap which is at least the given size, returning null if there is none.
+// This has to visit every free block which could be big enough, but it is only used occasionally for temporary buffers.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static memblock_t* Z_FindFreeBlockNearestEnd(memzone_t& zone, const int32_t allocSize) noexcept {
+    int32_t minFlIdx, minSlIdx;
+    Z_GetFreeListIdx(allocSize, minFlIdx, minSlIdx);
+    memblock_t* pBestBlock = nullptr;
+
+    for (uint32_t flBits = zone.freeListFLBits & (~0u << minFlIdx); flBits != 0; flBits &= flBits - 1) {
+        const int32_t flIdx = Z_FindFirstSetBit(flBits);
+        uint32_t slBits = zone.freeListSLBits[flIdx];
+
+        if (flIdx == minFlIdx) {
+            slBits &= ~0u << minSlIdx;
+        }
+
+        for (; slBits != 0; slBits &= slBits - 1) {
+            zlink_t& list = zone.freeLists[flIdx][Z_FindFirstSetBit(slBits)];
+
+            for (zlink_t* pLink = list.next; pLink != &list; pLink = pLink->next) {
+                memblock_t& block = Z_LinkToBlock(*pLink);
+
+                if ((block.size >= allocSize) && ((!pBestBlock) || (&block > pBestBlock))) {
+                    pBestBlock = &block;
+                }
+            }
+        }
+    }
+
+    return pBestBlock;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Frees the given in use block, merging it with any free neighbors and adding the result to the free lists.
+// Returns the free block which the given block became part of.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static memblock_t& Z_FreeBlock(memzone_t& zone, memblock_t& block) noexcept {
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnFree(block);
+    #endif
+
+    // Clear the pointer field referencing the memory block too.
+    // Treat very small addresses as not pointers also:
+    if (block.user > (void*) 0x100) {
+        *block.user = nullptr;
+    }
+
+    block.user = nullptr;
+    block.tag = 0;
+    block.id = 0;
+    Z_ListRemove(block.listLink);
+
+    // Merge with the previous and next blocks if they are free.
+    // If merging with the previous block then that block is already in the free lists, and may not even need to change list.
+    // The rover must also be moved off any block which is merged into another.
+    memblock_t* pFreeBlock = &block;
+    memblock_t* const pPrevBlock = block.prev;
+    bool bInFreeList = false;
+
+    if (pPrevBlock && (!pPrevBlock->user)) {
+        Z_SetFreeBlockSize(zone, *pPrevBlock, pPrevBlock->size + block.size);
+        pPrevBlock->next = block.next;
+
+        if (block.next) {
+            block.next->prev = pPrevBlock;
+        }
+
+        if (zone.rover == &block) {
+            zone.rover = pPrevBlock;
+        }
+
+        pFreeBlock = pPrevBlock;
+        bInFreeList = true;
+    }
+
+    memblock_t* const pNextBlock = pFreeBlock->next;
+
+    if (pNextBlock && (!pNextBlock->user)) {
+        Z_RemoveFreeBlock(zone, *pNextBlock);
+        const int32_t mergedSize = pFreeBlock->size + pNextBlock->size;
+
+        if (bInFreeList) {
+            Z_SetFreeBlockSize(zone, *pFreeBlock, mergedSize);
+        } else {
+            pFreeBlock->size = mergedSize;
+        }
+
+        pFreeBlock->next = pNextBlock->next;
+
+        if (pNextBlock->next) {
+            pNextBlock->next->prev = pFreeBlock;
+        }
+
+        if (zone.rover == pNextBlock) {
+            zone.rover = pFreeBlock;
+        }
+    }
+
+    if (!bInFreeList) {
+        Z_AddFreeBlock(zone, *pFreeBlock);
+    }
+
+    return *pFreeBlock;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Purges purgable blocks until a free block of at least the given size is available.
+// Returns the free block which is big enough, or null if there is no run of free and purgable blocks big enough.
+//
+// Like the original allocator, only the contiguous run of blocks which the allocation will go into is evicted, rather than purgable blocks
+// from all over the heap. The search starts at the zone's 'rover' (just past the last blocks purged) and stops at the first run of adjacent
+// free and purgable blocks which is big enough. Within that run, the shortest span which is big enough is chosen, so that as few bytes as
+// possible are purged, and only the purgable blocks inside that span are freed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static memblock_t* Z_PurgeBlocks(memzone_t& zone, const int32_t allocSize) noexcept {
+    // Slide a window over each run of adjacent free and purgable blocks, dropping blocks from the start of the window while it is still big
+    // enough without them. Spans never wrap around from the end of the heap to the start.
+    memblock_t* pSpanFirst = nullptr;
+    memblock_t* pSpanLast = nullptr;
+    int32_t spanSize = 0;
+
+    memblock_t* const pStart = zone.rover;
+    memblock_t* pBlock = pStart;
+
+    do {
+        if ((!pBlock->user) || (pBlock->tag >= PU_PURGELEVEL)) {
+            if (!pSpanFirst) {
+                pSpanFirst = pBlock;
+            }
+
+            spanSize += pBlock->size;
+
+            while ((pSpanFirst != pBlock) && (spanSize - pSpanFirst->size >= allocSize)) {
+                spanSize -= pSpanFirst->size;
+                pSpanFirst = pSpanFirst->next;
+            }
+
+            if (spanSize >= allocSize) {
+                pSpanLast = pBlock;
+                break;
+            }
+        } else {
+            // Blocks which can't be purged end the current run of blocks
+            pSpanFirst = nullptr;
+            spanSize = 0;
+        }
+
+        pBlock = pBlock->next;
+
+        if (!pBlock) {
+            pBlock = &zone.blocklist;
+            pSpanFirst = nullptr;
+            spanSize = 0;
+        }
+    } while (pBlock != pStart);
+
+    if (!pSpanLast)
+        return nullptr;
+
+    // Chuck out the purgable blocks in the chosen span, which all merge together into one free block big enough for the allocation.
+    // Blocks are in address order, and any free block following the span can be merged into it, hence the address comparison.
+    memblock_t* pFreeBlock = nullptr;
+
+    for (memblock_t* pSpanBlock = pSpanFirst; pSpanBlock && (pSpanBlock <= pSpanLast);) {
+        if (pSpanBlock->user) {
+            #if PSYDOOM_ZONE_STATS
+                Z_StatsOnPurge(*pSpanBlock);
+            #endif
+
+            #if PSYDOOM_MODS
+                gZoneNumPurges++;
+                gZonePurgedBytes += pSpanBlock->size;
+            #endif
+
+            pFreeBlock = &Z_FreeBlock(zone, *pSpanBlock);
+        } else {
+            pFreeBlock = pSpanBlock;
+        }
+
+        pSpanBlock = pFreeBlock->next;
+    }
+
+    // Move the rover past the purged blocks, so the next purge evicts different blocks
+    zone.rover = (pFreeBlock->next) ? pFreeBlock->next : &zone.blocklist;
+    return pFreeBlock;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Marks the given block (which has been removed from the free lists) as in use.
+// Sets up the links on the block back to the pointer referencing it and also populates that pointer (if given).
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void Z_SetBlockInUse(memzone_t& zone, memblock_t& block, const int16_t tag, void** const ppUser) noexcept {
+    if (ppUser) {
+        block.user = ppUser;
+        *ppUser = &(&block)[1];
+    } else {
+        if (tag >= PU_PURGELEVEL) {
+            I_Error("Z_Malloc: an owner is required for purgable blocks");
+        }
+
+        // Non purgable blocks without any owner are assigned a pointer value of '1'
+        block.user = (void**) 1;
+    }
+
+    block.tag = tag;
+    block.id = ZONEID;
+    Z_ListAddBack(zone.tagLists[Z_GetTagListIdx(tag)], block.listLink);
+
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnAlloc(block);
+    #endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Sets up the given block of memory as a memory zone
+//------------------------------------------------------------------------------------------------------------------------------------------
+memzone_t* Z_InitZone(void* const pBase, const int32_t size) noexcept {
+    memzone_t* const pZone = (memzone_t*) pBase;
+    const int32_t blockSize = size - (int32_t) MEMZONE_HEADER_SIZE;
+
+    if (blockSize >= (1 << Z_NUM_FREE_LIST_FL_BITS)) {
+        I_Error("Z_InitZone: zone size %d is too big", size);
+    }
+
+    pZone->size = size;
+    pZone->rover = &pZone->blocklist;
+
+    #if PSYDOOM_MODS
+        pZone->pNextRegion = nullptr;
+        pZone->failedAllocSize = INT32_MAX;
+    #endif
+
+    pZone->freeListFLBits = 0;
+
+    for (int32_t flIdx = 0; flIdx < Z_NUM_FREE_LIST_FL_BITS; ++flIdx) {
+        pZone->freeListSLBits[flIdx] = 0;
+
+        for (int32_t slIdx = 0; slIdx < Z_NUM_FREE_LIST_SL; ++slIdx) {
+            Z_InitList(pZone->freeLists[flIdx][slIdx]);
+        }
+    }
+
+    for (zlink_t& list : pZone->tagLists) {
+        Z_InitList(list);
+    }
+
+    // The entire zone starts off as one big free block
+    pZone->blocklist.size = blockSize;
+    pZone->blocklist.user = nullptr;
+    pZone->blocklist.tag = 0;
+    pZone->blocklist.id = ZONEID;
+    pZone->blocklist.lockframe = -1;
+    pZone->blocklist.next = nullptr;
+    pZone->blocklist.prev = nullptr;
+    Z_AddFreeBlock(*pZone, pZone->blocklist);
+    return pZone;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Allocate a block of memory in the given memory zone with the given purgability tags.
+// Optionally, a referencing pointer field can also be supplied which is updated when the block is allocated or freed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void* Z_Malloc(memzone_t& zone, const int32_t size, const int16_t tag, void** const ppUser) noexcept {
+    // Level data allocated while the level is being setup comes from the level arena instead, if it is active
+    #if PSYDOOM_MODS
+        if (Z_UseLevelArena(zone, tag))
+            return Z_LevelArenaMalloc(size, tag, ppUser);
+    #endif
+
+    // Find a free block big enough, purging purgable blocks if there is none.
+    // If there is still no block big enough after that then try the next region of the zone, creating it if needed.
+    const int32_t allocSize = Z_GetAllocSize(size);
+    memblock_t* pBase = Z_FindFreeBlock(zone, allocSize);
+
+    if (!pBase) {
+        pBase = Z_PurgeBlocks(zone, allocSize);
+
+        if (!pBase) {
+            #if PSYDOOM_MODS
+                return Z_Malloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+            #else
+                I_Error("Z_Malloc: failed allocation on %i", allocSize);
+            #endif
+        }
+    }
+
+    // If there are enough free bytes following the allocation then make a new free memory block
+    // and add it into the linked list of blocks. The new free block replaces the allocated one in the free lists.
+    const int32_t numUnusedBytes = pBase->size - allocSize;
+
+    if (numUnusedBytes > MINFRAGMENT) {
+        std::byte* const pUnusedBytes = (std::byte*) pBase + allocSize;
+
+        memblock_t& newBlock = (memblock_t&) *pUnusedBytes;
+        newBlock.prev = pBase;
+        newBlock.next = pBase->next;
+
+        if (pBase->next) {
+            pBase->next->prev = &newBlock;
+        }
+
+        pBase->next = &newBlock;
+
+        newBlock.size = numUnusedBytes;
+        newBlock.user = nullptr;
+        newBlock.tag = 0;
+        newBlock.id = 0;
+
+        Z_ReplaceFreeBlock(zone, *pBase, newBlock);
+        pBase->size = allocSize;
+    } else {
+        Z_RemoveFreeBlock(zone, *pBase);
+    }
+
+    Z_SetBlockInUse(zone, *pBase, tag, ppUser);
+    return &pBase[1];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// An alternate version of Z_Malloc that attempts to allocate at the end of the heap, or at least as close as possible to the end
+//------------------------------------------------------------------------------------------------------------------------------------------
+void* Z_EndMalloc(memzone_t& zone, const int32_t size, const int16_t tag, void** const ppUser) noexcept {
+    // Find the free block big enough which is closest to the end of the heap, purging purgable blocks if there is none
+    const int32_t allocSize = Z_GetAllocSize(size);
+    memblock_t* pBase = Z_FindFreeBlockNearestEnd(zone, allocSize);
+
+    if (!pBase) {
+        if (!Z_PurgeBlocks(zone, allocSize)) {
+            #if PSYDOOM_MODS
+                return Z_EndMalloc(Z_GetNextRegion(zone, allocSize), size, tag, ppUser);
+            #else
+                I_Error("Z_Malloc: failed allocation on %i", allocSize);
+            #endif
+        }
+
+        pBase = Z_FindFreeBlockNearestEnd(zone, allocSize);
+    }
+
+    // If there are enough free bytes remaining then make a new memory block for the allocation at the end of the free block.
+    // Unlike the regular Z_Malloc, the free block is left BEFORE the allocated memory.
+    const int32_t numUnusedBytes = pBase->size - allocSize;
+    memblock_t& freeBlock = *pBase;
+
+    if (numUnusedBytes > MINFRAGMENT) {
+        pBase = (memblock_t*)((std::byte*) pBase + numUnusedBytes);
+        pBase->size = allocSize;
+        pBase->prev = &freeBlock;
+        pBase->next = freeBlock.next;
+
+        if (freeBlock.next) {
+            freeBlock.next->prev = pBase;
+        }
+
+        freeBlock.next = pBase;
+        Z_SetFreeBlockSize(zone, freeBlock, numUnusedBytes);
+    } else {
+        Z_RemoveFreeBlock(zone, freeBlock);
+    }
+
+    Z_SetBlockInUse(zone, *pBase, tag, ppUser);
+    return &pBase[1];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Free the given block of memory
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_Free2(memzone_t& zone, void* const ptr) noexcept {
+    // Get the memory block header which is located before the actual memory.
+    // Verify also that the id is sane and that we are not just being passed a garbage pointer or a free block:
+    memblock_t& block = ((memblock_t*) ptr)[-1];
+
+    if ((block.id != ZONEID) || (!block.user)) {
+        I_Error("Z_Free: freed a pointer without ZONEID");
+    }
+
+    // Blocks in the level arena need to be freed by the arena, otherwise free the block in whatever region of the zone it belongs to
+    #if PSYDOOM_MODS
+        if (Z_IsLevelArenaBlock(block)) {
+            Z_FreeLevelArenaBlock(block);
+        } else {
+            Z_FreeBlock(Z_GetRegionForBlock(zone, &block), block);
+        }
+    #else
+        Z_FreeBlock(zone, block);
+    #endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Free memory blocks that have one or more of the given tag bits.
+// Only the lists of blocks which could have those tags are visited.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_FreeTags(memzone_t& zone, const int16_t tagBits) noexcept {
+    #if PSYDOOM_MODS
+        Z_FreeLevelArenaTags(zone, tagBits);
+    #endif
+
+    for (int32_t listIdx = 0; listIdx < Z_NUM_TAG_LISTS; ++listIdx) {
+        if ((listIdx != OTHER_TAGS_LIST_IDX) && ((tagBits & (1 << listIdx)) == 0))
+            continue;
+
+        zlink_t& list = zone.tagLists[listIdx];
+
+        for (zlink_t* pLink = list.next; pLink != &list;) {
+            memblock_t& block = Z_LinkToBlock(*pLink);
+            pLink = pLink->next;
+
+            if ((block.tag & tagBits) != 0) {
+                Z_FreeBlock(zone, block);
+            }
+        }
+    }
+
+    // Free matching blocks in any additional regions of the zone also
+    #if PSYDOOM_MODS
+        if (zone.pNextRegion) {
+            Z_FreeTags(*zone.pNextRegion, tagBits);
+        }
+    #endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Update the tags for a given block of memory.
+// Note: the block is assumed to be in the main memory zone (or the level arena), since that is the only zone and no zone is passed in.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Z_ChangeTag(void* const ptr, const int16_t tagBits) noexcept {
+    memblock_t& block = ((memblock_t*) ptr)[-1];
+
+    // Sanity check the zoneid for the block
+    if (block.id != ZONEID) {
+        I_Error("Z_ChangeTag: freed a pointer without ZONEID");
+    }
+
+    // If the block tag makes it purgeable then it must have an owner.
+    // Note: regard very small user addresses as NOT pointers.
+    if (tagBits >= PU_PURGELEVEL) {
+        if (block.user < (void*) 0x100) {
+            I_Error("Z_ChangeTag: an owner is required for purgable blocks");
+        }
+    }
+
+    #if PSYDOOM_ZONE_STATS
+        Z_StatsOnChangeTag(block, tagBits);
+    #endif
+
+    // Move the block to the list for it's new tag in whatever region of the zone it belongs to.
+    // Blocks in the level arena are not in any lists.
+    #if PSYDOOM_MODS
+        if (block.user && (!Z_IsLevelArenaBlock(block))) {
+            memzone_t& region = Z_GetRegionForBlock(*gpMainMemZone, &block);
+            Z_ListRemove(block.listLink);
+            Z_ListAddBack(region.tagLists[Z_GetTagListIdx(tagBits)], block.listLink);
+        }
+    #else
+        if (block.user) {
+            Z_ListRemove(block.listLink);
+            Z_ListAddBack(gpMainMemZone->tagLists[Z_GetTagListIdx(tagBits)], block.listLink);
+        }
+    #endif
+
+    block.tag = (int16_t) tagBits;
+}
+
+#endif  // #if PSYDOOM_USE_SEGREGATED_ZONE
@@ -20,7 +20,9 @@
 #include "p_setup.h"
 #include "p_tick.h"
 #include "PcPsx/Game.h"
+#include "PcPsx/DiscSectorCache.h"
 #include "PcPsx/Input.h"
+#include "PcPsx/ProgArgs.h"
 #include "PcPsx/Utils.h"
 #include "Wess/wessapi.h"
 
@@ -73,6 +75,16 @@ void G_DoLoadLevel() noexcept {
     Utils::waitUntilSeqExitedStatus(sfx_barexp, SequenceStatus::SEQUENCE_PLAYING);
     Utils::waitUntilSeqExitedStatus(sfx_pistol, SequenceStatus::SEQUENCE_PLAYING);
     
+    // PsyDoom: start reading the map's files from disc in the background while sound and music is loading.
+    // If reporting disc cache stats for the level load then start counting from here.
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbDiscCacheStats) {
+            DiscSectorCache::resetStats();
+        }
+
+        P_PrefetchLevelFiles(gGameMap);
+    #endif
+
     // Loading sound and music
     S_LoadMapSoundAndMusic(gGameMap);
 
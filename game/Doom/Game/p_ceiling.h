@@ -33,5 +33,6 @@ static constexpr int32_t MAXCEILINGS = 30;
 
 extern ceiling_t* gpActiveCeilings[MAXCEILINGS];
 
+void T_MoveCeiling(ceiling_t& ceiling) noexcept;
 bool EV_DoCeiling(line_t& line, const ceiling_e ceilingType) noexcept;
 bool EV_CeilingCrushStop(line_t& line) noexcept;
@@ -12,25 +12,13 @@
 #include "p_spec.h"
 #include "p_tick.h"
 
-// State for a door thinker
-struct vldoor_t {
-    thinker_t   thinker;        // Basic thinker fields
-    vldoor_e    type;           // What type of door it is
-    sector_t*   sector;         // Which sector is being moved
-    fixed_t     topheight;      // Sector ceiling height when opened
-    fixed_t     speed;          // Speed of door movement
-    int32_t     direction;      // Current movement direction: 1 = up, 0 = opened, -1 = down
-    int32_t     topwait;        // Door setting: total number of tics for the door to wait in the opened state
-    int32_t     topcountdown;   // Door state: how many tics before the door starts closing
-};
-
 static constexpr fixed_t VDOORSPEED = FRACUNIT * 6;     // Regular speed of vertical doors
 static constexpr int32_t VDOORWAIT  = 70;               // How long vertical doors normally wait before closing (game tics)
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Thinker/update logic for a door: moves the door, does door state transitions and sounds etc.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static void T_VerticalDoor(vldoor_t& door) noexcept {
+void T_VerticalDoor(vldoor_t& door) noexcept {
     // Which way is the door moving?
     switch (door.direction) {
         // Door is waiting
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <cstdint>
+#include "Doom/doomdef.h"
 
 struct line_t;
 struct mobj_t;
@@ -18,6 +18,19 @@ enum vldoor_e : int32_t {
     BlazeClose          = 7
 };
 
+// State for a door thinker
+struct vldoor_t {
+    thinker_t   thinker;        // Basic thinker fields
+    vldoor_e    type;           // What type of door it is
+    sector_t*   sector;         // Which sector is being moved
+    fixed_t     topheight;      // Sector ceiling height when opened
+    fixed_t     speed;          // Speed of door movement
+    int32_t     direction;      // Current movement direction: 1 = up, 0 = opened, -1 = down
+    int32_t     topwait;        // Door setting: total number of tics for the door to wait in the opened state
+    int32_t     topcountdown;   // Door state: how many tics before the door starts closing
+};
+
+void T_VerticalDoor(vldoor_t& door) noexcept;
 bool P_CheckKeyLock(line_t& line, mobj_t& user) noexcept;
 bool EV_DoDoor(line_t& line, const vldoor_e doorType) noexcept;
 void EV_VerticalDoor(line_t& line, mobj_t& mobj) noexcept;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <cstdint>
+#include "Doom/doomdef.h"
 
 struct line_t;
 struct sector_t;
@@ -18,6 +18,50 @@ static constexpr int32_t TURBODARK      = 4;    // Flashing lights: time spent i
 static constexpr int32_t FASTDARK       = 8;    // Flashing lights: time spent in the 'dark' phase (medium duration setting)
 static constexpr int32_t SLOWDARK       = 15;   // Flashing lights: time spent in the 'dark' phase (longer duration setting)
 
+// Definition and state for a fire flicker light
+struct fireflicker_t {
+    thinker_t   thinker;
+    sector_t*   sector;
+    int32_t     count;
+    int32_t     maxlight;
+    int32_t     minlight;
+};
+
+// Definition and state for a flashing light
+struct lightflash_t {
+    thinker_t   thinker;
+    sector_t*   sector;
+    int32_t     count;
+    int32_t     maxlight;
+    int32_t     minlight;
+    int32_t     maxtime;
+    int32_t     mintime;
+};
+
+// Definition and state for a strobing light
+struct strobe_t {
+    thinker_t   thinker;
+    sector_t*   sector;
+    int32_t     count;
+    int32_t     minlight;
+    int32_t     maxlight;
+    int32_t     darktime;
+    int32_t     brighttime;
+};
+
+// Definition and state for a glowing light
+struct glow_t {
+    thinker_t   thinker;
+    sector_t*   sector;
+    int32_t     minlight;
+    int32_t     maxlight;
+    int32_t     direction;
+};
+
+void T_FireFlicker(fireflicker_t& flicker) noexcept;
+void T_LightFlash(lightflash_t& lightFlash) noexcept;
+void T_StrobeFlash(strobe_t& strobe) noexcept;
+void T_Glow(glow_t& glow) noexcept;
 void P_SpawnFireFlicker(sector_t& sector) noexcept;
 void P_SpawnLightFlash(sector_t& sector) noexcept;
 void P_SpawnStrobeFlash(sector_t& sector, const int32_t darkTime, const bool bInSync) noexcept;
@@ -27,7 +27,7 @@ static void P_RemoveActivePlat(plat_t& plat) noexcept;
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Thinker/update logic for a moving platform: moves the platform, does state transitions and sounds etc.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static void T_PlatRaise(plat_t& plat) noexcept {
+void T_PlatRaise(plat_t& plat) noexcept {
     sector_t& sector = *plat.sector;
 
     switch (plat.status) {
@@ -42,6 +42,7 @@ static constexpr int32_t MAXPLATS = 30;
 
 extern plat_t* gpActivePlats[MAXPLATS];
 
+void T_PlatRaise(plat_t& plat) noexcept;
 bool EV_DoPlat(line_t& line, const plattype_e platType, const int32_t moveAmount) noexcept;
 void P_ActivateInStasis(const int32_t tag) noexcept;
 void EV_StopPlat(line_t& line) noexcept;
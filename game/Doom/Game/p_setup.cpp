@@ -21,11 +21,19 @@
 #include "p_spec.h"
 #include "p_switch.h"
 #include "p_tick.h"
+#include "PcPsx/DiscSectorCache.h"
+#include "PcPsx/ProgArgs.h"
+#include "Wess/psxcd.h"
+
+#include <cstdio>
 
 // How much heap space is required after loading the map in order to run the game (48 KiB in Doom, 32 KiB in Final Doom).
 // If we don't have this much then the game dies with an error; I'm adopting the Final Doom requirement here since it is the lowest.
 // Need to be able to support various small allocs throughout gameplay for particles and so forth.
-static constexpr int32_t MIN_REQ_HEAP_SPACE_FOR_GAMEPLAY = 1024 * 32;
+// PsyDoom: this is no longer required since the zone heap grows on demand.
+#if !PSYDOOM_MODS
+    static constexpr int32_t MIN_REQ_HEAP_SPACE_FOR_GAMEPLAY = 1024 * 32;
+#endif
 
 // How many maps are in a map folder and the number of files per maps folder etc.
 static constexpr int32_t LEVELS_PER_MAP_FOLDER = (uint32_t) CdFileId::MAPSPR01_IMG - (uint32_t) CdFileId::MAP01_WAD;
@@ -955,6 +963,40 @@ void P_Init() noexcept {
     P_InitPicAnims();
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: the disc files holding the data for a map
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct MapFiles {
+    CdFileId    wadFile;            // The map WAD
+    CdFileId    texFile;            // Map textures
+    CdFileId    sprFile;            // Map sprites
+    bool        bFinalDoomMap;      // If true then the map WAD is a Final Doom format '.ROM' file
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: figure out which disc files hold the data for the given map.
+// Used both when loading a level and when prefetching it's files, so the two always agree.
+//
+// Note: for Final Doom I've added logic to allow for MAPXX.WAD or MAPXX.ROM, with a preference for the .WAD file.
+// Also, if the file for the map has the .ROM extension then it is assumed the map data is in Final Doom format.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static MapFiles P_GetMapFiles(const int32_t mapNum) noexcept {
+    const int32_t mapIndex = mapNum - 1;
+    const int32_t mapFolderIdx = mapIndex / LEVELS_PER_MAP_FOLDER;
+    const int32_t mapIdxInFolder = mapIndex - mapFolderIdx * LEVELS_PER_MAP_FOLDER;
+    const int32_t mapFolderOffset = mapFolderIdx * NUM_FILES_PER_LEVEL * LEVELS_PER_MAP_FOLDER;
+
+    const CdFileId mapWadFile_doom = (CdFileId)((int32_t) CdFileId::MAP01_WAD + mapIdxInFolder + mapFolderOffset);
+    const CdFileId mapWadFile_finalDoom = (CdFileId)((int32_t) CdFileId::MAP01_ROM + mapIndex);
+
+    MapFiles mapFiles = {};
+    mapFiles.bFinalDoomMap = (!gCdMapTbl[(int32_t) mapWadFile_doom].startSector);
+    mapFiles.wadFile = (mapFiles.bFinalDoomMap) ? mapWadFile_finalDoom : mapWadFile_doom;
+    mapFiles.texFile = (CdFileId)((int32_t) CdFileId::MAPTEX01_IMG + mapIdxInFolder + mapFolderOffset);
+    mapFiles.sprFile = (CdFileId)((int32_t) CdFileId::MAPSPR01_IMG + mapIdxInFolder + mapFolderOffset);
+    return mapFiles;
+}
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Loads the specified level, textures and sets it up for gameplay by spawning things, players etc.
 // Note: while most of the loading and setup is done here for the level, sound and music are handled eleswhere.
@@ -972,6 +1014,12 @@ void P_SetupLevel(const int32_t mapNum, [[maybe_unused]] const skill_t skill) no
     Z_CheckHeap(*gpMainMemZone);
     M_ClearRandom();
 
+    // PsyDoom: allocate level data from the level arena while setting up the level, which is faster than the zone allocator.
+    // All of this memory is released at once when 'PU_LEVEL' memory is freed on exiting the level.
+    #if PSYDOOM_MODS
+        Z_BeginLevelArena();
+    #endif
+
     // Init player stats for the map
     gTotalKills = 0;
     gTotalItems = 0;
@@ -998,23 +1046,10 @@ void P_SetupLevel(const int32_t mapNum, [[maybe_unused]] const skill_t skill) no
     gItemRespawnQueueTail = 0;
     gDeadPlayerRemovalQueueIdx = 0;
 
-    // Figure out which file to open for the map WAD.
-    //
-    // Note: for Final Doom I've added logic to allow for MAPXX.WAD or MAPXX.ROM, with a preference for the .WAD file.
-    // Also, if the file for the map has the .ROM extension then it is assumed the map data is in Final Doom format.
-    const int32_t mapIndex = mapNum - 1;
-    const int32_t mapFolderIdx = mapIndex / LEVELS_PER_MAP_FOLDER;
-    const int32_t mapIdxInFolder = mapIndex - mapFolderIdx * LEVELS_PER_MAP_FOLDER;
-    const int32_t mapFolderOffset = mapFolderIdx * NUM_FILES_PER_LEVEL * LEVELS_PER_MAP_FOLDER;
-
-    const CdFileId mapWadFile_doom = (CdFileId)((int32_t) CdFileId::MAP01_WAD + mapIdxInFolder + mapFolderOffset);
-    const CdFileId mapWadFile_finalDoom = (CdFileId)((int32_t) CdFileId::MAP01_ROM + mapIndex);
-    gbLoadingFinalDoomMap = (!gCdMapTbl[(int32_t) mapWadFile_doom].startSector);
-
-    const CdFileId mapWadFile = (gbLoadingFinalDoomMap) ? mapWadFile_finalDoom : mapWadFile_doom;
-    
-    // Open the map wad
-    void* const pMapWadFileData = W_OpenMapWad(mapWadFile);
+    // Figure out which files hold the map data and open the map wad
+    const MapFiles mapFiles = P_GetMapFiles(mapNum);
+    gbLoadingFinalDoomMap = mapFiles.bFinalDoomMap;
+    void* const pMapWadFileData = W_OpenMapWad(mapFiles.wadFile);
 
     // Figure out the name of the map start lump marker
     char mapLumpName[8] = {};
@@ -1061,21 +1096,21 @@ void P_SetupLevel(const int32_t mapNum, [[maybe_unused]] const skill_t skill) no
 
     // Loading map textures and sprites
     if (!gbIsLevelBeingRestarted) {
-        const CdFileId mapTexFile = (CdFileId)((int32_t) CdFileId::MAPTEX01_IMG + mapIdxInFolder + mapFolderOffset);
-        const CdFileId mapSprFile = (CdFileId)((int32_t) CdFileId::MAPSPR01_IMG + mapIdxInFolder + mapFolderOffset);
-        
-        P_LoadBlocks(mapTexFile);
+        P_LoadBlocks(mapFiles.texFile);
         P_Init();
-        P_LoadBlocks(mapSprFile);
+        P_LoadBlocks(mapFiles.sprFile);
     }
 
-    // Check there is enough heap space left in order to run the level
-    const int32_t freeMemForGameplay = Z_FreeMemory(*gpMainMemZone);
+    // Check there is enough heap space left in order to run the level.
+    // PsyDoom: this check is no longer needed since the zone heap now grows on demand instead of running out of memory.
+    #if !PSYDOOM_MODS
+        const int32_t freeMemForGameplay = Z_FreeMemory(*gpMainMemZone);
 
-    if (freeMemForGameplay < MIN_REQ_HEAP_SPACE_FOR_GAMEPLAY) {
-        Z_DumpHeap();
-        I_Error("P_SetupLevel: not enough free memory %d", freeMemForGameplay);
-    }
+        if (freeMemForGameplay < MIN_REQ_HEAP_SPACE_FOR_GAMEPLAY) {
+            Z_DumpHeap();
+            I_Error("P_SetupLevel: not enough free memory %d", freeMemForGameplay);
+        }
+    #endif
 
     // Spawn the player(s)
     if (gNetGame != gt_single) {
@@ -1099,7 +1134,50 @@ void P_SetupLevel(const int32_t mapNum, [[maybe_unused]] const skill_t skill) no
     else {
         P_SpawnPlayer(gPlayerStarts[0]);
     }
+
+    // PsyDoom: done setting up the level, 'PU_LEVEL' allocations go to the zone again from here on
+    #if PSYDOOM_MODS
+        Z_EndLevelArena();
+    #endif
+
+    // PsyDoom: report how well the disc sector cache did for loading the level, if requested.
+    // The stats are reset before the level's files are prefetched (see 'G_DoLoadLevel'), so they cover just the level load.
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbDiscCacheStats) {
+            const DiscSectorCache::Stats stats = DiscSectorCache::getStats();
+            const uint64_t numReads = stats.numHits + stats.numMisses;
+            const double hitRate = (numReads > 0) ? (double) stats.numHits * 100.0 / (double) numReads : 0.0;
+
+            std::printf(
+                "Map %d disc cache: %llu hits (%llu prefetched), %llu misses, %.1f%% hit rate, %llu sectors prefetched, %llu evictions, "
+                "%u/%u sectors cached\n",
+                (int) mapNum,
+                (unsigned long long) stats.numHits,
+                (unsigned long long) stats.numPrefetchHits,
+                (unsigned long long) stats.numMisses,
+                hitRate,
+                (unsigned long long) stats.numPrefetched,
+                (unsigned long long) stats.numEvictions,
+                (unsigned) stats.numCachedSectors,
+                (unsigned) stats.maxCachedSectors
+            );
+        }
+    #endif
+}
+
+#if PSYDOOM_MODS
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: starts loading the disc files for the given map into the disc sector cache on a background thread.
+// The files are queued in the same order that 'P_SetupLevel' reads them: the map WAD, then the map textures and sprites.
+// This is called before the map's sound and music is loaded so that the disc reads for the map overlap with that work.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void P_PrefetchLevelFiles(const int32_t mapNum) noexcept {
+    const MapFiles mapFiles = P_GetMapFiles(mapNum);
+    psxcd_prefetch(mapFiles.wadFile);
+    psxcd_prefetch(mapFiles.texFile);
+    psxcd_prefetch(mapFiles.sprFile);
 }
+#endif  // #if PSYDOOM_MODS
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Loads a list of memory blocks containing WAD lumps from the given file.
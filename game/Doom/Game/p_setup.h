@@ -47,6 +47,11 @@ extern void (*gUpdateFireSkyFunc)(texture_t& skyTex);
 
 void P_Init() noexcept;
 void P_SetupLevel(const int32_t mapNum, const skill_t skill) noexcept;
+
+#if PSYDOOM_MODS
+    void P_PrefetchLevelFiles(const int32_t mapNum) noexcept;
+#endif
+
 void P_LoadBlocks(const CdFileId file) noexcept;
 void P_CacheSprite() noexcept;
 void P_CacheMapTexturesWithWidth(const int32_t width) noexcept;
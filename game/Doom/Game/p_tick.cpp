@@ -22,17 +22,22 @@
 #include "PcPsx/Config.h"
 #include "PcPsx/Controls.h"
 #include "PcPsx/DemoResult.h"
+#include "PcPsx/DemoTrace.h"
 #include "PcPsx/Game.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/PsxPadButtons.h"
 #include "PcPsx/Utils.h"
+#include "PcPsx/ZoneStats.h"
 #include "PsyQ/LIBGPU.h"
 #include "Wess/psxcd.h"
 #include "Wess/psxspu.h"
 #include "Wess/wessapi.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 
 // The number of buttons in a cheat sequence and a list of all the cheat sequences and their indices
 static constexpr uint32_t CHEAT_SEQ_LEN = 8;
@@ -85,6 +90,15 @@ static uint16_t     gCheatSequenceBtns[CHEAT_SEQ_LEN];      // Cheat sequence bu
 static int32_t      gTicConOnPause;                         // What 1 vblank tick we paused on, used to discount paused time on unpause
 static int32_t      gNumActiveThinkers;                     // Stat tracking count, no use other than that
 
+// PsyDoom: game logic timing for the current level, if enabled with the '-ticktiming' developer option
+#if PSYDOOM_MODS
+    typedef std::chrono::steady_clock tick_clock_t;
+
+    static int32_t  gNumTimedTicks;         // How many ticks of game logic have been timed so far for the level
+    static double   gTimedTicksSecs;        // Total time spent running game logic for the timed ticks
+    static double   gMaxTickSecs;           // The longest single tick of game logic timed so far for the level
+#endif
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Add a thinker to the linked list of thinkers
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -567,6 +581,8 @@ void P_CheckCheats() noexcept {
 // High level tick/update logic for main gameplay
 //------------------------------------------------------------------------------------------------------------------------------------------
 gameaction_t P_Ticker() noexcept {
+    PROFILE_SCOPE("P_Ticker");
+
     gGameAction = ga_nothing;
 
     #if PSYDOOM_MODS
@@ -587,6 +603,11 @@ gameaction_t P_Ticker() noexcept {
         }
     #endif
 
+    // PsyDoom: time the game logic for this tick if requested
+    #if PSYDOOM_MODS
+        const tick_clock_t::time_point tickStartTime = (ProgArgs::gbTickTiming) ? tick_clock_t::now() : tick_clock_t::time_point();
+    #endif
+
     // Check for pause and cheats
     P_CheckCheats();
 
@@ -619,6 +640,18 @@ gameaction_t P_Ticker() noexcept {
         P_PlayerThink(player);
     }
 
+    #if PSYDOOM_MODS
+        // PsyDoom: record the game state for this tick if saving a trace
+        DemoTrace::recordTick();
+
+        if (ProgArgs::gbTickTiming) {
+            const double tickSecs = std::chrono::duration<double>(tick_clock_t::now() - tickStartTime).count();
+            gNumTimedTicks++;
+            gTimedTicksSecs += tickSecs;
+            gMaxTickSecs = std::max(gMaxTickSecs, tickSecs);
+        }
+    #endif
+
     return gGameAction;
 }
 
@@ -626,15 +659,19 @@ gameaction_t P_Ticker() noexcept {
 // Does all drawing for main gameplay
 //------------------------------------------------------------------------------------------------------------------------------------------
 void P_Drawer() noexcept {
-    // PsyDoom: no drawing in headless mode, but do advance the elapsed time.
-    // Keep the framerate at the appropriate amount (for PAL or NTSC mode) for consistent demo playback.
+    PROFILE_SCOPE("P_Drawer");
+
+    // PsyDoom: no drawing in headless mode, but do a present so that the elapsed time advances.
+    // In headless mode that advances a virtual clock by one demo tick (for PAL or NTSC mode) for consistent demo playback, without waiting.
+    //
+    // Skipping the drawer does not change the simulation: no primitives are built or rasterized but the game logic still runs identically.
+    // The only state the renderer writes which the game logic reads is 'gbIsSkyVisible', which just gates the fire sky animation.
+    // That animation uses its own random index and only modifies the sky texture, so it's explicitly kept off here for consistency.
+    // Textures cached by the renderer are 'PU_CACHE' zone allocations, which gameplay code never depends on.
     #if PSYDOOM_MODS
         if (ProgArgs::gbHeadlessMode) {
-            const int32_t demoTickVBlanks = (Game::gSettings.bUsePalTimings) ? 3 : VBLANKS_PER_TIC;
-
-            gTotalVBlanks += demoTickVBlanks;
-            gLastTotalVBlanks = gTotalVBlanks;
-            gElapsedVBlanks = demoTickVBlanks;
+            gbIsSkyVisible = false;
+            I_DrawPresent();
             return;
         }
     #endif
@@ -649,6 +686,12 @@ void P_Drawer() noexcept {
     }
 
     ST_Drawer();
+
+    // PsyDoom: draw the frame profiler overlay on top of everything else, if built in and enabled
+    #if PSYDOOM_PROFILER
+        Profiler::drawOverlay();
+    #endif
+
     I_SubmitGpuCmds();
 }
 
@@ -667,6 +710,14 @@ void P_Start() noexcept {
         // PsyDoom: initialize the new framerate uncapped turning system
         P_PlayerInitTurning();
 
+        // PsyDoom: reset game logic timing for the level
+        gNumTimedTicks = 0;
+        gTimedTicksSecs = 0.0;
+        gMaxTickSecs = 0.0;
+
+        // PsyDoom: reset the texture cache stats for the level
+        I_ResetTexCacheLevelStats();
+
         // PsyDoom: don't interpolate the first draw frame if doing uncapped framerates
         if (Config::gbUncapFramerate) {
             R_NextInterpolation();
@@ -716,6 +767,37 @@ void P_Stop([[maybe_unused]] const gameaction_t exitAction) noexcept {
             }
         }
     #endif
+
+    // PsyDoom: report the game logic throughput for the level if requested
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbTickTiming && (gNumTimedTicks > 0)) {
+            const double avgTickSecs = gTimedTicksSecs / gNumTimedTicks;
+
+            std::printf(
+                "Map %d game logic: %d ticks in %.3f secs, %.0f ticks/sec, avg %.2f us/tick, max %.2f us/tick\n",
+                gGameMap,
+                gNumTimedTicks,
+                gTimedTicksSecs,
+                (avgTickSecs > 0.0) ? 1.0 / avgTickSecs : 0.0,
+                avgTickSecs * 1000000.0,
+                gMaxTickSecs * 1000000.0
+            );
+        }
+    #endif
+
+    // PsyDoom: report texture cache activity for the level if requested
+    #if PSYDOOM_MODS
+        I_PrintTexCacheLevelStats();
+    #endif
+
+    // PsyDoom: save zone memory statistics for the level if requested
+    #if PSYDOOM_ZONE_STATS
+        if (ProgArgs::gZoneStatsFilePath[0]) {
+            if (!ZoneStats::saveLevelStatsToJsonFile(ProgArgs::gZoneStatsFilePath)) {
+                std::printf("Failed to save the zone memory stats to '%s'!\n", ProgArgs::gZoneStatsFilePath);
+            }
+        }
+    #endif
     
     // Stop all sounds and music.
     // PsyDoom: don't stop all sounds, let them fade out naturally - otherwise the pistol sound on closing the main menu gets cut off.
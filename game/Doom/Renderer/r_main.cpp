@@ -9,6 +9,7 @@
 #include "Doom/Game/p_user.h"
 #include "PcPsx/Config.h"
 #include "PcPsx/Game.h"
+#include "PcPsx/Profiler.h"
 #include "PsyQ/LIBETC.h"
 #include "PsyQ/LIBGPU.h"
 #include "PsyQ/LIBGTE.h"
@@ -94,6 +95,8 @@ void R_Init() noexcept {
 // Render the 3D view and also player weapons
 //------------------------------------------------------------------------------------------------------------------------------------------
 void R_RenderPlayerView() noexcept {
+    PROFILE_SCOPE("R_RenderPlayerView");
+
     // If currently in fullbright mode (no lighting) then setup the light params now
     if (!gbDoViewLighting) {
         gCurLightValR = 128;
@@ -8,6 +8,7 @@
 #include "Doom/Game/p_setup.h"
 #include "Doom/Game/p_tick.h"
 #include "Doom/Renderer/r_local.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/PsxPadButtons.h"
 #include "PsyQ/LIBETC.h"
 #include "PsyQ/LIBGPU.h"
@@ -184,6 +185,8 @@ void AM_Control(player_t& player) noexcept {
 // Does drawing for the automap
 //------------------------------------------------------------------------------------------------------------------------------------------
 void AM_Drawer() noexcept {
+    PROFILE_SCOPE("AM_Drawer");
+
     // Finish up the previous frame
     I_DrawPresent();
 
@@ -13,6 +13,7 @@
 #include "Doom/Renderer/r_data.h"
 #include "in_main.h"
 #include "PcPsx/Game.h"
+#include "PcPsx/Profiler.h"
 #include "PsyQ/LIBETC.h"
 #include "PsyQ/LIBGPU.h"
 
@@ -290,6 +291,8 @@ void ST_Ticker() noexcept {
 // Do drawing for the HUD status bar
 //------------------------------------------------------------------------------------------------------------------------------------------
 void ST_Drawer() noexcept {
+    PROFILE_SCOPE("ST_Drawer");
+
     // Setup the current texture page and texture window.
     // PsyDoom: explicitly clear the texture window here also to disable wrapping - don't rely on previous drawing code to do that.
     {
@@ -14,6 +14,7 @@
 #include "Game/p_tick.h"
 #include "PcPsx/Game.h"
 #include "PcPsx/Input.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/PsxPadButtons.h"
 #include "PsyQ/LIBETC.h"
@@ -680,6 +681,16 @@ gameaction_t MiniLoop(
 
         // Call the drawer function to do drawing for the frame
         pDrawer();
+
+        // PsyDoom: record zone memory statistics which are sampled once per frame
+        #if PSYDOOM_ZONE_STATS
+            Z_SampleFrameStats();
+        #endif
+
+        // PsyDoom: end the current frame for the frame profiler, if built in
+        #if PSYDOOM_PROFILER
+            Profiler::endFrame();
+        #endif
         
         // Do we need to update sound? (sound updates at 15 Hz)
         if (gGameTic > gPrevGameTic) {
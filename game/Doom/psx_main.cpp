@@ -1,17 +1,24 @@
 #include "psx_main.h"
 
 #include "Base/i_main.h"
+#include "Base/w_wad.h"
+#include "Base/z_zone.h"
 #include "cdmaptbl.h"
 #include "PcPsx/Config.h"
 #include "PcPsx/Controls.h"
+#include "PcPsx/DemoTrace.h"
 #include "PcPsx/Game.h"
 #include "PcPsx/Input.h"
+#include "PcPsx/LumpCache.h"
 #include "PcPsx/ModMgr.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/PsxVm.h"
 #include "PcPsx/Utils.h"
 #include "PcPsx/Video.h"
 
+#include <cstdio>
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // This was the old reverse engineered entrypoint for PSXDOOM.EXE, which executed before 'main()' was called.
 //
@@ -40,6 +47,28 @@ int psx_main(const int argc, const char** const argv) noexcept {
         // Parse command line arguments and configuration and initialize input systems
         Utils::installFatalErrorHandler();
         ProgArgs::init(argc, argv);
+
+        // Developer option: compare two traces of the game state and exit without running the game, if requested
+        if (ProgArgs::gCompareTraceFilePath1[0]) {
+            const int exitCode = DemoTrace::compareTraceFiles(ProgArgs::gCompareTraceFilePath1, ProgArgs::gCompareTraceFilePath2);
+            ProgArgs::shutdown();
+            Utils::uninstallFatalErrorHandler();
+            return exitCode;
+        }
+
+        // Developer option: start recording a trace of the game state for each tick, if requested.
+        // The trace is opened once here and the ticks for every level played are appended to it.
+        if (ProgArgs::gSaveTraceFilePath[0]) {
+            if (!DemoTrace::beginRecording(ProgArgs::gSaveTraceFilePath)) {
+                std::printf("Failed to create the trace file '%s'!\n", ProgArgs::gSaveTraceFilePath);
+            }
+        }
+
+        // Developer option: start up the frame profiler, if built in
+        #if PSYDOOM_PROFILER
+            Profiler::init();
+        #endif
+
         Controls::init();
         Config::init();
         Input::init();
@@ -59,16 +88,34 @@ int psx_main(const int argc, const char** const argv) noexcept {
         ModMgr::init();
     #endif
 
-    // Call the original PSX Doom 'main()' function
-    I_Main();
+    // Call the original PSX Doom 'main()' function.
+    // PsyDoom: alternatively run a benchmark of WAD lump decompression or the zone allocator instead of the game, if requested.
+    #if PSYDOOM_MODS
+        if (ProgArgs::gbBenchmarkDecode) {
+            W_RunDecodeBenchmark();
+        } else if (ProgArgs::gbBenchmarkZone) {
+            Z_RunBenchmark();
+        } else {
+            I_Main();
+        }
+    #else
+        I_Main();
+    #endif
 
     // PsyDoom: cleanup logic after Doom itself is done
     #if PSYDOOM_MODS
+        DemoTrace::endRecording();
+        LumpCache::shutdown();
         PsxVm::shutdown();
         ModMgr::shutdown();
         Input::shutdown();
         Config::shutdown();
         Controls::shutdown();
+
+        #if PSYDOOM_PROFILER
+            Profiler::shutdown();
+        #endif
+
         ProgArgs::shutdown();
         Utils::uninstallFatalErrorHandler();
     #endif
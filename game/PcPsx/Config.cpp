@@ -44,6 +44,10 @@ struct ConfigFieldHandler {
 bool        gbFullscreen;
 bool        gbFloorRenderGapFix;
 int32_t     gLogicalDisplayW;
+int32_t     gRasterizerThreads;
+bool        gbPipelinedRendering;
+bool        gbUpload16BitFramebuffer;
+int32_t     gRenderScale;
 
 static const ConfigFieldHandler GRAPHICS_CFG_INI_HANDLERS[] = {
     {
@@ -94,6 +98,56 @@ static const ConfigFieldHandler GRAPHICS_CFG_INI_HANDLERS[] = {
         [](const IniUtils::Entry& iniEntry) { gbFloorRenderGapFix = iniEntry.getBoolValue(true); },
         []() { gbFloorRenderGapFix = true; }
     },
+    {
+        "RasterizerThreads",
+        "#---------------------------------------------------------------------------------------------------\n"
+        "# How many worker threads to use for drawing the game's graphics.\n"
+        "# Using more than one thread can speed up rendering considerably on multi-core CPUs, and the output\n"
+        "# is identical to single threaded rendering.\n"
+        "#\n"
+        "# Special values:\n"
+        "#  0 or 1 = Draw everything on the main game thread (the original behavior).\n"
+        "#  -1     = Auto: use as many threads as there are CPU cores (up to a limit).\n"
+        "#---------------------------------------------------------------------------------------------------\n"
+        "RasterizerThreads = 0\n",
+        [](const IniUtils::Entry& iniEntry) { gRasterizerThreads = iniEntry.getIntValue(0); },
+        []() { gRasterizerThreads = 0; }
+    },
+    {
+        "PipelinedRendering",
+        "#---------------------------------------------------------------------------------------------------\n"
+        "# Whether to let the game start on the next frame while the current one is still being drawn.\n"
+        "# When enabled each frame is shown one frame later than usual, but game logic and drawing can run at\n"
+        "# the same time which raises the achievable framerate. Only has an effect when 'RasterizerThreads'\n"
+        "# enables multithreaded drawing. Set to '1' to enable, and '0' to disable.\n"
+        "#---------------------------------------------------------------------------------------------------\n"
+        "PipelinedRendering = 0\n",
+        [](const IniUtils::Entry& iniEntry) { gbPipelinedRendering = iniEntry.getBoolValue(false); },
+        []() { gbPipelinedRendering = false; }
+    },
+    {
+        "Upload16BitFramebuffer",
+        "#---------------------------------------------------------------------------------------------------\n"
+        "# Whether to hand the game's 16-bit framebuffer to the graphics driver as-is for display, rather than\n"
+        "# converting it to 32-bit color first. Halves the amount of data uploaded each frame and moves the\n"
+        "# color format conversion work off the CPU, but some graphics drivers may handle it poorly.\n"
+        "# Set to '1' to enable, and '0' to disable.\n"
+        "#---------------------------------------------------------------------------------------------------\n"
+        "Upload16BitFramebuffer = 0\n",
+        [](const IniUtils::Entry& iniEntry) { gbUpload16BitFramebuffer = iniEntry.getBoolValue(false); },
+        []() { gbUpload16BitFramebuffer = false; }
+    },
+    {
+        "RenderScale",
+        "#---------------------------------------------------------------------------------------------------\n"
+        "# Internal resolution to draw the game's graphics at, as a multiple of the original 256x240.\n"
+        "# Higher resolutions give a sharper image but cost more CPU time to draw. Textures are unchanged.\n"
+        "# Allowed values are '1' (original resolution), '2' and '4'.\n"
+        "#---------------------------------------------------------------------------------------------------\n"
+        "RenderScale = 1\n",
+        [](const IniUtils::Entry& iniEntry) { gRenderScale = iniEntry.getIntValue(1); },
+        []() { gRenderScale = 1; }
+    },
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -136,6 +190,7 @@ int32_t                 gUseFinalDoomPlayerMovement;
 int32_t                 gAllowMovementCancellation;
 bool                    gbAllowTurningCancellation;
 int32_t                 gLostSoulSpawnLimit;
+int32_t                 gDiscCacheSizeMB;
 
 const char* getCueFilePath() noexcept { return gCueFilePath.c_str(); }
 
@@ -288,6 +343,18 @@ static const ConfigFieldHandler GAME_CFG_INI_HANDLERS[] = {
         [](const IniUtils::Entry& iniEntry) { gLostSoulSpawnLimit = iniEntry.getIntValue(0); },
         []() { gLostSoulSpawnLimit = 0; }
     },
+    {
+        "DiscCacheSizeMB",
+        "#---------------------------------------------------------------------------------------------------\n"
+        "# How much memory (in MiB) to use for caching data read from the game disc.\n"
+        "# Recently read disc sectors are kept in memory and map files are loaded ahead of time in the\n"
+        "# background when a level is about to load, which can greatly speed up level loading if the disc\n"
+        "# image is on slow storage. Set to '0' to disable the cache and always read from the disc image.\n"
+        "#---------------------------------------------------------------------------------------------------\n"
+        "DiscCacheSizeMB = 64\n",
+        [](const IniUtils::Entry& iniEntry) { gDiscCacheSizeMB = iniEntry.getIntValue(64); },
+        []() { gDiscCacheSizeMB = 64; }
+    },
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
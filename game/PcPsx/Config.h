@@ -15,11 +15,16 @@ extern int32_t  gUseFinalDoomPlayerMovement;
 extern int32_t  gAllowMovementCancellation;
 extern bool     gbAllowTurningCancellation;
 extern int32_t  gLostSoulSpawnLimit;
+extern int32_t  gDiscCacheSizeMB;
 
 // Video settings
 extern bool     gbFullscreen;
 extern bool     gbFloorRenderGapFix;
 extern int32_t  gLogicalDisplayW;
+extern int32_t  gRasterizerThreads;
+extern bool     gbPipelinedRendering;
+extern bool     gbUpload16BitFramebuffer;
+extern int32_t  gRenderScale;
 
 // Audio settings
 extern int32_t  gAudioBufferSize;
@@ -15,6 +15,7 @@
 #include "FileUtils.h"
 #include "Finally.h"
 
+#include <cstdio>
 #include <rapidjson/document.h>
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/prettywriter.h>
@@ -159,8 +160,10 @@ template <class T>
 static bool verifyJsonFieldMatches(const rapidjson::Value& jsonObj, const char* const fieldName, const T expectedVal) noexcept {
     const rapidjson::Value& field = getJsonFieldOrNull(jsonObj, fieldName);
 
-    if ((!field.Is<T>()) || (field.Get<T>() != expectedVal))
+    if ((!field.Is<T>()) || (field.Get<T>() != expectedVal)) {
+        std::printf("Demo result mismatch for field '%s'!\n", fieldName);
         return false;
+    }
 
     return true;
 }
@@ -177,13 +180,16 @@ static bool verifyJsonArrayFieldMatches(
 ) {
     const rapidjson::Value& field = getJsonFieldOrNull(jsonObj, arrayFieldName);
 
-    if ((!field.IsArray()) || (field.Size() != arraySize))
+    if ((!field.IsArray()) || (field.Size() != arraySize)) {
+        std::printf("Demo result mismatch for field '%s'!\n", arrayFieldName);
         return false;
+    }
 
     for (unsigned i = 0; i < arraySize; ++i) {
         const rapidjson::Value& arrayValue = field[i];
         
         if ((!arrayValue.Is<JsonT>()) || ((CppT) arrayValue.Get<JsonT>() != expectedValues[i])) {
+            std::printf("Demo result mismatch for field '%s[%u]'!\n", arrayFieldName, i);
             return false;
         }
     }
@@ -199,18 +205,24 @@ bool verifyMatchesJsonFileResult(const char* const jsonFilePath) noexcept {
     // Read the input json file
     const FileData fileData = FileUtils::getContentsOfFile(jsonFilePath, 8, std::byte(0));
 
-    if (!fileData.bytes)
+    if (!fileData.bytes) {
+        std::printf("Failed to read the demo result file '%s'!\n", jsonFilePath);
         return false;
+    }
 
     // Parse the json
     rapidjson::Document document;
 
-    if (document.ParseInsitu((char*) fileData.bytes.get()).HasParseError())
+    if (document.ParseInsitu((char*) fileData.bytes.get()).HasParseError()) {
+        std::printf("Failed to parse the demo result file '%s'!\n", jsonFilePath);
         return false;
+    }
 
     // Validate everything
-    if (!document.HasMember("player"))
+    if (!document.HasMember("player")) {
+        std::printf("Demo result file '%s' has no player!\n", jsonFilePath);
         return false;
+    }
 
     // Validate the demo result
     player_t& player = gPlayers[0];
@@ -0,0 +1,491 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Utilities for recording a trace of the game state for each tick of a demo and comparing two such traces.
+//
+// Used to help diagnose demo 'de-syncs': 'DemoResult' only tells us that the state at the end of a demo differs, whereas comparing the
+// trace of a known good build against the trace of a bad build tells us the first tick where the game logic differs and which part of
+// the game state (RNG, players, map objects etc.) is affected.
+//
+// The trace file is a compact binary file consisting of a header followed by one fixed size record per tick of game logic run.
+// Each record contains the map number, game tic and a hash of each of the game subsystems. The data is written in native (little endian)
+// byte order. The file is opened once when the game starts and the ticks of each level played are appended to it, one level after another.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "DemoTrace.h"
+
+#include "Doom/Base/m_random.h"
+#include "Doom/Game/g_game.h"
+#include "Doom/Game/info.h"
+#include "Doom/Game/p_ceiling.h"
+#include "Doom/Game/p_doors.h"
+#include "Doom/Game/p_floor.h"
+#include "Doom/Game/p_lights.h"
+#include "Doom/Game/p_plats.h"
+#include "Doom/Game/p_setup.h"
+#include "Doom/Game/p_tick.h"
+#include "Doom/Renderer/r_local.h"
+#include "Finally.h"
+
+#include <cstdio>
+#include <cstring>
+
+BEGIN_NAMESPACE(DemoTrace)
+
+// Identifies a trace file and the current version of the format
+static constexpr char       TRACE_FILE_ID[4]    = { 'P', 'D', 'T', 'R' };
+static constexpr uint32_t   TRACE_FILE_VERSION  = 2;
+
+// Header for a trace file
+struct TraceFileHdr {
+    char        fileId[4];          // Should be 'TRACE_FILE_ID'
+    uint32_t    version;            // Should be 'TRACE_FILE_VERSION'
+    uint32_t    numSubsystems;      // How many subsystem hashes there are for each tick
+};
+
+// The recorded state for one tick of game logic
+struct TraceTick {
+    int32_t     mapNum;                     // The map that the tick was run on
+    int32_t     gameTic;                    // The game tic that the tick was run on
+    uint32_t    hashes[NUM_SUBSYSTEMS];     // Hash of the state for each subsystem
+};
+
+// Names for each subsystem, for reporting
+static constexpr const char* const SUBSYSTEM_NAMES[NUM_SUBSYSTEMS] = {
+    "RNG",
+    "players",
+    "map objects",
+    "sectors",
+    "thinkers",
+};
+
+// The trace file currently being recorded to, if any
+static std::FILE* gpTraceFile;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Computes a 32-bit FNV-1a hash of a series of values from the game state
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct StateHasher {
+    uint32_t hash = 0x811C9DC5;
+
+    void add(const uint32_t value) noexcept {
+        for (uint32_t i = 0; i < 4; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x01000193;
+        }
+    }
+
+    void add(const int32_t value) noexcept { add((uint32_t) value); }
+    void add(const bool value) noexcept { add((uint32_t) value); }
+
+    // Add a state as an index since pointers vary from run to run
+    void addState(const state_t* const pState) noexcept {
+        add((pState) ? (int32_t)(pState - gStates) : -1);
+    }
+
+    // Add a sector as an index since pointers vary from run to run
+    void addSector(const sector_t* const pSector) noexcept {
+        add((pSector) ? (int32_t)(pSector - gpSectors) : -1);
+    }
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Hashing the state of each subsystem
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint32_t hashRng() noexcept {
+    uint32_t pRndIndex = {};
+    uint32_t mRndIndex = {};
+    M_GetRandomIndexes(pRndIndex, mRndIndex);
+
+    StateHasher hasher;
+    hasher.add(pRndIndex);
+    hasher.add(mRndIndex);
+    return hasher.hash;
+}
+
+static uint32_t hashPlayers() noexcept {
+    StateHasher hasher;
+
+    for (int32_t playerIdx = 0; playerIdx < MAXPLAYERS; ++playerIdx) {
+        hasher.add(gbPlayerInGame[playerIdx]);
+
+        if (!gbPlayerInGame[playerIdx])
+            continue;
+
+        const player_t& player = gPlayers[playerIdx];
+        hasher.add((int32_t) player.playerstate);
+        hasher.add(player.viewz);
+        hasher.add(player.viewheight);
+        hasher.add(player.deltaviewheight);
+        hasher.add(player.bob);
+        hasher.add(player.health);
+        hasher.add(player.armorpoints);
+        hasher.add(player.armortype);
+
+        for (int32_t power : player.powers) {
+            hasher.add(power);
+        }
+
+        for (bool bHasCard : player.cards) {
+            hasher.add(bHasCard);
+        }
+
+        hasher.add(player.backpack);
+        hasher.add((int32_t) player.readyweapon);
+        hasher.add((int32_t) player.pendingweapon);
+
+        for (bool bOwned : player.weaponowned) {
+            hasher.add(bOwned);
+        }
+
+        for (int32_t i = 0; i < NUMAMMO; ++i) {
+            hasher.add(player.ammo[i]);
+            hasher.add(player.maxammo[i]);
+        }
+
+        hasher.add(player.attackdown);
+        hasher.add(player.usedown);
+        hasher.add(player.cheats);
+        hasher.add(player.refire);
+        hasher.add(player.killcount);
+        hasher.add(player.itemcount);
+        hasher.add(player.secretcount);
+        hasher.add(player.damagecount);
+        hasher.add(player.bonuscount);
+        hasher.add(player.extralight);
+
+        for (const pspdef_t& psprite : player.psprites) {
+            hasher.addState(psprite.state);
+            hasher.add(psprite.tics);
+            hasher.add(psprite.sx);
+            hasher.add(psprite.sy);
+        }
+    }
+
+    return hasher.hash;
+}
+
+static uint32_t hashMapObjects() noexcept {
+    StateHasher hasher;
+
+    for (const mobj_t* pMobj = gMObjHead.next; pMobj != &gMObjHead; pMobj = pMobj->next) {
+        const mobj_t& mobj = *pMobj;
+        hasher.add((int32_t) mobj.type);
+        hasher.add(mobj.x);
+        hasher.add(mobj.y);
+        hasher.add(mobj.z);
+        hasher.add(mobj.angle);
+        hasher.add(mobj.momx);
+        hasher.add(mobj.momy);
+        hasher.add(mobj.momz);
+        hasher.add(mobj.floorz);
+        hasher.add(mobj.ceilingz);
+        hasher.add(mobj.radius);
+        hasher.add(mobj.height);
+        hasher.addState(mobj.state);
+        hasher.add(mobj.tics);
+        hasher.add(mobj.flags);
+        hasher.add(mobj.health);
+        hasher.add((int32_t) mobj.movedir);
+        hasher.add(mobj.movecount);
+        hasher.add(mobj.reactiontime);
+        hasher.add(mobj.threshold);
+        hasher.add((mobj.target) ? (int32_t) mobj.target->type : -1);
+    }
+
+    return hasher.hash;
+}
+
+static uint32_t hashSectors() noexcept {
+    StateHasher hasher;
+
+    for (int32_t sectorIdx = 0; sectorIdx < gNumSectors; ++sectorIdx) {
+        const sector_t& sector = gpSectors[sectorIdx];
+        hasher.add(sector.floorheight);
+        hasher.add(sector.ceilingheight);
+        hasher.add(sector.floorpic);
+        hasher.add(sector.ceilingpic);
+        hasher.add((int32_t) sector.colorid);
+        hasher.add((int32_t) sector.lightlevel);
+        hasher.add(sector.special);
+        hasher.add(sector.tag);
+        hasher.add(sector.soundtraversed);
+        hasher.add(sector.flags);
+        hasher.add(sector.specialdata != nullptr);
+    }
+
+    return hasher.hash;
+}
+
+static uint32_t hashThinkers() noexcept {
+    // Identifiers for each type of thinker hashed.
+    // Note: can't hash the think functions themselves since code addresses vary from run to run and build to build.
+    enum ThinkerType : int32_t {
+        Removed = -1,
+        Other,
+        Floor,
+        Ceiling,
+        Door,
+        Plat,
+        FireFlicker,
+        LightFlash,
+        StrobeFlash,
+        Glow
+    };
+
+    // Hash the type of every thinker in order, along with the state of all mover and light thinkers.
+    // The sectors affected are hashed as indexes, which ties the thinkers to the 'specialdata' of sectors hashed in 'hashSectors'.
+    StateHasher hasher;
+
+    for (const thinker_t* pThinker = gThinkerCap.next; pThinker != &gThinkerCap; pThinker = pThinker->next) {
+        const think_t thinkFunc = pThinker->function;
+
+        if (thinkFunc == (think_t)(intptr_t) -1) {
+            hasher.add(ThinkerType::Removed);
+        }
+        else if (thinkFunc == (think_t) &T_MoveFloor) {
+            const floormove_t& floor = (const floormove_t&) *pThinker;
+            hasher.add(ThinkerType::Floor);
+            hasher.add((int32_t) floor.type);
+            hasher.add(floor.crush);
+            hasher.addSector(floor.sector);
+            hasher.add(floor.direction);
+            hasher.add(floor.newspecial);
+            hasher.add((int32_t) floor.texture);
+            hasher.add(floor.floordestheight);
+            hasher.add(floor.speed);
+        }
+        else if (thinkFunc == (think_t) &T_MoveCeiling) {
+            const ceiling_t& ceiling = (const ceiling_t&) *pThinker;
+            hasher.add(ThinkerType::Ceiling);
+            hasher.add((int32_t) ceiling.type);
+            hasher.addSector(ceiling.sector);
+            hasher.add(ceiling.bottomheight);
+            hasher.add(ceiling.topheight);
+            hasher.add(ceiling.speed);
+            hasher.add(ceiling.crush);
+            hasher.add(ceiling.direction);
+            hasher.add(ceiling.tag);
+            hasher.add(ceiling.olddirection);
+        }
+        else if (thinkFunc == (think_t) &T_VerticalDoor) {
+            const vldoor_t& door = (const vldoor_t&) *pThinker;
+            hasher.add(ThinkerType::Door);
+            hasher.add((int32_t) door.type);
+            hasher.addSector(door.sector);
+            hasher.add(door.topheight);
+            hasher.add(door.speed);
+            hasher.add(door.direction);
+            hasher.add(door.topwait);
+            hasher.add(door.topcountdown);
+        }
+        else if (thinkFunc == (think_t) &T_PlatRaise) {
+            const plat_t& plat = (const plat_t&) *pThinker;
+            hasher.add(ThinkerType::Plat);
+            hasher.addSector(plat.sector);
+            hasher.add(plat.speed);
+            hasher.add(plat.low);
+            hasher.add(plat.high);
+            hasher.add(plat.wait);
+            hasher.add(plat.count);
+            hasher.add((int32_t) plat.status);
+            hasher.add((int32_t) plat.oldstatus);
+            hasher.add(plat.crush);
+            hasher.add(plat.tag);
+            hasher.add((int32_t) plat.type);
+        }
+        else if (thinkFunc == (think_t) &T_FireFlicker) {
+            const fireflicker_t& flicker = (const fireflicker_t&) *pThinker;
+            hasher.add(ThinkerType::FireFlicker);
+            hasher.addSector(flicker.sector);
+            hasher.add(flicker.count);
+            hasher.add(flicker.maxlight);
+            hasher.add(flicker.minlight);
+        }
+        else if (thinkFunc == (think_t) &T_LightFlash) {
+            const lightflash_t& flash = (const lightflash_t&) *pThinker;
+            hasher.add(ThinkerType::LightFlash);
+            hasher.addSector(flash.sector);
+            hasher.add(flash.count);
+            hasher.add(flash.maxlight);
+            hasher.add(flash.minlight);
+            hasher.add(flash.maxtime);
+            hasher.add(flash.mintime);
+        }
+        else if (thinkFunc == (think_t) &T_StrobeFlash) {
+            const strobe_t& strobe = (const strobe_t&) *pThinker;
+            hasher.add(ThinkerType::StrobeFlash);
+            hasher.addSector(strobe.sector);
+            hasher.add(strobe.count);
+            hasher.add(strobe.minlight);
+            hasher.add(strobe.maxlight);
+            hasher.add(strobe.darktime);
+            hasher.add(strobe.brighttime);
+        }
+        else if (thinkFunc == (think_t) &T_Glow) {
+            const glow_t& glow = (const glow_t&) *pThinker;
+            hasher.add(ThinkerType::Glow);
+            hasher.addSector(glow.sector);
+            hasher.add(glow.minlight);
+            hasher.add(glow.maxlight);
+            hasher.add(glow.direction);
+        }
+        else {
+            hasher.add(ThinkerType::Other);
+        }
+    }
+
+    return hasher.hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Starts recording a trace of the game state for each tick to the given file, overwriting it.
+// This should be called once only when the game starts: the ticks for every level played are then appended to the same trace.
+// Returns 'false' if the file could not be created.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool beginRecording(const char* const traceFilePath) noexcept {
+    endRecording();
+    gpTraceFile = std::fopen(traceFilePath, "wb");
+
+    if (!gpTraceFile)
+        return false;
+
+    TraceFileHdr hdr = {};
+    std::memcpy(hdr.fileId, TRACE_FILE_ID, sizeof(TRACE_FILE_ID));
+    hdr.version = TRACE_FILE_VERSION;
+    hdr.numSubsystems = NUM_SUBSYSTEMS;
+    std::fwrite(&hdr, sizeof(hdr), 1, gpTraceFile);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Finishes up recording the current trace, if there is one
+//------------------------------------------------------------------------------------------------------------------------------------------
+void endRecording() noexcept {
+    if (gpTraceFile) {
+        std::fflush(gpTraceFile);
+        std::fclose(gpTraceFile);
+        gpTraceFile = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Records the game state for the tick just run to the current trace, if recording
+//------------------------------------------------------------------------------------------------------------------------------------------
+void recordTick() noexcept {
+    if (!gpTraceFile)
+        return;
+
+    TraceTick tick = {};
+    tick.mapNum = gGameMap;
+    tick.gameTic = gGameTic;
+    tick.hashes[(uint32_t) Subsystem::Rng] = hashRng();
+    tick.hashes[(uint32_t) Subsystem::Players] = hashPlayers();
+    tick.hashes[(uint32_t) Subsystem::MapObjects] = hashMapObjects();
+    tick.hashes[(uint32_t) Subsystem::Sectors] = hashSectors();
+    tick.hashes[(uint32_t) Subsystem::Thinkers] = hashThinkers();
+    std::fwrite(&tick, sizeof(tick), 1, gpTraceFile);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Opens the given trace file for reading and verifies the header.
+// Returns null on failure, after printing the reason.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static std::FILE* openTraceFile(const char* const traceFilePath) noexcept {
+    std::FILE* const pFile = std::fopen(traceFilePath, "rb");
+
+    if (!pFile) {
+        std::printf("Failed to open trace file '%s'!\n", traceFilePath);
+        return nullptr;
+    }
+
+    TraceFileHdr hdr = {};
+    const bool bReadHdr = (std::fread(&hdr, sizeof(hdr), 1, pFile) == 1);
+
+    if ((!bReadHdr) || (std::memcmp(hdr.fileId, TRACE_FILE_ID, sizeof(TRACE_FILE_ID)) != 0)) {
+        std::printf("File '%s' is not a valid trace file!\n", traceFilePath);
+        std::fclose(pFile);
+        return nullptr;
+    }
+
+    if ((hdr.version != TRACE_FILE_VERSION) || (hdr.numSubsystems != NUM_SUBSYSTEMS)) {
+        std::printf("Trace file '%s' is from an incompatible version of PsyDoom!\n", traceFilePath);
+        std::fclose(pFile);
+        return nullptr;
+    }
+
+    return pFile;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Compares the two given trace files and reports the first tick where the game state differs and which subsystems differ.
+// Returns '0' if the traces match, '1' if they differ and '2' if there was an error reading the traces.
+//------------------------------------------------------------------------------------------------------------------------------------------
+int compareTraceFiles(const char* const traceFilePath1, const char* const traceFilePath2) noexcept {
+    std::FILE* const pFile1 = openTraceFile(traceFilePath1);
+    std::FILE* const pFile2 = (pFile1) ? openTraceFile(traceFilePath2) : nullptr;
+
+    auto closeFiles = finally([&]() noexcept {
+        if (pFile1) {
+            std::fclose(pFile1);
+        }
+
+        if (pFile2) {
+            std::fclose(pFile2);
+        }
+    });
+
+    if ((!pFile1) || (!pFile2))
+        return 2;
+
+    // Compare tick by tick until either trace ends or there is a difference
+    for (int32_t tickIdx = 0; ; ++tickIdx) {
+        TraceTick tick1 = {};
+        TraceTick tick2 = {};
+        const bool bHaveTick1 = (std::fread(&tick1, sizeof(tick1), 1, pFile1) == 1);
+        const bool bHaveTick2 = (std::fread(&tick2, sizeof(tick2), 1, pFile2) == 1);
+
+        if ((!bHaveTick1) && (!bHaveTick2)) {
+            std::printf("Traces match for all %d ticks.\n", tickIdx);
+            return 0;
+        }
+
+        if (bHaveTick1 != bHaveTick2) {
+            std::printf(
+                "Traces diverge at tick %d: trace '%s' ends while the other continues.\n",
+                tickIdx,
+                (bHaveTick1) ? traceFilePath2 : traceFilePath1
+            );
+
+            return 1;
+        }
+
+        // Make a list of which subsystems differ, if any
+        char diffList[256] = {};
+
+        if (tick1.mapNum != tick2.mapNum) {
+            std::snprintf(diffList, C_ARRAY_SIZE(diffList), "map (%d vs %d)", tick1.mapNum, tick2.mapNum);
+        }
+        else if (tick1.gameTic != tick2.gameTic) {
+            std::snprintf(diffList, C_ARRAY_SIZE(diffList), "game tic (%d vs %d)", tick1.gameTic, tick2.gameTic);
+        }
+
+        for (uint32_t i = 0; i < NUM_SUBSYSTEMS; ++i) {
+            if (tick1.hashes[i] == tick2.hashes[i])
+                continue;
+
+            const size_t diffListLen = std::strlen(diffList);
+            std::snprintf(
+                diffList + diffListLen,
+                C_ARRAY_SIZE(diffList) - diffListLen,
+                "%s%s",
+                (diffListLen > 0) ? ", " : "",
+                SUBSYSTEM_NAMES[i]
+            );
+        }
+
+        if (diffList[0]) {
+            std::printf("Traces diverge at tick %d (map %d, game tic %d): %s differ.\n", tickIdx, tick1.mapNum, tick1.gameTic, diffList);
+            return 1;
+        }
+    }
+}
+
+END_NAMESPACE(DemoTrace)
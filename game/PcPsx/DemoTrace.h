@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Macros.h"
+
+#include <cstdint>
+
+BEGIN_NAMESPACE(DemoTrace)
+
+// The parts of the game state which are hashed separately for each tick in a trace, so we can tell which part of the simulation differs
+enum class Subsystem : uint32_t {
+    Rng,            // Positions in the game and UI random number tables
+    Players,        // Player state and the state of their weapons
+    MapObjects,     // All map objects: positions, states, health and so on
+    Sectors,        // Sector floor and ceiling heights, lighting and specials
+    Thinkers,       // The order and types of all thinkers, and the state of mover and light thinkers
+    NUM_SUBSYSTEMS
+};
+
+static constexpr uint32_t NUM_SUBSYSTEMS = (uint32_t) Subsystem::NUM_SUBSYSTEMS;
+
+bool beginRecording(const char* const traceFilePath) noexcept;
+void endRecording() noexcept;
+void recordTick() noexcept;
+int compareTraceFiles(const char* const traceFilePath1, const char* const traceFilePath2) noexcept;
+
+END_NAMESPACE(DemoTrace)
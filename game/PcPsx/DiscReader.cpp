@@ -2,8 +2,52 @@
 
 #include "Asserts.h"
 #include "DiscInfo.h"
+#include "DiscSectorCache.h"
+#include "MappedFile.h"
 
 #include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// PsyDoom: memory mapped disc image files, which are shared between all disc readers and kept mapped for the lifetime of the app.
+// Reading from a mapped file is just a memory copy, which avoids the overhead of a 'fread' and 'fseek' for every sector read.
+// Files which failed to map are remembered also (with a null mapping) and are read using regular file I/O instead.
+// Each file is also given a unique id, which is used to identify its sectors in the shared sector cache.
+struct SourceFile {
+    std::unique_ptr<MappedFile>     pMappedFile;
+    uint64_t                        id;
+};
+
+static std::mutex gMappedFilesMutex;
+static std::map<std::string, SourceFile> gMappedFiles;
+
+// How many bits of a sector cache key are used for the physical offset of the sector in its file; the rest identify the file
+static constexpr uint32_t SECTOR_KEY_OFFSET_BITS = 40;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the shared details for the given disc image file, memory mapping the file if possible.
+// Note: this is called by multiple threads (the CD audio streamer, disc prefetcher and the main thread), hence the locking.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static const SourceFile& getSourceFile(const std::string& filePath) noexcept {
+    std::lock_guard<std::mutex> lock(gMappedFilesMutex);
+    auto iter = gMappedFiles.find(filePath);
+
+    if (iter == gMappedFiles.end()) {
+        std::unique_ptr<MappedFile> pMappedFile = std::make_unique<MappedFile>();
+
+        if (!pMappedFile->open(filePath.c_str())) {
+            pMappedFile.reset();
+        }
+
+        const uint64_t fileId = gMappedFiles.size();
+        iter = gMappedFiles.emplace(filePath, SourceFile{ std::move(pMappedFile), fileId }).first;
+    }
+
+    return iter->second;
+}
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Initialize the disc reader: the reference to the disc info must remain valid for the lifetime of this object
@@ -14,6 +58,9 @@ DiscReader::DiscReader(DiscInfo& discInfo) noexcept
     , mCurTrackIdx(-1)
     , mCurOffset(0)
     , mpOpenFile(nullptr)
+    , mpMappedFile(nullptr)
+    , mMappedSize(0)
+    , mSectorKeyBase(0)
 {
 }
 
@@ -47,12 +94,21 @@ bool DiscReader::setTrackNum(int32_t trackNum) noexcept {
 
     // Open the file for the new track if it's different to the current file
     if ((!mpCurTrack) || (mpCurTrack->sourceFilePath != pTrack->sourceFilePath)) {
-        // Need to switch files: close the old track and open the new one
+        // Need to switch files: close the old track and open the new one.
+        // Prefer to memory map the file if possible and fallback to regular file I/O otherwise.
         closeTrack();
-        mpOpenFile = std::fopen(pTrack->sourceFilePath.c_str(), "rb");
+        const SourceFile& sourceFile = getSourceFile(pTrack->sourceFilePath);
+        mSectorKeyBase = sourceFile.id << SECTOR_KEY_OFFSET_BITS;
 
-        if (!mpOpenFile)
-            return false;
+        if (const MappedFile* const pMappedFile = sourceFile.pMappedFile.get()) {
+            mpMappedFile = pMappedFile->getData();
+            mMappedSize = pMappedFile->getSize();
+        } else {
+            mpOpenFile = std::fopen(pTrack->sourceFilePath.c_str(), "rb");
+
+            if (!mpOpenFile)
+                return false;
+        }
     }
 
     // Success - save the current track number and track!
@@ -75,7 +131,7 @@ bool DiscReader::setTrackNum(int32_t trackNum) noexcept {
 // Is a track currently open for reading?
 //------------------------------------------------------------------------------------------------------------------------------------------
 bool DiscReader::isTrackOpen() noexcept {
-    return (mpOpenFile != nullptr);
+    return ((mpOpenFile != nullptr) || (mpMappedFile != nullptr));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -89,6 +145,10 @@ void DiscReader::closeTrack() noexcept {
         mpOpenFile = nullptr;
     }
 
+    // Note: the memory mapping is shared and stays around, this reader is just no longer using it
+    mpMappedFile = nullptr;
+    mMappedSize = 0;
+
     mCurOffset = 0;
     mCurTrackIdx = -1;
     mpCurTrack = nullptr;
@@ -102,7 +162,7 @@ bool DiscReader::trackSeekAbs(const int32_t offsetAbs) noexcept {
     if (!mpCurTrack)
         return false;
 
-    ASSERT(mpOpenFile);
+    ASSERT(mpOpenFile || mpMappedFile);
 
     if ((offsetAbs < 0) || (offsetAbs > mpCurTrack->trackPayloadSize))
         return false;
@@ -111,11 +171,13 @@ bool DiscReader::trackSeekAbs(const int32_t offsetAbs) noexcept {
     if (mCurOffset == offsetAbs)
         return true;
     
-    // Do the seek and save the result if successful
-    const int32_t physicalOffset = dataOffsetToPhysical(offsetAbs);
+    // Do the seek and save the result if successful; if the file is memory mapped then there is nothing to do other than save the offset
+    if (mpOpenFile) {
+        const int32_t physicalOffset = dataOffsetToPhysical(offsetAbs);
     
-    if (std::fseek((FILE*) mpOpenFile, physicalOffset, SEEK_SET) != 0)
-        return false;
+        if (std::fseek((FILE*) mpOpenFile, physicalOffset, SEEK_SET) != 0)
+            return false;
+    }
     
     mCurOffset = offsetAbs;
     return true;
@@ -129,7 +191,7 @@ bool DiscReader::trackSeekRel(const int32_t offsetRel) noexcept {
     if (!mpCurTrack)
         return false;
 
-    ASSERT(mpOpenFile);
+    ASSERT(mpOpenFile || mpMappedFile);
     const int32_t newOffset = mCurOffset + offsetRel;
 
     if ((newOffset < 0) || (newOffset > mpCurTrack->trackPayloadSize))
@@ -139,11 +201,13 @@ bool DiscReader::trackSeekRel(const int32_t offsetRel) noexcept {
     if (mCurOffset == newOffset)
         return true;
 
-    // Do the seek and save the result if successful
-    const int32_t physicalOffset = dataOffsetToPhysical(newOffset);
+    // Do the seek and save the result if successful; if the file is memory mapped then there is nothing to do other than save the offset
+    if (mpOpenFile) {
+        const int32_t physicalOffset = dataOffsetToPhysical(newOffset);
     
-    if (std::fseek((FILE*) mpOpenFile, physicalOffset, SEEK_SET) != 0)
-        return false;
+        if (std::fseek((FILE*) mpOpenFile, physicalOffset, SEEK_SET) != 0)
+            return false;
+    }
     
     mCurOffset = newOffset;
     return true;
@@ -164,6 +228,15 @@ bool DiscReader::read(void* const pBuffer, const int32_t numBytes) noexcept {
         return false;
     }
 
+    // PsyDoom: data track reads go through the shared sector cache if it's enabled.
+    // Audio tracks are not cached since they are streamed once from start to finish and would just push useful data out of the cache.
+    if (mpCurTrack->bIsData && DiscSectorCache::isEnabled())
+        return readCached(pBuffer, numBytes);
+
+    // If the file is memory mapped then take a faster path
+    if (mpMappedFile)
+        return readMapped(pBuffer, numBytes);
+
     // Continue reading until there no bytes left
     const int32_t blockPayloadSize = mpCurTrack->blockPayloadSize;
 
@@ -194,6 +267,178 @@ bool DiscReader::read(void* const pBuffer, const int32_t numBytes) noexcept {
     return true;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Does a read for a track in a memory mapped file: works the same as 'read' but just copies from the mapped file.
+// If the track has no sector framing (e.g a plain .iso image) then the whole read is done with a single copy.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool DiscReader::readMapped(void* const pBuffer, const int32_t numBytes) noexcept {
+    ASSERT(mpCurTrack);
+    ASSERT(mpMappedFile);
+
+    // Reads past the end of the track fail, same as for regular file I/O
+    if (numBytes > mpCurTrack->trackPayloadSize - mCurOffset) {
+        std::memset(pBuffer, 0, (size_t) numBytes);
+        return false;
+    }
+
+    const int32_t blockPayloadSize = mpCurTrack->blockPayloadSize;
+    const bool bContiguousPayload = (mpCurTrack->blockSize == blockPayloadSize);
+
+    std::byte* pDstBytes = (std::byte*) pBuffer;
+    int32_t bytesLeft = numBytes;
+
+    while (bytesLeft > 0) {
+        // How many bytes can be copied in one go? Either the rest of this sector, or everything if there is no sector framing.
+        const int32_t sectorBytesLeft = blockPayloadSize - (mCurOffset % blockPayloadSize);
+        const int32_t thisReadSize = (bContiguousPayload) ? bytesLeft : std::min(bytesLeft, sectorBytesLeft);
+        const size_t physicalOffset = (size_t) dataOffsetToPhysical(mCurOffset);
+
+        // Fail if the data is not actually in the file
+        if (physicalOffset + (size_t) thisReadSize > mMappedSize) {
+            std::memset(pBuffer, 0, (size_t) numBytes);
+            return false;
+        }
+
+        std::memcpy(pDstBytes, mpMappedFile + physicalOffset, (size_t) thisReadSize);
+        bytesLeft -= thisReadSize;
+        pDstBytes += thisReadSize;
+        mCurOffset += thisReadSize;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Warms the shared sector cache with the given number of bytes from the current offset in the track, without copying the data anywhere.
+// Like a read, the current offset in the track is advanced on success. Returns 'false' on failure or if the cache is not in use.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool DiscReader::prefetch(const int32_t numBytes) noexcept {
+    ASSERT(numBytes >= 0);
+
+    if ((!mpCurTrack) || (!mpCurTrack->bIsData) || (!DiscSectorCache::isEnabled()))
+        return false;
+
+    if (numBytes > mpCurTrack->trackPayloadSize - mCurOffset)
+        return false;
+
+    // Load all the sectors touched by the data range which are not already in the cache
+    const int32_t blockPayloadSize = mpCurTrack->blockPayloadSize;
+    const int32_t endOffset = mCurOffset + numBytes;
+    std::byte sectorData[DiscSectorCache::MAX_SECTOR_SIZE];
+
+    for (int32_t lba = mCurOffset / blockPayloadSize; lba * blockPayloadSize < endOffset; ++lba) {
+        const uint64_t sectorKey = getSectorCacheKey(lba);
+
+        if (DiscSectorCache::containsSector(sectorKey))
+            continue;
+
+        if (!readSectorPayload(lba, sectorData))
+            return false;
+
+        DiscSectorCache::addSector(sectorKey, sectorData, blockPayloadSize, true);
+    }
+
+    mCurOffset = endOffset;
+    return syncFilePosition();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Does a read for a data track using the shared sector cache: works the same as 'read' but sectors are fetched from the cache if possible.
+// Any sectors which are not in the cache are read from the disc image and added to the cache.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool DiscReader::readCached(void* const pBuffer, const int32_t numBytes) noexcept {
+    ASSERT(mpCurTrack);
+
+    // Reads past the end of the track fail, same as for regular file I/O
+    if (numBytes > mpCurTrack->trackPayloadSize - mCurOffset) {
+        std::memset(pBuffer, 0, (size_t) numBytes);
+        return false;
+    }
+
+    const int32_t blockPayloadSize = mpCurTrack->blockPayloadSize;
+    std::byte sectorData[DiscSectorCache::MAX_SECTOR_SIZE];
+
+    std::byte* pDstBytes = (std::byte*) pBuffer;
+    int32_t bytesLeft = numBytes;
+
+    while (bytesLeft > 0) {
+        // Read what we need from this sector, going to the disc image on a cache miss
+        const int32_t lba = mCurOffset / blockPayloadSize;
+        const int32_t sectorOffset = mCurOffset % blockPayloadSize;
+        const int32_t thisReadSize = std::min(bytesLeft, blockPayloadSize - sectorOffset);
+        const uint64_t sectorKey = getSectorCacheKey(lba);
+
+        if (!DiscSectorCache::readSector(sectorKey, pDstBytes, sectorOffset, thisReadSize)) {
+            if (!readSectorPayload(lba, sectorData)) {
+                std::memset(pBuffer, 0, (size_t) numBytes);
+                return false;
+            }
+
+            DiscSectorCache::addSector(sectorKey, sectorData, blockPayloadSize, false);
+            std::memcpy(pDstBytes, sectorData + sectorOffset, (size_t) thisReadSize);
+        }
+
+        bytesLeft -= thisReadSize;
+        pDstBytes += thisReadSize;
+        mCurOffset += thisReadSize;
+    }
+
+    // Reading sectors may have moved the file position, make sure it's where the track offset says it should be
+    if (!syncFilePosition()) {
+        std::memset(pBuffer, 0, (size_t) numBytes);
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Read the entire payload of the given sector in the current track directly from the disc image, bypassing the sector cache.
+// Note: for regular file I/O this leaves the file position at an unspecified location.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool DiscReader::readSectorPayload(const int32_t lba, std::byte* const pDst) noexcept {
+    ASSERT(mpCurTrack);
+    ASSERT(mpCurTrack->blockPayloadSize <= DiscSectorCache::MAX_SECTOR_SIZE);
+
+    const int32_t blockPayloadSize = mpCurTrack->blockPayloadSize;
+    const int64_t physicalOffset = (int64_t) mpCurTrack->fileOffset + (int64_t) lba * mpCurTrack->blockSize + mpCurTrack->blockPayloadOffset;
+
+    if (mpMappedFile) {
+        if ((size_t) physicalOffset + (size_t) blockPayloadSize > mMappedSize)
+            return false;
+
+        std::memcpy(pDst, mpMappedFile + physicalOffset, (size_t) blockPayloadSize);
+        return true;
+    }
+
+    FILE* const pFile = (FILE*) mpOpenFile;
+
+    if (std::fseek(pFile, (long) physicalOffset, SEEK_SET) != 0)
+        return false;
+
+    return (std::fread(pDst, (size_t) blockPayloadSize, 1, pFile) == 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Makes sure the file position for regular file I/O matches the current offset in the track; does nothing for memory mapped files
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool DiscReader::syncFilePosition() noexcept {
+    if (!mpOpenFile)
+        return true;
+
+    return (std::fseek((FILE*) mpOpenFile, dataOffsetToPhysical(mCurOffset), SEEK_SET) == 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the key which identifies the given sector of the current track in the shared sector cache.
+// This is based on the physical location of the sector in the disc image, so it is the same for all disc readers.
+//------------------------------------------------------------------------------------------------------------------------------------------
+uint64_t DiscReader::getSectorCacheKey(const int32_t lba) const noexcept {
+    ASSERT(mpCurTrack);
+    const int64_t physicalOffset = (int64_t) mpCurTrack->fileOffset + (int64_t) lba * mpCurTrack->blockSize;
+    return mSectorKeyBase | (uint64_t) physicalOffset;
+}
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Get the offset in the currently open track
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 #include "Macros.h"
 
+#include <cstddef>
 #include <cstdint>
 
 struct DiscInfo;
@@ -25,14 +26,23 @@ public:
     bool trackSeekAbs(const int32_t offsetAbs) noexcept;
     bool trackSeekRel(const int32_t offsetRel) noexcept;
     bool read(void* const pBuffer, const int32_t numBytes) noexcept;
+    bool prefetch(const int32_t numBytes) noexcept;
     int32_t tell() const noexcept;
 
 private:
+    bool readMapped(void* const pBuffer, const int32_t numBytes) noexcept;
+    bool readCached(void* const pBuffer, const int32_t numBytes) noexcept;
+    bool readSectorPayload(const int32_t lba, std::byte* const pDst) noexcept;
+    bool syncFilePosition() noexcept;
+    uint64_t getSectorCacheKey(const int32_t lba) const noexcept;
     int32_t dataOffsetToPhysical(const int32_t dataOffset) const noexcept;
 
     DiscInfo&           mDiscInfo;      // Information for the disc being read from
     const DiscTrack*    mpCurTrack;     // Pointer to the current track open for the disc reader
     int32_t             mCurTrackIdx;   // Current track index in the disc that is open for reading or '-1' if none
     int32_t             mCurOffset;     // Current byte offset in the actual track data we are at (NOT physical offset in the file)
-    void*               mpOpenFile;     // Handle to the open file for the current track
+    void*               mpOpenFile;     // Handle to the open file for the current track (if not memory mapped)
+    const std::byte*    mpMappedFile;   // Memory mapped contents of the file for the current track, or null if the file is being read normally
+    size_t              mMappedSize;    // Size of the memory mapped file
+    uint64_t            mSectorKeyBase; // Identifies the file for the current track in the shared sector cache
 };
@@ -0,0 +1,333 @@
+#include "DiscSectorCache.h"
+
+#include "Asserts.h"
+#include "DiscInfo.h"
+#include "DiscReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+BEGIN_NAMESPACE(DiscSectorCache)
+
+// How much data the prefetcher reads in one go before checking whether it has been asked to quit
+static constexpr int32_t PREFETCH_CHUNK_SIZE = 64 * 1024;
+
+// An entry in the cache for one sector
+struct CacheEntry {
+    uint64_t    key;            // Which sector is held, as identified by the disc reader
+    int32_t     lruPrev;        // Previous (more recently used) entry in the LRU list, or '-1' if none
+    int32_t     lruNext;        // Next (less recently used) entry in the LRU list, or '-1' if none
+    int32_t     size;           // How many bytes of sector data is held
+    bool        bPrefetched;    // True if the sector was loaded by the prefetcher and has not been read yet
+};
+
+// A request to warm the cache with a range of data in a disc track
+struct PrefetchRequest {
+    DiscInfo*   pDiscInfo;
+    int32_t     trackNum;
+    int32_t     offset;
+    int32_t     numBytes;
+};
+
+// The sector cache: all of this state is protected by the cache mutex.
+// Note that the sector data is deliberately left uninitialized so the memory for it is only committed as the cache is filled.
+static std::mutex                               gCacheMutex;
+static std::unique_ptr<CacheEntry[]>            gpEntries;
+static std::unique_ptr<std::byte[]>             gpSectorData;
+static std::unordered_map<uint64_t, int32_t>    gEntryLookup;
+static int32_t                                  gMaxEntries;
+static int32_t                                  gNumEntries;
+static int32_t                                  gLruHead;           // Most recently used entry
+static int32_t                                  gLruTail;           // Least recently used entry (evicted first)
+static Stats                                    gStats;
+
+// The prefetcher thread and the queue of work for it
+static std::mutex                       gPrefetchMutex;
+static std::condition_variable          gPrefetchWakeup;
+static std::deque<PrefetchRequest>      gPrefetchRequests;
+static std::thread                      gPrefetcherThread;
+static std::atomic<bool>                gbQuitPrefetcher;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the data for the given cache entry
+//------------------------------------------------------------------------------------------------------------------------------------------
+static std::byte* getEntryData(const int32_t entryIdx) noexcept {
+    ASSERT((entryIdx >= 0) && (entryIdx < gMaxEntries));
+    return gpSectorData.get() + (size_t) entryIdx * MAX_SECTOR_SIZE;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Unlink the given entry from the LRU list
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void lruUnlink(CacheEntry& entry) noexcept {
+    if (entry.lruPrev >= 0) {
+        gpEntries[entry.lruPrev].lruNext = entry.lruNext;
+    } else {
+        gLruHead = entry.lruNext;
+    }
+
+    if (entry.lruNext >= 0) {
+        gpEntries[entry.lruNext].lruPrev = entry.lruPrev;
+    } else {
+        gLruTail = entry.lruPrev;
+    }
+
+    entry.lruPrev = -1;
+    entry.lruNext = -1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Make the given entry the most recently used one
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void lruPushFront(const int32_t entryIdx) noexcept {
+    CacheEntry& entry = gpEntries[entryIdx];
+    entry.lruPrev = -1;
+    entry.lruNext = gLruHead;
+
+    if (gLruHead >= 0) {
+        gpEntries[gLruHead].lruPrev = entryIdx;
+    } else {
+        gLruTail = entryIdx;
+    }
+
+    gLruHead = entryIdx;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Warms the cache with the data range specified by the given request
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void doPrefetch(const PrefetchRequest& request) noexcept {
+    DiscReader discReader(*request.pDiscInfo);
+
+    if ((!discReader.setTrackNum(request.trackNum)) || (!discReader.trackSeekAbs(request.offset)))
+        return;
+
+    // Do the work in chunks so that the prefetcher can be stopped quickly on shutdown
+    int32_t bytesLeft = request.numBytes;
+
+    while ((bytesLeft > 0) && (!gbQuitPrefetcher)) {
+        const int32_t chunkSize = std::min(bytesLeft, PREFETCH_CHUNK_SIZE);
+
+        if (!discReader.prefetch(chunkSize))
+            break;
+
+        bytesLeft -= chunkSize;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Thread which services prefetch requests in the order they were made
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void prefetcherThreadMain() noexcept {
+    std::unique_lock<std::mutex> lock(gPrefetchMutex);
+
+    while (true) {
+        gPrefetchWakeup.wait(lock, []() noexcept { return (gbQuitPrefetcher || (!gPrefetchRequests.empty())); });
+
+        if (gbQuitPrefetcher)
+            break;
+
+        const PrefetchRequest request = gPrefetchRequests.front();
+        gPrefetchRequests.pop_front();
+
+        lock.unlock();
+        doPrefetch(request);
+        lock.lock();
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Initialize the sector cache with the given maximum size in MiB; if the size is '0' or less then the cache is disabled
+//------------------------------------------------------------------------------------------------------------------------------------------
+void init(const int32_t cacheSizeMB) noexcept {
+    ASSERT(gMaxEntries == 0);
+
+    if (cacheSizeMB <= 0)
+        return;
+
+    gMaxEntries = (int32_t) std::min<int64_t>(((int64_t) cacheSizeMB * 1024 * 1024) / MAX_SECTOR_SIZE, INT32_MAX);
+    gpEntries.reset(new CacheEntry[gMaxEntries]);
+    gpSectorData.reset(new std::byte[(size_t) gMaxEntries * MAX_SECTOR_SIZE]);
+    gEntryLookup.reserve((size_t) gMaxEntries);
+    gNumEntries = 0;
+    gLruHead = -1;
+    gLruTail = -1;
+    gStats = {};
+
+    gbQuitPrefetcher = false;
+    gPrefetcherThread = std::thread(prefetcherThreadMain);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Stops the prefetcher and frees up all memory used by the cache
+//------------------------------------------------------------------------------------------------------------------------------------------
+void shutdown() noexcept {
+    if (gPrefetcherThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(gPrefetchMutex);
+            gbQuitPrefetcher = true;
+            gPrefetchRequests.clear();
+        }
+
+        gPrefetchWakeup.notify_all();
+        gPrefetcherThread.join();
+    }
+
+    gpEntries.reset();
+    gpSectorData.reset();
+    gEntryLookup.clear();
+    gMaxEntries = 0;
+    gNumEntries = 0;
+    gLruHead = -1;
+    gLruTail = -1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells if the sector cache is in use.
+// Note: this is only changed on init and shutdown, when there should be no disc readers in use.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool isEnabled() noexcept {
+    return (gMaxEntries > 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Try to read part of the given sector from the cache and return 'false' if the sector is not cached (a miss).
+// On a hit the sector also becomes the most recently used one.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool readSector(const uint64_t sectorKey, void* const pDst, const int32_t offset, const int32_t numBytes) noexcept {
+    ASSERT(pDst);
+    ASSERT((offset >= 0) && (numBytes >= 0));
+
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    const auto iter = gEntryLookup.find(sectorKey);
+
+    if (iter == gEntryLookup.end()) {
+        gStats.numMisses++;
+        return false;
+    }
+
+    const int32_t entryIdx = iter->second;
+    CacheEntry& entry = gpEntries[entryIdx];
+    ASSERT(offset + numBytes <= entry.size);
+    std::memcpy(pDst, getEntryData(entryIdx) + offset, (size_t) numBytes);
+
+    gStats.numHits++;
+
+    if (entry.bPrefetched) {
+        gStats.numPrefetchHits++;
+        entry.bPrefetched = false;
+    }
+
+    if (gLruHead != entryIdx) {
+        lruUnlink(entry);
+        lruPushFront(entryIdx);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells if the given sector is in the cache; does not affect the LRU order or statistics
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool containsSector(const uint64_t sectorKey) noexcept {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    return (gEntryLookup.find(sectorKey) != gEntryLookup.end());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Add the data for the given sector to the cache, evicting the least recently used sector if the cache is full.
+// If the sector is already in the cache then this call does nothing, other than to make it the most recently used sector.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void addSector(const uint64_t sectorKey, const std::byte* const pData, const int32_t numBytes, const bool bPrefetched) noexcept {
+    ASSERT(pData);
+    ASSERT((numBytes >= 0) && (numBytes <= MAX_SECTOR_SIZE));
+
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    if (gMaxEntries <= 0)
+        return;
+
+    // Already cached? This can happen if the prefetcher and a reader both loaded the same sector at the same time.
+    if (const auto iter = gEntryLookup.find(sectorKey); iter != gEntryLookup.end()) {
+        const int32_t entryIdx = iter->second;
+
+        if (gLruHead != entryIdx) {
+            lruUnlink(gpEntries[entryIdx]);
+            lruPushFront(entryIdx);
+        }
+
+        return;
+    }
+
+    // Use a new entry if there is space, otherwise evict the least recently used one
+    int32_t entryIdx;
+
+    if (gNumEntries < gMaxEntries) {
+        entryIdx = gNumEntries++;
+    } else {
+        entryIdx = gLruTail;
+        ASSERT(entryIdx >= 0);
+
+        CacheEntry& evictedEntry = gpEntries[entryIdx];
+        lruUnlink(evictedEntry);
+        gEntryLookup.erase(evictedEntry.key);
+        gStats.numEvictions++;
+    }
+
+    CacheEntry& entry = gpEntries[entryIdx];
+    entry.key = sectorKey;
+    entry.size = numBytes;
+    entry.bPrefetched = bPrefetched;
+    std::memcpy(getEntryData(entryIdx), pData, (size_t) numBytes);
+
+    lruPushFront(entryIdx);
+    gEntryLookup[sectorKey] = entryIdx;
+
+    if (bPrefetched) {
+        gStats.numPrefetched++;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Queue a range of data in a disc track to be loaded into the cache on the prefetcher thread.
+// Requests are serviced in the order they are made. The disc info must remain valid until the cache is shut down.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void prefetch(DiscInfo& discInfo, const int32_t trackNum, const int32_t offset, const int32_t numBytes) noexcept {
+    if ((!isEnabled()) || (numBytes <= 0))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(gPrefetchMutex);
+        gPrefetchRequests.push_back(PrefetchRequest{ &discInfo, trackNum, offset, numBytes });
+    }
+
+    gPrefetchWakeup.notify_one();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get a snapshot of the cache statistics
+//------------------------------------------------------------------------------------------------------------------------------------------
+Stats getStats() noexcept {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    Stats stats = gStats;
+    stats.numCachedSectors = (uint32_t) gNumEntries;
+    stats.maxCachedSectors = (uint32_t) gMaxEntries;
+    return stats;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Reset the hit, miss and other event counters for the cache (the cached data remains)
+//------------------------------------------------------------------------------------------------------------------------------------------
+void resetStats() noexcept {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    gStats = {};
+}
+
+END_NAMESPACE(DiscSectorCache)
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Macros.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct DiscInfo;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A cache of recently read disc sectors which is shared by all disc readers, with least recently used sectors evicted first.
+// Also provides a background prefetcher which can warm the cache with data that is expected to be read soon.
+//------------------------------------------------------------------------------------------------------------------------------------------
+BEGIN_NAMESPACE(DiscSectorCache)
+
+// The maximum amount of data that a single sector in the cache can hold (a raw CD-ROM sector)
+static constexpr int32_t MAX_SECTOR_SIZE = 2352;
+
+// Statistics for how effective the cache is being
+struct Stats {
+    uint64_t    numHits;                // How many sector reads were served from the cache
+    uint64_t    numPrefetchHits;        // How many of the cache hits were for sectors which were loaded by the prefetcher
+    uint64_t    numMisses;              // How many sector reads had to go to the disc image
+    uint64_t    numPrefetched;          // How many sectors were loaded into the cache by the prefetcher
+    uint64_t    numEvictions;           // How many sectors were evicted from the cache to make room for others
+    uint32_t    numCachedSectors;       // How many sectors are currently in the cache
+    uint32_t    maxCachedSectors;       // The maximum number of sectors the cache can hold
+};
+
+void init(const int32_t cacheSizeMB) noexcept;
+void shutdown() noexcept;
+bool isEnabled() noexcept;
+bool readSector(const uint64_t sectorKey, void* const pDst, const int32_t offset, const int32_t numBytes) noexcept;
+bool containsSector(const uint64_t sectorKey) noexcept;
+void addSector(const uint64_t sectorKey, const std::byte* const pData, const int32_t numBytes, const bool bPrefetched) noexcept;
+void prefetch(DiscInfo& discInfo, const int32_t trackNum, const int32_t offset, const int32_t numBytes) noexcept;
+Stats getStats() noexcept;
+void resetStats() noexcept;
+
+END_NAMESPACE(DiscSectorCache)
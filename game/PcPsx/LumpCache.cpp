@@ -0,0 +1,376 @@
+#include "LumpCache.h"
+
+#include "Doom/Base/w_wad.h"
+#include "Doom/cdmaptbl.h"
+#include "DiscInfo.h"
+#include "FileUtils.h"
+#include "MappedFile.h"
+#include "ModMgr.h"
+#include "PsxVm.h"
+#include "Utils.h"
+#include "Wess/psxcd.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+BEGIN_NAMESPACE(LumpCache)
+
+// Name format of the cache file in the user data folder, and the version of the file format.
+// The hash of the source data is part of the file name, so that the caches for different game discs and mods can exist side by side.
+// Bump the version whenever the format or the contents of the cache change, so that old cache files are rebuilt.
+static constexpr const char* const CACHE_FILE_NAME_FMT = "lump_cache_%016llx.bin";
+static constexpr uint32_t CACHE_FILE_VERSION = 2;
+
+// Alignment for the data of each lump in the cache file
+static constexpr uint32_t LUMP_DATA_ALIGN = 16;
+
+// Header for the cache file
+struct CacheFileHeader {
+    char        fileId[8];      // Should always be 'PSYLUMPC'
+    uint32_t    version;        // Version of the file format
+    uint32_t    numEntries;     // The number of lumps in the cache
+    uint64_t    sourceHash;     // Hash identifying the disc image and mod files the cache was built from (see 'hashSourceIdentity')
+};
+
+// Describes one lump in the cache file
+struct CacheFileEntry {
+    int32_t     wadFile;        // Which WAD file on the disc the lump is from (a 'CdFileId')
+    int32_t     lumpNum;        // Index of the lump in the WAD
+    uint32_t    size;           // Decompressed size of the lump
+    uint32_t    pad;            // Unused
+    uint64_t    dataOffset;     // Where the decompressed lump data is, relative to the start of the file
+};
+
+static_assert(sizeof(CacheFileHeader) == 24);
+static_assert(sizeof(CacheFileEntry) == 24);
+
+static constexpr char CACHE_FILE_ID[8] = { 'P', 'S', 'Y', 'L', 'U', 'M', 'P', 'C' };
+
+// The cache file contents: either memory mapped from disk, or held in memory if the cache file could not be saved.
+// Lumps are looked up by a key made from the WAD file id and lump number.
+static MappedFile                                           gMappedCacheFile;
+static std::vector<std::byte>                               gCacheFileData;
+static const std::byte*                                     gpCacheData;
+static std::unordered_map<uint64_t, const CacheFileEntry*>  gEntries;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Make the key used to lookup a lump in the cache
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t makeLumpKey(const int32_t wadFile, const int32_t lumpNum) noexcept {
+    return ((uint64_t)(uint32_t) wadFile << 32) | (uint32_t) lumpNum;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Hashes the given data and combines it with an existing hash.
+// This only needs to be good enough to detect changes in the source files, so works on 8 bytes at a time for speed.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t hashData(const std::byte* const pData, const size_t size, uint64_t hash) noexcept {
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+    size_t offset = 0;
+
+    for (; offset + 8 <= size; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, pData + offset, 8);
+        hash = (hash ^ word) * MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+
+    for (; offset < size; ++offset) {
+        hash = (hash ^ (uint64_t) pData[offset]) * MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells if the given file is a WAD file which the cache should hold lumps for: the main IWAD or a map WAD
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool isCachedWadFile(const CdFileId fileId) noexcept {
+    if (fileId == CdFileId::PSXDOOM_WAD)
+        return true;
+
+    const char* const fileName = gCdMapTblFileNames[(int32_t) fileId];
+    const size_t nameLen = std::strlen(fileName);
+
+    if ((nameLen < 4) || (std::strncmp(fileName, "MAP", 3) != 0))
+        return false;
+
+    const char* const fileExt = fileName + nameLen - 4;
+    return ((std::strcmp(fileExt, ".WAD") == 0) || (std::strcmp(fileExt, ".ROM") == 0));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Read the entire contents of the given file on the disc (or the mod file overriding it) and return 'false' on failure
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool readDiscFile(const CdFileId fileId, std::vector<std::byte>& fileData) noexcept {
+    fileData.clear();
+
+    // Skip files which are not on the disc and not provided by a mod
+    if ((gCdMapTbl[(int32_t) fileId].startSector == 0) && (!ModMgr::areOverridesAvailableForFile(fileId)))
+        return false;
+
+    const int32_t fileSize = psxcd_get_file_size(fileId);
+
+    if (fileSize <= 0)
+        return false;
+
+    PsxCd_File* const pOpenedFile = psxcd_open(fileId);
+
+    if (!pOpenedFile)
+        return false;
+
+    PsxCd_File file = *pOpenedFile;
+    fileData.resize((size_t) fileSize);
+    const bool bReadOk = (psxcd_read(fileData.data(), fileSize, file) == fileSize);
+    psxcd_close(file);
+    return bReadOk;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Hash the path, size and last modification time of the given file, combining it with an existing hash
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t hashFileIdentity(const std::string& filePath, uint64_t hash) noexcept {
+    const int64_t fileInfo[2] = { FileUtils::getFileSize(filePath.c_str()), FileUtils::getFileModTime(filePath.c_str()) };
+    hash = hashData((const std::byte*) filePath.c_str(), filePath.size(), hash);
+    hash = hashData((const std::byte*) fileInfo, sizeof(fileInfo), hash);
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Compute a hash which identifies the source data the cache is built from: the game disc image plus any mod files overriding the WADs.
+//
+// This is cheap to compute because no file contents are read: the files which make up the disc image and any overriding mod files are
+// identified by their path, size and modification time. The location and size of each WAD file on the disc is also included, which is
+// already known from the disc's filesystem. Changing the disc image or the mod files causes the cache to be rebuilt.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t hashSourceIdentity() noexcept {
+    uint64_t hash = CACHE_FILE_VERSION;
+
+    for (const DiscTrack& track : PsxVm::gDiscInfo.tracks) {
+        const int32_t trackInfo[2] = { track.trackNum, track.fileOffset };
+        hash = hashData((const std::byte*) trackInfo, sizeof(trackInfo), hash);
+        hash = hashFileIdentity(track.sourceFilePath, hash);
+    }
+
+    for (int32_t fileIdx = 0; fileIdx < (int32_t) CdFileId::END; ++fileIdx) {
+        const CdFileId fileId = (CdFileId) fileIdx;
+
+        if (!isCachedWadFile(fileId))
+            continue;
+
+        const PsxCd_MapTblEntry& discFile = gCdMapTbl[fileIdx];
+        const int32_t fileInfo[3] = { fileIdx, discFile.startSector, discFile.size };
+        hash = hashData((const std::byte*) fileInfo, sizeof(fileInfo), hash);
+
+        if (ModMgr::areOverridesAvailableForFile(fileId)) {
+            hash = hashFileIdentity(ModMgr::getOverridenFilePath(fileId), hash);
+        }
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Decompress all of the compressed lumps in the given WAD file and add them to the cache file being built.
+// Lumps which look invalid are skipped, so that the game handles them the same as it normally would.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void addWadLumps(
+    const CdFileId fileId,
+    const std::vector<std::byte>& wadData,
+    std::vector<CacheFileEntry>& entries,
+    std::vector<std::byte>& lumpData
+) noexcept {
+    W_ForEachCompressedLump(wadData.data(), wadData.size(), [&](const int32_t lumpNum, const lumpinfo_t& lumpInfo, const std::byte* const pCompressedData) noexcept {
+        const size_t dataOffset = (lumpData.size() + LUMP_DATA_ALIGN - 1) & ~(size_t)(LUMP_DATA_ALIGN - 1);
+        lumpData.resize(dataOffset + lumpInfo.size);
+        decode(pCompressedData, lumpData.data() + dataOffset);
+
+        CacheFileEntry& entry = entries.emplace_back();
+        entry.wadFile = (int32_t) fileId;
+        entry.lumpNum = lumpNum;
+        entry.size = lumpInfo.size;
+        entry.pad = 0;
+        entry.dataOffset = dataOffset;
+    });
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Build the contents of the cache file for all of the WAD files in use
+//------------------------------------------------------------------------------------------------------------------------------------------
+static std::vector<std::byte> buildCacheFile(const uint64_t sourceHash) noexcept {
+    // Decompress the lumps in all of the WAD files
+    std::vector<CacheFileEntry> entries;
+    std::vector<std::byte> lumpData;
+    std::vector<std::byte> wadData;
+
+    for (int32_t fileIdx = 0; fileIdx < (int32_t) CdFileId::END; ++fileIdx) {
+        const CdFileId fileId = (CdFileId) fileIdx;
+
+        if (isCachedWadFile(fileId) && readDiscFile(fileId, wadData)) {
+            addWadLumps(fileId, wadData, entries, lumpData);
+        }
+    }
+
+    // Put the header, lump entries and the lump data together
+    const size_t headerSize = sizeof(CacheFileHeader) + entries.size() * sizeof(CacheFileEntry);
+    const size_t lumpDataOffset = (headerSize + LUMP_DATA_ALIGN - 1) & ~(size_t)(LUMP_DATA_ALIGN - 1);
+
+    CacheFileHeader header = {};
+    std::memcpy(header.fileId, CACHE_FILE_ID, sizeof(CACHE_FILE_ID));
+    header.version = CACHE_FILE_VERSION;
+    header.numEntries = (uint32_t) entries.size();
+    header.sourceHash = sourceHash;
+
+    for (CacheFileEntry& entry : entries) {
+        entry.dataOffset += lumpDataOffset;
+    }
+
+    std::vector<std::byte> fileData(lumpDataOffset + lumpData.size());
+    std::memcpy(fileData.data(), &header, sizeof(header));
+    std::memcpy(fileData.data() + sizeof(header), entries.data(), entries.size() * sizeof(CacheFileEntry));
+    std::memcpy(fileData.data() + lumpDataOffset, lumpData.data(), lumpData.size());
+    return fileData;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Check the given cache file data is valid and built from the WAD files in use, and if so populate the lump lookup from it
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool useCacheFileData(const std::byte* const pData, const size_t dataSize, const uint64_t sourceHash) noexcept {
+    gEntries.clear();
+    gpCacheData = nullptr;
+
+    if ((!pData) || (dataSize < sizeof(CacheFileHeader)))
+        return false;
+
+    CacheFileHeader header;
+    std::memcpy(&header, pData, sizeof(CacheFileHeader));
+
+    const bool bValidHeader = (
+        (std::memcmp(header.fileId, CACHE_FILE_ID, sizeof(CACHE_FILE_ID)) == 0) &&
+        (header.version == CACHE_FILE_VERSION) &&
+        (header.sourceHash == sourceHash) &&
+        (sizeof(CacheFileHeader) + (size_t) header.numEntries * sizeof(CacheFileEntry) <= dataSize)
+    );
+
+    if (!bValidHeader)
+        return false;
+
+    const CacheFileEntry* const pEntries = (const CacheFileEntry*)(pData + sizeof(CacheFileHeader));
+
+    for (uint32_t entryIdx = 0; entryIdx < header.numEntries; ++entryIdx) {
+        const CacheFileEntry& entry = pEntries[entryIdx];
+
+        if ((entry.dataOffset > dataSize) || (entry.size > dataSize - entry.dataOffset)) {
+            gEntries.clear();
+            return false;
+        }
+
+        gEntries[makeLumpKey(entry.wadFile, entry.lumpNum)] = &entry;
+    }
+
+    gpCacheData = pData;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Save the given cache file data to the given path and return 'true' on success.
+//
+// An existing cache file is never written into, since other PsyDoom processes may have it memory mapped and truncating it underneath them
+// would crash them or feed them garbage. Instead the data is written to a uniquely named temporary file in the same folder, which is then
+// renamed over the cache file. Processes which have the old file mapped keep seeing the old contents until they unmap it.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool saveCacheFile(const std::string& cacheFilePath, const std::vector<std::byte>& cacheFileData) noexcept {
+    // Make a temporary file name that won't clash with any other process building the cache at the same time
+    uint64_t uniqueId = (uint64_t) std::chrono::steady_clock::now().time_since_epoch().count();
+
+    try {
+        std::random_device randomDevice;
+        uniqueId ^= ((uint64_t) randomDevice() << 32) | randomDevice();
+    } catch (...) {
+        // Just go with the time if no random device is available
+    }
+
+    char tmpFileSuffix[32];
+    std::snprintf(tmpFileSuffix, C_ARRAY_SIZE(tmpFileSuffix), ".%016llx.tmp", (unsigned long long) uniqueId);
+    const std::string tmpFilePath = cacheFilePath + tmpFileSuffix;
+
+    if (!FileUtils::writeDataToFile(tmpFilePath.c_str(), cacheFileData.data(), cacheFileData.size())) {
+        FileUtils::removeFile(tmpFilePath.c_str());
+        return false;
+    }
+
+    if (!FileUtils::renameFile(tmpFilePath.c_str(), cacheFilePath.c_str())) {
+        FileUtils::removeFile(tmpFilePath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Initialize the lump cache: uses the existing cache file if it is up to date, otherwise (re)builds it.
+// Note: this must be called after the CD map table is initialized and any mods are setup.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void init() noexcept {
+    const uint64_t sourceHash = hashSourceIdentity();
+    char cacheFileName[64];
+    std::snprintf(cacheFileName, C_ARRAY_SIZE(cacheFileName), CACHE_FILE_NAME_FMT, (unsigned long long) sourceHash);
+    const std::string cacheFilePath = Utils::getOrCreateUserDataFolder() + cacheFileName;
+
+    // Try to use the existing cache file firstly
+    if (gMappedCacheFile.open(cacheFilePath.c_str())) {
+        if (useCacheFileData(gMappedCacheFile.getData(), gMappedCacheFile.getSize(), sourceHash))
+            return;
+
+        gMappedCacheFile.close();
+    }
+
+    // Otherwise build a new cache file and save it for the next run.
+    // If it can't be saved or mapped afterwards for some reason then just keep it in memory instead.
+    std::vector<std::byte> cacheFileData = buildCacheFile(sourceHash);
+
+    if (saveCacheFile(cacheFilePath, cacheFileData)) {
+        if (gMappedCacheFile.open(cacheFilePath.c_str())) {
+            if (useCacheFileData(gMappedCacheFile.getData(), gMappedCacheFile.getSize(), sourceHash))
+                return;
+
+            gMappedCacheFile.close();
+        }
+    }
+
+    gCacheFileData = std::move(cacheFileData);
+    useCacheFileData(gCacheFileData.data(), gCacheFileData.size(), sourceHash);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Frees up the lump cache
+//------------------------------------------------------------------------------------------------------------------------------------------
+void shutdown() noexcept {
+    gEntries.clear();
+    gpCacheData = nullptr;
+    gMappedCacheFile.close();
+    gCacheFileData.clear();
+    gCacheFileData.shrink_to_fit();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the decompressed data for the given lump in a WAD file, or null if it is not in the cache.
+// The expected decompressed size of the lump must be given, and the cached lump is only returned if its size matches.
+//------------------------------------------------------------------------------------------------------------------------------------------
+const std::byte* getLump(const CdFileId wadFile, const int32_t lumpNum, const int32_t lumpSize) noexcept {
+    const auto iter = gEntries.find(makeLumpKey((int32_t) wadFile, lumpNum));
+
+    if (iter == gEntries.end())
+        return nullptr;
+
+    const CacheFileEntry& entry = *iter->second;
+    return (entry.size == (uint32_t) lumpSize) ? gpCacheData + entry.dataOffset : nullptr;
+}
+
+END_NAMESPACE(LumpCache)
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Macros.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class CdFileId : int32_t;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A cache of pre-decompressed WAD lumps for the main IWAD and all map WADs on the game disc.
+// The cache is saved to a file in the user data folder when it is first built and memory mapped on subsequent runs.
+// There is a separate cache file for each combination of game disc and mods, named after a hash of them.
+// It is rebuilt automatically whenever the game disc image or the mod files overriding the WADs change.
+//------------------------------------------------------------------------------------------------------------------------------------------
+BEGIN_NAMESPACE(LumpCache)
+
+void init() noexcept;
+void shutdown() noexcept;
+const std::byte* getLump(const CdFileId wadFile, const int32_t lumpNum, const int32_t lumpSize) noexcept;
+bool isCachedWadFile(const CdFileId fileId) noexcept;
+bool readDiscFile(const CdFileId fileId, std::vector<std::byte>& fileData) noexcept;
+
+END_NAMESPACE(LumpCache)
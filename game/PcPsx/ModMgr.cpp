@@ -134,7 +134,7 @@ static bool isValidOverridenFile(const PsxCd_File& file) noexcept {
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Get the path to an overriden file
 //------------------------------------------------------------------------------------------------------------------------------------------
-static std::string getOverridenFilePath(const CdFileId discFile) noexcept {
+std::string getOverridenFilePath(const CdFileId discFile) noexcept {
     const char* const filename = gCdMapTblFileNames[(uint32_t) discFile];
 
     std::string filePath;
@@ -0,0 +1,319 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A simple profiler which times named scopes in the main loop and elsewhere (see 'PROFILE_SCOPE').
+//
+// Scope times can be shown in a rolling overlay drawn on top of gameplay ('-profile') and/or recorded and saved on exit in the Chrome
+// trace event json format ('-profiletrace <file>'), which can be viewed in 'chrome://tracing' or Perfetto to see where each frame's time
+// is spent across the game and audio threads.
+// Only available when the game is built with 'PSYDOOM_PROFILER' enabled; otherwise profile scopes compile to nothing.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "Profiler.h"
+
+#if PSYDOOM_PROFILER
+
+#include "Doom/d_main.h"
+#include "Finally.h"
+#include "ProgArgs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <rapidjson/document.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/writer.h>
+#include <vector>
+
+BEGIN_NAMESPACE(Profiler)
+
+static constexpr uint32_t   MAX_THREADS             = 16;                   // Maximum number of threads that can record scope times
+static constexpr uint32_t   MAX_SCOPE_STATS         = 64;                   // Maximum number of differently named scopes shown in the overlay
+static constexpr uint32_t   OVERLAY_AVG_FRAMES      = 30;                   // How many frames the times shown in the overlay are averaged over
+static constexpr uint32_t   MAX_OVERLAY_LINES       = 16;                   // Maximum number of scopes shown in the overlay
+static constexpr size_t     MAX_TRACE_EVENTS        = 4 * 1024 * 1024;      // Stop recording trace events after this many, to limit memory usage
+
+// Name of the scope recorded for each frame as a whole
+static constexpr const char* const FRAME_SCOPE_NAME = "Frame";
+
+// A single timed scope recorded for the trace
+struct TraceEvent {
+    const char*     name;
+    uint32_t        threadIdx;
+    uint64_t        startTimeNs;
+    uint64_t        durationNs;
+};
+
+// Time spent in a particular named scope, for the overlay.
+// Scopes on the game thread are tracked separately to scopes of the same name on other threads.
+struct ScopeStats {
+    const char*     name;
+    bool            bGameThread;
+    uint64_t        curTotalNs;     // Total time spent in the scope for the frames being averaged so far
+    double          avgFrameMs;     // Average time spent in the scope per frame over the last set of averaged frames
+};
+
+// Is the profiler enabled? If not then profile scopes do nothing.
+// This is atomic because profile scopes on the audio thread check it too. Relaxed ordering is enough since the profiler's data is
+// protected by a mutex, and checking it again under the mutex in 'addScopeTime' catches the profiler being disabled in the meantime.
+std::atomic<bool> gbEnabled;
+
+static bool                     gbShowOverlay;
+static bool                     gbRecordTrace;
+static uint64_t                 gStartTimeNs;           // When the profiler was initialized: trace timestamps are relative to this
+static std::mutex               gMutex;                 // Guards all the data below, since scopes are recorded from multiple threads
+static std::vector<TraceEvent>  gTraceEvents;
+static ScopeStats               gScopeStats[MAX_SCOPE_STATS];
+static uint32_t                 gNumScopeStats;
+static uint32_t                 gNumAvgFrames;          // How many frames have been recorded towards the current averages
+static uint64_t                 gLastFrameEndTimeNs;    // When the last frame ended
+static uint64_t                 gCurFramesTotalNs;      // Total time for the frames being averaged so far
+static double                   gAvgFrameMs;            // Average frame time over the last set of averaged frames
+
+// Thread indexes: the thread that initializes the profiler (the game thread) is always index '0'
+static std::atomic<uint32_t>    gNumThreads;
+static thread_local int32_t     tThreadIdx = -1;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the profiler index of the calling thread, assigning a new one if it doesn't have one yet
+//------------------------------------------------------------------------------------------------------------------------------------------
+static uint32_t getCurThreadIdx() noexcept {
+    if (tThreadIdx < 0) {
+        tThreadIdx = (int32_t) std::min(gNumThreads.fetch_add(1), MAX_THREADS - 1);
+    }
+
+    return (uint32_t) tThreadIdx;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Initializes the profiler and enables it if requested via program arguments
+//------------------------------------------------------------------------------------------------------------------------------------------
+void init() noexcept {
+    gbShowOverlay = ProgArgs::gbProfileOverlay;
+    gbRecordTrace = (ProgArgs::gProfileTraceFilePath[0] != 0);
+    gbEnabled.store(gbShowOverlay || gbRecordTrace, std::memory_order_relaxed);
+    gStartTimeNs = getTimeNs();
+    gLastFrameEndTimeNs = gStartTimeNs;
+
+    // The calling thread is the game thread and always gets the first index
+    gNumThreads = 0;
+    tThreadIdx = -1;
+    getCurThreadIdx();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Saves all the recorded scope times to a json file in the Chrome trace event format.
+// Returns 'false' on failure to save.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool saveTraceToJsonFile(const char* const jsonFilePath) noexcept {
+    // Create the json document
+    rapidjson::Document document;
+    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+    document.SetObject();
+
+    rapidjson::Value eventsJson(rapidjson::kArrayType);
+    eventsJson.Reserve((rapidjson::SizeType) gTraceEvents.size() + MAX_THREADS, allocator);
+
+    // Name each of the threads
+    const uint32_t numThreads = std::min(gNumThreads.load(), MAX_THREADS);
+
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx) {
+        char threadName[32];
+
+        if (threadIdx == 0) {
+            std::snprintf(threadName, C_ARRAY_SIZE(threadName), "Game");
+        } else {
+            std::snprintf(threadName, C_ARRAY_SIZE(threadName), "Thread %u", threadIdx);
+        }
+
+        rapidjson::Value argsJson(rapidjson::kObjectType);
+        argsJson.AddMember("name", rapidjson::Value(threadName, allocator), allocator);
+
+        rapidjson::Value eventJson(rapidjson::kObjectType);
+        eventJson.AddMember("name", rapidjson::StringRef("thread_name"), allocator);
+        eventJson.AddMember("ph", rapidjson::StringRef("M"), allocator);
+        eventJson.AddMember("pid", 1, allocator);
+        eventJson.AddMember("tid", threadIdx, allocator);
+        eventJson.AddMember("args", argsJson, allocator);
+        eventsJson.PushBack(eventJson, allocator);
+    }
+
+    // Add all the timed scopes as 'complete' events, with times in microseconds
+    for (const TraceEvent& event : gTraceEvents) {
+        rapidjson::Value eventJson(rapidjson::kObjectType);
+        eventJson.AddMember("name", rapidjson::StringRef(event.name), allocator);
+        eventJson.AddMember("ph", rapidjson::StringRef("X"), allocator);
+        eventJson.AddMember("pid", 1, allocator);
+        eventJson.AddMember("tid", event.threadIdx, allocator);
+        eventJson.AddMember("ts", (double)(event.startTimeNs - gStartTimeNs) / 1000.0, allocator);
+        eventJson.AddMember("dur", (double) event.durationNs / 1000.0, allocator);
+        eventsJson.PushBack(eventJson, allocator);
+    }
+
+    document.AddMember("traceEvents", eventsJson, allocator);
+    document.AddMember("displayTimeUnit", rapidjson::StringRef("ms"), allocator);
+
+    // Write the json to the given file
+    std::FILE* const pFile = std::fopen(jsonFilePath, "w");
+
+    if (!pFile)
+        return false;
+
+    auto closeFile = finally([&]() noexcept {
+        std::fflush(pFile);
+        std::fclose(pFile);
+    });
+
+    try {
+        char writeBuffer[4096];
+        rapidjson::FileWriteStream writeStream(pFile, writeBuffer, C_ARRAY_SIZE(writeBuffer));
+        rapidjson::Writer<rapidjson::FileWriteStream> fileWriter(writeStream);
+        document.Accept(fileWriter);
+    } catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Shuts down the profiler and saves the recorded trace, if requested
+//------------------------------------------------------------------------------------------------------------------------------------------
+void shutdown() noexcept {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gbEnabled.store(false, std::memory_order_relaxed);
+
+    if (gbRecordTrace) {
+        if (!saveTraceToJsonFile(ProgArgs::gProfileTraceFilePath)) {
+            std::printf("Failed to save the profiler trace to '%s'!\n", ProgArgs::gProfileTraceFilePath);
+        }
+    }
+
+    gbShowOverlay = false;
+    gbRecordTrace = false;
+    gTraceEvents.clear();
+    gTraceEvents.shrink_to_fit();
+    gNumScopeStats = 0;
+    gNumAvgFrames = 0;
+    gCurFramesTotalNs = 0;
+    gAvgFrameMs = 0.0;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get the current time for profiling purposes in nanoseconds
+//------------------------------------------------------------------------------------------------------------------------------------------
+uint64_t getTimeNs() noexcept {
+    typedef std::chrono::steady_clock clock_t;
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Records the time spent in a named scope on the calling thread
+//------------------------------------------------------------------------------------------------------------------------------------------
+void addScopeTime(const char* const name, const uint64_t startTimeNs, const uint64_t endTimeNs) noexcept {
+    const uint32_t threadIdx = getCurThreadIdx();
+    const uint64_t durationNs = endTimeNs - startTimeNs;
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    if (!gbEnabled.load(std::memory_order_relaxed))
+        return;
+
+    if (gbRecordTrace && (gTraceEvents.size() < MAX_TRACE_EVENTS)) {
+        gTraceEvents.push_back(TraceEvent{ name, threadIdx, startTimeNs, durationNs });
+    }
+
+    if (gbShowOverlay) {
+        const bool bGameThread = (threadIdx == 0);
+
+        // Find the stats for this scope or add new ones if there is room.
+        // Note: scope names are usually string literals so just compare the pointers.
+        for (uint32_t i = 0; i < gNumScopeStats; ++i) {
+            ScopeStats& stats = gScopeStats[i];
+
+            if ((stats.name == name) && (stats.bGameThread == bGameThread)) {
+                stats.curTotalNs += durationNs;
+                return;
+            }
+        }
+
+        if (gNumScopeStats < MAX_SCOPE_STATS) {
+            gScopeStats[gNumScopeStats] = ScopeStats{ name, bGameThread, durationNs, 0.0 };
+            gNumScopeStats++;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Marks the end of a frame of the main loop: records the frame in the trace and updates the averaged frame times for the overlay
+//------------------------------------------------------------------------------------------------------------------------------------------
+void endFrame() noexcept {
+    if (!gbEnabled.load(std::memory_order_relaxed))
+        return;
+
+    const uint64_t frameEndTimeNs = getTimeNs();
+    const uint64_t frameStartTimeNs = gLastFrameEndTimeNs;
+    gLastFrameEndTimeNs = frameEndTimeNs;
+    addScopeTime(FRAME_SCOPE_NAME, frameStartTimeNs, frameEndTimeNs);
+
+    // Update the averages shown in the overlay once enough frames have elapsed
+    std::lock_guard<std::mutex> lock(gMutex);
+    gCurFramesTotalNs += frameEndTimeNs - frameStartTimeNs;
+    gNumAvgFrames++;
+
+    if (gNumAvgFrames < OVERLAY_AVG_FRAMES)
+        return;
+
+    const double nsToAvgMs = 1.0 / ((double) gNumAvgFrames * 1000000.0);
+    gAvgFrameMs = (double) gCurFramesTotalNs * nsToAvgMs;
+    gCurFramesTotalNs = 0;
+    gNumAvgFrames = 0;
+
+    for (uint32_t i = 0; i < gNumScopeStats; ++i) {
+        ScopeStats& stats = gScopeStats[i];
+        stats.avgFrameMs = (double) stats.curTotalNs * nsToAvgMs;
+        stats.curTotalNs = 0;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Draws the overlay showing the average time per frame spent in the most expensive scopes, if enabled
+//------------------------------------------------------------------------------------------------------------------------------------------
+void drawOverlay() noexcept {
+    if (!gbShowOverlay)
+        return;
+
+    // Sort the scopes so the most expensive are shown first
+    ScopeStats scopeStats[MAX_SCOPE_STATS];
+    uint32_t numScopeStats = 0;
+    double avgFrameMs = 0.0;
+
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        std::copy(gScopeStats, gScopeStats + gNumScopeStats, scopeStats);
+        numScopeStats = gNumScopeStats;
+        avgFrameMs = gAvgFrameMs;
+    }
+
+    std::sort(scopeStats, scopeStats + numScopeStats, [](const ScopeStats& s1, const ScopeStats& s2) noexcept {
+        return (s1.avgFrameMs > s2.avgFrameMs);
+    });
+
+    // Draw the frame time and the time for each scope in milliseconds.
+    // Scopes from threads other than the game thread are marked with a '*'.
+    I_SetDebugDrawStringPos(4, 4);
+    I_DebugDrawString("FRAME %6.2f MS %5.1f FPS", avgFrameMs, (avgFrameMs > 0.0) ? 1000.0 / avgFrameMs : 0.0);
+
+    const uint32_t numLines = std::min(numScopeStats, MAX_OVERLAY_LINES);
+
+    for (uint32_t i = 0; i < numLines; ++i) {
+        const ScopeStats& stats = scopeStats[i];
+
+        if (stats.name == FRAME_SCOPE_NAME)
+            continue;
+
+        I_DebugDrawString("%c%-20.20s%6.2f", (stats.bGameThread) ? ' ' : '*', stats.name, stats.avgFrameMs);
+    }
+}
+
+END_NAMESPACE(Profiler)
+
+#endif  // #if PSYDOOM_PROFILER
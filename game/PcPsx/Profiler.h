@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Macros.h"
+
+#if PSYDOOM_PROFILER
+
+#include <atomic>
+#include <cstdint>
+
+BEGIN_NAMESPACE(Profiler)
+
+extern std::atomic<bool> gbEnabled;
+
+void init() noexcept;
+void shutdown() noexcept;
+uint64_t getTimeNs() noexcept;
+void addScopeTime(const char* const name, const uint64_t startTimeNs, const uint64_t endTimeNs) noexcept;
+void endFrame() noexcept;
+void drawOverlay() noexcept;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Times the scope it is declared in and records the time with the profiler, if the profiler is enabled.
+// The name given must be a string literal or otherwise remain valid for the lifetime of the program.
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct Scope {
+    const char* const   name;
+    const uint64_t      startTimeNs;
+
+    inline Scope(const char* const name) noexcept
+        : name(name)
+        , startTimeNs((gbEnabled.load(std::memory_order_relaxed)) ? getTimeNs() : 0)
+    {
+    }
+
+    inline ~Scope() noexcept {
+        if (startTimeNs != 0) {
+            addScopeTime(name, startTimeNs, getTimeNs());
+        }
+    }
+};
+
+END_NAMESPACE(Profiler)
+
+// Helpers to make a unique variable name for each profile scope
+#define PROFILE_SCOPE_VAR_NAME_2(Line) gProfileScope_##Line
+#define PROFILE_SCOPE_VAR_NAME(Line) PROFILE_SCOPE_VAR_NAME_2(Line)
+
+// Time the current scope with the given name
+#define PROFILE_SCOPE(Name)\
+    const Profiler::Scope PROFILE_SCOPE_VAR_NAME(__LINE__)(Name)
+
+#else
+
+// Profiling is compiled out entirely when the profiler is disabled
+#define PROFILE_SCOPE(Name)
+
+#endif  // #if PSYDOOM_PROFILER
@@ -3,6 +3,7 @@
 //------------------------------------------------------------------------------------------------------------------------------------------
 #include "ProgArgs.h"
 
+#include <cstdio>
 #include <cstring>
 #include <string>
 
@@ -26,6 +27,39 @@ const char* gPlayDemoFilePath = "";             // The demo file to play and exi
 const char* gSaveDemoResultFilePath = "";       // Path to a json file to save the demo result to
 const char* gCheckDemoResultFilePath = "";      // Path to a json file to read the demo result from and verify a match with
 
+// Developer option: path to a file to save a trace of the game state for each tick of gameplay to.
+// Used to find where demo playback first diverges when compared against the trace of a known good build.
+const char* gSaveTraceFilePath = "";
+
+// Developer option: paths to two trace files to compare, reporting the first tick where they differ and exiting without running the game
+const char* gCompareTraceFilePath1 = "";
+const char* gCompareTraceFilePath2 = "";
+
+// Developer option: path to a json file to save zone memory statistics to at the end of each level.
+// Only has an effect if the game was built with 'PSYDOOM_ZONE_STATS' enabled.
+const char* gZoneStatsFilePath = "";
+
+// Developer option: if true then time the game logic for each tick of gameplay and print the throughput at the end of each level.
+// Intended for use with headless demo playback, where no rendering is done and only the game simulation is measured.
+bool gbTickTiming = false;
+
+// Developer options: show the frame profiler overlay and/or save a Chrome trace ('chrome://tracing') of all profiled scopes on exit.
+// Only have an effect if the game was built with 'PSYDOOM_PROFILER' enabled.
+bool gbProfileOverlay = false;
+const char* gProfileTraceFilePath = "";
+
+// Developer option: if true then print statistics for the disc sector cache after each level is loaded (hits, misses, prefetches etc.)
+bool gbDiscCacheStats = false;
+
+// Developer option: if true then print statistics for the texture cache at the end of each level (uploads, evictions, residency etc.)
+bool gbTexCacheStats = false;
+
+// Developer option: if true then benchmark decompression of all the WAD lumps on the disc and exit instead of running the game
+bool gbBenchmarkDecode = false;
+
+// Developer option: if true then benchmark the zone memory allocator and exit instead of running the game
+bool gbBenchmarkZone = false;
+
 bool    gbIsNetServer   = false;                // True if this peer is a server in a networked game (player 1, waits for client connection)
 bool    gbIsNetClient   = false;                // True if this peer is a client in a networked game (player 2, connects to waiting server)
 uint16_t gServerPort    = DEFAULT_NET_PORT;     // Port that the server listens on or that the client connects to
@@ -92,6 +126,112 @@ static int parseArg_checkresult(const int argc, const char** const argv) {
     return 0;
 }
 
+static int parseArg_savetrace(const int argc, const char** const argv) {
+    if ((argc >= 2) && (std::strcmp(argv[0], "-savetrace") == 0)) {
+        gSaveTraceFilePath = argv[1];
+        return 2;
+    }
+
+    return 0;
+}
+
+static int parseArg_comparetraces(const int argc, const char** const argv) {
+    if ((argc >= 3) && (std::strcmp(argv[0], "-comparetraces") == 0)) {
+        gCompareTraceFilePath1 = argv[1];
+        gCompareTraceFilePath2 = argv[2];
+        return 3;
+    }
+
+    return 0;
+}
+
+static int parseArg_benchdecode([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-benchdecode") == 0) {
+        gbBenchmarkDecode = true;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int parseArg_benchzone([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-benchzone") == 0) {
+        gbBenchmarkZone = true;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int parseArg_zonestats(const int argc, const char** const argv) {
+    if ((argc >= 2) && (std::strcmp(argv[0], "-zonestats") == 0)) {
+        gZoneStatsFilePath = argv[1];
+
+        #if !PSYDOOM_ZONE_STATS
+            std::printf("Warning: '-zonestats' has no effect since this build of PsyDoom does not record zone memory stats (PSYDOOM_ZONE_STATS)!\n");
+        #endif
+
+        return 2;
+    }
+
+    return 0;
+}
+
+static int parseArg_ticktiming([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-ticktiming") == 0) {
+        gbTickTiming = true;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int parseArg_profile([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-profile") == 0) {
+        gbProfileOverlay = true;
+
+        #if !PSYDOOM_PROFILER
+            std::printf("Warning: '-profile' has no effect since this build of PsyDoom does not include the profiler (PSYDOOM_PROFILER)!\n");
+        #endif
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static int parseArg_profiletrace(const int argc, const char** const argv) {
+    if ((argc >= 2) && (std::strcmp(argv[0], "-profiletrace") == 0)) {
+        gProfileTraceFilePath = argv[1];
+
+        #if !PSYDOOM_PROFILER
+            std::printf("Warning: '-profiletrace' has no effect since this build of PsyDoom does not include the profiler (PSYDOOM_PROFILER)!\n");
+        #endif
+
+        return 2;
+    }
+
+    return 0;
+}
+
+static int parseArg_disccachestats([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-disccachestats") == 0) {
+        gbDiscCacheStats = true;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int parseArg_tcachestats([[maybe_unused]] const int argc, const char** const argv) {
+    if (std::strcmp(argv[0], "-tcachestats") == 0) {
+        gbTexCacheStats = true;
+        return 1;
+    }
+
+    return 0;
+}
+
 static int parseArg_server([[maybe_unused]] const int argc, const char** const argv) {
     if (std::strcmp(argv[0], "-server") == 0) {
         gbIsNetServer = true;
@@ -168,6 +308,16 @@ static constexpr ArgParser ARG_PARSERS[] = {
     parseArg_playdemo,
     parseArg_saveresult,
     parseArg_checkresult,
+    parseArg_savetrace,
+    parseArg_comparetraces,
+    parseArg_benchdecode,
+    parseArg_benchzone,
+    parseArg_zonestats,
+    parseArg_ticktiming,
+    parseArg_profile,
+    parseArg_profiletrace,
+    parseArg_disccachestats,
+    parseArg_tcachestats,
     parseArg_server,
     parseArg_client
 };
@@ -215,6 +365,17 @@ void shutdown() noexcept {
     gPlayDemoFilePath = "";
     gSaveDemoResultFilePath = "";
     gCheckDemoResultFilePath = "";
+    gSaveTraceFilePath = "";
+    gCompareTraceFilePath1 = "";
+    gCompareTraceFilePath2 = "";
+    gZoneStatsFilePath = "";
+    gbTickTiming = false;
+    gbProfileOverlay = false;
+    gProfileTraceFilePath = "";
+    gbDiscCacheStats = false;
+    gbTexCacheStats = false;
+    gbBenchmarkDecode = false;
+    gbBenchmarkZone = false;
     gbIsNetServer = false;
     gbIsNetClient = false;
 }
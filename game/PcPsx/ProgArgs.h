@@ -11,6 +11,17 @@ extern const char*  gDataDirPath;
 extern const char*  gPlayDemoFilePath;
 extern const char*  gSaveDemoResultFilePath;
 extern const char*  gCheckDemoResultFilePath;
+extern const char*  gSaveTraceFilePath;
+extern const char*  gCompareTraceFilePath1;
+extern const char*  gCompareTraceFilePath2;
+extern bool         gbBenchmarkDecode;
+extern bool         gbBenchmarkZone;
+extern const char*  gZoneStatsFilePath;
+extern bool         gbTickTiming;
+extern bool         gbProfileOverlay;
+extern const char*  gProfileTraceFilePath;
+extern bool         gbDiscCacheStats;
+extern bool         gbTexCacheStats;
 extern bool         gbIsNetServer;
 extern bool         gbIsNetClient;
 extern uint16_t     gServerPort;
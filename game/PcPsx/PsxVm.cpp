@@ -8,13 +8,19 @@
 #include "Config.h"
 #include "DiscInfo.h"
 #include "DiscReader.h"
+#include "DiscSectorCache.h"
 #include "Input.h"
 #include "IsoFileSys.h"
+#include "Profiler.h"
 #include "ProgArgs.h"
+#include "SpscQueue.h"
 #include "Spu.h"
 
 #include <SDL.h>
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <thread>
 
 BEGIN_DISABLE_HEADER_WARNINGS
     #include <system.h>
@@ -27,28 +33,165 @@ IsoFileSys  gIsoFileSys;
 System*     gpSystem;
 gpu::GPU*   gpGpu;
 Spu::Core   gSpu;
+bool        gbFramePipelining;
 
 static std::unique_ptr<System>  gSystem;
 static SDL_AudioDeviceID        gSdlAudioDeviceId;
 static std::recursive_mutex     gSpuMutex;
+static uint32_t                 gAudioBufferSamples;    // Size of the audio device buffer in samples
+
+// Queued up SPU commands from the game thread, and how many commands have been submitted (game thread only) and applied (audio thread only)
+static constexpr uint32_t MAX_SPU_VOICES = 24;
+
+static SpscQueue<SpuCmd, 8192>  gSpuCmdQueue;
+static uint64_t                 gNumSpuCmdsSubmitted;
+static uint64_t                 gNumSpuCmdsApplied;
+static uint32_t                 gLastSpuCmdCycle;                       // The cycle the last submitted command was stamped with
+static uint64_t                 gSpuVoiceKeyOnCmdNums[MAX_SPU_VOICES];  // Command number of the last key on for each voice, for detecting pending key ons
+static uint64_t                 gSpuVoiceKeyOffCmdNums[MAX_SPU_VOICES]; // Command number of the last key off for each voice, for detecting pending key offs
+
+// State published by the audio thread for the game thread.
+// The audio clock packs the SPU cycle count in the upper 32-bits and the time (in microseconds) that the audio callback began in the lower.
+static std::atomic<uint64_t>        gAudioClock;
+static std::atomic<uint64_t>        gNumSpuCmdsAppliedPublished;
+static std::atomic<Spu::EnvPhase>   gSpuVoiceEnvPhases[MAX_SPU_VOICES];
+
+static uint32_t getTimeMicroseconds() noexcept {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Applies a single SPU command: this must only be done by the audio thread, or with the SPU locked if there is no audio thread
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void applySpuCmd(Spu::Core& spu, const SpuCmd& cmd) noexcept {
+    if (cmd.type <= SpuCmdType::VoiceKeyOff) {
+        if (cmd.index >= spu.numVoices)
+            return;
+
+        Spu::Voice& voice = spu.pVoices[cmd.index];
+
+        switch (cmd.type) {
+            case SpuCmdType::VoiceSampleRate:   voice.sampleRate = (uint16_t) cmd.value;            break;
+            case SpuCmdType::VoiceStartAddr8:   voice.adpcmStartAddr8 = cmd.value;                  break;
+            case SpuCmdType::VoiceRepeatAddr8:  voice.adpcmRepeatAddr8 = cmd.value;                 break;
+            case SpuCmdType::VoiceEnvBits:      voice.envBits = cmd.value;                          break;
+            case SpuCmdType::VoiceVolumeLeft:   voice.volume.left = (int16_t) cmd.value;            break;
+            case SpuCmdType::VoiceVolumeRight:  voice.volume.right = (int16_t) cmd.value;           break;
+            case SpuCmdType::VoiceReverb:       voice.bDoReverb = (cmd.value != 0);                 break;
+            case SpuCmdType::VoiceKeyOn:        Spu::keyOn(voice);                                  break;
+            case SpuCmdType::VoiceKeyOff:       Spu::keyOff(voice);                                 break;
+
+            default: break;
+        }
+    } else {
+        switch (cmd.type) {
+            case SpuCmdType::MasterVolumeLeft:      spu.masterVol.left = (int16_t) cmd.value;       break;
+            case SpuCmdType::MasterVolumeRight:     spu.masterVol.right = (int16_t) cmd.value;      break;
+            case SpuCmdType::ReverbVolumeLeft:      spu.reverbVol.left = (int16_t) cmd.value;       break;
+            case SpuCmdType::ReverbVolumeRight:     spu.reverbVol.right = (int16_t) cmd.value;      break;
+            case SpuCmdType::ExtInputVolumeLeft:    spu.extInputVol.left = (int16_t) cmd.value;     break;
+            case SpuCmdType::ExtInputVolumeRight:   spu.extInputVol.right = (int16_t) cmd.value;    break;
+            case SpuCmdType::Unmute:                spu.bUnmute = (cmd.value != 0);                 break;
+            case SpuCmdType::ReverbWriteEnable:     spu.bReverbWriteEnable = (cmd.value != 0);      break;
+            case SpuCmdType::ExtEnabled:            spu.bExtEnabled = (cmd.value != 0);             break;
+            case SpuCmdType::ExtReverbEnable:       spu.bExtReverbEnable = (cmd.value != 0);        break;
+            case SpuCmdType::ReverbBaseAddr8:       spu.reverbBaseAddr8 = cmd.value;                break;
+
+            // Note: the reverb registers are all 16-bit and are indexed in the order they are declared
+            case SpuCmdType::ReverbReg: {
+                static_assert(sizeof(Spu::ReverbRegs) == 32 * sizeof(uint16_t));
+
+                if (cmd.index < 32) {
+                    uint16_t regs[32];
+                    std::memcpy(regs, &spu.reverbRegs, sizeof(regs));
+                    regs[cmd.index] = (uint16_t) cmd.value;
+                    std::memcpy(&spu.reverbRegs, regs, sizeof(regs));
+                }
+            }   break;
+
+            default: break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Publishes the envelope phase of each voice for the game thread, and how many commands had been applied when that was done.
+// This must only be done by the consumer of the SPU command queue.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void publishSpuVoiceState() noexcept {
+    const uint32_t numVoices = std::min(gSpu.numVoices, MAX_SPU_VOICES);
+
+    for (uint32_t voiceIdx = 0; voiceIdx < numVoices; ++voiceIdx) {
+        gSpuVoiceEnvPhases[voiceIdx].store(gSpu.pVoices[voiceIdx].envPhase, std::memory_order_relaxed);
+    }
+
+    gNumSpuCmdsAppliedPublished.store(gNumSpuCmdsApplied, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Applies all queued SPU commands immediately, regardless of the cycle they were due to be applied at.
+// The audio thread must be paused while this is done (see 'lockSpu'), since this makes the calling thread the consumer of the queue.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void flushSpuCmds() noexcept {
+    bool bAppliedCmds = false;
+
+    while (const SpuCmd* const pCmd = gSpuCmdQueue.front()) {
+        applySpuCmd(gSpu, *pCmd);
+        gSpuCmdQueue.pop();
+        gNumSpuCmdsApplied++;
+        bAppliedCmds = true;
+    }
+
+    if (bAppliedCmds) {
+        publishSpuVoiceState();
+    }
+}
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 // A callback invoked by SDL to ask for audio from PsyDoom
 //------------------------------------------------------------------------------------------------------------------------------------------
 static void SdlAudioCallback([[maybe_unused]] void* userData, Uint8* pOutput, int outputSize) noexcept {
+    PROFILE_SCOPE("SdlAudioCallback");
+
     // Ignore invalid requests
     if (outputSize <= 0)
         return;
 
-    // Lock the SPU and generate the requested number of samples
-    PsxVm::LockSpu spuLock;
+    // Generate the requested number of samples.
+    // Note: no locking is needed here since all changes to the SPU arrive via the command queue. The only other direct accesses to the SPU
+    // are done with the audio device locked (see 'lockSpu'), and SDL never runs this callback while the device is locked.
     const uint32_t numSamples = (uint32_t) outputSize / sizeof(Spu::StereoSample);
-    
-    for (uint32_t sampleIdx = 0; sampleIdx < numSamples; ++sampleIdx) {
-        const Spu::StereoSample sample = Spu::stepCore(gSpu);
-        std::memcpy(pOutput, &sample, sizeof(sample));
-        pOutput += sizeof(sample);
+
+    // Let the game thread know where the SPU is up to at this point in time, so it can timestamp the commands it issues
+    gAudioClock.store(((uint64_t) gSpu.cycleCount << 32) | getTimeMicroseconds(), std::memory_order_release);
+
+    Spu::StereoSample* const pOutputSamples = reinterpret_cast<Spu::StereoSample*>(pOutput);
+    uint32_t sampleIdx = 0;
+
+    while (sampleIdx < numSamples) {
+        // Apply any SPU commands which are due before generating the next sample
+        uint32_t blockSize = numSamples - sampleIdx;
+
+        while (const SpuCmd* const pCmd = gSpuCmdQueue.front()) {
+            const int32_t cyclesUntilCmd = (int32_t)(pCmd->applyAtCycle - gSpu.cycleCount);
+
+            // If the next command is not due yet then mix up until the point where it is
+            if (cyclesUntilCmd > 0) {
+                blockSize = std::min(blockSize, (uint32_t) cyclesUntilCmd);
+                break;
+            }
+
+            applySpuCmd(gSpu, *pCmd);
+            gSpuCmdQueue.pop();
+            gNumSpuCmdsApplied++;
+        }
+
+        Spu::stepCoreBlock(gSpu, pOutputSamples + sampleIdx, blockSize);
+        sampleIdx += blockSize;
     }
+
+    publishSpuVoiceState();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -66,6 +209,20 @@ bool init(const char* const doomCdCuePath) noexcept {
     // GPU: disable logging - this eats up TONS of memory!
     gpGpu->gpuLogEnabled = false;
 
+    // GPU: use multithreaded rasterization if configured.
+    // In 'auto' mode use one thread per core, but leave one core to the main game thread since it will be busy running game logic.
+    const int32_t numRasterizerThreads = (Config::gRasterizerThreads < 0) ?
+        std::min((int32_t) std::thread::hardware_concurrency() - 1, 8) :
+        Config::gRasterizerThreads;
+
+    gpGpu->setRasterizerThreads(numRasterizerThreads);
+
+    // GPU: draw at a higher internal resolution if configured
+    gpGpu->setRenderScale(Config::gRenderScale);
+
+    // Frame pipelining is only useful if drawing happens on other threads
+    gbFramePipelining = (Config::gbPipelinedRendering && (numRasterizerThreads > 1));
+
     // Parse the .cue info for the game disc
     {
         std::string parseErrorMsg;
@@ -79,6 +236,9 @@ bool init(const char* const doomCdCuePath) noexcept {
         }
     }
 
+    // Setup the cache for sectors read from the game disc
+    DiscSectorCache::init(Config::gDiscCacheSizeMB);
+
     // Build up the ISO file system from the game disc
     {
         DiscReader discReader(gDiscInfo);
@@ -114,6 +274,7 @@ bool init(const char* const doomCdCuePath) noexcept {
         gSdlAudioDeviceId = SDL_OpenAudioDevice(nullptr, false, &wantFmt, &gotFmt, false);
 
         if (gSdlAudioDeviceId != 0) {
+            gAudioBufferSamples = gotFmt.samples;
             SDL_PauseAudioDevice(gSdlAudioDeviceId, false);
         }
     }
@@ -133,6 +294,17 @@ void shutdown() noexcept {
         gSdlAudioDeviceId = 0;
     }
 
+    // Discard any SPU commands that the audio thread did not get to: there is no audio thread anymore so it's safe to do this here
+    while (gSpuCmdQueue.front()) {
+        gSpuCmdQueue.pop();
+    }
+
+    gNumSpuCmdsApplied = gNumSpuCmdsSubmitted;
+    gNumSpuCmdsAppliedPublished = gNumSpuCmdsSubmitted;
+    gLastSpuCmdCycle = 0;
+    gAudioClock = 0;
+
+    DiscSectorCache::shutdown();
     Spu::destroyCore(gSpu);     // Note: no locking of the SPU here because all threads should be done with it at this point
     gpGpu = nullptr;
     gpSystem = nullptr;
@@ -140,36 +312,118 @@ void shutdown() noexcept {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Submit a drawing primitive to the GPU
-// TODO: submitGpuPrimitive: replace with a more readable solution; don't write to GP0 and setup the GPU and submit primitives directly
+// Submit a drawing primitive to the GPU.
+// The data words for the whole primitive are handed over in one batch, so that complete draw commands can be decoded and executed
+// directly rather than being fed through the GPU's per-word command state machine.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void submitGpuPrimitive(const void* const pPrim) noexcept {
     ASSERT(pPrim);
-    
+
     // Get the primitive tag and consequently how many data words there are in the primitive
-    const uint32_t* pCurWord = (const uint32_t*) pPrim;
-    const uint32_t tag = pCurWord[0];
+    const uint32_t* const pPrimWords = (const uint32_t*) pPrim;
+    const uint32_t tag = pPrimWords[0];
     const uint32_t numDataWords = tag >> 24;
 
-    ++pCurWord;
-
     // Submit the primitive's data words to the GPU
-    uint32_t dataWordsLeft = numDataWords;
-
-    while (dataWordsLeft > 0) {
-        const uint32_t dataWord = *pCurWord;
-        ++pCurWord;
-        --dataWordsLeft;
-        gpGpu->writeGP0(dataWord);
-    }
+    gpGpu->writeGP0Words(pPrimWords + 1, numDataWords);
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Lock and unlock the SPU for direct access.
+// If there is an audio thread then it is paused by locking the audio device, and any SPU commands still queued are applied right away so
+// that the direct access happens after all the changes the game has made so far (key offs before sample uploads, for example).
+//------------------------------------------------------------------------------------------------------------------------------------------
 void lockSpu() noexcept {
     gSpuMutex.lock();
+
+    if (gSdlAudioDeviceId != 0) {
+        SDL_LockAudioDevice(gSdlAudioDeviceId);
+        flushSpuCmds();
+    }
 }
 
 void unlockSpu() noexcept {
+    if (gSdlAudioDeviceId != 0) {
+        SDL_UnlockAudioDevice(gSdlAudioDeviceId);
+    }
+
     gSpuMutex.unlock();
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Queue up a change to the SPU, to be applied by the audio thread.
+// If there is no audio thread then the change is applied immediately.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void submitSpuCmd(const SpuCmdType type, const uint32_t index, const uint32_t value) noexcept {
+    SpuCmd cmd = {};
+    cmd.type = type;
+    cmd.index = (uint8_t) index;
+    cmd.value = value;
+
+    if (gSdlAudioDeviceId == 0) {
+        LockSpu spuLock;
+        applySpuCmd(gSpu, cmd);
+        return;
+    }
+
+    // The samples made by the last audio callback are played out over roughly the next buffer's worth of time, and the samples made by the
+    // next callback over the buffer after that. Stamp the command to take effect in that 2nd buffer at the same offset in time that it was
+    // issued after the last callback. Never go past the end of that buffer in case the audio thread is running late, and never stamp a
+    // command earlier than the one before it since they must be applied in order.
+    const uint64_t audioClock = gAudioClock.load(std::memory_order_acquire);
+    const uint32_t callbackCycle = (uint32_t)(audioClock >> 32);
+    const uint32_t callbackTimeUs = (uint32_t) audioClock;
+    const uint32_t elapsedUs = getTimeMicroseconds() - callbackTimeUs;
+    const uint32_t elapsedCycles = (uint32_t) std::min<uint64_t>(((uint64_t) elapsedUs * 44100) / 1'000'000, gAudioBufferSamples - 1);
+
+    cmd.applyAtCycle = callbackCycle + gAudioBufferSamples + elapsedCycles;
+
+    if ((int32_t)(cmd.applyAtCycle - gLastSpuCmdCycle) < 0) {
+        cmd.applyAtCycle = gLastSpuCmdCycle;
+    }
+
+    gLastSpuCmdCycle = cmd.applyAtCycle;
+
+    // Remember when each voice was last keyed on or off
+    gNumSpuCmdsSubmitted++;
+
+    if (index < MAX_SPU_VOICES) {
+        if (type == SpuCmdType::VoiceKeyOn) {
+            gSpuVoiceKeyOnCmdNums[index] = gNumSpuCmdsSubmitted;
+        } else if (type == SpuCmdType::VoiceKeyOff) {
+            gSpuVoiceKeyOffCmdNums[index] = gNumSpuCmdsSubmitted;
+        }
+    }
+
+    // If the queue is full then the audio thread must be behind: wait for it to catch up
+    while (!gSpuCmdQueue.push(cmd)) {
+        std::this_thread::yield();
+    }
+}
+
+Spu::EnvPhase getSpuVoiceEnvPhase(const uint32_t voiceIdx) noexcept {
+    if (voiceIdx >= MAX_SPU_VOICES)
+        return Spu::EnvPhase::Off;
+
+    // If there is no audio thread then commands are applied immediately and the SPU can be read directly
+    if (gSdlAudioDeviceId == 0) {
+        LockSpu spuLock;
+        return (voiceIdx < gSpu.numVoices) ? gSpu.pVoices[voiceIdx].envPhase : Spu::EnvPhase::Off;
+    }
+
+    // If the last key on or key off for the voice has not been applied yet then report the phase the voice will be in once it is.
+    // Note: keying off always puts the voice into release, even if it was silent.
+    const uint64_t numCmdsApplied = gNumSpuCmdsAppliedPublished.load(std::memory_order_acquire);
+    const uint64_t keyOnCmdNum = gSpuVoiceKeyOnCmdNums[voiceIdx];
+    const uint64_t keyOffCmdNum = gSpuVoiceKeyOffCmdNums[voiceIdx];
+
+    if ((keyOffCmdNum > numCmdsApplied) && (keyOffCmdNum > keyOnCmdNum))
+        return Spu::EnvPhase::Release;
+
+    if (keyOnCmdNum > numCmdsApplied)
+        return Spu::EnvPhase::Attack;
+
+    return gSpuVoiceEnvPhases[voiceIdx].load(std::memory_order_relaxed);
+}
+
 END_NAMESPACE(PsxVm)
@@ -9,6 +9,7 @@ struct IsoFileSys;
 
 namespace Spu {
     struct Core;
+    enum class EnvPhase : uint8_t;
 }
 
 // Forward declaring avocado types
@@ -26,6 +27,9 @@ extern System*      gpSystem;
 extern gpu::GPU*    gpGpu;
 extern Spu::Core    gSpu;
 
+// Whether frames are pipelined: if set then the previous frame may still be drawing on other threads while the game works on the next
+extern bool         gbFramePipelining;
+
 bool init(const char* const doomCdCuePath) noexcept;
 void shutdown() noexcept;
 void submitGpuPrimitive(const void* const pPrim) noexcept;
@@ -35,7 +39,9 @@ void submitGpuPrimitive(const void* const pPrim) noexcept;
 void generateTimerEvents() noexcept;
 
 // Lock and unlock the SPU and a helper to do it via the RAII pattern.
-// The SPU should be locked before reading from or writing to any of it's properties.
+// The SPU should be locked before reading from or writing to SPU RAM, or before changing the SPU's external input.
+// Locking pauses the audio thread and applies any queued SPU commands first, so it should only be done rarely (level loads etc.).
+// Changes to SPU voices and settings should be made via SPU commands instead (see below).
 void lockSpu() noexcept;
 void unlockSpu() noexcept;
 
@@ -44,4 +50,53 @@ struct LockSpu {
     ~LockSpu() noexcept { unlockSpu(); }
 };
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// SPU commands: these are how the game thread changes SPU voices and settings without locking the SPU.
+//
+// Commands are pushed onto a lock-free queue and applied by the audio thread in between generating samples. Each command is stamped with
+// the SPU cycle at which it should take effect, which is worked out from the time it was issued relative to when the audio thread last ran.
+// This spreads changes out over an audio buffer in the same way they were spread out in time by the game, rather than them all bunching up
+// at the start of the next buffer.
+//------------------------------------------------------------------------------------------------------------------------------------------
+enum class SpuCmdType : uint8_t {
+    // Voice settings: 'index' is the voice index
+    VoiceSampleRate,
+    VoiceStartAddr8,
+    VoiceRepeatAddr8,
+    VoiceEnvBits,
+    VoiceVolumeLeft,
+    VoiceVolumeRight,
+    VoiceReverb,
+    VoiceKeyOn,
+    VoiceKeyOff,
+
+    // Core settings: 'index' is unused except for reverb registers, where it is the index of the 16-bit register
+    MasterVolumeLeft,
+    MasterVolumeRight,
+    ReverbVolumeLeft,
+    ReverbVolumeRight,
+    ExtInputVolumeLeft,
+    ExtInputVolumeRight,
+    Unmute,
+    ReverbWriteEnable,
+    ExtEnabled,
+    ExtReverbEnable,
+    ReverbBaseAddr8,
+    ReverbReg,
+};
+
+struct SpuCmd {
+    uint32_t        applyAtCycle;   // SPU cycle at which to apply the command
+    SpuCmdType      type;           // What to change
+    uint8_t         index;          // Which voice or register to change (if applicable)
+    uint32_t        value;          // The new value
+};
+
+void submitSpuCmd(const SpuCmdType type, const uint32_t index, const uint32_t value) noexcept;
+
+// Get the envelope phase of a voice as last seen by the audio thread.
+// If the voice has been keyed on or off but the audio thread has not done that yet then the voice is reported as being in the attack or
+// release phase respectively.
+Spu::EnvPhase getSpuVoiceEnvPhase(const uint32_t voiceIdx) noexcept;
+
 END_NAMESPACE(PsxVm)
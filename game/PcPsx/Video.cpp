@@ -10,6 +10,14 @@
 #include "Utils.h"
 
 #include <SDL.h>
+#include <cstring>
+#include <vector>
+
+// Use SSE2 for the framebuffer conversion if available
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PSYDOOM_VIDEO_USE_SSE2 1
+    #include <emmintrin.h>
+#endif
 
 BEGIN_DISABLE_HEADER_WARNINGS
     #include <device/gpu/gpu.h>
@@ -21,7 +29,9 @@ static SDL_Window*      gWindow;
 static SDL_Renderer*    gRenderer;
 static SDL_Texture*     gFramebufferTexture;
 static SDL_Rect         gOutputRect;
-static uint32_t*        gpFrameBuffer;
+static bool             gbFramebufferTexture16Bit;
+static int32_t          gFramebufferW;                  // Size of the framebuffer texture: the original draw resolution times the render scale
+static int32_t          gFramebufferH;
 
 // The original render/draw and output/display resolution of the game: the game rendered to a 256x240 framebuffer but stretched this image to
 // approximately 292.57x240 in square pixel terms - even though the game asks for a 320x200 'pixel' display (CRTs did not have pixels).
@@ -36,6 +46,11 @@ constexpr int32_t ORIG_DRAW_RES_Y = 240;
 constexpr int32_t ORIG_DISP_RES_X = 292;
 constexpr int32_t ORIG_DISP_RES_Y = 240;
 
+// A copy of the PSX framebuffer pixels last uploaded to the framebuffer texture, and whether it holds anything valid yet.
+// Used to only re-upload the rows of the framebuffer that have changed, which is nothing at all for static screens like menus.
+static std::vector<uint16_t>    gUploadedPixels;
+static bool                     gbUploadedPixelsValid;
+
 static void decideStartupResolution(int32_t& w, int32_t& h) noexcept {
     // Get the screen resolution.
     // On high DPI screens like MacOS retina the resolution returned will be virtual not physical resolution.
@@ -65,18 +80,6 @@ static void decideStartupResolution(int32_t& w, int32_t& h) noexcept {
     h = ORIG_DISP_RES_Y * multiplier;
 }
 
-static void lockFramebufferTexture() noexcept {
-    int pitch = 0;
-
-    if (SDL_LockTexture(gFramebufferTexture, nullptr, reinterpret_cast<void**>(&gpFrameBuffer), &pitch) != 0) {
-        FatalErrors::raise("Failed to lock the framebuffer texture for writing!");
-    }
-}
-
-static void unlockFramebufferTexture() noexcept {
-    SDL_UnlockTexture(gFramebufferTexture);
-}
-
 static void presentSdlFramebuffer() noexcept {
     // Get the size of the window.
     // Don't bother outputting if the window has been made zero sized.
@@ -87,9 +90,6 @@ static void presentSdlFramebuffer() noexcept {
     if (winSizeX <= 0 || winSizeY <= 0)
         return;
 
-    // Grab the framebuffer texture for writing to
-    unlockFramebufferTexture();
-
     // Are we using a free aspect ratio mode, specified by using a logical display width of <= 0?
     // If so then just stretch the output image in any way to fill the window.
     if (Config::gLogicalDisplayW <= 0) {
@@ -121,38 +121,128 @@ static void presentSdlFramebuffer() noexcept {
     // Blit the framebuffer to the display
     SDL_RenderCopy(gRenderer, gFramebufferTexture, nullptr, &gOutputRect);
 
-    // Present the rendered frame and re-lock the framebuffer texture
+    // Present the rendered frame
     SDL_RenderPresent(gRenderer);
-    lockFramebufferTexture();
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Convert a row of PSX framebuffer pixels (XBGR1555) to 32-bit XBGR8888 pixels.
+// The conversion is exact: each 5-bit color component is just shifted up by 3 bits.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void convertPsxPixels(const uint16_t* pSrc, uint32_t* pDst, const uint32_t numPixels) noexcept {
+    const uint16_t* const pSrcEnd = pSrc + numPixels;
+
+    #if PSYDOOM_VIDEO_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alpha = _mm_set1_epi32((int32_t) 0xFF000000);
+        const __m128i rMask = _mm_set1_epi32(0x001F);
+        const __m128i gMask = _mm_set1_epi32(0x03E0);
+        const __m128i bMask = _mm_set1_epi32(0x7C00);
+
+        const auto convert4 = [&](const __m128i pixels) noexcept {
+            const __m128i r = _mm_slli_epi32(_mm_and_si128(pixels, rMask), 3);
+            const __m128i g = _mm_slli_epi32(_mm_and_si128(pixels, gMask), 6);
+            const __m128i b = _mm_slli_epi32(_mm_and_si128(pixels, bMask), 9);
+            return _mm_or_si128(_mm_or_si128(alpha, r), _mm_or_si128(g, b));
+        };
+
+        // Do 8 pixels at a time
+        for (; pSrc + 8 <= pSrcEnd; pSrc += 8, pDst += 8) {
+            const __m128i pixels = _mm_loadu_si128((const __m128i*) pSrc);
+            _mm_storeu_si128((__m128i*)(pDst + 0), convert4(_mm_unpacklo_epi16(pixels, zero)));
+            _mm_storeu_si128((__m128i*)(pDst + 4), convert4(_mm_unpackhi_epi16(pixels, zero)));
+        }
+    #endif
+
+    // Convert the remaining pixels (or all pixels, if there is no SIMD support)
+    for (; pSrc < pSrcEnd; ++pSrc, ++pDst) {
+        const uint16_t srcPixel = *pSrc;
+        const uint32_t r = ((srcPixel >> 0 ) & 0x1F) << 3;
+        const uint32_t g = ((srcPixel >> 5 ) & 0x1F) << 3;
+        const uint32_t b = ((srcPixel >> 10) & 0x1F) << 3;
+
+        *pDst = (
+            0xFF000000 |
+            (b << 16) |
+            (g << 8 ) |
+            (r << 0 )
+        );
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Copies the currently displayed PSX framebuffer to the SDL framebuffer texture.
+// Only the range of rows which changed since the last upload are converted and uploaded; if nothing changed then no work is done.
+//------------------------------------------------------------------------------------------------------------------------------------------
 static void copyPsxToSdlFramebuffer() noexcept {
     gpu::GPU& gpu = *PsxVm::gpGpu;
-    const uint16_t* const vramPixels = gpu.vram.data();
-    uint32_t* pDstPixel = gpFrameBuffer;
-    
-    for (uint32_t y = 0; y < ORIG_DRAW_RES_Y; ++y) {
-        const uint16_t* const rowPixels = vramPixels + ((intptr_t) y + gpu.displayAreaStartY) * 1024;   // Note: VRAM size is '1024x512 @ 16 bpp'
-        const uint32_t xStart = (uint32_t) gpu.displayAreaStartX;
-        const uint32_t xEnd = xStart + ORIG_DRAW_RES_X;
-        ASSERT(xEnd <= 1024);
-
-        for (uint32_t x = xStart; x < xEnd; ++x) {
-            const uint16_t srcPixel = rowPixels[x];
-            const uint32_t r = ((srcPixel >> 10) & 0x1F) << 3;
-            const uint32_t g = ((srcPixel >> 5 ) & 0x1F) << 3;
-            const uint32_t b = ((srcPixel >> 0 ) & 0x1F) << 3;
-            
-            *pDstPixel = (
-               0xFF000000 |
-               (r << 16) |
-               (g << 8 ) |
-               (b << 0 )
-            );
-
-            ++pDstPixel;
+    gpu.waitForRasterizerFence(gpu.displayFence);   // Make sure queued drawing to the displayed framebuffer is finished
+
+    // Note: if drawing at a higher internal resolution then the display area must be scaled up to find the pixels in the high resolution VRAM
+    const int32_t scale = gpu.getRenderScale();
+    const int32_t vramW = gpu.getHiresVramWidth();
+    const int32_t xStart = gpu.displayAreaStartX * scale;
+    const int32_t yStart = gpu.displayAreaStartY * scale;
+    ASSERT(xStart + gFramebufferW <= vramW);
+
+    const uint16_t* const pVram = gpu.getDisplayVram();
+
+    const auto getSrcRow = [&](const int32_t y) noexcept {
+        return pVram + ((intptr_t) y + yStart) * vramW + xStart;
+    };
+
+    const auto getUploadedRow = [&](const int32_t y) noexcept {
+        return gUploadedPixels.data() + (intptr_t) y * gFramebufferW;
+    };
+
+    // Figure out which rows of the framebuffer have changed since the last upload
+    const size_t rowSize = gFramebufferW * sizeof(uint16_t);
+    int32_t firstDirtyRow = 0;
+    int32_t lastDirtyRow = gFramebufferH - 1;
+
+    if (gbUploadedPixelsValid) {
+        while ((firstDirtyRow <= lastDirtyRow) && (std::memcmp(getSrcRow(firstDirtyRow), getUploadedRow(firstDirtyRow), rowSize) == 0)) {
+            ++firstDirtyRow;
+        }
+
+        while ((lastDirtyRow >= firstDirtyRow) && (std::memcmp(getSrcRow(lastDirtyRow), getUploadedRow(lastDirtyRow), rowSize) == 0)) {
+            --lastDirtyRow;
+        }
+
+        if (firstDirtyRow > lastDirtyRow)
+            return;
+    }
+
+    // Lock the part of the framebuffer texture that needs updating
+    SDL_Rect lockRect = {};
+    lockRect.x = 0;
+    lockRect.y = firstDirtyRow;
+    lockRect.w = gFramebufferW;
+    lockRect.h = lastDirtyRow - firstDirtyRow + 1;
+
+    uint8_t* pDstRow = nullptr;
+    int pitch = 0;
+
+    if (SDL_LockTexture(gFramebufferTexture, &lockRect, reinterpret_cast<void**>(&pDstRow), &pitch) != 0) {
+        FatalErrors::raise("Failed to lock the framebuffer texture for writing!");
+    }
+
+    // Copy each dirty row: the 16-bit texture takes PSX pixels as-is and leaves the format conversion to SDL and the GPU
+    for (int32_t y = firstDirtyRow; y <= lastDirtyRow; ++y) {
+        const uint16_t* const pSrcRow = getSrcRow(y);
+
+        if (gbFramebufferTexture16Bit) {
+            std::memcpy(pDstRow, pSrcRow, rowSize);
+        } else {
+            convertPsxPixels(pSrcRow, reinterpret_cast<uint32_t*>(pDstRow), gFramebufferW);
         }
+
+        std::memcpy(getUploadedRow(y), pSrcRow, rowSize);
+        pDstRow += pitch;
     }
+
+    SDL_UnlockTexture(gFramebufferTexture);
+    gbUploadedPixelsValid = true;
 }
 
 void initVideo() noexcept {
@@ -212,25 +302,30 @@ void initVideo() noexcept {
         FatalErrors::raise("Failed to create renderer!");
     }
 
+    // Note: the PSX framebuffer format is 'XBGR1555' which 'SDL_PIXELFORMAT_BGR555' matches exactly.
+    // The framebuffer is bigger than the original if the GPU is drawing at a higher internal resolution.
+    gbFramebufferTexture16Bit = Config::gbUpload16BitFramebuffer;
+    gFramebufferW = ORIG_DRAW_RES_X * PsxVm::gpGpu->getRenderScale();
+    gFramebufferH = ORIG_DRAW_RES_Y * PsxVm::gpGpu->getRenderScale();
     gFramebufferTexture = SDL_CreateTexture(
         gRenderer,
-        SDL_PIXELFORMAT_ABGR8888,
+        (gbFramebufferTexture16Bit) ? SDL_PIXELFORMAT_BGR555 : SDL_PIXELFORMAT_ABGR8888,
         SDL_TEXTUREACCESS_STREAMING,
-        (int32_t) ORIG_DRAW_RES_X,
-        (int32_t) ORIG_DRAW_RES_Y
+        gFramebufferW,
+        gFramebufferH
     );
 
     if (!gFramebufferTexture) {
         FatalErrors::raise("Failed to create a framebuffer texture!");
     }
 
+    gUploadedPixels.assign((size_t) gFramebufferW * gFramebufferH, 0);
+    gbUploadedPixelsValid = false;
+
     // Clear the renderer to black
     SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0);
     SDL_RenderClear(gRenderer);
 
-    // Immediately lock the framebuffer texture for updating
-    lockFramebufferTexture();
-
     // Hide the cursor and switch to relative input mode.
     //
     // Note: added the set focus and warp mouse calls for MacOS to prevent a strange freezing issue on pressing the
@@ -248,8 +343,10 @@ void shutdownVideo() noexcept {
         return;
     
     // Do the cleanup
-    gpFrameBuffer = nullptr;
-    
+    gbUploadedPixelsValid = false;
+    gUploadedPixels.clear();
+    gUploadedPixels.shrink_to_fit();
+
     if (gRenderer) {
         SDL_DestroyRenderer(gRenderer);
         gRenderer = nullptr;
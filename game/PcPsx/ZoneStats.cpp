@@ -0,0 +1,146 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Utilities for writing zone memory statistics to a json file at the end of each level.
+//
+// Used to help size the zone heap ('Z_HEAP_SIZE') and the WMD memory buffer ('WMD_MEM_SIZE') from real usage data.
+// Statistics for each level played are kept in memory and the entire file is rewritten at the end of each level, so that the file is
+// always complete and valid even if the game is quit in the middle of a level.
+// Only available when the game is built with 'PSYDOOM_ZONE_STATS' enabled, since recording the statistics has a small cost.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "ZoneStats.h"
+
+#if PSYDOOM_ZONE_STATS
+
+#include "Doom/Base/s_sound.h"
+#include "Doom/Base/z_zone.h"
+#include "Doom/Game/g_game.h"
+#include "EngineLimits.h"
+#include "Finally.h"
+
+#include <cstdio>
+#include <rapidjson/document.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/prettywriter.h>
+
+BEGIN_NAMESPACE(ZoneStats)
+
+// Names for each tag bit that statistics are kept for, or null if the tag bit is not used by the game
+static constexpr const char* const TAG_NAMES[Z_NUM_STATS_TAGS] = {
+    "PU_STATIC",
+    "PU_LEVEL",
+    "PU_LEVSPEC",
+    "PU_ANIMATION",
+    "PU_PURGELEVEL",
+    "PU_CACHE",
+};
+
+// The json document holding the statistics for all levels played so far
+static rapidjson::Document gStatsDocument;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Creates the json document for the statistics if not done already, adding the sizes of the memory buffers being measured
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void initStatsDocument() noexcept {
+    if (gStatsDocument.IsObject())
+        return;
+
+    rapidjson::Document::AllocatorType& allocator = gStatsDocument.GetAllocator();
+    gStatsDocument.SetObject();
+    gStatsDocument.AddMember("zoneHeapSize", Z_HEAP_SIZE, allocator);
+    gStatsDocument.AddMember("wmdMemSize", WMD_MEM_SIZE, allocator);
+    gStatsDocument.AddMember("levels", rapidjson::Value(rapidjson::kArrayType), allocator);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Adds the zone memory statistics for the level just ended to the given json file, which contains the stats for all levels played so far.
+// Starts a new period for recording statistics also, so the stats for the next level are separate.
+// Returns 'false' on failure to save.
+//------------------------------------------------------------------------------------------------------------------------------------------
+bool saveLevelStatsToJsonFile(const char* const jsonFilePath) noexcept {
+    // Add the stats for the level to the json document
+    initStatsDocument();
+    rapidjson::Document::AllocatorType& allocator = gStatsDocument.GetAllocator();
+
+    {
+        const zonestats_t& stats = gZoneStats;
+        rapidjson::Value levelJson(rapidjson::kObjectType);
+
+        levelJson.AddMember("map", gGameMap, allocator);
+        levelJson.AddMember("demo", gbDemoPlayback, allocator);
+        levelJson.AddMember("numFrames", stats.numFrames, allocator);
+
+        // Allocation counts
+        levelJson.AddMember("numAllocs", stats.numAllocs, allocator);
+        levelJson.AddMember("numFrees", stats.numFrees, allocator);
+        levelJson.AddMember("numPurges", stats.numPurges, allocator);
+        levelJson.AddMember("allocBytes", stats.allocBytes, allocator);
+        levelJson.AddMember("purgedBytes", stats.purgedBytes, allocator);
+
+        // Memory usage and fragmentation
+        levelJson.AddMember("usedBytes", stats.usedBytes, allocator);
+        levelJson.AddMember("peakUsedBytes", stats.peakUsedBytes, allocator);
+        levelJson.AddMember("largestFreeBlock", stats.largestFreeBlock, allocator);
+        levelJson.AddMember("minLargestFreeBlock", stats.minLargestFreeBlock, allocator);
+        levelJson.AddMember("peakNumRegions", stats.peakNumRegions, allocator);
+
+        // Memory usage by tag, for tags which have been used
+        {
+            rapidjson::Value tagsJson(rapidjson::kObjectType);
+
+            for (int32_t tagIdx = 0; tagIdx < Z_NUM_STATS_TAGS; ++tagIdx) {
+                if (stats.tagPeakUsedBytes[tagIdx] == 0)
+                    continue;
+
+                rapidjson::Value tagJson(rapidjson::kObjectType);
+                tagJson.AddMember("usedBytes", stats.tagUsedBytes[tagIdx], allocator);
+                tagJson.AddMember("peakUsedBytes", stats.tagPeakUsedBytes[tagIdx], allocator);
+
+                char tagName[32];
+
+                if (TAG_NAMES[tagIdx]) {
+                    std::snprintf(tagName, C_ARRAY_SIZE(tagName), "%s", TAG_NAMES[tagIdx]);
+                } else {
+                    std::snprintf(tagName, C_ARRAY_SIZE(tagName), "0x%04X", 1u << tagIdx);
+                }
+
+                tagsJson.AddMember(rapidjson::Value(tagName, allocator), tagJson, allocator);
+            }
+
+            levelJson.AddMember("tags", tagsJson, allocator);
+        }
+
+        // Memory used in the WMD buffer for sound and music
+        levelJson.AddMember("wmdMemUsed", S_GetWmdMemUsed(), allocator);
+
+        gStatsDocument["levels"].PushBack(levelJson, allocator);
+    }
+
+    // The next level gets it's own stats
+    Z_BeginStatsPeriod();
+
+    // Write all the stats to the given file
+    std::FILE* const pFile = std::fopen(jsonFilePath, "w");
+
+    if (!pFile)
+        return false;
+
+    auto closeFile = finally([&]() noexcept {
+        std::fflush(pFile);
+        std::fclose(pFile);
+    });
+
+    try {
+        char writeBuffer[4096];
+        rapidjson::FileWriteStream writeStream(pFile, writeBuffer, C_ARRAY_SIZE(writeBuffer));
+        rapidjson::PrettyWriter<rapidjson::FileWriteStream> fileWriter(writeStream);
+        gStatsDocument.Accept(fileWriter);
+    } catch (...) {
+        return false;
+    }
+
+    // All good if we get to here!
+    return true;
+}
+
+END_NAMESPACE(ZoneStats)
+
+#endif  // #if PSYDOOM_ZONE_STATS
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Macros.h"
+
+#if PSYDOOM_ZONE_STATS
+
+BEGIN_NAMESPACE(ZoneStats)
+
+bool saveLevelStatsToJsonFile(const char* const jsonFilePath) noexcept;
+
+END_NAMESPACE(ZoneStats)
+
+#endif  // #if PSYDOOM_ZONE_STATS
@@ -6,6 +6,7 @@
 
 #include "Asserts.h"
 #include "LIBETC.h"
+#include "PcPsx/Profiler.h"
 #include "PcPsx/PsxVm.h"
 
 #include <cstdarg>
@@ -125,8 +126,12 @@ void LIBGPU_SetDispMask(const int32_t mask) noexcept {
 //  1 = Return the number of drawing operations currently in progress.
 //------------------------------------------------------------------------------------------------------------------------------------------
 int32_t LIBGPU_DrawSync([[maybe_unused]] const int32_t mode) noexcept {
-    // This function doesn't need to do anything in this emulated environment.
-    // When we submit something to the 'gpu' then Avocado executes it immediately and blocks before returning.
+    PROFILE_SCOPE("LIBGPU_DrawSync");
+
+    // When we submit something to the 'gpu' then Avocado normally executes it immediately and blocks before returning.
+    // If multithreaded rasterization is enabled however then drawing may still be queued up, in which case wait for it all to finish.
+    // Note: always blocking, even for mode '1', since the count of outstanding operations is only ever used to wait for completion.
+    PsxVm::gpGpu->flushRasterizer();
     return 0;
 }
 
@@ -150,8 +155,9 @@ void LIBGPU_LoadImage(const RECT& dstRect, const uint16_t* const pImageData) noe
     const uint16_t dstTy = (uint16_t)(dstRect.y            );
     const uint16_t dstBy = (uint16_t)(dstRect.y + dstRect.h);
 
-    // Copy each row into VRAM
+    // Copy each row into VRAM, after waiting for any queued drawing to finish
     gpu::GPU& gpu = *PsxVm::gpGpu;
+    gpu.flushRasterizer();
     uint16_t* const pVram = gpu.vram.data();
 
     const uint16_t* pSrcPixels = pImageData;
@@ -186,6 +192,9 @@ void LIBGPU_LoadImage(const RECT& dstRect, const uint16_t* const pImageData) noe
             pSrcPixels += numWrappedPixels;
         }
     }
+
+    // If drawing at a higher internal resolution then the high resolution copy of VRAM also needs the new pixels
+    gpu.upscaleVramRect(dstLx, dstTy % gpu::VRAM_HEIGHT, rowW, dstRect.h);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -206,6 +215,7 @@ int32_t LIBGPU_MoveImage(const RECT& srcRect, const int32_t dstX, const int32_t
     const uint32_t rowSize = srcRect.w * sizeof(uint16_t);
 
     gpu::GPU& gpu = *PsxVm::gpGpu;
+    gpu.flushRasterizer();      // Wait for any queued drawing to finish before touching VRAM
 
     const uint16_t* pSrcRow = gpu.vram.data() + srcRect.x + (intptr_t) srcRect.y * gpu::VRAM_WIDTH;
     uint16_t* pDstRow = gpu.vram.data() + dstX + (intptr_t) dstY * gpu::VRAM_WIDTH;
@@ -216,6 +226,8 @@ int32_t LIBGPU_MoveImage(const RECT& srcRect, const int32_t dstX, const int32_t
         pDstRow += gpu::VRAM_WIDTH;
     }
 
+    // Do the same copy for the high resolution copy of VRAM (if drawing at a higher internal resolution), so no detail is lost
+    gpu.copyHiresVramRect(srcRect.x, srcRect.y, srcRect.w, srcRect.h, dstX, dstY);
     return 0;   // This is the position of the command in the queue, according to PsyQ docs - don't care about this...
 }
 
@@ -353,6 +365,10 @@ DISPENV& LIBGPU_PutDispEnv(DISPENV& env) noexcept {
     gpu.displayAreaStartX = env.disp.x;
     gpu.displayAreaStartY = env.disp.y;
 
+    // PsyDoom: remember how much of the queued drawing must be done before the new framebuffer can be shown.
+    // If rasterization is multithreaded then this allows drawing of the next frame to begin before the displayed one has finished.
+    gpu.displayFence = gpu.getRasterizerFence();
+
     // Set the display range if specified, otherwise leave alone (I've never seen DOOM try to modify this)
     if ((env.screen.w != 0) && (env.screen.h != 0)) {
         gpu.displayRangeX1 = env.screen.x;
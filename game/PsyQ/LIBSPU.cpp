@@ -12,6 +12,15 @@
 // The current reverb mode in use
 static SpuReverbMode gReverbMode = SPU_REV_MODE_OFF;
 
+// PsyDoom: the SPU is owned by the audio thread and LIBSPU changes voices and settings by submitting commands (see 'PsxVm::submitSpuCmd').
+// These hold the voice and SPU settings as LIBSPU last set them, for when it needs to read back or partially modify a setting.
+// Only the setting fields of these are used, playback state like the current envelope phase must be queried from the audio thread.
+static Spu::Voice   gVoiceSettings[SPU_NUM_VOICES];
+static Spu::Core    gSpuSettings;
+
+using PsxVm::SpuCmdType;
+using PsxVm::submitSpuCmd;
+
 // Where to write to next in SPU ram
 static uint32_t gTransferStartAddr;
 
@@ -59,19 +68,21 @@ void LIBSPU_SpuSetVoiceAttr(const SpuVoiceAttr& attribs) noexcept {
     const bool bSetVolR         = (bSetAllAttribs || (attribMask & SPU_VOICE_VOLR));
     const bool bSetVolModeR     = (bSetAllAttribs || (attribMask & SPU_VOICE_VOLMODER));
 
-    // Set the required attributes for all specified voices
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
+    // Which of the envelope settings are being changed
+    const bool bSetEnvelope = (
+        bSetAttackRate || bSetDecayRate || bSetSustainLevel || bSetSustainRate || bSetReleaseRate || bSetAdsrPart1 || bSetAdsrPart2
+    );
 
+    // Set the required attributes for all specified voices
     const uint32_t voiceBits = attribs.voice_bits;
 
-    for (uint32_t voiceIdx = 0; voiceIdx < spu.numVoices; ++voiceIdx) {
+    for (uint32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
         // Skip this voice if we're not setting its attributes
         if ((voiceBits & (1 << voiceIdx)) == 0)
             continue;
 
         // Set: voice 'pitch' or sample rate. Note that '4,096' = '44,100 Hz'.
-        Spu::Voice& voice = spu.pVoices[voiceIdx];
+        Spu::Voice& voice = gVoiceSettings[voiceIdx];
 
         if (bSetPitch) {
             voice.sampleRate = attribs.pitch;
@@ -216,6 +227,31 @@ void LIBSPU_SpuSetVoiceAttr(const SpuVoiceAttr& attribs) noexcept {
                 voice.volume.right = modeBits | volBits;
             }
         }
+
+        // Send all of the changed settings to the SPU
+        if (bSetPitch || bSetNote) {
+            submitSpuCmd(SpuCmdType::VoiceSampleRate, voiceIdx, voice.sampleRate);
+        }
+
+        if (bSetWaveAddr) {
+            submitSpuCmd(SpuCmdType::VoiceStartAddr8, voiceIdx, voice.adpcmStartAddr8);
+        }
+
+        if (bSetEnvelope) {
+            submitSpuCmd(SpuCmdType::VoiceEnvBits, voiceIdx, voice.envBits);
+        }
+
+        if (bSetWaveLoopAddr) {
+            submitSpuCmd(SpuCmdType::VoiceRepeatAddr8, voiceIdx, voice.adpcmRepeatAddr8);
+        }
+
+        if (bSetVolL) {
+            submitSpuCmd(SpuCmdType::VoiceVolumeLeft, voiceIdx, (uint16_t) voice.volume.left);
+        }
+
+        if (bSetVolR) {
+            submitSpuCmd(SpuCmdType::VoiceVolumeRight, voiceIdx, (uint16_t) voice.volume.right);
+        }
     }
 }
 
@@ -277,8 +313,7 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
     const bool bClearReverbWorkingArea  = (reverbAttr.mode & SPU_REV_MODE_CLEAR_WA);
 
     // Set the new reverb mode (if changing) and grab the default reverb settings for whatever mode is now current
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
+    Spu::Core& spu = gSpuSettings;
 
     if (bSetReverbMode) {
         const SpuReverbMode reverbMode = (SpuReverbMode)(reverbAttr.mode & (~SPU_REV_MODE_CLEAR_WA));   // Must remove the 'CLEAR_WA' (clear working area flag)
@@ -286,6 +321,7 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
         if (reverbMode < SPU_REV_MODE_MAX) {
             gReverbMode = reverbMode;
             spu.reverbBaseAddr8 = gReverbWorkAreaBaseAddrs[gReverbMode];    // Update the reverb working area base address when changing mode
+            submitSpuCmd(SpuCmdType::ReverbBaseAddr8, 0, spu.reverbBaseAddr8);
         } else {
             // Bad reverb mode - this causes the call to fail!
             return SPU_ERROR;
@@ -340,6 +376,7 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
     // If the reverb mode is being set then we must disable master temporarily
     const bool bPrevReverbEnabled = spu.bReverbWriteEnable;
     spu.bReverbWriteEnable = false;
+    submitSpuCmd(SpuCmdType::ReverbWriteEnable, 0, false);
 
     // Update the reverb depth.
     // Note that if the reverb mode is being set then LIBSPU must also set reverb depth temporarily to '0', as per the docs.
@@ -347,13 +384,17 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
     if (bSetReverbMode) {
         spu.reverbVol.left = 0;
         spu.reverbVol.right = 0;
+        submitSpuCmd(SpuCmdType::ReverbVolumeLeft, 0, 0);
+        submitSpuCmd(SpuCmdType::ReverbVolumeRight, 0, 0);
     } else {
         if (bSetReverbLeftDepth) {
             spu.reverbVol.left = reverbAttr.depth.left;
+            submitSpuCmd(SpuCmdType::ReverbVolumeLeft, 0, (uint16_t) spu.reverbVol.left);
         }
 
         if (bSetReverbRightDepth) {
             spu.reverbVol.right = reverbAttr.depth.right;
+            submitSpuCmd(SpuCmdType::ReverbVolumeRight, 0, (uint16_t) spu.reverbVol.right);
         }
     }
     
@@ -366,6 +407,7 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
         const auto updateReg = [=](const uint32_t idx, auto& reg, const uint16_t value) noexcept {
             if (bSetAllRegs || (regBits & (1 << idx))) {
                 reg = value;
+                submitSpuCmd(SpuCmdType::ReverbReg, idx, value);
             }
         };
 
@@ -410,6 +452,7 @@ int32_t LIBSPU_SpuSetReverbModeParam(const SpuReverbAttr& reverbAttr) noexcept {
 
     // Restore master reverb if we disabled it and return success
     spu.bReverbWriteEnable = bPrevReverbEnabled;
+    submitSpuCmd(SpuCmdType::ReverbWriteEnable, 0, bPrevReverbEnabled);
     return SPU_SUCCESS;
 }
 
@@ -439,8 +482,7 @@ void LIBSPU_SpuSetCommonAttr(const SpuCommonAttr& attribs) noexcept {
     #endif
 
     // Set: master volume and mode (left)
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
+    Spu::Core& spu = gSpuSettings;
 
     if (bSetMVolL) {
         const uint16_t mode = (bSetMVolModeL) ? attribs.mvolmode.left : 0;
@@ -452,6 +494,8 @@ void LIBSPU_SpuSetCommonAttr(const SpuCommonAttr& attribs) noexcept {
             const uint16_t modeBits = 0x8000 | ((mode - 1) << 12);
             spu.masterVol.left = modeBits | volBits;
         }
+
+        submitSpuCmd(SpuCmdType::MasterVolumeLeft, 0, (uint16_t) spu.masterVol.left);
     }
 
     // Set: master volume and mode (right)
@@ -465,6 +509,8 @@ void LIBSPU_SpuSetCommonAttr(const SpuCommonAttr& attribs) noexcept {
             const uint16_t modeBits = 0x8000 | ((mode - 1) << 12);
             spu.masterVol.right = modeBits | volBits;
         }
+
+        submitSpuCmd(SpuCmdType::MasterVolumeRight, 0, (uint16_t) spu.masterVol.right);
     }
 
     // Note: PsyDoom's new SPU implemention only supports a single external input, which is used to supply CD audio.
@@ -475,19 +521,23 @@ void LIBSPU_SpuSetCommonAttr(const SpuCommonAttr& attribs) noexcept {
     // Set: cd volume left and right
     if (bSetCdVolL) {
         spu.extInputVol.left = attribs.cd.volume.left;
+        submitSpuCmd(SpuCmdType::ExtInputVolumeLeft, 0, (uint16_t) spu.extInputVol.left);
     }
 
     if (bSetCdVolR) {
         spu.extInputVol.right = attribs.cd.volume.right;
+        submitSpuCmd(SpuCmdType::ExtInputVolumeRight, 0, (uint16_t) spu.extInputVol.right);
     }
 
     // Set: cd reverb and mix enabled
     if (bSetCdReverb) {
         spu.bExtReverbEnable = (attribs.cd.reverb != 0);
+        submitSpuCmd(SpuCmdType::ExtReverbEnable, 0, spu.bExtReverbEnable);
     }
 
     if (bSetCdMix) {
         spu.bExtEnabled = (attribs.cd.mix != 0);
+        submitSpuCmd(SpuCmdType::ExtEnabled, 0, spu.bExtEnabled);
     }
 
     // Attributes relating to PlayStation external inputs are ignored for PsyDoom (see comments above)
@@ -515,8 +565,7 @@ void LIBSPU_SpuSetCommonAttr(const SpuCommonAttr& attribs) noexcept {
 // Any bytes past this address are used for reverb.
 //------------------------------------------------------------------------------------------------------------------------------------------
 uint32_t LIBSPU_SpuGetReverbOffsetAddr() noexcept {
-    PsxVm::LockSpu spuLock;
-    return PsxVm::gSpu.reverbBaseAddr8 * 8;
+    return gSpuSettings.reverbBaseAddr8 * 8;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -524,11 +573,13 @@ uint32_t LIBSPU_SpuGetReverbOffsetAddr() noexcept {
 // Will return 'SPU_ERROR' if that area is currently in use, otherwise 'SPU_SUCCESS'.
 //------------------------------------------------------------------------------------------------------------------------------------------
 int32_t LIBSPU_SpuClearReverbWorkArea() noexcept {
-    // Can't clear the reverb area if reverb is active!
-    // Also can't clear if no reverb address is set:
+    // Note: must lock the SPU to write to SPU RAM.
+    // Locking also applies any queued SPU commands, so the live reverb settings checked below reflect everything the game has set.
     Spu::Core& spu = PsxVm::gSpu;
     PsxVm::LockSpu spuLock;
 
+    // Can't clear the reverb area if reverb is active!
+    // Also can't clear if no reverb address is set:
     const uint32_t reverbBaseAddr = (uint32_t) spu.reverbBaseAddr8 * 8;
 
     if (spu.bReverbWriteEnable || (reverbBaseAddr == 0)) {
@@ -557,15 +608,16 @@ void LIBSPU_SpuStart() noexcept {
 // By default both left and right channels are set, but you can set independently using 'SPU_REV_DEPTHL' and 'SPU_REV_DEPTHR' mask flags.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void LIBSPU_SpuSetReverbDepth(const SpuReverbAttr& reverb) noexcept {
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
+    Spu::Core& spu = gSpuSettings;
 
     if ((reverb.mask == 0) || (reverb.mask & SPU_REV_DEPTHL)) {
         spu.reverbVol.left = reverb.depth.left;
+        submitSpuCmd(SpuCmdType::ReverbVolumeLeft, 0, (uint16_t) spu.reverbVol.left);
     }
 
     if ((reverb.mask == 0) || (reverb.mask & SPU_REV_DEPTHR)) {
         spu.reverbVol.right = reverb.depth.right;
+        submitSpuCmd(SpuCmdType::ReverbVolumeRight, 0, (uint16_t) spu.reverbVol.right);
     }
 }
 
@@ -581,13 +633,11 @@ void LIBSPU_SpuSetReverbDepth(const SpuReverbAttr& reverb) noexcept {
 //------------------------------------------------------------------------------------------------------------------------------------------
 int32_t LIBSPU_SpuSetReverbVoice(const int32_t onOff, const int32_t voiceBits) noexcept {
     // Enabling/disabling reverb for every single voice with the bit mask?
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
-
     if (onOff == SPU_BIT) {
-        for (int32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
-            Spu::Voice& voice = spu.pVoices[voiceIdx];
+        for (uint32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
+            Spu::Voice& voice = gVoiceSettings[voiceIdx];
             voice.bDoReverb = ((voiceBits & (1 << voiceIdx)) != 0);
+            submitSpuCmd(SpuCmdType::VoiceReverb, voiceIdx, voice.bDoReverb);
         }
 
         return voiceBits;
@@ -597,11 +647,12 @@ int32_t LIBSPU_SpuSetReverbVoice(const int32_t onOff, const int32_t voiceBits) n
     const bool bEnableReverb = (onOff != SPU_OFF);
     int32_t enabledVoiceBits = 0;
 
-    for (int32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
-        Spu::Voice& voice = spu.pVoices[voiceIdx];
+    for (uint32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
+        Spu::Voice& voice = gVoiceSettings[voiceIdx];
 
         if (voiceBits & (1 << voiceIdx)) {
             voice.bDoReverb = bEnableReverb;
+            submitSpuCmd(SpuCmdType::VoiceReverb, voiceIdx, voice.bDoReverb);
         }
 
         enabledVoiceBits |= (voice.bDoReverb) ? (1 << voiceIdx) : 0;
@@ -614,8 +665,7 @@ int32_t LIBSPU_SpuSetReverbVoice(const int32_t onOff, const int32_t voiceBits) n
 // Initializes the SPU to a default state
 //------------------------------------------------------------------------------------------------------------------------------------------
 void LIBSPU_SpuInit() noexcept {
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
+    Spu::Core& spu = gSpuSettings;
 
     spu.bExtEnabled = false;
     spu.bExtReverbEnable = false;
@@ -626,17 +676,35 @@ void LIBSPU_SpuInit() noexcept {
     spu.reverbVol = {};
     spu.extInputVol = {};
 
-    for (uint32_t voiceIdx = 0; voiceIdx < spu.numVoices; ++voiceIdx) {
-        Spu::Voice& voice = spu.pVoices[voiceIdx];
+    submitSpuCmd(SpuCmdType::ExtEnabled, 0, false);
+    submitSpuCmd(SpuCmdType::ExtReverbEnable, 0, false);
+    submitSpuCmd(SpuCmdType::Unmute, 0, false);
+    submitSpuCmd(SpuCmdType::ReverbWriteEnable, 0, false);
+    submitSpuCmd(SpuCmdType::MasterVolumeLeft, 0, 0);
+    submitSpuCmd(SpuCmdType::MasterVolumeRight, 0, 0);
+    submitSpuCmd(SpuCmdType::ReverbVolumeLeft, 0, 0);
+    submitSpuCmd(SpuCmdType::ReverbVolumeRight, 0, 0);
+    submitSpuCmd(SpuCmdType::ExtInputVolumeLeft, 0, 0);
+    submitSpuCmd(SpuCmdType::ExtInputVolumeRight, 0, 0);
+
+    for (uint32_t voiceIdx = 0; voiceIdx < SPU_NUM_VOICES; ++voiceIdx) {
+        Spu::Voice& voice = gVoiceSettings[voiceIdx];
 
-        Spu::keyOff(voice);
         voice.volume = {};
         voice.sampleRate = 0x00FF;
         voice.adpcmStartAddr8 = 0;
         voice.env = {};
+
+        submitSpuCmd(SpuCmdType::VoiceKeyOff, voiceIdx, 0);
+        submitSpuCmd(SpuCmdType::VoiceVolumeLeft, voiceIdx, 0);
+        submitSpuCmd(SpuCmdType::VoiceVolumeRight, voiceIdx, 0);
+        submitSpuCmd(SpuCmdType::VoiceSampleRate, voiceIdx, voice.sampleRate);
+        submitSpuCmd(SpuCmdType::VoiceStartAddr8, voiceIdx, 0);
+        submitSpuCmd(SpuCmdType::VoiceEnvBits, voiceIdx, 0);
     }
 
     spu.bUnmute = true;
+    submitSpuCmd(SpuCmdType::Unmute, 0, true);
     LIBSPU_SpuStart();
 
     // Ensure the reverb work area address is correct
@@ -646,6 +714,8 @@ void LIBSPU_SpuInit() noexcept {
         spu.reverbBaseAddr8 = gReverbWorkAreaBaseAddrs[0];
     }
 
+    submitSpuCmd(SpuCmdType::ReverbBaseAddr8, 0, spu.reverbBaseAddr8);
+
     gTransferStartAddr = 0;
 }
 
@@ -657,9 +727,8 @@ void LIBSPU_SpuInit() noexcept {
 int32_t LIBSPU_SpuSetReverb(const int32_t onOff) noexcept {
     const bool bEnable = (onOff != SPU_OFF);
 
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
-    spu.bReverbWriteEnable = bEnable;
+    gSpuSettings.bReverbWriteEnable = bEnable;
+    submitSpuCmd(SpuCmdType::ReverbWriteEnable, 0, bEnable);
     return (bEnable) ? SPU_ON : SPU_OFF;
 }
 
@@ -703,11 +772,9 @@ uint32_t LIBSPU_SpuSetTransferStartAddr(const uint32_t addr) noexcept {
     // Per PsyQ docs the address given is rounded up to the next 8-byte boundary.
     // It also must be in range or the instruction is ignored and '0' returned.
     const uint32_t alignedAddr = (addr + 7) & (~7u);
-    
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
 
-    if (alignedAddr < spu.ramSize) {
+    // Note: the SPU RAM size never changes after the SPU is created, so it is safe to read without locking the SPU
+    if (alignedAddr < PsxVm::gSpu.ramSize) {
         gTransferStartAddr = alignedAddr;
         return alignedAddr;
     } else {
@@ -749,24 +816,19 @@ void LIBSPU_SpuSetKeyOnWithAttr(const SpuVoiceAttr& attribs) noexcept {
 // The on/off action to perform must be either 'SPU_OFF' or 'SPU_ON'
 //------------------------------------------------------------------------------------------------------------------------------------------
 void LIBSPU_SpuSetKey(const int32_t onOff, const uint32_t voiceBits) noexcept {
-    Spu::Core& spu = PsxVm::gSpu;
-    PsxVm::LockSpu spuLock;
-
-    const uint32_t numVoicesToSet = std::min(SPU_NUM_VOICES, spu.numVoices);
+    const uint32_t numVoicesToSet = std::min(SPU_NUM_VOICES, PsxVm::gSpu.numVoices);
     
     if (onOff == SPU_OFF) {
         for (uint32_t voiceIdx = 0; voiceIdx < numVoicesToSet; ++voiceIdx) {
             if (voiceBits & (1 << voiceIdx)) {
-                Spu::Voice& voice = spu.pVoices[voiceIdx];
-                Spu::keyOff(voice);
+                submitSpuCmd(SpuCmdType::VoiceKeyOff, voiceIdx, 0);
             }
         }
     }
     else if (onOff == SPU_ON) {
         for (uint32_t voiceIdx = 0; voiceIdx < numVoicesToSet; ++voiceIdx) {
             if (voiceBits & (1 << voiceIdx)) {
-                Spu::Voice& voice = spu.pVoices[voiceIdx];
-                Spu::keyOn(voice);
+                submitSpuCmd(SpuCmdType::VoiceKeyOn, voiceIdx, 0);
             }
         }
     }
@@ -782,11 +844,10 @@ void LIBSPU_SpuSetKey(const int32_t onOff, const uint32_t voiceBits) noexcept {
 //------------------------------------------------------------------------------------------------------------------------------------------
 void LIBSPU_SpuGetAllKeysStatus(uint8_t statuses[SPU_NUM_VOICES]) noexcept {
     // Get the statuses
-    Spu::Core& spu = PsxVm::gSpu;
-    const uint32_t numVoicesToGet = std::min(SPU_NUM_VOICES, spu.numVoices);
+    const uint32_t numVoicesToGet = std::min(SPU_NUM_VOICES, PsxVm::gSpu.numVoices);
 
     for (uint32_t voiceIdx = 0; voiceIdx < numVoicesToGet; ++voiceIdx) {
-        const Spu::EnvPhase envPhase = spu.pVoices[voiceIdx].envPhase;
+        const Spu::EnvPhase envPhase = PsxVm::getSpuVoiceEnvPhase(voiceIdx);
 
         switch (envPhase) {
             case Spu::EnvPhase::Attack:
@@ -11,6 +11,7 @@
 #include "FatalErrors.h"
 #include "PcPsx/DiscInfo.h"
 #include "PcPsx/DiscReader.h"
+#include "PcPsx/DiscSectorCache.h"
 #include "PcPsx/ModMgr.h"
 #include "PcPsx/ProgArgs.h"
 #include "PcPsx/PsxVm.h"
@@ -18,12 +19,26 @@
 #include "psxspu.h"
 #include "Spu.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 static constexpr int32_t MAX_OPEN_FILES     = 4;        // Maximum number of open files
 static constexpr int32_t FADE_TIME_MS       = 250;      // Time it takes to fade out CD audio (milliseconds)
 static constexpr int32_t CDDA_SECTOR_SIZE   = 2352;     // Size of of a CD digital audio sector
 
+// How many stereo sample frames there are in a CD digital audio sector
+static constexpr int32_t CDDA_SECTOR_FRAMES = CDDA_SECTOR_SIZE / (sizeof(int16_t) * 2);
+
+// How many sectors of CD audio the streaming thread tries to keep buffered ahead of playback.
+// At 75 sectors per second this is roughly 850 milliseconds of audio.
+static constexpr uint32_t CDDA_STREAM_SECTORS = 64;
+
+// How often the streaming thread checks if there is room to buffer more audio, if it's not woken up before that
+static constexpr std::chrono::milliseconds CDDA_STREAM_POLL_INTERVAL = std::chrono::milliseconds(5);
+
 // If true then the 'psxcd' module has been initialized
 static bool gbPSXCD_IsCdInit;
 
@@ -31,17 +46,37 @@ static bool gbPSXCD_IsCdInit;
 static PsxCd_File gPSXCD_cdfile;
 
 // CD audio playback related state.
-// Access to all of this is controlled by the CD player mutex.
+//
+// PsyDoom: CD audio is read from disc ahead of time by a streaming thread, which fills a ring buffer of whole sectors that the SPU pulls from.
+// This keeps disc reads (which might be slow) out of the audio thread. The audio thread never locks the CD player and only accesses the
+// atomic fields and the ring buffer. Access to everything else is controlled by the CD player mutex.
 static struct {
     DiscReader  discReader          = { PsxVm::gDiscInfo };     // The disc reader used to stream the audio
-    bool        bPlay               = false;                    // If 'false' then playback is either paused or stopped (stopped if the disc reader doesn't have a track)
     bool        bLoop               = false;                    // If 'true' then playback is looped upon reaching the end
-    int32_t     bufferOffset        = 0;                        // Where we are in the audio buffer
+    bool        bReachedEnd         = false;                    // Set when the streaming thread has read all of the track and there is no looping
     int32_t     loopTrack           = 0;                        // The track to play when looping
     int32_t     loopSectorOffset    = 0;                        // Offset (in sectors) to start at in the track when looping
-
-    // The CD audio buffer: we read CD audio in chunks
-    int16_t buffer[CDDA_SECTOR_SIZE / sizeof(int16_t)];
+    uint32_t    playId              = 0;                        // Incremented each time playback is started, so audio streamed for a previous play can be identified
+
+    // If 'false' then playback is either paused or stopped (stopped if the disc reader doesn't have a track).
+    // Only changed while holding the CD player mutex.
+    std::atomic<bool> bPlay = { false };
+
+    // Ring buffer read and write positions and where the audio thread must skip ahead to in order to discard old audio.
+    // The number of sectors written is only changed by the streaming thread while holding the CD player mutex, the number of frames read is only
+    // changed by the audio thread. The discard position is only changed by the main thread while holding the CD player mutex.
+    std::atomic<uint64_t>   numSectorsWritten       = { 0 };
+    std::atomic<uint64_t>   numFramesRead           = { 0 };
+    std::atomic<uint64_t>   discardBeforeSector     = { 0 };
+
+    // The 'play id' (upper 32-bits) and track offset (lower 32-bits) after reading the sector which is currently being played.
+    // Updated by the audio thread as it starts playing each sector.
+    std::atomic<uint64_t>   playbackPos = { 0 };
+
+    // The ring buffer of streamed sectors and the 'play id' and track offset after reading for each sector
+    int16_t     sectorSamples[CDDA_STREAM_SECTORS][CDDA_SECTOR_SIZE / sizeof(int16_t)];
+    uint32_t    sectorPlayIds[CDDA_STREAM_SECTORS];
+    int32_t     sectorEndOffsets[CDDA_STREAM_SECTORS];
 } gCdPlayer;
 
 // The lock for the CD player and a helper to lock/unlock via RAII.
@@ -54,77 +89,190 @@ struct LockCdPlayer {
     ~LockCdPlayer() noexcept { gCdPlayerMutex.unlock(); }
 };
 
+// The thread which streams CD audio from disc ahead of playback, and what is used to wake it up or tell it to quit.
+// The thread is stopped on exit of the app by this holder object, if not stopped already.
+static std::condition_variable_any gCdStreamerWakeup;
+
+static struct CdStreamer {
+    std::thread     thread;
+    bool            bQuit = false;      // Guarded by the CD player mutex
+
+    ~CdStreamer() noexcept {
+        if (thread.joinable()) {
+            {
+                LockCdPlayer cdPlayerLock;
+                bQuit = true;
+            }
+
+            gCdStreamerWakeup.notify_all();
+            thread.join();
+        }
+    }
+} gCdStreamer;
+
 // Disc readers used for each open file
 static DiscReader gFileDiscReaders[MAX_OPEN_FILES] = { PsxVm::gDiscInfo, PsxVm::gDiscInfo, PsxVm::gDiscInfo, PsxVm::gDiscInfo };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// A callback invoked by the SPU when it wants audio from the CD player - returns a single sample.
+// Discards all streamed CD audio: the audio thread will skip past it and the streaming thread is free to overwrite it.
+// The CD player must be locked when calling this.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static Spu::StereoSample SpuAudioCallback([[maybe_unused]] void* pUserData) noexcept {
-    // Lock the CD player while we are doing this.
-    // Note that this thread also has the SPU lock at this point too.
-    // Therefore the main thread must NOT lock both the CD player and the SPU at the same time, or otherwise a deadlock might occur.
-    LockCdPlayer cdPlayerLock;
+static void discardStreamedCdAudio() noexcept {
+    gCdPlayer.discardBeforeSector.store(gCdPlayer.numSectorsWritten.load(std::memory_order_relaxed), std::memory_order_release);
+}
 
-    // If the CD player is not currently active then return silence
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells if the audio thread has played all of the CD audio that has been streamed so far.
+// The CD player must be locked when calling this.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool isStreamedCdAudioFinished() noexcept {
+    const uint64_t numSectorsWritten = gCdPlayer.numSectorsWritten.load(std::memory_order_relaxed);
+    const uint64_t numFramesRead = gCdPlayer.numFramesRead.load(std::memory_order_acquire);
+    const uint64_t discardBeforeSector = gCdPlayer.discardBeforeSector.load(std::memory_order_relaxed);
+    return (std::max(numFramesRead, discardBeforeSector * CDDA_SECTOR_FRAMES) >= numSectorsWritten * CDDA_SECTOR_FRAMES);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells if CD audio is actively playing, including any streamed audio that is still to be played after reaching the end of the track.
+// The CD player must be locked when calling this.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool isCdAudioPlaying() noexcept {
     if ((!gCdPlayer.bPlay) || (!gCdPlayer.discReader.isTrackOpen()))
-        return Spu::StereoSample{ 0, 0 };
+        return false;
 
-    // Check if we have any data left in the buffer firstly
-    constexpr int16_t SAMPLE_SIZE = sizeof(int16_t);
-    constexpr int32_t NUM_BUFFER_SAMPLES = sizeof(gCdPlayer.buffer) / SAMPLE_SIZE;
-    static_assert(NUM_BUFFER_SAMPLES % 2 == 0);
+    return ((!gCdPlayer.bReachedEnd) || (!isStreamedCdAudioFinished()));
+}
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Read the next sector of CD audio into the stream ring buffer, if there is space and there is audio left to read.
+// Handles looping back around when the end of the track is reached. Returns 'true' if a sector was read.
+// The CD player must be locked when calling this.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool streamCdAudioSector() noexcept {
     DiscReader& disc = gCdPlayer.discReader;
 
-    if (gCdPlayer.bufferOffset >= NUM_BUFFER_SAMPLES) {
-        // Get the size of the track and were we are at in it
-        const DiscTrack* const pTrack = disc.getOpenTrack();
-        const int32_t trackSize = pTrack->trackPayloadSize;
-        int32_t trackOffset = disc.tell();
-
-        // See if there is any data left in the track to read
-        if (trackOffset >= trackSize) {
-            // We reached the end, do we loop back around again?
-            if (gCdPlayer.bLoop) {
-                // Looping: rewind back to the start plus any additional offset.
-                // Change tracks also if we need to.
-                if (disc.getTrackNum() != gCdPlayer.loopTrack) {
-                    disc.setTrackNum(gCdPlayer.loopTrack);
-                }
-
-                if (gCdPlayer.loopSectorOffset > 0) {
-                    disc.trackSeekAbs(CDDA_SECTOR_SIZE * gCdPlayer.loopSectorOffset);
-                } else {
-                    disc.trackSeekAbs(0);
-                }
-
-                trackOffset = disc.tell();
+    if ((!disc.isTrackOpen()) || gCdPlayer.bReachedEnd)
+        return false;
+
+    // Is there space in the ring buffer? Note that sectors before the discard point are free, even if the audio thread hasn't skipped them yet.
+    const uint64_t numSectorsWritten = gCdPlayer.numSectorsWritten.load(std::memory_order_relaxed);
+    const uint64_t numSectorsRead = std::max(
+        gCdPlayer.numFramesRead.load(std::memory_order_acquire) / CDDA_SECTOR_FRAMES,
+        gCdPlayer.discardBeforeSector.load(std::memory_order_relaxed)
+    );
+
+    if (numSectorsWritten - numSectorsRead >= CDDA_STREAM_SECTORS)
+        return false;
+
+    // Get the size of the track and were we are at in it
+    const DiscTrack* const pTrack = disc.getOpenTrack();
+    const int32_t trackSize = pTrack->trackPayloadSize;
+    int32_t trackOffset = disc.tell();
+
+    // See if there is any data left in the track to read
+    if (trackOffset >= trackSize) {
+        // We reached the end, do we loop back around again?
+        if (gCdPlayer.bLoop) {
+            // Looping: rewind back to the start plus any additional offset.
+            // Change tracks also if we need to.
+            if (disc.getTrackNum() != gCdPlayer.loopTrack) {
+                disc.setTrackNum(gCdPlayer.loopTrack);
             }
-            else {
-                // No looping, mark the CD player as no longer playing and return an empty sample
-                gCdPlayer.bPlay = false;
-                return Spu::StereoSample{ 0, 0 };
+
+            if (gCdPlayer.loopSectorOffset > 0) {
+                disc.trackSeekAbs(CDDA_SECTOR_SIZE * gCdPlayer.loopSectorOffset);
+            } else {
+                disc.trackSeekAbs(0);
             }
+
+            trackOffset = disc.tell();
         }
+        else {
+            // No looping, don't stream any more audio.
+            // Playback stops once the audio thread has played everything that was streamed.
+            gCdPlayer.bReachedEnd = true;
+            return false;
+        }
+    }
+
+    // Read what we can and zero anything we can't (in case the last sector is short for some reason)
+    constexpr int16_t SAMPLE_SIZE = sizeof(int16_t);
+    constexpr int32_t NUM_SECTOR_SAMPLES = CDDA_SECTOR_SIZE / SAMPLE_SIZE;
+
+    const uint32_t ringIdx = (uint32_t)(numSectorsWritten % CDDA_STREAM_SECTORS);
+    int16_t* const pSamples = gCdPlayer.sectorSamples[ringIdx];
 
-        // Read what we can and zero anything we can't (in case the last sector is short for some reason)
-        const int32_t samplesToRead = std::min<int32_t>((trackSize - trackOffset) / SAMPLE_SIZE, NUM_BUFFER_SAMPLES);
-        const int32_t samplesToZero = NUM_BUFFER_SAMPLES - samplesToRead;
-        disc.read(gCdPlayer.buffer, samplesToRead * SAMPLE_SIZE);
+    const int32_t samplesToRead = std::min<int32_t>((trackSize - trackOffset) / SAMPLE_SIZE, NUM_SECTOR_SAMPLES);
+    const int32_t samplesToZero = NUM_SECTOR_SAMPLES - samplesToRead;
+    disc.read(pSamples, samplesToRead * SAMPLE_SIZE);
 
-        if (samplesToZero > 0) {
-            std::memset(gCdPlayer.buffer + samplesToRead * SAMPLE_SIZE, 0, samplesToZero * SAMPLE_SIZE);
+    if (samplesToZero > 0) {
+        std::memset(pSamples + samplesToRead, 0, samplesToZero * SAMPLE_SIZE);
+    }
+
+    // Make the sector available to the audio thread
+    gCdPlayer.sectorPlayIds[ringIdx] = gCdPlayer.playId;
+    gCdPlayer.sectorEndOffsets[ringIdx] = disc.tell();
+    gCdPlayer.numSectorsWritten.store(numSectorsWritten + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Entry point for the CD audio streaming thread: keeps reading sectors ahead of playback until told to quit
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void cdStreamerThreadMain() noexcept {
+    std::unique_lock<std::recursive_mutex> cdPlayerLock(gCdPlayerMutex);
+
+    while (!gCdStreamer.bQuit) {
+        // Read a sector at a time, letting the main thread in to change the CD player state in between.
+        // If there is nothing to read then wait until woken or until it's time to check if the audio thread has made some room.
+        if (streamCdAudioSector()) {
+            cdPlayerLock.unlock();
+            cdPlayerLock.lock();
+        } else {
+            gCdStreamerWakeup.wait_for(cdPlayerLock, CDDA_STREAM_POLL_INTERVAL);
         }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A callback invoked by the SPU when it wants audio from the CD player - returns a single sample.
+// PsyDoom: this just pulls audio from the ring buffer filled by the streaming thread and never blocks.
+// If the streaming thread has fallen behind then silence is returned.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static Spu::StereoSample SpuAudioCallback([[maybe_unused]] void* pUserData) noexcept {
+    // If the CD player is not currently active then return silence
+    if (!gCdPlayer.bPlay.load(std::memory_order_relaxed))
+        return Spu::StereoSample{ 0, 0 };
+
+    // Skip past any audio which has been discarded
+    uint64_t frameIdx = gCdPlayer.numFramesRead.load(std::memory_order_relaxed);
+    const uint64_t firstFrameIdx = gCdPlayer.discardBeforeSector.load(std::memory_order_acquire) * CDDA_SECTOR_FRAMES;
 
-        gCdPlayer.bufferOffset = 0;
+    if (frameIdx < firstFrameIdx) {
+        frameIdx = firstFrameIdx;
+        gCdPlayer.numFramesRead.store(frameIdx, std::memory_order_release);
     }
 
-    // Should have samples in the buffer at this point, return the requested samples
-    ASSERT(gCdPlayer.bufferOffset + 2 <= NUM_BUFFER_SAMPLES);
+    // Is there any audio available?
+    const uint64_t sectorIdx = frameIdx / CDDA_SECTOR_FRAMES;
+
+    if (sectorIdx >= gCdPlayer.numSectorsWritten.load(std::memory_order_acquire))
+        return Spu::StereoSample{ 0, 0 };
+
+    // Make a note of where we are in the track when starting a new sector
+    const uint32_t ringIdx = (uint32_t)(sectorIdx % CDDA_STREAM_SECTORS);
+    const uint32_t sectorFrameIdx = (uint32_t)(frameIdx % CDDA_SECTOR_FRAMES);
 
-    Spu::StereoSample sample = { gCdPlayer.buffer[gCdPlayer.bufferOffset], gCdPlayer.buffer[gCdPlayer.bufferOffset + 1] };
-    gCdPlayer.bufferOffset += 2;
+    if (sectorFrameIdx == 0) {
+        const uint64_t playbackPos = ((uint64_t) gCdPlayer.sectorPlayIds[ringIdx] << 32) | (uint32_t) gCdPlayer.sectorEndOffsets[ringIdx];
+        gCdPlayer.playbackPos.store(playbackPos, std::memory_order_relaxed);
+    }
+
+    // Return the sample and move along
+    const int16_t* const pSamples = gCdPlayer.sectorSamples[ringIdx] + sectorFrameIdx * 2;
+    const Spu::StereoSample sample = { pSamples[0], pSamples[1] };
+    gCdPlayer.numFramesRead.store(frameIdx + 1, std::memory_order_release);
     return sample;
 }
 
@@ -146,6 +294,12 @@ void psxcd_init() noexcept {
         PsxVm::gSpu.pExtInputCallback = SpuAudioCallback;
         PsxVm::gSpu.pExtInputUserData = nullptr;
     }
+
+    // Start the thread which streams CD audio
+    if (!gCdStreamer.thread.joinable()) {
+        gCdStreamer.bQuit = false;
+        gCdStreamer.thread = std::thread(cdStreamerThreadMain);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -158,6 +312,17 @@ void psxcd_exit() noexcept {
         PsxVm::gSpu.pExtInputCallback = nullptr;
         PsxVm::gSpu.pExtInputUserData = nullptr;
     }
+
+    // Stop the thread which streams CD audio
+    if (gCdStreamer.thread.joinable()) {
+        {
+            LockCdPlayer cdPlayerLock;
+            gCdStreamer.bQuit = true;
+        }
+
+        gCdStreamerWakeup.notify_all();
+        gCdStreamer.thread.join();
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -343,6 +508,7 @@ static void psxcd_play_internal(
         LockCdPlayer cdPlayerLock;
         gCdPlayer.bPlay = false;
         setTrackOk = gCdPlayer.discReader.setTrackNum(track);
+        discardStreamedCdAudio();
     }
 
     if (!setTrackOk) {
@@ -370,13 +536,18 @@ static void psxcd_play_internal(
             gCdPlayer.discReader.trackSeekAbs(CDDA_SECTOR_SIZE * sectorOffset);
         }
 
-        // Mark the player as playing and save loop parameters
+        // Mark the player as playing and save loop parameters.
+        // Also discard anything streamed before the seek and start streaming the new audio.
+        discardStreamedCdAudio();
+        gCdPlayer.playId++;
         gCdPlayer.bPlay = true;
-        gCdPlayer.bufferOffset = CDDA_SECTOR_SIZE / sizeof(int16_t);    // Need to read a sector
+        gCdPlayer.bReachedEnd = false;
         gCdPlayer.bLoop = bLoop;
         gCdPlayer.loopTrack = loopTrack;
         gCdPlayer.loopSectorOffset = loopSectorOffset;
     }
+
+    gCdStreamerWakeup.notify_all();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -436,7 +607,7 @@ void psxcd_stop() noexcept {
     {
         // N.B: don't hold this lock in the main thread at the same time as the SPU lock - otherwise deadlock might occur!
         LockCdPlayer cdPlayerLock;
-        bMightNeedFade = (gCdPlayer.discReader.isTrackOpen() && gCdPlayer.bPlay);
+        bMightNeedFade = isCdAudioPlaying();
     }
 
     if (bMightNeedFade) {
@@ -456,8 +627,10 @@ void psxcd_stop() noexcept {
         gCdPlayer.discReader.closeTrack();
         gCdPlayer.bPlay = false;
         gCdPlayer.bLoop = false;
-        gCdPlayer.bufferOffset = 0;
+        gCdPlayer.bReachedEnd = false;
         gCdPlayer.loopSectorOffset = 0;
+        gCdPlayer.playId++;
+        discardStreamedCdAudio();
     }
 }
 
@@ -471,7 +644,7 @@ void psxcd_pause() noexcept {
     {
         // N.B: don't hold this lock in the main thread at the same time as the SPU lock - otherwise deadlock might occur!
         LockCdPlayer cdPlayerLock;
-        bMightNeedFade = (gCdPlayer.discReader.isTrackOpen() && gCdPlayer.bPlay);
+        bMightNeedFade = isCdAudioPlaying();
     }
 
     if (bMightNeedFade) {
@@ -507,6 +680,8 @@ void psxcd_restart(const int32_t vol) noexcept {
         gCdPlayer.bPlay = true;
     }
 
+    gCdStreamerWakeup.notify_all();
+
     // Set the audio volume
     psxspu_set_cd_vol(vol);
 }
@@ -516,8 +691,17 @@ void psxcd_restart(const int32_t vol) noexcept {
 //------------------------------------------------------------------------------------------------------------------------------------------
 int32_t psxcd_elapsed_sectors() noexcept {
     // N.B: don't hold this lock in the main thread at the same time as the SPU lock - otherwise deadlock might occur!
+    // PsyDoom: this is now based on what the audio thread is playing rather than what has been read from disc, since reading is done ahead
+    // of time. Ignore the playback position if it's from a previous play of a track.
     LockCdPlayer cdPlayerLock;
-    return (gCdPlayer.discReader.isTrackOpen()) ? gCdPlayer.discReader.tell() / CDDA_SECTOR_SIZE : 0;
+
+    if (!gCdPlayer.discReader.isTrackOpen())
+        return 0;
+
+    const uint64_t playbackPos = gCdPlayer.playbackPos.load(std::memory_order_relaxed);
+    const uint32_t playId = (uint32_t)(playbackPos >> 32);
+    const int32_t trackOffset = (int32_t)(uint32_t) playbackPos;
+    return (playId == gCdPlayer.playId) ? trackOffset / CDDA_SECTOR_SIZE : 0;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -530,3 +714,21 @@ int32_t psxcd_get_file_size(const CdFileId discFile) noexcept {
 
     return gCdMapTbl[(int32_t) discFile].size;
 }
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// PsyDoom: hint that the given file will be read soon, so that it can be loaded into the disc sector cache on a background thread.
+// Does nothing if the file is overriden by a mod, is not on the disc or if the sector cache is disabled.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void psxcd_prefetch(const CdFileId discFile) noexcept {
+    if (((int32_t) discFile < 0) || (discFile >= CdFileId::END))
+        return;
+
+    if (ModMgr::areOverridesAvailableForFile(discFile))
+        return;
+
+    const PsxCd_MapTblEntry& fileTableEntry = gCdMapTbl[(uint32_t) discFile];
+
+    if (fileTableEntry.startSector != 0) {
+        DiscSectorCache::prefetch(PsxVm::gDiscInfo, 1, fileTableEntry.startSector * CDROM_SECTOR_SIZE, fileTableEntry.size);
+    }
+}
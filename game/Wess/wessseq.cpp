@@ -5,6 +5,7 @@
 #include "wessseq.h"
 
 #include "Macros.h"
+#include "PcPsx/Profiler.h"
 #include "wessapi.h"
 
 #include <algorithm>
@@ -807,6 +808,8 @@ void Eng_NullEvent([[maybe_unused]] track_status& trackStat) noexcept {
 // Originally this was driven via interrupts coming from the PlayStation's hardware timers.
 //------------------------------------------------------------------------------------------------------------------------------------------
 void SeqEngine() noexcept {
+    PROFILE_SCOPE("SeqEngine");
+
     // PsyDoom: this can now be invoked at any time rather than at fixed 120 Hz intervals, so the delta time which can pass is variable.
     // Compute the fractional number of 120Hz ticks/interrupts elapsed here:
     #if PSYDOOM_MODS
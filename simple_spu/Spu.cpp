@@ -2,8 +2,39 @@
 
 #include "Asserts.h"
 
+#include <cstring>
+
+// Use SIMD for mixing if available.
+// Defining 'SIMPLE_SPU_NO_SIMD' forces the plain C++ code to be used, which is useful for checking the SIMD code produces the same output.
+#if !defined(SIMPLE_SPU_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define SIMPLE_SPU_USE_SSE2 1
+        #include <emmintrin.h>
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #define SIMPLE_SPU_USE_NEON 1
+        #include <arm_neon.h>
+    #endif
+#endif
+
 using namespace Spu;
 
+// The maximum number of samples mixed at a time by 'stepCoreBlock'; longer requests are split up into blocks of this size.
+// This bounds the size of the temporary mix buffers on the stack.
+static constexpr uint32_t MAX_MIX_BLOCK_SIZE = 256;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Holds the dry and to be reverberated output of all voices for a block of samples.
+// Left and right channels are stored in separate arrays so that voices can be accumulated into them in simple, vectorizable loops.
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct MixBlock {
+    int16_t dryL[MAX_MIX_BLOCK_SIZE];
+    int16_t dryR[MAX_MIX_BLOCK_SIZE];
+    int16_t reverbL[MAX_MIX_BLOCK_SIZE];
+    int16_t reverbR[MAX_MIX_BLOCK_SIZE];
+    int16_t reverbOutL[MAX_MIX_BLOCK_SIZE];     // Processed reverb to add to the final mix, for each sample
+    int16_t reverbOutR[MAX_MIX_BLOCK_SIZE];
+};
+
 // A series of co-efficients used by the SPU's gaussian sample interpolation.
 // For more details on this see: https://problemkaputt.de/psx-spx.htm#cdromxaaudioadpcmcompression
 static constexpr int32_t INTERP_GAUSS_TABLE[512] = {
@@ -209,20 +240,21 @@ static EnvPhaseParams getEnvPhaseParams(const AdsrEnvelope env, const EnvPhase p
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Step the ADSR envelope for the given voice
+// Step an ADSR envelope with the given settings, phase, level and wait cycle count.
+// These are passed in separately so that block processing can keep them in local variables.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static void stepVoiceEnvelope(Voice& voice) noexcept {
+static inline void stepEnvelope(const AdsrEnvelope env, EnvPhase& envPhase, int16_t& envLevel, int32_t& envWaitCycles) noexcept {
     // Don't process the envelope if we must wait a few more cycles
-    if (voice.envWaitCycles > 0) {
-        voice.envWaitCycles--;
+    if (envWaitCycles > 0) {
+        envWaitCycles--;
 
-        if (voice.envWaitCycles > 0)
+        if (envWaitCycles > 0)
             return;
     }
 
     // Step the envelope in it's current phase and compute the new envelope level
-    const EnvPhaseParams envParams = getEnvPhaseParams(voice.env, voice.envPhase, voice.envLevel);
-    int32_t newEnvLevel = std::clamp<int32_t>(voice.envLevel + envParams.step, MIN_ENV_LEVEL, MAX_ENV_LEVEL);
+    const EnvPhaseParams envParams = getEnvPhaseParams(env, envPhase, envLevel);
+    int32_t newEnvLevel = std::clamp<int32_t>(envLevel + envParams.step, MIN_ENV_LEVEL, MAX_ENV_LEVEL);
 
     // Do state transitions when ramping up or down, unless we're in the 'sustain' phase (targetLevel < 0)
     bool bReachedTargetLevel = false;
@@ -237,42 +269,38 @@ static void stepVoiceEnvelope(Voice& voice) noexcept {
 
     if (bReachedTargetLevel) {
         newEnvLevel = envParams.targetLevel;
-        voice.envPhase = getNextEnvPhase(voice.envPhase);
-        voice.envWaitCycles = 0;
+        envPhase = getNextEnvPhase(envPhase);
+        envWaitCycles = 0;
     } else {
-        voice.envWaitCycles = envParams.stepCycles;
+        envWaitCycles = envParams.stepCycles;
     }
     
-    voice.envLevel = (int16_t) newEnvLevel;
+    envLevel = (int16_t) newEnvLevel;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Get a requested sample from the voice's sample buffer.
-// Returns a zeroed sample if the sample buffer has not been filled or if the index is out of range.
+// Step the ADSR envelope for the given voice
 //------------------------------------------------------------------------------------------------------------------------------------------
-static Sample getVoiceSample(const Voice& voice, const uint32_t index) noexcept {
-    if (voice.bSamplesLoaded) {
-        if (index < Voice::SAMPLE_BUFFER_SIZE) {
-            return voice.samples[index];
-        }
-    }
-
-    return 0;
+static void stepVoiceEnvelope(Voice& voice) noexcept {
+    stepEnvelope(voice.env, voice.envPhase, voice.envLevel, voice.envWaitCycles);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Get the current (interpolated) sample for the given voice
+// Get the interpolated sample at the given position in a voice's sample buffer.
+// Note: the sample buffer must be loaded and the sample index must be within the current ADPCM block.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static Sample getInterpolatedVoiceSample(const Voice& voice) noexcept {
+static inline Sample interpolateVoiceSample(const int16_t samples[Voice::SAMPLE_BUFFER_SIZE], const AdpcmBlockPos blockPos) noexcept {
     // What sample and interpolation index should we use?
-    const int32_t curSampleIdx  = (int32_t) voice.adpcmBlockPos.fields.sampleIdx;
-    const int32_t gaussTableIdx = (int32_t)(uint8_t) voice.adpcmBlockPos.fields.gaussIdx;
+    const int32_t curSampleIdx  = (int32_t) blockPos.fields.sampleIdx;
+    const int32_t gaussTableIdx = (int32_t)(uint8_t) blockPos.fields.gaussIdx;
+
+    ASSERT(curSampleIdx < ADPCM_BLOCK_NUM_SAMPLES);
 
     // Get the most recent sample and previous 3 samples
-    const int32_t samp1 = getVoiceSample(voice, Voice::NUM_PREV_SAMPLES + curSampleIdx - 3);
-    const int32_t samp2 = getVoiceSample(voice, Voice::NUM_PREV_SAMPLES + curSampleIdx - 2);
-    const int32_t samp3 = getVoiceSample(voice, Voice::NUM_PREV_SAMPLES + curSampleIdx - 1);
-    const int32_t samp4 = getVoiceSample(voice, Voice::NUM_PREV_SAMPLES + curSampleIdx    );
+    const int32_t samp1 = samples[Voice::NUM_PREV_SAMPLES + curSampleIdx - 3];
+    const int32_t samp2 = samples[Voice::NUM_PREV_SAMPLES + curSampleIdx - 2];
+    const int32_t samp3 = samples[Voice::NUM_PREV_SAMPLES + curSampleIdx - 1];
+    const int32_t samp4 = samples[Voice::NUM_PREV_SAMPLES + curSampleIdx    ];
 
     // Sanity check...
     static_assert(-1 >> 1 == -1, "Right shift on signed types must be an arithmetic shift!");
@@ -299,19 +327,231 @@ static Sample getInterpolatedVoiceSample(const Voice& voice) noexcept {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Process/update a single voice and return it's output and output to be reverberated
+// Get the current (interpolated) sample for the given voice
 //------------------------------------------------------------------------------------------------------------------------------------------
-static void stepVoice(
-    Voice& voice,
-    const std::byte* pRam,
-    const uint32_t ramSize,
-    StereoSample& output,
-    StereoSample& outputToReverb
+static Sample getInterpolatedVoiceSample(const Voice& voice) noexcept {
+    ASSERT(voice.bSamplesLoaded);
+    return interpolateVoiceSample(voice.samples, voice.adpcmBlockPos);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// SIMD helpers: do a saturated add or a volume attenuation (see 'sampleAdd' and 'sampleAttenuate') for 8 samples at a time.
+// The attenuation keeps the lower 16-bits of '(sample * volume) >> 15' just like the scalar version does, so the results are identical.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#if SIMPLE_SPU_USE_SSE2
+    static inline __m128i simdSampleAdd(const __m128i samples1, const __m128i samples2) noexcept {
+        return _mm_adds_epi16(samples1, samples2);
+    }
+
+    static inline __m128i simdSampleAttenuate(const __m128i samples, const __m128i volumes) noexcept {
+        const __m128i productLo = _mm_mullo_epi16(samples, volumes);
+        const __m128i productHi = _mm_mulhi_epi16(samples, volumes);
+        return _mm_or_si128(_mm_slli_epi16(productHi, 1), _mm_srli_epi16(productLo, 15));
+    }
+#elif SIMPLE_SPU_USE_NEON
+    static inline int16x8_t simdSampleAdd(const int16x8_t samples1, const int16x8_t samples2) noexcept {
+        return vqaddq_s16(samples1, samples2);
+    }
+
+    static inline int16x8_t simdSampleAttenuate(const int16x8_t samples, const int16x8_t volumes) noexcept {
+        const int32x4_t productLo = vmull_s16(vget_low_s16(samples), vget_low_s16(volumes));
+        const int32x4_t productHi = vmull_s16(vget_high_s16(samples), vget_high_s16(volumes));
+        return vcombine_s16(vshrn_n_s32(productLo, 15), vshrn_n_s32(productHi, 15));
+    }
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Attenuate the given samples by a fixed volume and add them to the given output samples
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void attenuateAndAccumulate(int16_t* pDst, const int16_t* pSrc, const int16_t volume, const uint32_t numSamples) noexcept {
+    const int16_t* const pSrcEnd = pSrc + numSamples;
+
+    #if SIMPLE_SPU_USE_SSE2
+        const __m128i volumes = _mm_set1_epi16(volume);
+
+        for (; pSrc + 8 <= pSrcEnd; pSrc += 8, pDst += 8) {
+            const __m128i samples = simdSampleAttenuate(_mm_loadu_si128((const __m128i*) pSrc), volumes);
+            _mm_storeu_si128((__m128i*) pDst, simdSampleAdd(_mm_loadu_si128((const __m128i*) pDst), samples));
+        }
+    #elif SIMPLE_SPU_USE_NEON
+        const int16x8_t volumes = vdupq_n_s16(volume);
+
+        for (; pSrc + 8 <= pSrcEnd; pSrc += 8, pDst += 8) {
+            const int16x8_t samples = simdSampleAttenuate(vld1q_s16(pSrc), volumes);
+            vst1q_s16(pDst, simdSampleAdd(vld1q_s16(pDst), samples));
+        }
+    #endif
+
+    // Do the remaining samples (or all samples, if there is no SIMD support)
+    for (; pSrc < pSrcEnd; ++pSrc, ++pDst) {
+        *pDst = sampleAdd(*pDst, sampleAttenuate(*pSrc, volume));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Attenuate the given samples by a volume level for each sample
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void attenuateSamples(int16_t* pDst, const int16_t* pSrc, const int16_t* pVolumes, const uint32_t numSamples) noexcept {
+    const int16_t* const pSrcEnd = pSrc + numSamples;
+
+    #if SIMPLE_SPU_USE_SSE2
+        for (; pSrc + 8 <= pSrcEnd; pSrc += 8, pDst += 8, pVolumes += 8) {
+            const __m128i samples = _mm_loadu_si128((const __m128i*) pSrc);
+            const __m128i volumes = _mm_loadu_si128((const __m128i*) pVolumes);
+            _mm_storeu_si128((__m128i*) pDst, simdSampleAttenuate(samples, volumes));
+        }
+    #elif SIMPLE_SPU_USE_NEON
+        for (; pSrc + 8 <= pSrcEnd; pSrc += 8, pDst += 8, pVolumes += 8) {
+            vst1q_s16(pDst, simdSampleAttenuate(vld1q_s16(pSrc), vld1q_s16(pVolumes)));
+        }
+    #endif
+
+    for (; pSrc < pSrcEnd; ++pSrc, ++pDst, ++pVolumes) {
+        *pDst = sampleAttenuate(*pSrc, *pVolumes);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Adds together dry and reverb samples and attenuates the result by the given (master) volume
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void addAndAttenuate(
+    int16_t* pDst,
+    const int16_t* pSrc1,
+    const int16_t* pSrc2,
+    const int16_t volume,
+    const uint32_t numSamples
 ) noexcept {
-    // Nothing to do if the voice is switched off
-    if (voice.envPhase == EnvPhase::Off)
-        return;
+    const int16_t* const pSrc1End = pSrc1 + numSamples;
+
+    #if SIMPLE_SPU_USE_SSE2
+        const __m128i volumes = _mm_set1_epi16(volume);
+
+        for (; pSrc1 + 8 <= pSrc1End; pSrc1 += 8, pSrc2 += 8, pDst += 8) {
+            const __m128i samples = simdSampleAdd(_mm_loadu_si128((const __m128i*) pSrc1), _mm_loadu_si128((const __m128i*) pSrc2));
+            _mm_storeu_si128((__m128i*) pDst, simdSampleAttenuate(samples, volumes));
+        }
+    #elif SIMPLE_SPU_USE_NEON
+        const int16x8_t volumes = vdupq_n_s16(volume);
+
+        for (; pSrc1 + 8 <= pSrc1End; pSrc1 += 8, pSrc2 += 8, pDst += 8) {
+            vst1q_s16(pDst, simdSampleAttenuate(simdSampleAdd(vld1q_s16(pSrc1), vld1q_s16(pSrc2)), volumes));
+        }
+    #endif
 
+    for (; pSrc1 < pSrc1End; ++pSrc1, ++pSrc2, ++pDst) {
+        *pDst = sampleAttenuate(sampleAdd(*pSrc1, *pSrc2), volume);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interleave separate left and right channel samples into stereo samples
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void interleaveStereo(StereoSample* pDst, const int16_t* pSrcL, const int16_t* pSrcR, const uint32_t numSamples) noexcept {
+    static_assert(sizeof(StereoSample) == sizeof(int16_t) * 2);
+    const int16_t* const pSrcLEnd = pSrcL + numSamples;
+
+    #if SIMPLE_SPU_USE_SSE2
+        for (; pSrcL + 8 <= pSrcLEnd; pSrcL += 8, pSrcR += 8, pDst += 8) {
+            const __m128i samplesL = _mm_loadu_si128((const __m128i*) pSrcL);
+            const __m128i samplesR = _mm_loadu_si128((const __m128i*) pSrcR);
+            _mm_storeu_si128((__m128i*)(pDst + 0), _mm_unpacklo_epi16(samplesL, samplesR));
+            _mm_storeu_si128((__m128i*)(pDst + 4), _mm_unpackhi_epi16(samplesL, samplesR));
+        }
+    #elif SIMPLE_SPU_USE_NEON
+        for (; pSrcL + 8 <= pSrcLEnd; pSrcL += 8, pSrcR += 8, pDst += 8) {
+            int16x8x2_t samples;
+            samples.val[0] = vld1q_s16(pSrcL);
+            samples.val[1] = vld1q_s16(pSrcR);
+            vst2q_s16((int16_t*) pDst, samples);
+        }
+    #endif
+
+    for (; pSrcL < pSrcLEnd; ++pSrcL, ++pSrcR, ++pDst) {
+        *pDst = StereoSample{ *pSrcL, *pSrcR };
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Get interpolated samples from a voice's sample buffer starting at the given position and advancing by the given sample rate each time.
+// All of the sample positions must be within the current ADPCM block.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void interpolateVoiceSamples(
+    int16_t* pDst,
+    const int16_t samples[Voice::SAMPLE_BUFFER_SIZE],
+    AdpcmBlockPos blockPos,
+    const uint32_t sampleRate,
+    const uint32_t numSamples
+) noexcept {
+    const int16_t* const pDstEnd = pDst + numSamples;
+
+    #if SIMPLE_SPU_USE_SSE2 || SIMPLE_SPU_USE_NEON
+        // Do 4 samples at a time: gather the 4 input samples and gauss factors for each output sample, then do the filter in parallel.
+        // Note that each product is shifted before summing and the sum is truncated to 16-bits, same as in 'interpolateVoiceSample'.
+        for (; pDst + 4 <= pDstEnd; pDst += 4) {
+            static_assert(Voice::NUM_PREV_SAMPLES == 3);
+            int16_t tapSamples[4][4];
+            int16_t tapFactors[4][4];
+
+            for (int32_t i = 0; i < 4; ++i) {
+                const int32_t curSampleIdx = (int32_t) blockPos.fields.sampleIdx;
+                const int32_t gaussTableIdx = (int32_t)(uint8_t) blockPos.fields.gaussIdx;
+                ASSERT(curSampleIdx < ADPCM_BLOCK_NUM_SAMPLES);
+
+                for (int32_t tap = 0; tap < 4; ++tap) {
+                    tapSamples[tap][i] = samples[curSampleIdx + tap];
+                }
+
+                tapFactors[0][i] = (int16_t) INTERP_GAUSS_TABLE[(255 - gaussTableIdx) & 0x1FF];
+                tapFactors[1][i] = (int16_t) INTERP_GAUSS_TABLE[(511 - gaussTableIdx) & 0x1FF];
+                tapFactors[2][i] = (int16_t) INTERP_GAUSS_TABLE[(256 + gaussTableIdx) & 0x1FF];
+                tapFactors[3][i] = (int16_t) INTERP_GAUSS_TABLE[(      gaussTableIdx) & 0x1FF];
+                blockPos.counter += sampleRate;
+            }
+
+            #if SIMPLE_SPU_USE_SSE2
+                // Two taps per register: multiply to get the full 32-bit products, then shift and sum them
+                const auto tapPairProducts = [&](const int32_t tap, __m128i& products1, __m128i& products2) noexcept {
+                    const __m128i samp = _mm_loadu_si128((const __m128i*) tapSamples[tap]);
+                    const __m128i factor = _mm_loadu_si128((const __m128i*) tapFactors[tap]);
+                    const __m128i productLo = _mm_mullo_epi16(samp, factor);
+                    const __m128i productHi = _mm_mulhi_epi16(samp, factor);
+                    products1 = _mm_srai_epi32(_mm_unpacklo_epi16(productLo, productHi), 15);
+                    products2 = _mm_srai_epi32(_mm_unpackhi_epi16(productLo, productHi), 15);
+                };
+
+                __m128i sampMix1, sampMix2, sampMix3, sampMix4;
+                tapPairProducts(0, sampMix1, sampMix2);
+                tapPairProducts(2, sampMix3, sampMix4);
+
+                // Sum and truncate to 16-bits: sign extend the lower 16-bits so the saturating pack does not change anything
+                __m128i sum = _mm_add_epi32(_mm_add_epi32(sampMix1, sampMix2), _mm_add_epi32(sampMix3, sampMix4));
+                sum = _mm_srai_epi32(_mm_slli_epi32(sum, 16), 16);
+                _mm_storel_epi64((__m128i*) pDst, _mm_packs_epi32(sum, sum));
+            #else
+                int32x4_t sum = vdupq_n_s32(0);
+
+                for (int32_t tap = 0; tap < 4; ++tap) {
+                    const int32x4_t products = vmull_s16(vld1_s16(tapSamples[tap]), vld1_s16(tapFactors[tap]));
+                    sum = vaddq_s32(sum, vshrq_n_s32(products, 15));
+                }
+
+                vst1_s16(pDst, vmovn_s32(sum));
+            #endif
+        }
+    #endif
+
+    // Do the remaining samples (or all samples, if there is no SIMD support)
+    for (; pDst < pDstEnd; ++pDst) {
+        *pDst = interpolateVoiceSample(samples, blockPos);
+        blockPos.counter += sampleRate;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Process/update a single voice for 1 sample.
+// If requested, returns the interpolated sample for the voice scaled by the current envelope level (before voice volume is applied).
+//------------------------------------------------------------------------------------------------------------------------------------------
+static Sample stepVoice(Voice& voice, const std::byte* pRam, const uint32_t ramSize, const bool bGetOutput) noexcept {
     // Read and decode the next ADPCM block if it is time.
     // Note that if we read in a new block then we'll have to handle the ADPCM flags at the end.
     std::byte adpcmBlock[ADPCM_BLOCK_SIZE];
@@ -328,25 +568,12 @@ static void stepVoice(
     // Process the ADSR envelope for the voice
     stepVoiceEnvelope(voice);
 
-    // Get the interpolated sample for the voice, attenuate by the volume envelope and voice volume, and add to the output.
-    // Only bother doing this however if the voice is actually turned on.
-    if (!voice.bDisabled) {
-        const Sample rawSample = getInterpolatedVoiceSample(voice);
-        const Sample sampleEnvScaled = rawSample * voice.envLevel;
-        const int16_t realVoiceVolL = (int16_t) std::clamp((int32_t) voice.volume.left * 2, INT16_MIN, +INT16_MAX);     // N.B: voice volume was divided by 2
-        const int16_t realVoiceVolR = (int16_t) std::clamp((int32_t) voice.volume.right * 2, INT16_MIN, +INT16_MAX);
-
-        const StereoSample sampleVolScaled = {
-            sampleEnvScaled * realVoiceVolL,
-            sampleEnvScaled * realVoiceVolR
-        };
-        
-        output += sampleVolScaled;
+    // Get the interpolated sample for the voice and attenuate by the volume envelope, if the output is wanted
+    Sample sampleEnvScaled = 0;
 
-        // Only include in the output to reverberate if reverb is enabled for the voice
-        if (voice.bDoReverb) {
-            outputToReverb += sampleVolScaled;
-        }
+    if (bGetOutput) {
+        const Sample rawSample = getInterpolatedVoiceSample(voice);
+        sampleEnvScaled = rawSample * voice.envLevel;
     }
 
     // Advance the position of the voice within the current sample block.
@@ -389,23 +616,135 @@ static void stepVoice(
             }
         }
     }
+
+    return sampleEnvScaled;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Process/update all voices and get 1 sample of output from them
+// Process/update a single voice for a block of samples and accumulate it's output into the given mix block.
+//
+// The voice is run for the whole block first and then it's output is scaled by the voice volume and added to the mix in one go.
+// Since each voice is added to the mix in the same order as before for every sample, the result is identical to stepping voice by voice,
+// sample by sample. Voice volume and other settings can only change in between blocks so they are constant for this whole process.
 //------------------------------------------------------------------------------------------------------------------------------------------
-static void stepVoices(
+static void stepVoiceBlock(
+    Voice& voice,
+    const std::byte* pRam,
+    const uint32_t ramSize,
+    const uint32_t numSamples,
+    MixBlock& mix
+) noexcept {
+    ASSERT(numSamples <= MAX_MIX_BLOCK_SIZE);
+
+    // Nothing to do if the voice is switched off
+    if (voice.envPhase == EnvPhase::Off)
+        return;
+
+    // Work out the real voice volume: if it's disabled or silent then we don't need to bother generating output, just advance the voice
+    const int16_t realVoiceVolL = (int16_t) std::clamp((int32_t) voice.volume.left * 2, INT16_MIN, +INT16_MAX);     // N.B: voice volume was divided by 2
+    const int16_t realVoiceVolR = (int16_t) std::clamp((int32_t) voice.volume.right * 2, INT16_MIN, +INT16_MAX);
+    const bool bGetOutput = ((!voice.bDisabled) && ((realVoiceVolL != 0) || (realVoiceVolR != 0)));
+
+    // Run the voice for the block, stopping early if it switches off.
+    // Once a voice is off it stays off and produces no more output until it's keyed on again, which can only happen in between blocks.
+    int16_t voiceSamples[MAX_MIX_BLOCK_SIZE];
+    uint32_t numVoiceSamples = 0;
+
+    while ((numVoiceSamples < numSamples) && (voice.envPhase != EnvPhase::Off)) {
+        // If we need to load a new ADPCM block then let the general (slower) single sample step handle that
+        if (!voice.bSamplesLoaded) {
+            voiceSamples[numVoiceSamples] = stepVoice(voice, pRam, ramSize, bGetOutput);
+            numVoiceSamples++;
+            continue;
+        }
+
+        // Otherwise step through the rest of the currently loaded ADPCM block, or as much of it as will fit in the output block.
+        // This does exactly the same thing as 'stepVoice' does for a voice that has it's samples loaded.
+        // Firstly, figure out how many samples we can get from the ADPCM block:
+        const uint32_t sampleRate = std::min<uint16_t>(voice.sampleRate, MAX_SAMPLE_RATE);
+        const uint32_t blockEndCounter = (uint32_t) ADPCM_BLOCK_NUM_SAMPLES << 12;
+        const uint32_t maxSamples = numSamples - numVoiceSamples;
+        uint32_t numSegmentSamples = maxSamples;
+
+        if (sampleRate > 0) {
+            const uint32_t numSamplesLeftInBlock = (blockEndCounter - voice.adpcmBlockPos.counter + sampleRate - 1) / sampleRate;
+            numSegmentSamples = std::min(numSamplesLeftInBlock, maxSamples);
+        }
+
+        // Step the envelope for those samples (with the envelope state in local variables), stopping if the voice switches off
+        int16_t envLevels[MAX_MIX_BLOCK_SIZE];
+        const AdsrEnvelope env = voice.env;
+        EnvPhase envPhase = voice.envPhase;
+        int16_t envLevel = voice.envLevel;
+        int32_t envWaitCycles = voice.envWaitCycles;
+
+        for (uint32_t i = 0; i < numSegmentSamples; ++i) {
+            stepEnvelope(env, envPhase, envLevel, envWaitCycles);
+            envLevels[i] = envLevel;
+
+            if (envPhase == EnvPhase::Off) {
+                numSegmentSamples = i + 1;
+                break;
+            }
+        }
+
+        voice.envPhase = envPhase;
+        voice.envLevel = envLevel;
+        voice.envWaitCycles = envWaitCycles;
+
+        // Get the interpolated samples and attenuate by the envelope, if we want the output
+        if (bGetOutput) {
+            int16_t* const pSegmentSamples = voiceSamples + numVoiceSamples;
+            interpolateVoiceSamples(pSegmentSamples, voice.samples, voice.adpcmBlockPos, sampleRate, numSegmentSamples);
+            attenuateSamples(pSegmentSamples, pSegmentSamples, envLevels, numSegmentSamples);
+        }
+
+        // Advance the position of the voice within the current sample block
+        voice.adpcmBlockPos.counter += sampleRate * numSegmentSamples;
+        numVoiceSamples += numSegmentSamples;
+
+        // Is it time to read another ADPCM block because we have consumed the current one?
+        if (voice.adpcmBlockPos.fields.sampleIdx >= ADPCM_BLOCK_NUM_SAMPLES) {
+            voice.adpcmBlockPos.fields.sampleIdx -= ADPCM_BLOCK_NUM_SAMPLES;
+            voice.adpcmCurAddr8 += ADPCM_BLOCK_SIZE / 8;
+            voice.bSamplesLoaded = false;
+
+            // Time to go to the loop address?
+            if (voice.bRepeat) {
+                voice.bRepeat = false;
+                voice.adpcmCurAddr8 = voice.adpcmRepeatAddr8;
+            }
+        }
+    }
+
+    if (!bGetOutput)
+        return;
+
+    // Scale by voice volume and add to the output, and also the output to reverberate if reverb is enabled for the voice
+    attenuateAndAccumulate(mix.dryL, voiceSamples, realVoiceVolL, numVoiceSamples);
+    attenuateAndAccumulate(mix.dryR, voiceSamples, realVoiceVolR, numVoiceSamples);
+
+    if (voice.bDoReverb) {
+        attenuateAndAccumulate(mix.reverbL, voiceSamples, realVoiceVolL, numVoiceSamples);
+        attenuateAndAccumulate(mix.reverbR, voiceSamples, realVoiceVolR, numVoiceSamples);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Process/update all voices for a block of samples and accumulate their output into the given mix block
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void stepVoicesBlock(
     Voice* const pVoices,
     const int32_t numVoices,
     const std::byte* pRam,
     const uint32_t ramSize,
-    StereoSample& output,
-    StereoSample& outputToReverb
+    const uint32_t numSamples,
+    MixBlock& mix
 ) noexcept {
     ASSERT(pVoices || (numVoices == 0));
 
     for (int32_t voiceIdx = 0; voiceIdx < numVoices; ++voiceIdx) {
-        stepVoice(pVoices[voiceIdx], pRam, ramSize, output, outputToReverb);
+        stepVoiceBlock(pVoices[voiceIdx], pRam, ramSize, numSamples, mix);
     }
 }
 
@@ -585,26 +924,6 @@ static void doReverb(
     };
 }
 
-//------------------------------------------------------------------------------------------------------------------------------------------
-// Does the final mix and attenuation of dry sound and reverb sound, and scales according to the master volume
-//------------------------------------------------------------------------------------------------------------------------------------------
-void doMasterMix(
-    const StereoSample dryOutput,
-    const StereoSample reverbOutput,
-    const Volume masterVol,
-    StereoSample& output
-) noexcept {
-    // Note: master volume is expected to be +/- 0x3FFF.
-    // Need to clamp if exceeding this and also scale by 2.
-    const StereoSample wetOutput = dryOutput + reverbOutput;
-    const Volume scaledMasterVol = {
-        (int16_t)(std::clamp(masterVol.left, MIN_MASTER_VOLUME, MAX_MASTER_VOLUME) * 2),
-        (int16_t)(std::clamp(masterVol.right, MIN_MASTER_VOLUME, MAX_MASTER_VOLUME) * 2),
-    };
-
-    output = wetOutput * scaledMasterVol;
-}
-
 //------------------------------------------------------------------------------------------------------------------------------------------
 // Core initialization and teardown
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -647,50 +966,92 @@ void Spu::destroyCore(Core& core) noexcept {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
-// Start playing the given voice
+// Step the SPU core for a single sample
 //------------------------------------------------------------------------------------------------------------------------------------------
 StereoSample Spu::stepCore(Core& core) noexcept {
-    // Process all voices firstly and silence the output if we are not unmuted
-    StereoSample output = {};
-    StereoSample outputToReverb = {};
-    stepVoices(core.pVoices, core.numVoices, core.pRam, core.ramSize, output, outputToReverb);
-
-    if (!core.bUnmute) {
-        output = {};
-        outputToReverb = {};
-    }
+    StereoSample output;
+    stepCoreBlock(core, &output, 1);
+    return output;
+}
 
-    // Mix any external input
-    if (core.bExtEnabled) {
-        mixExternalInput(
-            core.pExtInputCallback,
-            core.pExtInputUserData,
-            core.extInputVol,
-            core.bExtReverbEnable,
-            output,
-            outputToReverb
-        );
-    }
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Step the SPU core for the given number of samples and save the output to the given buffer.
+//
+// Voices are processed one at a time for a whole block of samples, rather than all voices being processed for each sample.
+// This keeps the state for each voice hot while it's being worked on and allows the mixing to be done in tight loops.
+// Note: the one difference from stepping sample by sample is that voices read all of their sample data for the block before reverb writes
+// for the block are done. This only matters for voices playing from the reverb work area, which is never done in practice.
+//------------------------------------------------------------------------------------------------------------------------------------------
+void Spu::stepCoreBlock(Core& core, StereoSample* const pOutput, const uint32_t numSamples) noexcept {
+    ASSERT(pOutput || (numSamples == 0));
+
+    for (uint32_t blockStartIdx = 0; blockStartIdx < numSamples; blockStartIdx += MAX_MIX_BLOCK_SIZE) {
+        const uint32_t blockSize = std::min(numSamples - blockStartIdx, MAX_MIX_BLOCK_SIZE);
+
+        // Process all voices firstly and silence the output if we are not unmuted
+        MixBlock mix;
+        std::memset(mix.dryL, 0, sizeof(int16_t) * blockSize);
+        std::memset(mix.dryR, 0, sizeof(int16_t) * blockSize);
+        std::memset(mix.reverbL, 0, sizeof(int16_t) * blockSize);
+        std::memset(mix.reverbR, 0, sizeof(int16_t) * blockSize);
+
+        stepVoicesBlock(core.pVoices, core.numVoices, core.pRam, core.ramSize, blockSize, mix);
+
+        if (!core.bUnmute) {
+            std::memset(mix.dryL, 0, sizeof(int16_t) * blockSize);
+            std::memset(mix.dryR, 0, sizeof(int16_t) * blockSize);
+            std::memset(mix.reverbL, 0, sizeof(int16_t) * blockSize);
+            std::memset(mix.reverbR, 0, sizeof(int16_t) * blockSize);
+        }
 
-    // Do reverb every 2 cycles: PSX reverb operates at 22,050 Hz and the SPU operates at 44,100 Hz
-    if ((core.cycleCount & 1) == 0) {
-        doReverb(
-            core.pRam,
-            core.ramSize,
-            core.reverbBaseAddr8,
-            core.reverbCurAddr,
-            core.reverbVol,
-            core.bReverbWriteEnable,
-            core.reverbRegs,
-            outputToReverb,
-            core.processedReverb
-        );
-    }
+        // Mix in external input and do reverb for each sample.
+        // These can't be done in bulk because the external input callback and the reverb work area must be processed sample by sample.
+        for (uint32_t i = 0; i < blockSize; ++i) {
+            StereoSample output = { mix.dryL[i], mix.dryR[i] };
+            StereoSample outputToReverb = { mix.reverbL[i], mix.reverbR[i] };
+
+            // Mix any external input
+            if (core.bExtEnabled) {
+                mixExternalInput(
+                    core.pExtInputCallback,
+                    core.pExtInputUserData,
+                    core.extInputVol,
+                    core.bExtReverbEnable,
+                    output,
+                    outputToReverb
+                );
+            }
 
-    // Do the final mixing and finish up
-    doMasterMix(output, core.processedReverb, core.masterVol, output);
-    core.cycleCount++;
-    return output;
+            // Do reverb every 2 cycles: PSX reverb operates at 22,050 Hz and the SPU operates at 44,100 Hz
+            if ((core.cycleCount & 1) == 0) {
+                doReverb(
+                    core.pRam,
+                    core.ramSize,
+                    core.reverbBaseAddr8,
+                    core.reverbCurAddr,
+                    core.reverbVol,
+                    core.bReverbWriteEnable,
+                    core.reverbRegs,
+                    outputToReverb,
+                    core.processedReverb
+                );
+            }
+
+            mix.dryL[i] = output.left;
+            mix.dryR[i] = output.right;
+            mix.reverbOutL[i] = core.processedReverb.left;
+            mix.reverbOutR[i] = core.processedReverb.right;
+            core.cycleCount++;
+        }
+
+        // Do the final mixing of dry sound and reverb sound and scale according to the master volume.
+        // Note: master volume is expected to be +/- 0x3FFF. Need to clamp if exceeding this and also scale by 2.
+        const int16_t masterVolL = (int16_t)(std::clamp(core.masterVol.left, MIN_MASTER_VOLUME, MAX_MASTER_VOLUME) * 2);
+        const int16_t masterVolR = (int16_t)(std::clamp(core.masterVol.right, MIN_MASTER_VOLUME, MAX_MASTER_VOLUME) * 2);
+        addAndAttenuate(mix.dryL, mix.dryL, mix.reverbOutL, masterVolL, blockSize);
+        addAndAttenuate(mix.dryR, mix.dryR, mix.reverbOutR, masterVolR, blockSize);
+        interleaveStereo(pOutput + blockStartIdx, mix.dryL, mix.dryR, blockSize);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -370,8 +370,10 @@ void initPS1Core(Core& core) noexcept;
 void initPS2Core(Core& core) noexcept;
 void destroyCore(Core& core) noexcept;
 
-// Step the given SPU core
+// Step the given SPU core for a single sample, or for a block of samples.
+// Stepping in blocks is much faster and produces the same output as stepping sample by sample.
 StereoSample stepCore(Core& core) noexcept;
+void stepCoreBlock(Core& core, StereoSample* const pOutput, const uint32_t numSamples) noexcept;
 
 // Key on or off the given SPU voice
 void keyOn(Voice& voice) noexcept;
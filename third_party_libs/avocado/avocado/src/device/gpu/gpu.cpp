@@ -1,6 +1,7 @@
 #include "gpu.h"
 #include <fmt/core.h>
 #include <cassert>
+#include <cstring>
 #include "config.h"
 #include "render/render.h"
 #include "system.h"
@@ -8,6 +9,10 @@
 #include "utils/logic.h"
 #include "utils/macros.h"
 
+#if PSYDOOM_AVOCADO_MODS
+    #include "render/threaded_rasterizer.h"
+#endif
+
 // DC: disabling for this project to simplify dependencies
 #if (!PSYDOOM_AVOCADO_MODS)
     // For vram dump
@@ -21,7 +26,14 @@ GPU::GPU(System* sys) : sys(sys) {
     reset();
 }
 
-GPU::~GPU() { bus.unlistenAll(busToken); }
+GPU::~GPU() {
+// PsyDoom: make sure the rasterizer worker threads are stopped before the VRAM they draw to goes away
+#if PSYDOOM_AVOCADO_MODS
+    rasterizer.reset();
+#endif
+
+    bus.unlistenAll(busToken);
+}
 
 void GPU::reload() {
     verbose = config.debug.log.gpu;
@@ -53,7 +65,7 @@ void GPU::reset() {
 
     gp0_e6._reg = 0;
 
-    clutCachePos = ivec2(-1, -1);
+    clutCache.pos = ivec2(-1, -1);
 }
 
 void GPU::drawTriangle(const primitive::Triangle& triangle) {
@@ -84,7 +96,24 @@ void GPU::drawTriangle(const primitive::Triangle& triangle) {
     }
 
     if (softwareRendering) {
-        Render::drawTriangle(this, triangle);
+    // PsyDoom: if rendering at a higher internal resolution then also draw a scaled up version of the primitive to the high resolution VRAM
+    #if PSYDOOM_AVOCADO_MODS
+        if (renderScaleShift > 0) {
+            primitive::Triangle hiresTriangle = triangle;
+
+            for (auto& v : hiresTriangle.v) {
+                v.pos.x <<= renderScaleShift;
+                v.pos.y <<= renderScaleShift;
+            }
+
+            submitTriangle(getHiresRenderState(), hiresTriangle);
+        }
+
+        submitTriangle(getRenderState(), triangle);
+    #else
+        RenderState state = getRenderState();
+        Render::drawTriangle(&state, triangle);
+    #endif
     }
 }
 
@@ -129,7 +158,24 @@ void GPU::drawLine(const primitive::Line& line) {
     }
 
     if (softwareRendering) {
-        Render::drawLine(this, line);
+    // PsyDoom: if rendering at a higher internal resolution then also draw a scaled up version of the primitive to the high resolution VRAM
+    #if PSYDOOM_AVOCADO_MODS
+        if (renderScaleShift > 0) {
+            primitive::Line hiresLine = line;
+
+            for (auto& pos : hiresLine.pos) {
+                pos.x <<= renderScaleShift;
+                pos.y <<= renderScaleShift;
+            }
+
+            submitLine(getHiresRenderState(), hiresLine);
+        }
+
+        submitLine(getRenderState(), line);
+    #else
+        RenderState state = getRenderState();
+        Render::drawLine(&state, line);
+    #endif
     }
 }
 
@@ -191,7 +237,22 @@ void GPU::drawRectangle(const primitive::Rect& rect) {
     }
 
     if (softwareRendering) {
-        Render::drawRectangle(this, rect);
+    // PsyDoom: if rendering at a higher internal resolution then also draw a scaled up version of the primitive to the high resolution VRAM
+    #if PSYDOOM_AVOCADO_MODS
+        if (renderScaleShift > 0) {
+            primitive::Rect hiresRect = rect;
+            hiresRect.pos.x <<= renderScaleShift;
+            hiresRect.pos.y <<= renderScaleShift;
+            hiresRect.size.x <<= renderScaleShift;
+            hiresRect.size.y <<= renderScaleShift;
+            submitRectangle(getHiresRenderState(), hiresRect);
+        }
+
+        submitRectangle(getRenderState(), rect);
+    #else
+        RenderState state = getRenderState();
+        Render::drawRectangle(&state, rect);
+    #endif
     }
 }
 
@@ -210,6 +271,28 @@ void GPU::cmdFillRectangle() {
 
     uint32_t color = to15bit(arguments[0] & 0xffffff);
 
+// PsyDoom: the fill is done through the same path as drawing, so it can be queued for the rasterizer worker threads and also applied to the
+// high resolution VRAM. The fill area is given as the drawing area.
+#if PSYDOOM_AVOCADO_MODS
+    if (softwareRendering) {
+        if ((endX > startX) && (endY > startY)) {
+            if (renderScaleShift > 0) {
+                RenderState hiresState = getHiresRenderState();
+                hiresState.drawingArea = Rect<int16_t>{
+                    (int16_t)(startX << renderScaleShift),
+                    (int16_t)(startY << renderScaleShift),
+                    (int16_t)((endX << renderScaleShift) - 1),
+                    (int16_t)((endY << renderScaleShift) - 1),
+                };
+                submitFill(hiresState, (uint16_t)color);
+            }
+
+            RenderState state = getRenderState();
+            state.drawingArea = Rect<int16_t>{(int16_t)startX, (int16_t)startY, (int16_t)(endX - 1), (int16_t)(endY - 1)};
+            submitFill(state, (uint16_t)color);
+        }
+    } else
+#endif
     // Note: not sure if coords should include last column and row
     for (int y = startY; y < endY; y++) {
         for (int x = startX; x < endX; x++) {
@@ -423,6 +506,11 @@ struct MaskCopy {
 };
 
 void GPU::cmdCpuToVram1() {
+// PsyDoom: wait for queued drawing to finish before accessing VRAM directly
+#if PSYDOOM_AVOCADO_MODS
+    flushRasterizer();
+#endif
+
     if ((arguments[0] & 0x00ffffff) != 0) {
         fmt::print("[GPU] cmdCpuToVram1: Suspicious arg0: 0x{:x}\n", arguments[0]);
     }
@@ -455,6 +543,11 @@ void GPU::cmdCpuToVram2() {
             currX = startX;
             if (++currY >= endY) {
                 cmd = Command::None;
+
+            // PsyDoom: the transfer is complete, bring the high resolution VRAM up to date
+            #if PSYDOOM_AVOCADO_MODS
+                upscaleVramRect(startX, startY, endX - startX, endY - startY);
+            #endif
                 return true;
             }
         }
@@ -472,6 +565,11 @@ void GPU::cmdCpuToVram2() {
 }
 
 void GPU::cmdVramToCpu() {
+// PsyDoom: wait for queued drawing to finish before accessing VRAM directly
+#if PSYDOOM_AVOCADO_MODS
+    flushRasterizer();
+#endif
+
     if ((arguments[0] & 0x00ffffff) != 0) {
         fmt::print("[GPU] cmdVramToCpu: Suspicious arg0: 0x{:x}\n", arguments[0]);
     }
@@ -506,6 +604,11 @@ uint32_t GPU::readVramData() {
 }
 
 void GPU::cmdVramToVram() {
+// PsyDoom: wait for queued drawing to finish before accessing VRAM directly
+#if PSYDOOM_AVOCADO_MODS
+    flushRasterizer();
+#endif
+
     cmd = Command::None;
 
     if ((arguments[0] & 0x00ffffff) != 0) {
@@ -535,6 +638,17 @@ void GPU::cmdVramToVram() {
             maskedWrite(dstX + x, dstY + y, src);
         }
     }
+
+// PsyDoom: bring the high resolution VRAM up to date, keeping the detail of the source area where possible.
+#if PSYDOOM_AVOCADO_MODS
+    const bool bWraps = (srcX + w > VRAM_WIDTH) || (srcY + h > VRAM_HEIGHT) || (dstX + w > VRAM_WIDTH) || (dstY + h > VRAM_HEIGHT);
+
+    if ((!bWraps) && (!gp0_e6.checkMaskBeforeDraw) && (!gp0_e6.setMaskWhileDrawing)) {
+        copyHiresVramRect(srcX, srcY, w, h, dstX, dstY);
+    } else {
+        upscaleVramRect(dstX, dstY, w, h);
+    }
+#endif
 }
 
 uint32_t GPU::getStat() {
@@ -612,7 +726,12 @@ void GPU::writeGP0(uint32_t data) {
             }
         } else if (command == 0x01) {
             // Clear Cache
-            clutCachePos = ivec2(-1, -1);
+            clutCache.pos = ivec2(-1, -1);
+
+        // PsyDoom: the rasterizer worker threads have their own CLUT caches, these get cleared once queued drawing is done
+        #if PSYDOOM_AVOCADO_MODS
+            flushRasterizer();
+        #endif
         } else if (command == 0x02) {
             // Fill rectangle
             cmd = Command::FillRectangle;
@@ -737,6 +856,71 @@ void GPU::writeGP0(uint32_t data) {
     }
 }
 
+#if PSYDOOM_AVOCADO_MODS
+// PsyDoom: submit a run of GP0 words in one call.
+// Complete polygon, rectangle and single line commands are copied straight into the argument buffer and dispatched directly,
+// avoiding a trip through the command state machine for every word. Anything else (state setting commands, VRAM transfers,
+// poly-lines, commands which are split across calls or already in progress) falls back to the regular 'writeGP0' path.
+void GPU::writeGP0Words(const uint32_t* pWords, uint32_t numWords) {
+    // Logging relies on the state machine path, so just use that if enabled
+    if (gpuLogEnabled || verbose) {
+        for (uint32_t i = 0; i < numWords; ++i) {
+            writeGP0(pWords[i]);
+        }
+        return;
+    }
+
+    while (numWords > 0) {
+        // Figure out how many words the next command needs, if it's one which can be dispatched directly
+        const uint8_t cmdByte = (uint8_t)(pWords[0] >> 24);
+        uint32_t numCmdWords = 0;
+
+        if (cmd == Command::None) {
+            if (cmdByte >= 0x20 && cmdByte < 0x40) {
+                numCmdWords = PolygonArgs(cmdByte).getArgumentCount() + 1;
+            } else if (cmdByte >= 0x40 && cmdByte < 0x60 && (!LineArgs(cmdByte).polyLine)) {
+                numCmdWords = LineArgs(cmdByte).getArgumentCount() + 1;
+            } else if (cmdByte >= 0x60 && cmdByte < 0x80) {
+                numCmdWords = RectangleArgs(cmdByte).getArgumentCount() + 1;
+            }
+        }
+
+        // Can't dispatch directly? Feed the word through the state machine instead:
+        if ((numCmdWords == 0) || (numCmdWords > numWords)) {
+            writeGP0(pWords[0]);
+            ++pWords;
+            --numWords;
+            continue;
+        }
+
+        // Setup the command state exactly as 'writeGP0' would once all the arguments have arrived, then execute
+        command = cmdByte;
+        arguments[0] = pWords[0] & 0xffffff;
+
+        for (uint32_t i = 1; i < numCmdWords; ++i) {
+            arguments[i] = pWords[i];
+        }
+
+        argumentCount = (int) numCmdWords;
+        currentArgument = (int) numCmdWords;
+
+        if (cmdByte < 0x40) {
+            cmd = Command::Polygon;
+            cmdPolygon(cmdByte);
+        } else if (cmdByte < 0x60) {
+            cmd = Command::Line;
+            cmdLine(cmdByte);
+        } else {
+            cmd = Command::Rectangle;
+            cmdRectangle(cmdByte);
+        }
+
+        pWords += numCmdWords;
+        numWords -= numCmdWords;
+    }
+}
+#endif
+
 void GPU::writeGP1(uint32_t data) {
     uint32_t command = (data >> 24) & 0x3f;
     uint32_t argument = data & 0xffffff;
@@ -833,6 +1017,177 @@ bool GPU::insideDrawingArea(int x, int y) const {
            && (y < VRAM_HEIGHT);
 }
 
+RenderState GPU::getRenderState() {
+    return RenderState{
+        vram.data(),  //
+        &clutCache,   //
+        gp0_e1,       //
+        gp0_e2,       //
+        gp0_e6,       //
+        drawingArea,  //
+        vram.data(),  //
+        VRAM_WIDTH,   //
+        VRAM_HEIGHT,  //
+        0,            //
+    };
+}
+
+// PsyDoom: drawing to the high resolution VRAM.
+// Note that the drawing area covers all of the high resolution pixels of the original drawing area's edge pixels.
+#if PSYDOOM_AVOCADO_MODS
+RenderState GPU::getHiresRenderState() {
+    const int scaleMask = (1 << renderScaleShift) - 1;
+
+    RenderState state = getRenderState();
+    state.drawingArea.left = (int16_t)(drawingArea.left << renderScaleShift);
+    state.drawingArea.top = (int16_t)(drawingArea.top << renderScaleShift);
+    state.drawingArea.right = (int16_t)((drawingArea.right << renderScaleShift) + scaleMask);
+    state.drawingArea.bottom = (int16_t)((drawingArea.bottom << renderScaleShift) + scaleMask);
+    state.target = hiresVram.data();
+    state.targetWidth = VRAM_WIDTH << renderScaleShift;
+    state.targetHeight = VRAM_HEIGHT << renderScaleShift;
+    state.scaleShift = renderScaleShift;
+    return state;
+}
+
+// PsyDoom: queue the primitive up for the rasterizer worker threads if multithreaded rendering is enabled, otherwise draw it now
+void GPU::submitTriangle(const RenderState& state, const primitive::Triangle& triangle) {
+    if (rasterizer) {
+        rasterizer->drawTriangle(state, triangle);
+    } else {
+        RenderState stateCopy = state;
+        Render::drawTriangle(&stateCopy, triangle);
+    }
+}
+
+void GPU::submitLine(const RenderState& state, const primitive::Line& line) {
+    if (rasterizer) {
+        rasterizer->drawLine(state, line);
+    } else {
+        RenderState stateCopy = state;
+        Render::drawLine(&stateCopy, line);
+    }
+}
+
+void GPU::submitRectangle(const RenderState& state, const primitive::Rect& rect) {
+    if (rasterizer) {
+        rasterizer->drawRectangle(state, rect);
+    } else {
+        RenderState stateCopy = state;
+        Render::drawRectangle(&stateCopy, rect);
+    }
+}
+
+void GPU::submitFill(const RenderState& state, uint16_t color) {
+    if (rasterizer) {
+        rasterizer->fillRectangle(state, color);
+    } else {
+        for (int y = state.drawingArea.top; y <= state.drawingArea.bottom; y++) {
+            uint16_t* const row = state.target + y * state.targetWidth;
+            std::fill(row + state.drawingArea.left, row + state.drawingArea.right + 1, color);
+        }
+    }
+}
+#endif
+
+// PsyDoom: control over multithreaded software rasterization
+#if PSYDOOM_AVOCADO_MODS
+void GPU::setRasterizerThreads(int numThreads) {
+    // Note: destroying the old rasterizer flushes any drawing it has queued
+    rasterizer.reset();
+    displayFence = 0;
+
+    if (numThreads > 1) {
+        rasterizer = std::make_unique<ThreadedRasterizer>(numThreads);
+    }
+}
+
+void GPU::flushRasterizer() {
+    if (rasterizer) {
+        rasterizer->flush();
+    }
+}
+
+uint64_t GPU::getRasterizerFence() { return (rasterizer) ? rasterizer->getFence() : 0; }
+
+void GPU::waitForRasterizerFence(uint64_t fence) {
+    if (rasterizer) {
+        rasterizer->waitForFence(fence);
+    }
+}
+
+void GPU::setRenderScale(int scale) {
+    flushRasterizer();
+
+    switch (scale) {
+        case 4: renderScaleShift = 2; break;
+        case 2: renderScaleShift = 1; break;
+        default: renderScaleShift = 0; break;
+    }
+
+    // Start the high resolution VRAM off with whatever is in VRAM currently
+    if (renderScaleShift > 0) {
+        hiresVram.assign((size_t)(VRAM_WIDTH << renderScaleShift) * (VRAM_HEIGHT << renderScaleShift), 0);
+        upscaleVramRect(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+    } else {
+        hiresVram.clear();
+        hiresVram.shrink_to_fit();
+    }
+}
+
+// PsyDoom: copy an area of VRAM to the high resolution VRAM, scaling it up with nearest neighbor filtering.
+// Coordinates wrap around the edges of VRAM, like they do for VRAM transfers.
+void GPU::upscaleVramRect(int x, int y, int w, int h) {
+    if (renderScaleShift <= 0) return;
+
+    flushRasterizer();
+
+    const int scale = 1 << renderScaleShift;
+    const int hiresWidth = VRAM_WIDTH << renderScaleShift;
+
+    for (int srcY = y; srcY < y + h; srcY++) {
+        const uint16_t* const pSrcRow = VRAM[srcY % VRAM_HEIGHT];
+        uint16_t* const pDstRow = hiresVram.data() + (size_t)((srcY % VRAM_HEIGHT) << renderScaleShift) * hiresWidth;
+
+        for (int srcX = x; srcX < x + w; srcX++) {
+            const int wrappedX = srcX % VRAM_WIDTH;
+            std::fill_n(pDstRow + (wrappedX << renderScaleShift), scale, pSrcRow[wrappedX]);
+        }
+
+        // The rest of the high resolution rows for this VRAM row are the same as the first
+        for (int i = 1; i < scale; i++) {
+            uint16_t* const pDupRow = pDstRow + (size_t)i * hiresWidth;
+
+            for (int srcX = x; srcX < x + w; srcX++) {
+                const int dstX = (srcX % VRAM_WIDTH) << renderScaleShift;
+                std::copy_n(pDstRow + dstX, scale, pDupRow + dstX);
+            }
+        }
+    }
+}
+
+// PsyDoom: copy one area of the high resolution VRAM to another, so that VRAM to VRAM copies keep their detail.
+// The area must not wrap around the edges of VRAM.
+void GPU::copyHiresVramRect(int srcX, int srcY, int w, int h, int dstX, int dstY) {
+    if (renderScaleShift <= 0) return;
+
+    flushRasterizer();
+
+    const int hiresWidth = VRAM_WIDTH << renderScaleShift;
+    const int rowSize = w << renderScaleShift;
+    const int numRows = h << renderScaleShift;
+
+    const uint16_t* pSrcRow = hiresVram.data() + (srcX << renderScaleShift) + (size_t)(srcY << renderScaleShift) * hiresWidth;
+    uint16_t* pDstRow = hiresVram.data() + (dstX << renderScaleShift) + (size_t)(dstY << renderScaleShift) * hiresWidth;
+
+    for (int row = 0; row < numRows; row++) {
+        std::memmove(pDstRow, pSrcRow, rowSize * sizeof(uint16_t));
+        pSrcRow += hiresWidth;
+        pDstRow += hiresWidth;
+    }
+}
+#endif
+
 bool GPU::isNtsc() { return forceNtsc || gp1_08.videoMode == GP1_08::VideoMode::ntsc; }
 
 void GPU::dumpVram() {
@@ -1,5 +1,7 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <memory>
 #include <vector>
 #include "color_depth.h"
 #include "primitive.h"
@@ -12,11 +14,52 @@ struct System;
 class Render;
 class OpenGL;
 
+#if PSYDOOM_AVOCADO_MODS
+class ThreadedRasterizer;
+#endif
+
 namespace gpu {
 
 const int VRAM_WIDTH = 1024;
 const int VRAM_HEIGHT = 512;
 
+// PsyDoom: the color look-up table cache used by the software rasterizer
+struct ClutCache {
+    std::array<uint16_t, 256> entries{};
+    ivec2 pos{-1, -1};
+    ColorDepth colorDepth = ColorDepth::NONE;
+};
+
+// PsyDoom: the GPU state needed by the software rasterizer to draw a primitive.
+// Rasterization works from this rather than from the GPU directly, so that primitives can be drawn later on other threads with their own
+// CLUT cache and clipping area.
+//
+// Textures and CLUTs are always read from 'vram' but pixels are written to 'target', which is either VRAM itself or a copy of VRAM at a
+// higher internal resolution (scaled up by '1 << scaleShift'). When drawing to a high resolution target the primitive coordinates and
+// drawing area are in target pixels.
+struct RenderState {
+    uint16_t* vram;
+    ClutCache* clutCache;
+    GP0_E1 gp0_e1;
+    GP0_E2 gp0_e2;
+    GP0_E6 gp0_e6;
+    Rect<int16_t> drawingArea;
+    uint16_t* target;
+    int targetWidth;
+    int targetHeight;
+    int scaleShift;
+
+    int minDrawingX(int x) const { return std::max((int)drawingArea.left, std::max(0, x)); }
+    int minDrawingY(int y) const { return std::max((int)drawingArea.top, std::max(0, y)); }
+    int maxDrawingX(int x) const { return std::min((int)drawingArea.right, std::min(targetWidth, x)); }
+    int maxDrawingY(int y) const { return std::min((int)drawingArea.bottom, std::min(targetHeight, y)); }
+
+    bool insideDrawingArea(int x, int y) const {
+        return (x >= drawingArea.left) && (x < drawingArea.right) && (x < targetWidth) && (y >= drawingArea.top) && (y < drawingArea.bottom)
+               && (y < targetHeight);
+    }
+};
+
 const int LINE_VBLANK_START_NTSC = 243;
 const int LINES_TOTAL_NTSC = 263;
 
@@ -105,9 +148,22 @@ public:
     std::array<uint16_t, VRAM_WIDTH * VRAM_HEIGHT> vram{};
 
     // TODO: Serialize?
-    std::array<uint16_t, 256> clutCache{};
-    ivec2 clutCachePos{-1, -1};
-    ColorDepth clutCacheColorDepth = ColorDepth::NONE;
+    ClutCache clutCache;
+
+// PsyDoom: optional multithreaded software rasterization.
+// The display fence marks the end of the queued drawing for the framebuffer currently being displayed.
+#if PSYDOOM_AVOCADO_MODS
+    std::unique_ptr<ThreadedRasterizer> rasterizer;
+    uint64_t displayFence = 0;
+#endif
+
+// PsyDoom: optional higher internal resolution for the software renderer.
+// Everything is still drawn to VRAM at the original resolution (so VRAM reads, copies and render-to-texture work as before) but is also drawn
+// to a copy of VRAM which is scaled up by '1 << renderScaleShift'. Only the high resolution copy is displayed.
+#if PSYDOOM_AVOCADO_MODS
+    int renderScaleShift = 0;
+    std::vector<uint16_t> hiresVram;
+#endif
 
 // PsyDoom: allowing some lower level access to the GPU for speed
 #if !PSYDOOM_AVOCADO_MODS
@@ -137,8 +193,22 @@ public:
     void writeGP0(uint32_t data);
     void writeGP1(uint32_t data);
 
+// PsyDoom: bulk submission of GP0 command words, bypassing the per-word state machine for whole draw commands
+#if PSYDOOM_AVOCADO_MODS
+    void writeGP0Words(const uint32_t* pWords, uint32_t numWords);
+#endif
+
     void reload();
     void maskedWrite(int x, int y, uint16_t value);
+    RenderState getRenderState();
+
+#if PSYDOOM_AVOCADO_MODS
+    RenderState getHiresRenderState();
+    void submitTriangle(const RenderState& state, const primitive::Triangle& triangle);
+    void submitLine(const RenderState& state, const primitive::Line& line);
+    void submitRectangle(const RenderState& state, const primitive::Rect& rect);
+    void submitFill(const RenderState& state, uint16_t color);
+#endif
 
     uint32_t readVramData();
     uint32_t getStat();
@@ -158,6 +228,24 @@ public:
     int maxDrawingY(int y) const;
     bool insideDrawingArea(int x, int y) const;
 
+// PsyDoom: control over multithreaded software rasterization.
+// When enabled, drawing primitives are queued up and rasterized by worker threads. The queue must be flushed before touching VRAM directly.
+#if PSYDOOM_AVOCADO_MODS
+    void setRasterizerThreads(int numThreads);
+    void flushRasterizer();
+    uint64_t getRasterizerFence();
+    void waitForRasterizerFence(uint64_t fence);
+
+    // PsyDoom: control over the internal render resolution, which must be 1, 2 or 4 times the original resolution.
+    // The high resolution copy of VRAM must be kept in sync with any direct writes to VRAM, by upscaling or copying the affected area.
+    void setRenderScale(int scale);
+    int getRenderScale() const { return 1 << renderScaleShift; }
+    int getHiresVramWidth() const { return VRAM_WIDTH << renderScaleShift; }
+    const uint16_t* getDisplayVram() const { return (renderScaleShift > 0) ? hiresVram.data() : vram.data(); }
+    void upscaleVramRect(int x, int y, int w, int h);
+    void copyHiresVramRect(int srcX, int srcY, int w, int h, int dstX, int dstY);
+#endif
+
     // Debug && replay
     bool gpuLogEnabled = true;
     std::vector<LogEntry> gpuLogList;
@@ -3,7 +3,7 @@
 
 class Render {
    public:
-    static void drawLine(gpu::GPU* gpu, const primitive::Line& line);
-    static void drawTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle);
-    static void drawRectangle(gpu::GPU* gpu, const primitive::Rect& rect);
+    static void drawLine(gpu::RenderState* state, const primitive::Line& line);
+    static void drawTriangle(gpu::RenderState* state, const primitive::Triangle& triangle);
+    static void drawRectangle(gpu::RenderState* state, const primitive::Rect& rect);
 };
\ No newline at end of file
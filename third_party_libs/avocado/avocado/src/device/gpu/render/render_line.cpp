@@ -3,14 +3,15 @@
 #include "render.h"
 #include "utils/macros.h"
 
+// PsyDoom: pixels are written to the draw target, which may be VRAM or a higher resolution copy of it
 #undef VRAM
-#define VRAM ((uint16_t(*)[gpu::VRAM_WIDTH])gpu->vram.data())
+#define TARGET_ROW(y) (state->target + (intptr_t)(y) * state->targetWidth)
 
-void Render::drawLine(gpu::GPU* gpu, const primitive::Line& line) {
-    const auto transparency = gpu->gp0_e1.semiTransparency;
-    const bool checkMaskBeforeDraw = gpu->gp0_e6.checkMaskBeforeDraw;
-    const bool setMaskWhileDrawing = gpu->gp0_e6.setMaskWhileDrawing;
-    const bool dithering = gpu->gp0_e1.dither24to15;
+void Render::drawLine(gpu::RenderState* state, const primitive::Line& line) {
+    const auto transparency = state->gp0_e1.semiTransparency;
+    const bool checkMaskBeforeDraw = state->gp0_e6.checkMaskBeforeDraw;
+    const bool setMaskWhileDrawing = state->gp0_e6.setMaskWhileDrawing;
+    const bool dithering = state->gp0_e1.dither24to15;
 
     int x0 = line.pos[0].x;
     int y0 = line.pos[0].y;
@@ -21,9 +22,9 @@ void Render::drawLine(gpu::GPU* gpu, const primitive::Line& line) {
 
     // TODO: Clip line in drawRectangle
 
-    // Skip rendering when distance between vertices is bigger than 1023x511
-    if (abs(x0 - x1) >= 1024) return;
-    if (abs(y0 - y1) >= 512) return;
+    // Skip rendering when distance between vertices is bigger than 1023x511 (in original resolution pixels)
+    if (abs(x0 - x1) >= (1024 << state->scaleShift)) return;
+    if (abs(y0 - y1) >= (512 << state->scaleShift)) return;
 
     bool steep = false;
     if (std::abs(x0 - x1) < std::abs(y0 - y1)) {
@@ -58,7 +59,7 @@ void Render::drawLine(gpu::GPU* gpu, const primitive::Line& line) {
     };
 
     auto putPixel = [&](int x, int y, RGB fullColor) {
-        PSXColor bg = VRAM[y][x];
+        PSXColor bg = TARGET_ROW(y)[x];
         if (unlikely(checkMaskBeforeDraw)) {
             if (bg.k) return;
         }
@@ -78,15 +79,15 @@ void Render::drawLine(gpu::GPU* gpu, const primitive::Line& line) {
 
         c.k |= setMaskWhileDrawing;
 
-        VRAM[y][x] = c.raw;
+        TARGET_ROW(y)[x] = c.raw;
     };
 
     for (int _x = x0; _x <= x1; _x++) {
         if (steep) {
             // TODO: Remove insideDrawingArea calls
-            if (gpu->insideDrawingArea(_y, _x)) putPixel(_y, _x, getColor(_x, _y));
+            if (state->insideDrawingArea(_y, _x)) putPixel(_y, _x, getColor(_x, _y));
         } else {
-            if (gpu->insideDrawingArea(_x, _y)) putPixel(_x, _y, getColor(_x, _y));
+            if (state->insideDrawingArea(_x, _y)) putPixel(_x, _y, getColor(_x, _y));
         }
         error += derror;
         if (error > dx) {
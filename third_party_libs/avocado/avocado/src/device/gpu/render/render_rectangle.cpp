@@ -3,53 +3,59 @@
 #include "texture_utils.h"
 #include "utils/macros.h"
 
+// PsyDoom: pixels are written to the draw target, which may be VRAM or a higher resolution copy of it
 #undef VRAM
-#define VRAM ((uint16_t(*)[gpu::VRAM_WIDTH])gpu->vram.data())
+#define TARGET_ROW(y) (state->target + (intptr_t)(y) * state->targetWidth)
 
 template <ColorDepth bits, bool isSemiTransparent, bool isBlended, bool checkMaskBeforeDraw>
-INLINE void rasterizeRectangle(gpu::GPU* gpu, const primitive::Rect& rect) {
+INLINE void rasterizeRectangle(gpu::RenderState* state, const primitive::Rect& rect) {
     // Extract common GPU state
-    const auto transparency = gpu->gp0_e1.semiTransparency;
-    const bool setMaskWhileDrawing = gpu->gp0_e6.setMaskWhileDrawing;
-    const auto textureWindow = gpu->gp0_e2;
+    const auto transparency = state->gp0_e1.semiTransparency;
+    const bool setMaskWhileDrawing = state->gp0_e6.setMaskWhileDrawing;
+    const auto textureWindow = state->gp0_e2;
     constexpr bool isTextured = bits != ColorDepth::NONE;
 
-    if (rect.size.x >= 1024 || rect.size.y >= 512) return;
+    if (rect.size.x >= (1024 << state->scaleShift) || rect.size.y >= (512 << state->scaleShift)) return;
 
     const ivec2 pos(  //
         rect.pos.x,   //
         rect.pos.y    //
     );
     const ivec2 min(              //
-        gpu->minDrawingX(pos.x),  //
-        gpu->minDrawingY(pos.y)   //
+        state->minDrawingX(pos.x),  //
+        state->minDrawingY(pos.y)   //
     );
     const ivec2 max(                                //
-        gpu->maxDrawingX(pos.x + rect.size.x - 1),  //
-        gpu->maxDrawingY(pos.y + rect.size.y - 1)   //
+        state->maxDrawingX(pos.x + rect.size.x - 1),  //
+        state->maxDrawingY(pos.y + rect.size.y - 1)   //
     );
 
-    const ivec2 uv(                   //
-        rect.uv.x + (min.x - pos.x),  // Add offset if part of rectange was cut off
-        rect.uv.y + (min.y - pos.y)   //
-    );
     int uStep = 1, vStep = 1;
 
     // Texture flipping
     // TODO: Not tested!
-    if (gpu->gp0_e1.texturedRectangleXFlip) {
+    if (state->gp0_e1.texturedRectangleXFlip) {
         uStep = -1;
     }
-    if (gpu->gp0_e1.texturedRectangleYFlip) {
+    if (state->gp0_e1.texturedRectangleYFlip) {
         vStep = -1;
     }
 
-    loadClutCacheIfRequired<bits>(gpu, rect.clut);
+    // PsyDoom: the texel for each pixel is worked out from the pixel's offset within the rectangle, stepping in the flipped direction if
+    // required. This way the texel drawn at a pixel does not depend on how the rectangle is clipped. When drawing at a higher internal
+    // resolution each texel covers a block of pixels, since the texture coordinates are still in original resolution texels.
+    const int scaleShift = state->scaleShift;
+
+    loadClutCacheIfRequired<bits>(state, rect.clut);
 
     int x, y, u, v;
-    for (y = min.y, v = uv.y; y <= max.y; y++, v += vStep) {
-        for (x = min.x, u = uv.x; x <= max.x; x++, u += uStep) {
-            PSXColor bg = VRAM[y][x];
+    for (y = min.y; y <= max.y; y++) {
+        v = rect.uv.y + ((y - pos.y) >> scaleShift) * vStep;
+
+        for (x = min.x; x <= max.x; x++) {
+            u = rect.uv.x + ((x - pos.x) >> scaleShift) * uStep;
+
+            PSXColor bg = TARGET_ROW(y)[x];
             if constexpr (checkMaskBeforeDraw) {
                 if (bg.k) continue;
             }
@@ -59,7 +65,7 @@ INLINE void rasterizeRectangle(gpu::GPU* gpu, const primitive::Rect& rect) {
                 c = PSXColor(rect.color.r, rect.color.g, rect.color.b);
             } else {
                 const ivec2 texel = maskTexel(ivec2(u, v), textureWindow);
-                c = fetchTex<bits>(gpu, texel, rect.texpage);
+                c = fetchTex<bits>(state, texel, rect.texpage);
                 if (c.raw == 0x0000) continue;
 
                 if constexpr (isBlended) {
@@ -75,13 +81,13 @@ INLINE void rasterizeRectangle(gpu::GPU* gpu, const primitive::Rect& rect) {
 
             c.k |= setMaskWhileDrawing;
 
-            VRAM[y][x] = c.raw;
+            TARGET_ROW(y)[x] = c.raw;
         }
     }
 }
 
 // Generate all permutations of rasterizeRectangle
-using rasterizeRectangle_t = void(gpu::GPU* gpu, const primitive::Rect& rect);
+using rasterizeRectangle_t = void(gpu::RenderState* state, const primitive::Rect& rect);
 
 #define E(bits, isSemiTransparent, isBlended, checkMaskBit) \
     &rasterizeRectangle<bitsToDepth<bits>(), isSemiTransparent, isBlended, checkMaskBit>
@@ -110,13 +116,13 @@ static constexpr rasterizeRectangle_t* rasterizeRectangleDispatchTable[4][2][2][
       {{E(16, 1, 0, 0), E(16, 1, 0, 1)}, {E(16, 1, 1, 0), E(16, 1, 1, 1)}}}};
 #undef E
 
-void Render::drawRectangle(gpu::GPU* gpu, const primitive::Rect& rect) {
+void Render::drawRectangle(gpu::RenderState* state, const primitive::Rect& rect) {
     auto bits = (int)bitsToDepth(rect.bits);
     auto isSemiTransparent = rect.isSemiTransparent;
     auto isBlended = !rect.isRawTexture;
-    auto checkMaskBit = gpu->gp0_e6.checkMaskBeforeDraw;
+    auto checkMaskBit = state->gp0_e6.checkMaskBeforeDraw;
 
     auto rasterize = rasterizeRectangleDispatchTable[bits][isSemiTransparent][isBlended][checkMaskBit];
 
-    rasterize(gpu, rect);
+    rasterize(state, rect);
 }
\ No newline at end of file
@@ -5,8 +5,17 @@
 #include "texture_utils.h"
 #include "utils/macros.h"
 
+// PsyDoom: SSE2 is used by the span filler where available (always the case for x86-64)
+#if PSYDOOM_AVOCADO_MODS && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define USE_SSE2_SPAN_FILLER 1
+    #include <emmintrin.h>
+#else
+    #define USE_SSE2_SPAN_FILLER 0
+#endif
+
+// PsyDoom: pixels are written to the draw target, which may be VRAM or a higher resolution copy of it
 #undef VRAM
-#define VRAM ((uint16_t(*)[gpu::VRAM_WIDTH])gpu->vram.data())
+#define TARGET_ROW(y) (state->target + (intptr_t)(y) * state->targetWidth)
 
 int orient2d(const ivec2& a, const ivec2& b, const ivec2& c) {  //
     return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
@@ -26,30 +35,51 @@ void calculateFillRuleBias(int bias[3], const ivec2 pos[3]) {
     bias[2] = isTopLeft(D01) ? -1 : 0;
 }
 
-// TODO: Fixed point has some rounding issue, need more investigation
-// #define USE_FIXED_POINT
+// PsyDoom: use an exact fixed point path for attribute interpolation instead of floating point.
+// Floating point interpolation had precision issues causing some wall & floor texels to shift around between alternating positions every
+// frame (the different VRAM addresses for each alternate framebuffer produced different rasterization results). Using 'double' fixed that
+// visually but made every per-pixel attribute step a double add in the hottest loop of the program.
+#if PSYDOOM_AVOCADO_MODS
+    #define USE_FIXED_POINT
+#endif
 
 #ifdef USE_FIXED_POINT
-#define FP_PRECISION 12
-#define FP_PADDING 12
+// PsyDoom: attributes are stored in 32.32 fixed point.
+//
+// Every exact attribute value is a multiple of '1 / (2 * area)' (including the +0.5 rounding offset) and the triangle area is always less
+// than 2^19, since the bounding box is restricted to 1023x511. Start values and deltas are rounded up (towards +infinity) from their exact
+// rational values, so after any walk across VRAM (< 2^11 steps) the fixed point value is never below the exact value and exceeds it by
+// less than 2^-21. Flooring the fixed point value therefore always gives exactly the same integer as the true rational value would.
+//
+// When drawing at a higher internal resolution these bounds grow with the scale, so the result is no longer guaranteed to be exact.
+// At 4x the accumulated error is still below 2^-19 of a texel or color step, which is far too small to be visible.
+#define FP_PRECISION 32
+
+using delta_t = int64_t;
+#define FROM_FP(x) ((int)((x) >> FP_PRECISION))
+
+// Divide 'num' by 'den' and return the result in fixed point, rounded towards +infinity
+static delta_t divToFpCeil(int64_t num, int64_t den) {
+    if (den < 0) {
+        num = -num;
+        den = -den;
+    }
 
-using delta_t = int32_t;
-#define TO_FP(x) ((x) * (1 << FP_PRECISION))
-#define FROM_FP(x) ((x) >> (FP_PRECISION + FP_PADDING))
-#define ADD_PADDING(x) ((delta_t)(x) << FP_PADDING)
-#else
+    int64_t q = num / den;
+    int64_t r = num % den;
 
-// DOOM: hack temp fix for some wall & floor texels shifting around between alternating positions every frame.
-// There seems to be some precision issues and the different VRAM addresses for each alternate frame produce different rasterization results.
-#if PSYDOOM_AVOCADO_MODS
-    using delta_t = double;
+    if (r < 0) {
+        q -= 1;
+        r += den;
+    }
+
+    const int64_t frac = ((r << FP_PRECISION) + den - 1) / den;
+    return q * ((int64_t) 1 << FP_PRECISION) + frac;
+}
 #else
-    using delta_t = float;
-#endif
+using delta_t = float;
 
-#define TO_FP(x) (x)
 #define FROM_FP(x) (x)
-#define ADD_PADDING(x) (x)
 #endif
 
 struct Attributes {
@@ -78,44 +108,43 @@ delta_t calculateYDelta(const ivec2 p[3], const int a[3]) {
     return (p[2].x - p[1].x) * a[0] + (p[0].x - p[2].x) * a[1] + (p[1].x - p[0].x) * a[2];
 }
 
+#ifdef USE_FIXED_POINT
 AttributeDeltas::Delta calculateDelta(const int area, const ivec2 p[3], const int a[3]) {
-    delta_t x = ADD_PADDING(TO_FP(calculateXDelta(p, a)) / area);
-    delta_t y = ADD_PADDING(TO_FP(calculateYDelta(p, a)) / area);
+    delta_t x = divToFpCeil(calculateXDelta(p, a), area);
+    delta_t y = divToFpCeil(calculateYDelta(p, a), area);
 
     return {x, y};
 }
 
 delta_t calculateStartAttribute(const int area, const ivec2 p[3], const int bias[3], const int a[3]) {
-    // DOOM: hack temp fix for some wall & floor texels shifting around between alternating positions every frame.
-    // There seems to be some precision issues and the different VRAM addresses for each alternate frame produce different rasterization results.
-    #if PSYDOOM_AVOCADO_MODS
-        double A = (p[1].x * p[2].y - p[2].x * p[1].y) * a[0] - bias[0];
-        double B = (p[2].x * p[0].y - p[0].x * p[2].y) * a[1] - bias[1];
-        double C = (p[0].x * p[1].y - p[1].x * p[0].y) * a[2] - bias[2];
-    #else
-        float A = (p[1].x * p[2].y - p[2].x * p[1].y) * a[0] - bias[0];
-        float B = (p[2].x * p[0].y - p[0].x * p[2].y) * a[1] - bias[1];
-        float C = (p[0].x * p[1].y - p[1].x * p[0].y) * a[2] - bias[2];
-    #endif
+    const int64_t A = (int64_t)(p[1].x * p[2].y - p[2].x * p[1].y) * a[0] - bias[0];
+    const int64_t B = (int64_t)(p[2].x * p[0].y - p[0].x * p[2].y) * a[1] - bias[1];
+    const int64_t C = (int64_t)(p[0].x * p[1].y - p[1].x * p[0].y) * a[2] - bias[2];
 
-#ifdef USE_FIXED_POINT
-    auto half = (1 << (FP_PRECISION - 1));
+    // (A + B + C) / area + 0.5, with the rounding offset folded into the fraction so the result is still exact
+    return divToFpCeil(2 * (A + B + C) + area, 2 * (int64_t) area);
+}
 #else
-    auto half = 0.5f;
-#endif
-    
-    // DOOM: hack temp fix for some wall & floor texels shifting around between alternating positions every frame.
-    // There seems to be some precision issues and the different VRAM addresses for each alternate frame produce different rasterization results.
-    #if PSYDOOM_AVOCADO_MODS
-        return ADD_PADDING((TO_FP(A + B + C) / static_cast<double>(area)) + half);
-    #else
-        return ADD_PADDING((TO_FP(A + B + C) / static_cast<float>(area)) + half);
-    #endif
+AttributeDeltas::Delta calculateDelta(const int area, const ivec2 p[3], const int a[3]) {
+    delta_t x = calculateXDelta(p, a) / area;
+    delta_t y = calculateYDelta(p, a) / area;
+
+    return {x, y};
+}
+
+delta_t calculateStartAttribute(const int area, const ivec2 p[3], const int bias[3], const int a[3]) {
+    float A = (p[1].x * p[2].y - p[2].x * p[1].y) * a[0] - bias[0];
+    float B = (p[2].x * p[0].y - p[0].x * p[2].y) * a[1] - bias[1];
+    float C = (p[0].x * p[1].y - p[1].x * p[0].y) * a[2] - bias[2];
+
+    return ((A + B + C) / static_cast<float>(area)) + 0.5f;
 }
+#endif
 
+// Note: 'origin' is the pixel position that the start attributes are evaluated at
 template <bool isGouraudShaded, bool isTextured>
-Attributes calculateStartAttributes(const primitive::Triangle& triangle) {
-    ivec2 p[3] = {triangle.v[0].pos, triangle.v[1].pos, triangle.v[2].pos};
+Attributes calculateStartAttributes(const primitive::Triangle& triangle, const ivec2 origin = ivec2(0, 0)) {
+    ivec2 p[3] = {triangle.v[0].pos - origin, triangle.v[1].pos - origin, triangle.v[2].pos - origin};
 
     const int area = orient2d(p[0], p[1], p[2]);
     if (area == 0) return {};
@@ -207,12 +236,184 @@ RGB dither(const RGB color, const ivec2 p) {
     return RGB(r, g, b);
 }
 
+#if PSYDOOM_AVOCADO_MODS
+// PsyDoom: floor and ceiling division helpers for the span calculations below (divisor must be positive)
+static int floorDiv(const int a, const int b) { return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+static int ceilDiv(const int a, const int b) { return -floorDiv(-a, b); }
+
+// PsyDoom: narrows the pixel range '[spanL, spanR]' on a row to the pixels for which an edge function is >= 0.
+// 'c' is the value of the edge function at the first pixel in the row (x = 0) and 'step' is how much it changes per pixel.
+static void clipSpanToEdge(const int c, const int step, int& spanL, int& spanR) {
+    if (step > 0) {
+        spanL = std::max(spanL, ceilDiv(-c, step));
+    } else if (step < 0) {
+        spanR = std::min(spanR, floorDiv(c, -step));
+    } else if (c < 0) {
+        spanR = spanL - 1;
+    }
+}
+
+#if USE_SSE2_SPAN_FILLER
+// PsyDoom: SSE2 helpers for the span filler, operating on 8 packed 15-bit colors at a time
+static inline __m128i getR(const __m128i c) { return _mm_and_si128(c, _mm_set1_epi16(0x1f)); }
+static inline __m128i getG(const __m128i c) { return _mm_and_si128(_mm_srli_epi16(c, 5), _mm_set1_epi16(0x1f)); }
+static inline __m128i getB(const __m128i c) { return _mm_and_si128(_mm_srli_epi16(c, 10), _mm_set1_epi16(0x1f)); }
+static inline __m128i getK(const __m128i c) { return _mm_and_si128(c, _mm_set1_epi16((int16_t) 0x8000)); }
+
+static inline __m128i makeColor(const __m128i r, const __m128i g, const __m128i b, const __m128i k) {
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi16(g, 5)), _mm_or_si128(_mm_slli_epi16(b, 10), k));
+}
+
+static inline __m128i select(const __m128i mask, const __m128i a, const __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Same as 'PSXColor::operator*(RGB)' for 8 colors
+static inline __m128i modulate(const __m128i c, const RGB color) {
+    const __m128i max = _mm_set1_epi16(31);
+    const __m128i r = _mm_min_epi16(_mm_srli_epi16(_mm_mullo_epi16(getR(c), _mm_set1_epi16(color.r)), 7), max);
+    const __m128i g = _mm_min_epi16(_mm_srli_epi16(_mm_mullo_epi16(getG(c), _mm_set1_epi16(color.g)), 7), max);
+    const __m128i b = _mm_min_epi16(_mm_srli_epi16(_mm_mullo_epi16(getB(c), _mm_set1_epi16(color.b)), 7), max);
+    return makeColor(r, g, b, getK(c));
+}
+
+// Same as 'PSXColor::blend' for 8 colors
+static inline __m128i blend(const __m128i bg, const __m128i c, const gpu::SemiTransparency transparency) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(31);
+    const __m128i bgR = getR(bg), bgG = getG(bg), bgB = getB(bg);
+    const __m128i cR = getR(c), cG = getG(c), cB = getB(c);
+    __m128i r, g, b;
+
+    switch (transparency) {
+        case gpu::SemiTransparency::Bby2plusFby2:
+            r = _mm_srli_epi16(_mm_add_epi16(bgR, cR), 1);
+            g = _mm_srli_epi16(_mm_add_epi16(bgG, cG), 1);
+            b = _mm_srli_epi16(_mm_add_epi16(bgB, cB), 1);
+            break;
+
+        case gpu::SemiTransparency::BplusF:
+            r = _mm_min_epi16(_mm_add_epi16(bgR, cR), max);
+            g = _mm_min_epi16(_mm_add_epi16(bgG, cG), max);
+            b = _mm_min_epi16(_mm_add_epi16(bgB, cB), max);
+            break;
+
+        case gpu::SemiTransparency::BminusF:
+            r = _mm_max_epi16(_mm_sub_epi16(bgR, cR), zero);
+            g = _mm_max_epi16(_mm_sub_epi16(bgG, cG), zero);
+            b = _mm_max_epi16(_mm_sub_epi16(bgB, cB), zero);
+            break;
+
+        default:
+            r = _mm_min_epi16(_mm_add_epi16(bgR, _mm_srli_epi16(cR, 2)), max);
+            g = _mm_min_epi16(_mm_add_epi16(bgG, _mm_srli_epi16(cG, 2)), max);
+            b = _mm_min_epi16(_mm_add_epi16(bgB, _mm_srli_epi16(cB, 2)), max);
+            break;
+    }
+
+    return makeColor(r, g, b, getK(c));
+}
+#endif  // USE_SSE2_SPAN_FILLER
+
+// PsyDoom: fills a horizontal span of a flat shaded, undithered and textured triangle.
+// This is the most common case by far for PsyDoom (walls, floors, sprites and UI) and produces exactly the same output as the general
+// per-pixel path in 'rasterizeTriangle'. Where SSE2 is available texels are fetched individually but shading, blending and the masked
+// write to VRAM are done for 8 pixels at a time.
+template <ColorDepth bits, bool isSemiTransparent, bool isBlended, bool checkMaskBeforeDraw>
+void fillTexturedSpan(
+    gpu::RenderState* state,
+    const primitive::Triangle& triangle,
+    const int y,
+    const int x1,
+    const int x2,
+    delta_t u,
+    delta_t v,
+    const delta_t du,
+    const delta_t dv
+) {
+    const auto transparency = triangle.transparency;
+    const bool setMaskWhileDrawing = state->gp0_e6.setMaskWhileDrawing;
+    const auto textureWindow = state->gp0_e2;
+    const RGB colorFlat = triangle.v[0].color;
+    uint16_t* const pRow = TARGET_ROW(y);
+    int x = x1;
+
+#if USE_SSE2_SPAN_FILLER
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i setMask = _mm_set1_epi16(setMaskWhileDrawing ? (int16_t) 0x8000 : 0);
+
+    for (; x + 7 <= x2; x += 8) {
+        alignas(16) uint16_t texels[8];
+
+        for (int i = 0; i < 8; ++i) {
+            const ivec2 texel = maskTexel(ivec2(FROM_FP(u), FROM_FP(v)), textureWindow);
+            texels[i] = fetchTex<bits>(state, texel, triangle.texpage).raw;
+            u += du;
+            v += dv;
+        }
+
+        __m128i c = _mm_load_si128((const __m128i*) texels);
+        const __m128i bg = _mm_loadu_si128((const __m128i*)(pRow + x));
+
+        // Fully transparent texels (and pixels protected by the mask bit, if checking) are not written
+        __m128i writeMask = _mm_andnot_si128(_mm_cmpeq_epi16(c, zero), _mm_cmpeq_epi16(zero, zero));
+
+        if constexpr (checkMaskBeforeDraw) {
+            writeMask = _mm_and_si128(writeMask, _mm_cmpeq_epi16(getK(bg), zero));
+        }
+
+        if (_mm_movemask_epi8(writeMask) == 0)
+            continue;
+
+        if constexpr (isBlended) {
+            c = modulate(c, colorFlat);
+        }
+
+        if constexpr (isSemiTransparent) {
+            c = select(_mm_srai_epi16(c, 15), blend(bg, c, transparency), c);
+        }
+
+        c = _mm_or_si128(c, setMask);
+        _mm_storeu_si128((__m128i*)(pRow + x), select(writeMask, c, bg));
+    }
+#endif
+
+    for (; x <= x2; ++x) {
+        const ivec2 texel = maskTexel(ivec2(FROM_FP(u), FROM_FP(v)), textureWindow);
+        PSXColor c = fetchTex<bits>(state, texel, triangle.texpage);
+        u += du;
+        v += dv;
+
+        if (c.raw == 0x0000) continue;
+
+        const PSXColor bg = pRow[x];
+
+        if constexpr (checkMaskBeforeDraw) {
+            if (bg.k) continue;
+        }
+
+        if constexpr (isBlended) {
+            c = c * colorFlat;
+        }
+
+        if constexpr (isSemiTransparent) {
+            if (c.k) {
+                c = PSXColor::blend(bg, c, transparency);
+            }
+        }
+
+        c.k |= setMaskWhileDrawing;
+        pRow[x] = c.raw;
+    }
+}
+#endif  // PSYDOOM_AVOCADO_MODS
+
 template <ColorDepth bits, bool isSemiTransparent, bool isGouraudShaded, bool isBlended, bool checkMaskBeforeDraw, bool dithering>
-void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
+void rasterizeTriangle(gpu::RenderState* state, const primitive::Triangle& triangle) {
     // Extract common GPU state
     const auto transparency = triangle.transparency;
-    const bool setMaskWhileDrawing = gpu->gp0_e6.setMaskWhileDrawing;
-    const auto textureWindow = gpu->gp0_e2;
+    const bool setMaskWhileDrawing = state->gp0_e6.setMaskWhileDrawing;
+    const auto textureWindow = state->gp0_e2;
     constexpr bool isTextured = bits != ColorDepth::NONE;
     constexpr bool isDithered = dithering && isBlended;
 
@@ -222,7 +423,7 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
     const int area = orient2d(pos[0], pos[1], pos[2]);
     if (area == 0) return;
 
-    loadClutCacheIfRequired<bits>(gpu, triangle.clut);
+    loadClutCacheIfRequired<bits>(state, triangle.clut);
 
     ivec2 min(                                     //
         std::min({pos[0].x, pos[1].x, pos[2].x}),  //
@@ -233,17 +434,17 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
         std::max({pos[0].y, pos[1].y, pos[2].y})   //
     );
 
-    // Skip rendering when distance between vertices is bigger than 1023x511
+    // Skip rendering when distance between vertices is bigger than 1023x511 (in original resolution pixels)
     const ivec2 size = max - min;
-    if (size.x >= 1024 || size.y >= 512) return;
+    if (size.x >= (1024 << state->scaleShift) || size.y >= (512 << state->scaleShift)) return;
 
     min = ivec2(                  //
-        gpu->minDrawingX(min.x),  //
-        gpu->minDrawingY(min.y)   //
+        state->minDrawingX(min.x),  //
+        state->minDrawingY(min.y)   //
     );
     max = ivec2(                  //
-        gpu->maxDrawingX(max.x),  //
-        gpu->maxDrawingY(max.y)   //
+        state->maxDrawingX(max.x),  //
+        state->maxDrawingY(max.y)   //
     );
 
     // https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
@@ -264,11 +465,58 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
         orient2d(pos[0], pos[1], min) + bias[2]   //
     };
 
+#ifdef USE_FIXED_POINT
+    // PsyDoom: evaluate the start attributes exactly at the first pixel rather than stepping there from the VRAM origin.
+    // This keeps the fixed point values small and limits the number of rounded steps taken.
+    Attributes startAttributes = calculateStartAttributes<isGouraudShaded, isTextured>(triangle, min);
+    AttributeDeltas deltas = calculateDeltas<isGouraudShaded, isTextured>(triangle);
+#else
     Attributes startAttributes = calculateStartAttributes<isGouraudShaded, isTextured>(triangle);
     AttributeDeltas deltas = calculateDeltas<isGouraudShaded, isTextured>(triangle);
 
     addYDeltas<isGouraudShaded, isTextured>(startAttributes, deltas, min.y);
     addXDeltas<isGouraudShaded, isTextured>(startAttributes, deltas, min.x);
+#endif
+
+    // PsyDoom: use the span filler for flat shaded, undithered CLUT textured triangles.
+    // Since the edge functions sum to 'area + bias[0] + bias[1] + bias[2]', an area above 3 guarantees that they are never all zero.
+    // The regular inside test then reduces to all edge functions being >= 0, which is what the span extents are computed from.
+#if PSYDOOM_AVOCADO_MODS
+    constexpr bool bCanUseSpanFiller = ((bits == ColorDepth::BIT_4) || (bits == ColorDepth::BIT_8)) && (!isGouraudShaded) && (!isDithered);
+
+    if constexpr (bCanUseSpanFiller) {
+        if (area > 3) {
+            for (int y = min.y; y <= max.y; y++) {
+                int spanL = 0;
+                int spanR = max.x - min.x;
+                clipSpanToEdge(CY[0], D12.y, spanL, spanR);
+                clipSpanToEdge(CY[1], D20.y, spanL, spanR);
+                clipSpanToEdge(CY[2], D01.y, spanL, spanR);
+
+                if (spanL <= spanR) {
+                    fillTexturedSpan<bits, isSemiTransparent, isBlended, checkMaskBeforeDraw>(
+                        state,
+                        triangle,
+                        y,
+                        min.x + spanL,
+                        min.x + spanR,
+                        startAttributes.u + deltas.u.x * spanL,
+                        startAttributes.v + deltas.v.x * spanL,
+                        deltas.u.x,
+                        deltas.v.x
+                    );
+                }
+
+                CY[0] += D12.x;
+                CY[1] += D20.x;
+                CY[2] += D01.x;
+                addYDeltas<isGouraudShaded, isTextured>(startAttributes, deltas);
+            }
+
+            return;
+        }
+    }
+#endif
 
     ivec2 p;
     for (p.y = min.y; p.y <= max.y; p.y++) {
@@ -277,7 +525,7 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
 
         for (p.x = min.x; p.x <= max.x; p.x++) {
             if ((CX[0] | CX[1] | CX[2]) > 0) {
-                const PSXColor bg = VRAM[p.y][p.x];
+                const PSXColor bg = TARGET_ROW(p.y)[p.x];
                 if constexpr (checkMaskBeforeDraw) {
                     if (bg.k) goto DONE;
                 }
@@ -302,7 +550,7 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
                 } else {
                     const ivec2 uv(FROM_FP(attrib.u), FROM_FP(attrib.v));
                     const ivec2 texel = maskTexel(uv, textureWindow);
-                    c = fetchTex<bits>(gpu, texel, triangle.texpage);
+                    c = fetchTex<bits>(state, texel, triangle.texpage);
                     if (c.raw == 0x0000) goto DONE;
 
                     if constexpr (isBlended) {
@@ -326,7 +574,7 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
 
                 c.k |= setMaskWhileDrawing;
 
-                VRAM[p.y][p.x] = c.raw;
+                TARGET_ROW(p.y)[p.x] = c.raw;
             }
 
         DONE:
@@ -343,7 +591,7 @@ void rasterizeTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
 }
 
 // Generate all permutations of rasterizeTriangle so that compiler can provide optimized versions of the function (no ifs in loop)
-using rasterizeTriangle_t = void(gpu::GPU* gpu, const primitive::Triangle& triangle);
+using rasterizeTriangle_t = void(gpu::RenderState* state, const primitive::Triangle& triangle);
 
 #define E(bits, isSemiTransparent, isGouraudShaded, isBlended, checkMaskBit, dithering) \
     &rasterizeTriangle<bitsToDepth<bits>(), isSemiTransparent, isGouraudShaded, isBlended, checkMaskBit, dithering>
@@ -401,15 +649,15 @@ static constexpr rasterizeTriangle_t* rasterizeTriangleDispatchTable[4][2][2][2]
         {{E(16, 1, 1, 1, 0, 0), E(16, 1, 1, 1, 0, 1)}, {E(16, 1, 1, 1, 1, 0), E(16, 1, 1, 1, 1, 1)}}}}}};
 #undef E
 
-void Render::drawTriangle(gpu::GPU* gpu, const primitive::Triangle& triangle) {
+void Render::drawTriangle(gpu::RenderState* state, const primitive::Triangle& triangle) {
     auto bits = (int)bitsToDepth(triangle.bits);
     auto isSemiTransparent = triangle.isSemiTransparent;
     auto isGouraudShaded = triangle.gouraudShading;
     auto isBlended = !triangle.isRawTexture;
-    auto checkMaskBit = gpu->gp0_e6.checkMaskBeforeDraw;
-    auto dithering = gpu->gp0_e1.dither24to15;
+    auto checkMaskBit = state->gp0_e6.checkMaskBeforeDraw;
+    auto dithering = state->gp0_e1.dither24to15;
 
     auto rasterize = rasterizeTriangleDispatchTable[bits][isSemiTransparent][isGouraudShaded][isBlended][checkMaskBit][dithering];
 
-    rasterize(gpu, triangle);
+    rasterize(state, triangle);
 }
\ No newline at end of file
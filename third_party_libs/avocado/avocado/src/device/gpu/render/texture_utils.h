@@ -4,54 +4,54 @@
 #include "../color_depth.h"
 #include "../primitive.h"
 
-#define gpuVRAM ((uint16_t(*)[gpu::VRAM_WIDTH])gpu->vram.data())
+#define gpuVRAM ((uint16_t(*)[gpu::VRAM_WIDTH])state->vram)
 
 template <ColorDepth bits>
-void loadClutCacheIfRequired(gpu::GPU* gpu, ivec2 clut) {
+void loadClutCacheIfRequired(gpu::RenderState* state, ivec2 clut) {
     // Only paletted textures should reload the color look-up table cache
     if constexpr (bits != ColorDepth::BIT_4 && bits != ColorDepth::BIT_8) {
         return;
     }
 
-    bool textureFormatRequireReload = bits > gpu->clutCacheColorDepth;
-    bool clutPositionChanged = gpu->clutCachePos != clut;
+    bool textureFormatRequireReload = bits > state->clutCache->colorDepth;
+    bool clutPositionChanged = state->clutCache->pos != clut;
 
     if (!textureFormatRequireReload && !clutPositionChanged) {
         return;
     }
 
-    gpu->clutCacheColorDepth = bits;
-    gpu->clutCachePos = clut;
+    state->clutCache->colorDepth = bits;
+    state->clutCache->pos = clut;
 
     constexpr int entries = (bits == ColorDepth::BIT_8) ? 256 : 16;
     for (int i = 0; i < entries; i++) {
-        gpu->clutCache[i] = gpuVRAM[clut.y][clut.x + i];
+        state->clutCache->entries[i] = gpuVRAM[clut.y][clut.x + i];
     }
 }
 
 namespace {
-INLINE uint16_t tex4bit(gpu::GPU* gpu, ivec2 tex, ivec2 texPage) {
+INLINE uint16_t tex4bit(gpu::RenderState* state, ivec2 tex, ivec2 texPage) {
     uint16_t index = gpuVRAM[(texPage.y + tex.y) & 511][(texPage.x + tex.x / 4) & 1023];
     uint8_t entry = (index >> ((tex.x & 3) * 4)) & 0xf;
-    return gpu->clutCache[entry];
+    return state->clutCache->entries[entry];
 }
 
-INLINE uint16_t tex8bit(gpu::GPU* gpu, ivec2 tex, ivec2 texPage) {
+INLINE uint16_t tex8bit(gpu::RenderState* state, ivec2 tex, ivec2 texPage) {
     uint16_t index = gpuVRAM[(texPage.y + tex.y) & 511][(texPage.x + tex.x / 2) & 1023];
     uint8_t entry = (index >> ((tex.x & 1) * 8)) & 0xff;
-    return gpu->clutCache[entry];
+    return state->clutCache->entries[entry];
 }
 
-INLINE uint16_t tex16bit(gpu::GPU* gpu, ivec2 tex, ivec2 texPage) { return gpuVRAM[(texPage.y + tex.y) & 511][(texPage.x + tex.x) & 1023]; }
+INLINE uint16_t tex16bit(gpu::RenderState* state, ivec2 tex, ivec2 texPage) { return gpuVRAM[(texPage.y + tex.y) & 511][(texPage.x + tex.x) & 1023]; }
 
 template <ColorDepth bits>
-INLINE PSXColor fetchTex(gpu::GPU* gpu, ivec2 texel, const ivec2 texPage) {
+INLINE PSXColor fetchTex(gpu::RenderState* state, ivec2 texel, const ivec2 texPage) {
     if constexpr (bits == ColorDepth::BIT_4) {
-        return tex4bit(gpu, texel, texPage);
+        return tex4bit(state, texel, texPage);
     } else if constexpr (bits == ColorDepth::BIT_8) {
-        return tex8bit(gpu, texel, texPage);
+        return tex8bit(state, texel, texPage);
     } else if constexpr (bits == ColorDepth::BIT_16) {
-        return tex16bit(gpu, texel, texPage);
+        return tex16bit(state, texel, texPage);
     } else {
         static_assert(true, "Invalid ColorDepth parameter");
     }
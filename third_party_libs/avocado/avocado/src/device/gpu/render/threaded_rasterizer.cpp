@@ -0,0 +1,214 @@
+#include "threaded_rasterizer.h"
+#include <algorithm>
+#include "render.h"
+
+ThreadedRasterizer::ThreadedRasterizer(int numThreads) : jobs(MAX_JOBS) {
+    numThreads = std::clamp(numThreads, 1, NUM_TILES);
+
+    for (int i = 0; i < numThreads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        workers[i]->thread = std::thread([this, i]() { workerMain(i); });
+    }
+}
+
+ThreadedRasterizer::~ThreadedRasterizer() {
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+
+    workReady.notify_all();
+
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void ThreadedRasterizer::drawTriangle(const gpu::RenderState& state, const primitive::Triangle& triangle) {
+    const int minY = std::min({triangle.v[0].pos.y, triangle.v[1].pos.y, triangle.v[2].pos.y});
+    const int maxY = std::max({triangle.v[0].pos.y, triangle.v[1].pos.y, triangle.v[2].pos.y});
+
+    if (Job* job = allocJob(JobType::Triangle, state, minY, maxY)) {
+        job->triangle = triangle;
+        submitJob();
+    }
+}
+
+void ThreadedRasterizer::drawLine(const gpu::RenderState& state, const primitive::Line& line) {
+    const int minY = std::min(line.pos[0].y, line.pos[1].y);
+    const int maxY = std::max(line.pos[0].y, line.pos[1].y);
+
+    if (Job* job = allocJob(JobType::Line, state, minY, maxY)) {
+        job->line = line;
+        submitJob();
+    }
+}
+
+void ThreadedRasterizer::drawRectangle(const gpu::RenderState& state, const primitive::Rect& rect) {
+    if (Job* job = allocJob(JobType::Rectangle, state, rect.pos.y, rect.pos.y + rect.size.y - 1)) {
+        job->rect = rect;
+        submitJob();
+    }
+}
+
+void ThreadedRasterizer::fillRectangle(const gpu::RenderState& state, uint16_t color) {
+    if (Job* job = allocJob(JobType::Fill, state, state.drawingArea.top, state.drawingArea.bottom)) {
+        job->fillColor = color;
+        submitJob();
+    }
+}
+
+void ThreadedRasterizer::flush() {
+    if (numJobs == 0) return;
+
+    publishJobs();
+
+    // Wait for all workers to finish everything that was queued, then start over with an empty job list
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workDone.wait(lock, [this]() {
+            return std::all_of(workers.begin(), workers.end(), [this](auto& worker) { return worker->numJobsDone == numJobsPublished; });
+        });
+
+        numJobsPublished = 0;
+
+        for (auto& worker : workers) {
+            worker->numJobsDone = 0;
+
+            // VRAM may be modified directly after this point, so cached palettes can no longer be trusted
+            worker->clutCache.pos = ivec2(-1, -1);
+        }
+    }
+
+    numJobsFlushed += numJobs;
+    numJobs = 0;
+}
+
+void ThreadedRasterizer::waitForFence(uint64_t fence) {
+    // Fences from before the last flush are already done
+    if (fence <= numJobsFlushed) return;
+
+    // Make sure the workers can see all of the jobs before the fence, then wait for them to get through those jobs
+    const uint32_t numFenceJobs = (uint32_t)std::min<uint64_t>(fence - numJobsFlushed, numJobs);
+    publishJobs();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&]() {
+        return std::all_of(workers.begin(), workers.end(), [&](auto& worker) { return worker->numJobsDone >= numFenceJobs; });
+    });
+}
+
+ThreadedRasterizer::Job* ThreadedRasterizer::allocJob(JobType type, const gpu::RenderState& state, int minY, int maxY) {
+    // Skip primitives which are entirely outside of the drawing area or the draw target, no worker would draw anything for them
+    minY = std::max({minY, (int)state.drawingArea.top, 0});
+    maxY = std::min({maxY, (int)state.drawingArea.bottom, state.targetHeight - 1});
+
+    if (minY > maxY) return nullptr;
+
+    if (numJobs >= MAX_JOBS) {
+        flush();
+    }
+
+    Job& job = jobs[numJobs];
+    job.type = type;
+    job.minY = (int16_t)minY;
+    job.maxY = (int16_t)maxY;
+    job.state = state;
+    return &job;
+}
+
+void ThreadedRasterizer::submitJob() {
+    numJobs++;
+
+    if (numJobs % PUBLISH_BATCH_SIZE == 0) {
+        publishJobs();
+    }
+}
+
+void ThreadedRasterizer::publishJobs() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        numJobsPublished = numJobs;
+    }
+
+    workReady.notify_all();
+}
+
+void ThreadedRasterizer::workerMain(int workerIdx) {
+    Worker& worker = *workers[workerIdx];
+
+    while (true) {
+        uint32_t beginJob, endJob;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [&]() { return quit || numJobsPublished > worker.numJobsDone; });
+
+            if (quit) return;
+
+            beginJob = worker.numJobsDone;
+            endJob = numJobsPublished;
+        }
+
+        for (uint32_t i = beginJob; i < endJob; i++) {
+            executeJob(jobs[i], worker, workerIdx);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            worker.numJobsDone = endJob;
+        }
+
+        workDone.notify_one();
+    }
+}
+
+void ThreadedRasterizer::executeJob(const Job& job, Worker& worker, int workerIdx) {
+    const int numWorkers = (int)workers.size();
+    const int firstTile = job.minY / TILE_HEIGHT;
+    const int lastTile = job.maxY / TILE_HEIGHT;
+
+    // Tiles are dealt out round robin, find the first one at or after the top of the primitive that belongs to this worker
+    int tile = firstTile + (workerIdx - firstTile % numWorkers + numWorkers) % numWorkers;
+
+    for (; tile <= lastTile; tile += numWorkers) {
+        const int tileTop = tile * TILE_HEIGHT;
+        const int tileBottom = tileTop + TILE_HEIGHT - 1;
+
+        gpu::RenderState state = job.state;
+        state.clutCache = &worker.clutCache;
+        state.drawingArea.top = (int16_t)std::max((int)state.drawingArea.top, tileTop);
+
+        switch (job.type) {
+            case JobType::Triangle:
+                state.drawingArea.bottom = (int16_t)std::min((int)state.drawingArea.bottom, tileBottom);
+                Render::drawTriangle(&state, job.triangle);
+                break;
+
+            // Note: lines treat the bottom of the drawing area as exclusive, unlike the other primitives
+            case JobType::Line:
+                state.drawingArea.bottom = (int16_t)std::min((int)state.drawingArea.bottom, tileBottom + 1);
+                Render::drawLine(&state, job.line);
+                break;
+
+            case JobType::Rectangle:
+                state.drawingArea.bottom = (int16_t)std::min((int)state.drawingArea.bottom, tileBottom);
+                Render::drawRectangle(&state, job.rect);
+                break;
+
+            case JobType::Fill:
+                state.drawingArea.bottom = (int16_t)std::min((int)state.drawingArea.bottom, tileBottom);
+
+                for (int y = state.drawingArea.top; y <= state.drawingArea.bottom; y++) {
+                    uint16_t* const row = state.target + y * state.targetWidth;
+                    std::fill(row + state.drawingArea.left, row + state.drawingArea.right + 1, job.fillColor);
+                }
+                break;
+        }
+    }
+}
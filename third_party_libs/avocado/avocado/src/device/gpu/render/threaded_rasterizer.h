@@ -0,0 +1,79 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "device/gpu/gpu.h"
+
+// PsyDoom: multithreaded software rasterization.
+//
+// Drawing primitives are captured along with a snapshot of the GPU drawing state and streamed to a pool of worker threads.
+// The draw target is split up into horizontal tiles which are dealt out to the workers in an interleaved fashion; each worker draws every primitive
+// overlapping one of its tiles, in submission order, clipped to the bounds of that tile. Since no two workers ever touch the same target
+// rows and the rasterizers produce the same result for a pixel regardless of clipping, the output is identical to drawing serially.
+//
+// Anything which reads or writes VRAM directly must call 'flush()' first to wait for all queued drawing to finish.
+// Alternatively a fence can be taken after submitting some drawing, and waited on later to ensure just that drawing is done.
+class ThreadedRasterizer {
+   public:
+    explicit ThreadedRasterizer(int numThreads);
+    ~ThreadedRasterizer();
+
+    int getNumThreads() const { return (int)workers.size(); }
+
+    void drawTriangle(const gpu::RenderState& state, const primitive::Triangle& triangle);
+    void drawLine(const gpu::RenderState& state, const primitive::Line& line);
+    void drawRectangle(const gpu::RenderState& state, const primitive::Rect& rect);
+    void fillRectangle(const gpu::RenderState& state, uint16_t color);
+
+    void flush();
+
+    uint64_t getFence() const { return numJobsFlushed + numJobs; }
+    void waitForFence(uint64_t fence);
+
+   private:
+    // Height of each VRAM tile in rows and the maximum number of jobs that can be queued before a flush is forced
+    static constexpr int TILE_HEIGHT = 16;
+    static constexpr int NUM_TILES = gpu::VRAM_HEIGHT / TILE_HEIGHT;
+    static constexpr uint32_t MAX_JOBS = 16384;
+
+    // How many jobs to queue up before waking the workers
+    static constexpr uint32_t PUBLISH_BATCH_SIZE = 16;
+
+    enum class JobType : uint8_t { Triangle, Line, Rectangle, Fill };
+
+    struct Job {
+        JobType type;
+        int16_t minY;
+        int16_t maxY;
+        gpu::RenderState state;
+        primitive::Triangle triangle;  // Valid if type == Triangle
+        primitive::Line line;          // Valid if type == Line
+        primitive::Rect rect;          // Valid if type == Rectangle
+        uint16_t fillColor;            // Valid if type == Fill, which fills the whole drawing area
+    };
+
+    struct Worker {
+        std::thread thread;
+        gpu::ClutCache clutCache;
+        uint32_t numJobsDone = 0;  // Guarded by 'mutex'
+    };
+
+    std::vector<Job> jobs;
+    uint32_t numJobs = 0;
+    uint64_t numJobsFlushed = 0;  // Total number of jobs completed by previous flushes, used as the base for fences
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    uint32_t numJobsPublished = 0;  // Guarded by 'mutex'
+    bool quit = false;              // Guarded by 'mutex'
+
+    Job* allocJob(JobType type, const gpu::RenderState& state, int minY, int maxY);
+    void submitJob();
+    void publishJobs();
+    void workerMain(int workerIdx);
+    void executeJob(const Job& job, Worker& worker, int workerIdx);
+};
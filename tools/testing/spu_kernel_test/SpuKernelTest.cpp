@@ -0,0 +1,84 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// SpuKernelTest:
+//      Checks that the SIMD versions of the SPU mixing kernels (interpolation, volume scaling and mixing) produce exactly the same output
+//      as the plain C++ versions. Both builds of the SPU are run on the same random inputs and the outputs must match bit for bit.
+//      Returns '0' if all outputs match, or '1' if there are any differences.
+//
+//      Usage: SpuKernelTest [NUM_SEEDS]
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "SpuKernelTest.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Compare the output of one kernel from the SIMD and plain C++ builds and report the first difference, if any
+//------------------------------------------------------------------------------------------------------------------------------------------
+static bool compareKernelOutput(
+    const char* const kernelName,
+    const uint32_t seed,
+    const std::vector<int16_t>& simdOutput,
+    const std::vector<int16_t>& scalarOutput
+) noexcept {
+    if (simdOutput.size() != scalarOutput.size()) {
+        std::printf(
+            "%s (seed %u): output size mismatch! SIMD: %zu, scalar: %zu\n",
+            kernelName,
+            seed,
+            simdOutput.size(),
+            scalarOutput.size()
+        );
+
+        return false;
+    }
+
+    for (size_t i = 0; i < simdOutput.size(); ++i) {
+        if (simdOutput[i] != scalarOutput[i]) {
+            std::printf(
+                "%s (seed %u): output mismatch at sample %zu! SIMD: %d, scalar: %d\n",
+                kernelName,
+                seed,
+                i,
+                (int) simdOutput[i],
+                (int) scalarOutput[i]
+            );
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, const char* const argv[]) noexcept {
+    const uint32_t numSeeds = (argc >= 2) ? (uint32_t) std::strtoul(argv[1], nullptr, 10) : 4;
+    std::printf("Checking SPU kernels (SIMD type: %s) with %u seeds...\n", SpuSimdKernels::getSimdType(), numSeeds);
+
+    bool bAllMatch = true;
+    size_t numSamplesChecked = 0;
+
+    for (uint32_t seed = 1; seed <= numSeeds; ++seed) {
+        KernelOutputs simdOutputs;
+        KernelOutputs scalarOutputs;
+        SpuSimdKernels::runKernels(seed, simdOutputs);
+        SpuScalarKernels::runKernels(seed, scalarOutputs);
+
+        bAllMatch &= compareKernelOutput("Interpolate", seed, simdOutputs.interpolate, scalarOutputs.interpolate);
+        bAllMatch &= compareKernelOutput("AttenuateAndAccumulate", seed, simdOutputs.attenuateAndAccumulate, scalarOutputs.attenuateAndAccumulate);
+        bAllMatch &= compareKernelOutput("Attenuate", seed, simdOutputs.attenuate, scalarOutputs.attenuate);
+        bAllMatch &= compareKernelOutput("AddAndAttenuate", seed, simdOutputs.addAndAttenuate, scalarOutputs.addAndAttenuate);
+        bAllMatch &= compareKernelOutput("Interleave", seed, simdOutputs.interleave, scalarOutputs.interleave);
+        bAllMatch &= compareKernelOutput("Core", seed, simdOutputs.core, scalarOutputs.core);
+
+        numSamplesChecked += scalarOutputs.interpolate.size() + scalarOutputs.attenuateAndAccumulate.size() + scalarOutputs.attenuate.size();
+        numSamplesChecked += scalarOutputs.addAndAttenuate.size() + scalarOutputs.interleave.size() + scalarOutputs.core.size();
+    }
+
+    if (bAllMatch) {
+        std::printf("All %zu samples match.\n", numSamplesChecked);
+        return 0;
+    } else {
+        std::printf("SIMD and plain C++ kernel outputs differ!\n");
+        return 1;
+    }
+}
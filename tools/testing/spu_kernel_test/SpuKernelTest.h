@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Macros.h"
+
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// The output of each of the SPU mixing kernels for a set of randomly generated inputs.
+// Produced once by the SIMD build of the SPU and once by the plain C++ build, so the two can be compared.
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct KernelOutputs {
+    std::vector<int16_t>    interpolate;                // Gaussian interpolation of voice samples
+    std::vector<int16_t>    attenuateAndAccumulate;     // Voice volume scaling and saturating accumulation into a mix
+    std::vector<int16_t>    attenuate;                  // Envelope scaling with a volume for each sample
+    std::vector<int16_t>    addAndAttenuate;            // Adding dry and reverb mixes and applying master volume
+    std::vector<int16_t>    interleave;                 // Interleaving left and right channels into stereo samples
+    std::vector<int16_t>    core;                       // Output of a whole SPU core with random voices, reverb and external input
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A small random number generator (xorshift) so both builds of the SPU get exactly the same inputs for a given seed
+//------------------------------------------------------------------------------------------------------------------------------------------
+struct TestRng {
+    uint32_t state;
+
+    uint32_t next() noexcept {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Random number in the range 0 to 'max' inclusive
+    uint32_t nextUpTo(const uint32_t max) noexcept {
+        return next() % (max + 1);
+    }
+
+    // Random sample, volume or other 16-bit value: occasionally gives the most extreme values to exercise overflow and saturation
+    int16_t nextInt16() noexcept {
+        switch (nextUpTo(15)) {
+            case 0:     return INT16_MIN;
+            case 1:     return INT16_MAX;
+            default:    return (int16_t) next();
+        }
+    }
+};
+
+// Run all the kernels on random inputs generated from the given seed, using the SIMD and plain C++ builds of the SPU respectively
+BEGIN_NAMESPACE(SpuSimdKernels)
+    void runKernels(const uint32_t seed, KernelOutputs& outputs) noexcept;
+    const char* getSimdType() noexcept;
+END_NAMESPACE(SpuSimdKernels)
+
+BEGIN_NAMESPACE(SpuScalarKernels)
+    void runKernels(const uint32_t seed, KernelOutputs& outputs) noexcept;
+END_NAMESPACE(SpuScalarKernels)
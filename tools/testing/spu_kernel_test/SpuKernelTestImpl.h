@@ -0,0 +1,271 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Runs each of the SPU mixing kernels on random inputs and saves the output.
+//
+// Note: this is deliberately included more than once and has no include guard. Each includer first compiles in a copy of 'Spu.cpp' (with
+// or without SIMD) and defines 'KERNEL_TEST_NAMESPACE' so that the tests below are built against that particular copy of the SPU.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "SpuKernelTest.h"
+
+#include <cstring>
+
+BEGIN_NAMESPACE(KERNEL_TEST_NAMESPACE)
+
+static constexpr uint32_t NUM_KERNEL_RUNS   = 2000;     // How many times to run each individual kernel on new random inputs
+static constexpr uint32_t MAX_KERNEL_LEN    = 256;      // Maximum number of samples processed by each kernel run
+static constexpr uint32_t NUM_CORE_BLOCKS   = 400;      // How many blocks of output to generate from the whole SPU core
+static constexpr uint32_t CORE_RAM_SIZE     = 64 * 1024;
+static constexpr uint32_t CORE_SOUNDS_SIZE  = 48 * 1024;    // Sounds are in the lower part of RAM and reverb works on the rest
+static constexpr uint32_t CORE_NUM_VOICES   = 24;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Gaussian interpolation: random sample data, pitch and starting position within an ADPCM block.
+// The number of samples is limited so that all sample positions remain within the block, as 'interpolateVoiceSamples' requires.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testInterpolate(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    for (uint32_t run = 0; run < NUM_KERNEL_RUNS; ++run) {
+        int16_t samples[Spu::Voice::SAMPLE_BUFFER_SIZE];
+
+        for (int16_t& sample : samples) {
+            sample = rng.nextInt16();
+        }
+
+        Spu::AdpcmBlockPos blockPos = {};
+        blockPos.counter = rng.nextUpTo(Spu::ADPCM_BLOCK_NUM_SAMPLES * 0x1000 - 1);
+        const uint32_t sampleRate = 1 + rng.nextUpTo(Spu::MAX_SAMPLE_RATE - 1);
+
+        const uint32_t blockEndCounter = Spu::ADPCM_BLOCK_NUM_SAMPLES * 0x1000;
+        const uint32_t maxSamples = std::min((blockEndCounter - 1 - blockPos.counter) / sampleRate + 1, MAX_KERNEL_LEN);
+        const uint32_t numSamples = rng.nextUpTo(maxSamples);
+        int16_t results[MAX_KERNEL_LEN];
+        interpolateVoiceSamples(results, samples, blockPos, sampleRate, numSamples);
+        output.insert(output.end(), results, results + numSamples);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Voice volume scaling and accumulation into a mix, with a fixed volume
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testAttenuateAndAccumulate(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    for (uint32_t run = 0; run < NUM_KERNEL_RUNS; ++run) {
+        int16_t dst[MAX_KERNEL_LEN];
+        int16_t src[MAX_KERNEL_LEN];
+        const uint32_t numSamples = rng.nextUpTo(MAX_KERNEL_LEN);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            dst[i] = rng.nextInt16();
+            src[i] = rng.nextInt16();
+        }
+
+        attenuateAndAccumulate(dst, src, rng.nextInt16(), numSamples);
+        output.insert(output.end(), dst, dst + numSamples);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Envelope scaling, with a different volume for each sample
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testAttenuate(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    for (uint32_t run = 0; run < NUM_KERNEL_RUNS; ++run) {
+        int16_t dst[MAX_KERNEL_LEN];
+        int16_t src[MAX_KERNEL_LEN];
+        int16_t volumes[MAX_KERNEL_LEN];
+        const uint32_t numSamples = rng.nextUpTo(MAX_KERNEL_LEN);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            src[i] = rng.nextInt16();
+            volumes[i] = rng.nextInt16();
+        }
+
+        attenuateSamples(dst, src, volumes, numSamples);
+        output.insert(output.end(), dst, dst + numSamples);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Final mixing of dry and reverb sound with the master volume applied
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testAddAndAttenuate(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    for (uint32_t run = 0; run < NUM_KERNEL_RUNS; ++run) {
+        int16_t dst[MAX_KERNEL_LEN];
+        int16_t src1[MAX_KERNEL_LEN];
+        int16_t src2[MAX_KERNEL_LEN];
+        const uint32_t numSamples = rng.nextUpTo(MAX_KERNEL_LEN);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            src1[i] = rng.nextInt16();
+            src2[i] = rng.nextInt16();
+        }
+
+        addAndAttenuate(dst, src1, src2, rng.nextInt16(), numSamples);
+        output.insert(output.end(), dst, dst + numSamples);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Interleaving separate left and right channels into stereo samples
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testInterleave(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    for (uint32_t run = 0; run < NUM_KERNEL_RUNS; ++run) {
+        int16_t srcL[MAX_KERNEL_LEN];
+        int16_t srcR[MAX_KERNEL_LEN];
+        Spu::StereoSample dst[MAX_KERNEL_LEN];
+        const uint32_t numSamples = rng.nextUpTo(MAX_KERNEL_LEN);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            srcL[i] = rng.nextInt16();
+            srcR[i] = rng.nextInt16();
+        }
+
+        interleaveStereo(dst, srcL, srcR, numSamples);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            output.push_back(dst[i].left);
+            output.push_back(dst[i].right);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// External input for the SPU core test: random sound generated from the RNG passed as user data
+//------------------------------------------------------------------------------------------------------------------------------------------
+static Spu::StereoSample testExtInputCallback(void* pUserData) noexcept {
+    TestRng& rng = *(TestRng*) pUserData;
+    const int16_t left = rng.nextInt16();
+    const int16_t right = rng.nextInt16();
+    return Spu::StereoSample{ left, right };
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Randomly setup a voice of the SPU core with a random sound, pitch, envelope and volume
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void randomizeVoice(TestRng& rng, Spu::Voice& voice) noexcept {
+    constexpr uint32_t NUM_SOUND_BLOCKS = CORE_SOUNDS_SIZE / Spu::ADPCM_BLOCK_SIZE;
+
+    voice.adpcmStartAddr8 = rng.nextUpTo(NUM_SOUND_BLOCKS - 1) * 2;
+    voice.adpcmRepeatAddr8 = rng.nextUpTo(NUM_SOUND_BLOCKS - 1) * 2;
+    voice.sampleRate = (uint16_t) rng.nextUpTo(Spu::MAX_SAMPLE_RATE);
+    voice.envBits = rng.next();
+    voice.volume.left = rng.nextInt16();
+    voice.volume.right = rng.nextInt16();
+    voice.bDoReverb = (rng.nextUpTo(1) != 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// A whole SPU core with random sounds in RAM, random voices and reverb settings and random external input.
+// Blocks of random sizes are mixed, and voices are randomly keyed on and off and changed in between, like the audio thread does.
+//------------------------------------------------------------------------------------------------------------------------------------------
+static void testCore(TestRng& rng, std::vector<int16_t>& output) noexcept {
+    Spu::Core core = {};
+    Spu::initCore(core, CORE_RAM_SIZE, CORE_NUM_VOICES);
+
+    // Fill RAM with valid ADPCM blocks (shift 0-12, filter 0-4) with occasional loop flags.
+    // The last block always loops back so that voices never play past the end of the sounds and into the reverb work area.
+    for (uint32_t blockOffset = 0; blockOffset < CORE_SOUNDS_SIZE; blockOffset += Spu::ADPCM_BLOCK_SIZE) {
+        std::byte* const pBlock = core.pRam + blockOffset;
+        const uint32_t shift = rng.nextUpTo(12);
+        const uint32_t filter = rng.nextUpTo(4);
+        const uint32_t flagsRoll = rng.nextUpTo(31);
+        uint8_t flags = 0;
+
+        if (blockOffset + Spu::ADPCM_BLOCK_SIZE >= CORE_SOUNDS_SIZE) {
+            flags = Spu::ADPCM_FLAG_LOOP_END | Spu::ADPCM_FLAG_REPEAT;
+        } else if (flagsRoll == 0) {
+            flags = Spu::ADPCM_FLAG_LOOP_START;
+        } else if (flagsRoll == 1) {
+            flags = Spu::ADPCM_FLAG_LOOP_END | Spu::ADPCM_FLAG_REPEAT;
+        } else if (flagsRoll == 2) {
+            flags = Spu::ADPCM_FLAG_LOOP_END;
+        }
+
+        pBlock[0] = (std::byte)((filter << 4) | shift);
+        pBlock[1] = (std::byte) flags;
+
+        for (uint32_t i = 2; i < Spu::ADPCM_BLOCK_SIZE; ++i) {
+            pBlock[i] = (std::byte) rng.next();
+        }
+    }
+
+    // Core settings
+    core.masterVol.left = rng.nextInt16();
+    core.masterVol.right = rng.nextInt16();
+    core.reverbVol.left = rng.nextInt16();
+    core.reverbVol.right = rng.nextInt16();
+    core.extInputVol.left = rng.nextInt16();
+    core.extInputVol.right = rng.nextInt16();
+    core.bUnmute = true;
+    core.bReverbWriteEnable = true;
+    core.bExtEnabled = true;
+    core.bExtReverbEnable = true;
+    core.pExtInputCallback = testExtInputCallback;
+    core.pExtInputUserData = &rng;
+    core.reverbBaseAddr8 = CORE_SOUNDS_SIZE / 8;
+
+    {
+        uint16_t regs[32];
+
+        for (uint16_t& reg : regs) {
+            reg = (uint16_t) rng.next();
+        }
+
+        std::memcpy(&core.reverbRegs, regs, sizeof(regs));
+    }
+
+    for (uint32_t voiceIdx = 0; voiceIdx < core.numVoices; ++voiceIdx) {
+        randomizeVoice(rng, core.pVoices[voiceIdx]);
+        Spu::keyOn(core.pVoices[voiceIdx]);
+    }
+
+    // Mix blocks of random sizes and randomly change voices in between
+    Spu::StereoSample samples[1024];
+
+    for (uint32_t blockIdx = 0; blockIdx < NUM_CORE_BLOCKS; ++blockIdx) {
+        const uint32_t numSamples = 1 + rng.nextUpTo(1023);
+        Spu::stepCoreBlock(core, samples, numSamples);
+
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            output.push_back(samples[i].left);
+            output.push_back(samples[i].right);
+        }
+
+        const uint32_t numVoiceChanges = rng.nextUpTo(8);
+
+        for (uint32_t i = 0; i < numVoiceChanges; ++i) {
+            Spu::Voice& voice = core.pVoices[rng.nextUpTo(core.numVoices - 1)];
+
+            if (rng.nextUpTo(1) != 0) {
+                randomizeVoice(rng, voice);
+                Spu::keyOn(voice);
+            } else {
+                Spu::keyOff(voice);
+            }
+        }
+
+        // Occasionally toggle muting, reverb writes and external input so those paths get covered too
+        if (rng.nextUpTo(15) == 0) {
+            core.bUnmute = !core.bUnmute;
+        }
+
+        if (rng.nextUpTo(15) == 0) {
+            core.bReverbWriteEnable = !core.bReverbWriteEnable;
+        }
+
+        if (rng.nextUpTo(15) == 0) {
+            core.bExtEnabled = !core.bExtEnabled;
+        }
+    }
+
+    Spu::destroyCore(core);
+}
+
+void runKernels(const uint32_t seed, KernelOutputs& outputs) noexcept {
+    TestRng rng = { (seed != 0) ? seed : 1 };   // Note: xorshift must not be seeded with zero
+
+    testInterpolate(rng, outputs.interpolate);
+    testAttenuateAndAccumulate(rng, outputs.attenuateAndAccumulate);
+    testAttenuate(rng, outputs.attenuate);
+    testAddAndAttenuate(rng, outputs.addAndAttenuate);
+    testInterleave(rng, outputs.interleave);
+    testCore(rng, outputs.core);
+}
+
+END_NAMESPACE(KERNEL_TEST_NAMESPACE)
@@ -0,0 +1,10 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the SPU with SIMD disabled and runs the kernel tests against it, to get the reference output for the SIMD code.
+// The SPU namespace is renamed so this copy of the SPU can live alongside the SIMD copy in the same program.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#define SIMPLE_SPU_NO_SIMD 1
+#define Spu SpuScalar
+#include "Spu.cpp"
+
+#define KERNEL_TEST_NAMESPACE SpuScalarKernels
+#include "SpuKernelTestImpl.h"
@@ -0,0 +1,21 @@
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Builds the SPU with SIMD enabled (if supported) and runs the kernel tests against it.
+// The SPU source is compiled directly into this file so the tests can get at the internal mixing functions.
+//------------------------------------------------------------------------------------------------------------------------------------------
+#include "Spu.cpp"
+
+#define KERNEL_TEST_NAMESPACE SpuSimdKernels
+#include "SpuKernelTestImpl.h"
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// Tells what kind of SIMD the SPU was built with, if any
+//------------------------------------------------------------------------------------------------------------------------------------------
+const char* SpuSimdKernels::getSimdType() noexcept {
+    #if SIMPLE_SPU_USE_SSE2
+        return "SSE2";
+    #elif SIMPLE_SPU_USE_NEON
+        return "NEON";
+    #else
+        return "none";
+    #endif
+}